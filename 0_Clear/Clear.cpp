@@ -115,13 +115,15 @@ void Clear::Render()
 
 	m_CurrentBackbufferIndex = Application::GetCurrentBackbufferIndex();
 	auto backbuff = Application::GetBackbuffer(m_CurrentBackbufferIndex);
+	ResourceStateTracker& stateTracker = Application::GetStateTracker();
 
 	auto rtv = Application::GetCurrentBackbufferRTV();
 	auto dsv = m_DsvHeap->GetCPUDescriptorHandleForHeapStart();
 
 	// Clear RT
 	{
-		TransitionResource(cmdList, backbuff, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		TransitionResource(stateTracker, backbuff, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		FlushBarriers(stateTracker, cmdList);
 
 		FLOAT clearColor[] = { 0.4f, 0.9f, 0.6f, 1.0f };
 		ClearRTV(cmdList, rtv, clearColor);
@@ -130,7 +132,8 @@ void Clear::Render()
 
 	// PRESENT image
 	{
-		TransitionResource(cmdList, backbuff, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+		TransitionResource(stateTracker, backbuff, D3D12_RESOURCE_STATE_PRESENT);
+		FlushBarriers(stateTracker, cmdList);
 
 		// Execute
 		m_FenceValues[m_CurrentBackbufferIndex] = cmdQueue->ExecuteCommandList(cmdList);
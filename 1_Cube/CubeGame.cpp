@@ -1,4 +1,5 @@
 #include "CubeGame.h"
+#include "..\DX12FrameWork\Utils\Utils.h"
 
 #include <d3dcompiler.h> // D3DReadFileToBlob
 
@@ -66,58 +67,24 @@ CubeGame::~CubeGame()
 // =====================================================================================
 
 void CubeGame::UpdateBufferResource(
-	ComPtr<ID3D12GraphicsCommandList4> commandList,
 	ID3D12Resource** pDestinationResource,
-	ID3D12Resource** pIntermediateResource,
 	size_t numElements, size_t elementSize, const void* bufferData,
 	D3D12_RESOURCE_FLAGS flags)
 {
-	auto device = Application::GetDevice();
-
-	size_t bufferSize = numElements * elementSize;
-
-	// Create a committed resource for the GPU resource in a default heap.
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(pDestinationResource)));
-
-	// Create a committed resource for the upload.
-	if (bufferData)
-	{
-		ThrowIfFailed(device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(pIntermediateResource)));
-
-		D3D12_SUBRESOURCE_DATA subresourceData = {};
-		subresourceData.pData = bufferData;
-		subresourceData.RowPitch = bufferSize;
-		subresourceData.SlicePitch = subresourceData.RowPitch;
-
-		UpdateSubresources(commandList.Get(),
-			*pDestinationResource, *pIntermediateResource,
-			0, 0, 1, &subresourceData);
-	}
+	// A default heap buffer, the data goes through the staging ring of the copy queue - the copy
+	// is recorded there and runs with the next Submit() of the ring
+	ComPtr<ID3D12Resource> buffer = Application::GetUploadBuffer()->CreateBuffer(bufferData, numElements * elementSize, flags);
+	*pDestinationResource = buffer.Detach();
 }
 
 
 bool CubeGame::LoadContent(std::wstring shaderBlobPath)
 {
 	auto device = Application::GetDevice();
-	auto commandQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-	auto commandList = commandQueue->GetCommandList();
+	auto uploadBuffer = Application::GetUploadBuffer();
 
 	// Upload vertex buffer data.
-	ComPtr<ID3D12Resource> intermediateVertexBuffer;
-	UpdateBufferResource(commandList,
-		&m_VertexBuffer, &intermediateVertexBuffer,
+	UpdateBufferResource(&m_VertexBuffer,
 		_countof(g_Vertices), sizeof(VertexPosColor), g_Vertices);
 
 	// Create the vertex buffer view.
@@ -126,9 +93,7 @@ bool CubeGame::LoadContent(std::wstring shaderBlobPath)
 	m_VertexBufferView.StrideInBytes = sizeof(VertexPosColor);
 
 	// Upload index buffer data.
-	ComPtr<ID3D12Resource> intermediateIndexBuffer;
-	UpdateBufferResource(commandList,
-		&m_IndexBuffer, &intermediateIndexBuffer,
+	UpdateBufferResource(&m_IndexBuffer,
 		_countof(g_Indicies), sizeof(WORD), g_Indicies);
 
 	// Create index buffer view.
@@ -219,8 +184,9 @@ bool CubeGame::LoadContent(std::wstring shaderBlobPath)
 	};
 	ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
 
-	auto fenceValue = commandQueue->ExecuteCommandList(commandList);
-	commandQueue->WaitForFenceValue(fenceValue);
+	// One submit for both buffers
+	auto fenceValue = uploadBuffer->Submit();
+	uploadBuffer->GetCommandQueue()->WaitForFenceValue(fenceValue);
 
 	m_ContentLoaded = true;
 
@@ -297,13 +263,15 @@ void CubeGame::Render()
 	
 	m_CurrentBackBufferIndex = Application::GetCurrentBackbufferIndex();
 	auto backBuffer = Application::GetBackbuffer(m_CurrentBackBufferIndex);
+	ResourceStateTracker& stateTracker = Application::GetStateTracker();
 
 	auto rtv = Application::GetCurrentBackbufferRTV();
 	auto dsv = m_DsvHeap->GetCPUDescriptorHandleForHeapStart();
 
 	// Clear RT
 	{
-		TransitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		TransitionResource(stateTracker, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		FlushBarriers(stateTracker, commandList);
 
 		FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
 		ClearRTV(commandList, rtv, clearColor);
@@ -337,7 +305,8 @@ void CubeGame::Render()
 		//     to the screen.
 		// !!! Before presenting, the back buffer resource must be 
 		//     transitioned to the PRESENT state.
-		TransitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+		TransitionResource(stateTracker, backBuffer, D3D12_RESOURCE_STATE_PRESENT);
+		FlushBarriers(stateTracker, commandList);
 
 		// Execute
 		m_FenceValues[m_CurrentBackBufferIndex] = commandQueue->ExecuteCommandList(commandList);
@@ -415,17 +384,6 @@ void CubeGame::ResizeDepthBuffer(int width, int height)
 //									Helper Funcs
 // =====================================================================================
 
-void CubeGame::TransitionResource(ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource> resource,
-	D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
-{
-	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition
-	(
-		resource.Get(), before, after
-	);
-
-	commandList->ResourceBarrier(1, &barrier);
-}
-
 void CubeGame::ClearRTV(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList,
 	D3D12_CPU_DESCRIPTOR_HANDLE rtv, FLOAT* clearColor)
 {
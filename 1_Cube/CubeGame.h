@@ -22,17 +22,14 @@ public:
 	void UnloadContent();
 
 protected:
-	// Create a GPU buffer.
-	void UpdateBufferResource(ComPtr<ID3D12GraphicsCommandList4> commandList,
-		ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource,
+	// Create a GPU buffer, uploaded with the next Submit() of the upload ring.
+	void UpdateBufferResource(ID3D12Resource** pDestinationResource,
 		size_t numElements, size_t elementSize, const void* bufferData,
 		D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
 	// Resize the depth buffer to match the size of the client area.
 	void ResizeDepthBuffer(int width, int height);
 
 	// Helpers
-	void TransitionResource(ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource> resource,
-		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
 	void ClearRTV(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList,
 		D3D12_CPU_DESCRIPTOR_HANDLE rtv, FLOAT* clearColor);
 	void ClearDepth(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList,
@@ -3,13 +3,20 @@
 #include <fbxsdk.h>
 #include <assert.h>
 
+#include <random>
+#include <string>
 #include <vector>
-#include <set>
 //#include <cmath>
 
 #include <DirectXMath.h>
 using namespace DirectX;
 
+#include "..\..\DX12FrameWork\MeshTools\Meshlet.h"
+#include "..\..\DX12FrameWork\MeshTools\Simplify.h"
+#include "..\..\DX12FrameWork\MeshTools\VertexQuantization.h"
+#include "..\..\DX12FrameWork\MeshTools\VertexWelder.h"
+#include "..\..\DX12FrameWork\Utils\ThreadPool.h"
+
 #define USE_OPTIMIZAED_INDICES
 
 // Vertex data for a colored cube.
@@ -20,29 +27,213 @@ struct VertexPosColor
 	XMFLOAT3 Normal;
 	XMFLOAT2 UV;
 };
-typedef std::pair<VertexPosColor, uint16_t> viPair;
 
-// Class comparator for vertices in the set
-struct CmpClass 
+// One mesh node of the FBX scene - a range of the shared vertex/index arena of MeshData
+struct Submesh
 {
-	const float EPS = 0.0; //0.001;
+	std::string name;
+	// Global transform of the node (row vectors, multiplies like an XMMATRIX model matrix)
+	XMFLOAT4X4 world;
+	// Indices are relative to baseVertex (the BaseVertexLocation of the draw)
+	uint32_t baseVertex = 0;
+	uint32_t vertexCount = 0;
+	// Offset into MeshData::indexData, a multiple of 4 bytes
+	uint32_t indexByteOffset = 0;
+	uint32_t indexCount = 0;
+	// 16-bit indices unless the submesh has more than 65536 vertices
+	bool use32BitIndices = false;
+	// Range of MeshData::meshlets, built from the submesh's index run (empty until cooked)
+	uint32_t firstMeshlet = 0;
+	uint32_t meshletCount = 0;
+	// Unorm16 positions in the vertex buffer are relative to these (identity for float positions)
+	MeshTools::QuantizationBounds positionBounds;
+	// Range of MeshData::lods, coarser index runs of the same vertices (empty until cooked)
+	uint32_t firstLod = 0;
+	uint32_t lodCount = 0;
+	// Bounding sphere in the submesh's space, for the LOD distance
+	XMFLOAT3 boundsCenter = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	float boundsRadius = 0.0f;
+
+	uint32_t GetIndexSize() const { return use32BitIndices ? 4 : 2; }
+	// StartIndexLocation when the index buffer view starts at indexData[0]
+	uint32_t GetStartIndex() const { return indexByteOffset / GetIndexSize(); }
+};
 
-	bool operator() (const viPair& p1, const viPair& p2) const
-	{
-		if (fabs(p1.first.Position.x - p2.first.Position.x) > EPS) return p1.first.Position.x < p2.first.Position.x;
-		if (fabs(p1.first.Position.y - p2.first.Position.y) > EPS) return p1.first.Position.y < p2.first.Position.y;
-		if (fabs(p1.first.Position.z - p2.first.Position.z) > EPS) return p1.first.Position.z < p2.first.Position.z;
-		return false;
-	}
+// All meshes of a scene in one vertex and one index buffer
+struct MeshData
+{
+	std::vector<VertexPosColor> vertices;
+	// Runs of 16- or 32-bit indices, one per submesh
+	std::vector<uint8_t> indexData;
+	std::vector<Submesh> submeshes;
+	MeshTools::MeshletData meshlets;
+	// LOD levels of all submeshes, their index runs are part of indexData
+	std::vector<MeshTools::MeshLod> lods;
+
+	void Clear() { vertices.clear(); indexData.clear(); submeshes.clear(); meshlets.Clear(); lods.clear(); }
 };
-std::set<viPair, CmpClass> setVertInd;
 
 
 FbxManager* g_pFbxSdkManager = nullptr;
 
 
-// Loads the FBX file and retrives vertices and indices - loading is too slow (TODO)
-bool LoadFBX(const char * fbxFilePath, std::vector<VertexPosColor> * pOutVertices, std::vector<uint16_t> * pOutIndices)
+// A mesh node found in the scene, converted by one task
+struct FbxMeshTask
+{
+	FbxNode* pNode;
+	FbxMesh* pMesh;
+	XMFLOAT4X4 world;
+
+	// Output of the task: welded vertices (no colors yet) and indices local to the mesh
+	std::vector<VertexPosColor> vertices;
+	std::vector<uint32_t> indices;
+};
+
+// Depth-first walk over the node hierarchy, a task per mesh attribute.
+// The node transforms are evaluated here, on one thread - the FBX evaluator caches results.
+void CollectFbxMeshes(FbxNode* pNode, std::vector<FbxMeshTask>* pOutTasks)
+{
+	if (pNode == nullptr)
+		return;
+
+	for (int a = 0; a < pNode->GetNodeAttributeCount(); a++)
+	{
+		FbxNodeAttribute* pAttribute = pNode->GetNodeAttributeByIndex(a);
+		if (pAttribute == nullptr || pAttribute->GetAttributeType() != FbxNodeAttribute::eMesh)
+			continue;
+
+		FbxMeshTask task;
+		task.pNode = pNode;
+		task.pMesh = (FbxMesh*)pAttribute;
+		if (task.pMesh->GetPolygonCount() == 0)
+			continue;
+
+		// Global transform with the geometric (pivot) offset of the node
+		FbxAMatrix geometricOffset(pNode->GetGeometricTranslation(FbxNode::eSourcePivot),
+			pNode->GetGeometricRotation(FbxNode::eSourcePivot), pNode->GetGeometricScaling(FbxNode::eSourcePivot));
+		FbxAMatrix world = pNode->EvaluateGlobalTransform() * geometricOffset;
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				task.world.m[r][c] = (float)world.Get(r, c);
+
+		pOutTasks->push_back(std::move(task));
+	}
+
+	for (int i = 0; i < pNode->GetChildCount(); i++)
+		CollectFbxMeshes(pNode->GetChild(i), pOutTasks);
+}
+
+// Converts one triangulated FbxMesh into welded vertices + indices.
+// Only reads the mesh, so tasks of different meshes run concurrently.
+void ExtractFbxMesh(FbxMeshTask* pTask, MeshTools::VertexWelder<VertexPosColor>* pWelder)
+{
+	FbxMesh* pMesh = pTask->pMesh;
+	FbxVector4* pVertices = pMesh->GetControlPoints();
+	// Triangulated: corner k of polygon j is at 3 * j + k
+	const int* pPolygonVertices = pMesh->GetPolygonVertices();
+
+	bool hasNormal = pMesh->GetElementNormalCount() > 0;
+	bool hasUV = pMesh->GetElementUVCount() > 0;
+	bool lUnmappedUV;
+	FbxStringList lUVNames;
+	pMesh->GetUVSetNames(lUVNames);
+	const char * lUVName = NULL;
+	if (hasUV && lUVNames.GetCount())
+	{
+		lUVName = lUVNames[0];
+	}
+
+	const int polygonCount = pMesh->GetPolygonCount();
+	pTask->indices.reserve(polygonCount * 3);
+#ifdef USE_OPTIMIZAED_INDICES
+	pWelder->Reset(polygonCount * 3);
+#else
+	pTask->vertices.reserve(polygonCount * 3);
+#endif
+
+	for (int j = 0; j < polygonCount; j++)
+	{
+		assert(pMesh->GetPolygonSize(j) == 3);
+
+		for (int k = 0; k < 3; k++) {
+			int iControlPointIndex = pPolygonVertices[j * 3 + k];
+
+			// Zero-initialized: missing attributes must compare equal when welding
+			VertexPosColor vertex = {};
+			vertex.Position.x = (float)pVertices[iControlPointIndex].mData[0];
+			vertex.Position.y = (float)pVertices[iControlPointIndex].mData[1];
+			vertex.Position.z = (float)pVertices[iControlPointIndex].mData[2];
+
+			if (hasNormal) {
+				FbxVector4 lCurrentNormal;
+				pMesh->GetPolygonVertexNormal(j, k, lCurrentNormal);
+				vertex.Normal.x = static_cast<float>(lCurrentNormal[0]);
+				vertex.Normal.y = static_cast<float>(lCurrentNormal[1]);
+				vertex.Normal.z = static_cast<float>(lCurrentNormal[2]);
+			}
+
+			if (hasUV)
+			{
+				FbxVector2 lCurrentUV;
+				pMesh->GetPolygonVertexUV(j, k, lUVName, lCurrentUV, lUnmappedUV);
+				vertex.UV.x = static_cast<float>(lCurrentUV[0]);
+				vertex.UV.y = static_cast<float>(lCurrentUV[1]);
+			}
+
+#ifdef USE_OPTIMIZAED_INDICES
+			pTask->indices.push_back(pWelder->Insert(vertex));
+#else 
+			pTask->indices.push_back((uint32_t)pTask->vertices.size());
+			pTask->vertices.push_back(vertex);
+#endif
+		}
+	}
+
+#ifdef USE_OPTIMIZAED_INDICES
+	// The welder hands out indices in insertion order - its vertices are the mesh's vertices
+	pTask->vertices = pWelder->GetVertices();
+#endif
+}
+
+// Copies the output of a task into its region of the arena and frees it.
+// Regions are disjoint, so tasks are scattered concurrently.
+void ScatterFbxMesh(FbxMeshTask* pTask, const Submesh& submesh, uint32_t seed, MeshData* pOutMesh)
+{
+	// Debug colors per unique vertex, reproducible between runs
+	std::minstd_rand random(seed + 1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	VertexPosColor* pDstVertices = &pOutMesh->vertices[submesh.baseVertex];
+	for (uint32_t i = 0; i < submesh.vertexCount; i++)
+	{
+		pDstVertices[i] = pTask->vertices[i];
+		pDstVertices[i].Color.x = unit(random);
+		pDstVertices[i].Color.y = unit(random);
+		pDstVertices[i].Color.z = unit(random);
+	}
+
+	uint8_t* pDst = &pOutMesh->indexData[submesh.indexByteOffset];
+	if (submesh.use32BitIndices)
+	{
+		memcpy(pDst, pTask->indices.data(), submesh.indexCount * sizeof(uint32_t));
+	}
+	else
+	{
+		uint16_t* pDst16 = reinterpret_cast<uint16_t*>(pDst);
+		for (uint32_t i = 0; i < submesh.indexCount; i++)
+			pDst16[i] = (uint16_t)pTask->indices[i];
+	}
+
+	std::vector<VertexPosColor>().swap(pTask->vertices);
+	std::vector<uint32_t>().swap(pTask->indices);
+}
+
+
+// Loads every mesh of the FBX file (the whole node hierarchy) into one MeshData, a Submesh per mesh node.
+// Corners are welded on all their attributes (position, normal, UV) with a hash table
+// that lives for one mesh only; the debug colors are assigned per unique vertex afterwards.
+// Mesh nodes are converted in parallel on pPool (nullptr - ThreadPool::GetDefault()).
+bool LoadFBX(const char * fbxFilePath, MeshData * pOutMesh, ThreadPool * pPool = nullptr)
 {
 	if (g_pFbxSdkManager == nullptr)
 	{
@@ -86,105 +277,48 @@ bool LoadFBX(const char * fbxFilePath, std::vector<VertexPosColor> * pOutVertice
 	FbxGeometryConverter lGeomConverter(g_pFbxSdkManager);
 	lGeomConverter.Triangulate(pFbxScene, /*replace*/true);
 
-	// ----------------------------- Getting Mesh
-	FbxNode* pFbxRootNode = pFbxScene->GetRootNode();
-	uint16_t index = 0;
-
-	if (pFbxRootNode)
-	{
-		// TODO: 
-		//		Temproray set child count to 1, need to add support for per child meshes
-		//int childCount = pFbxRootNode->GetChildCount();
-		int childCount = pFbxRootNode->GetChildCount() > 0 ? 1 : 0;
-
-		for (uint16_t i = 0; i < childCount; i++)
-		{
-			FbxNode* pFbxChildNode = pFbxRootNode->GetChild(i);
-
-			if (pFbxChildNode->GetNodeAttribute() == NULL)
-				continue;
-
-			FbxNodeAttribute::EType AttributeType = pFbxChildNode->GetNodeAttribute()->GetAttributeType();
-
-			if (AttributeType != FbxNodeAttribute::eMesh)
-				continue;
+	// ----------------------------- Getting Meshes
+	// The scene is read once; every mesh node is then converted (and welded) by its own task
+	pOutMesh->Clear();
 
-			FbxMesh* pMesh = (FbxMesh*)pFbxChildNode->GetNodeAttribute();
+	std::vector<FbxMeshTask> tasks;
+	CollectFbxMeshes(pFbxScene->GetRootNode(), &tasks);
 
-			FbxVector4* pVertices = pMesh->GetControlPoints();
-
-			bool hasNormal = pMesh->GetElementNormalCount() > 0;
-			bool hasUV = pMesh->GetElementUVCount() > 0;
-			bool lUnmappedUV;
-			FbxStringList lUVNames;
-			pMesh->GetUVSetNames(lUVNames);
-			const char * lUVName = NULL;
-			if (hasUV && lUVNames.GetCount())
-			{
-				lUVName = lUVNames[0];
-			}
-
-			for (uint16_t j = 0; j < pMesh->GetPolygonCount(); j++)
-			{
-				uint16_t iNumVertices = pMesh->GetPolygonSize(j);
-				assert(iNumVertices == 3);
-
-				for (int k = 0; k < iNumVertices; k++) {
-					int iControlPointIndex = pMesh->GetPolygonVertex(j, k);
-
-					VertexPosColor vertex;
-					vertex.Position.x = (float)pVertices[iControlPointIndex].mData[0];
-					vertex.Position.y = (float)pVertices[iControlPointIndex].mData[1];
-					vertex.Position.z = (float)pVertices[iControlPointIndex].mData[2];
-
-					vertex.Color.x = rand() / float(RAND_MAX);
-					vertex.Color.y = rand() / float(RAND_MAX);
-					vertex.Color.z = rand() / float(RAND_MAX);
-
-					if (hasNormal) {
-						FbxVector4 lCurrentNormal;
-						pMesh->GetPolygonVertexNormal(j, k, lCurrentNormal);
-						vertex.Normal.x = static_cast<float>(lCurrentNormal[0]);
-						vertex.Normal.y = static_cast<float>(lCurrentNormal[1]);
-						vertex.Normal.z = static_cast<float>(lCurrentNormal[2]);
-					}
-
-					if (hasUV)
-					{
-						FbxVector2 lCurrentUV;
-						pMesh->GetPolygonVertexUV(j, k, lUVName, lCurrentUV, lUnmappedUV);
-						vertex.UV.x = static_cast<float>(lCurrentUV[0]);
-						vertex.UV.y = static_cast<float>(lCurrentUV[1]);
-					}
-
-#ifdef USE_OPTIMIZAED_INDICES
-					std::set<viPair>::iterator it = setVertInd.find(std::make_pair(vertex, 0/*this value doesn't matter*/));
-					if (it != setVertInd.end()) pOutIndices->push_back(it->second);
-					else
-					{
-						setVertInd.insert(std::make_pair(vertex, index));
-						pOutIndices->push_back(index++);
-					}
-#else 
-					pOutVertices->push_back(vertex);
-					pOutIndices->push_back(index++);
-#endif
-				}
-			}
-		}
+	ThreadPool& pool = pPool ? *pPool : ThreadPool::GetDefault();
+	std::vector<MeshTools::VertexWelder<VertexPosColor>> welders(pool.GetThreadCount());
+	ParallelForWorkStealing(pool, (uint32_t)tasks.size(), [&](uint32_t taskIndex, uint32_t workerIndex)
+	{
+		ExtractFbxMesh(&tasks[taskIndex], &welders[workerIndex]);
+	});
+	welders.clear();
+
+	// Regions of the arena - every index run starts 4-byte aligned, so both index formats
+	// can address it from one buffer view
+	size_t vertexCount = 0, indexDataSize = 0;
+	for (FbxMeshTask& task : tasks)
+	{
+		Submesh submesh;
+		submesh.name = task.pNode->GetName();
+		submesh.world = task.world;
+		submesh.baseVertex = (uint32_t)vertexCount;
+		submesh.vertexCount = (uint32_t)task.vertices.size();
+		submesh.indexByteOffset = (uint32_t)indexDataSize;
+		submesh.indexCount = (uint32_t)task.indices.size();
+		submesh.use32BitIndices = submesh.vertexCount > 0x10000;
+
+		vertexCount += submesh.vertexCount;
+		indexDataSize += ((size_t)submesh.indexCount * submesh.GetIndexSize() + 3) & ~(size_t)3;
+		pOutMesh->submeshes.push_back(submesh);
+	}
 
-#ifdef USE_OPTIMIZAED_INDICES
-		// Notice that the vertices in the set are not sorted by the index
-		// so you'll have to rearrange them like this:
-		pOutVertices->resize(setVertInd.size());
-		for (std::set<viPair>::iterator it = setVertInd.begin(); it != setVertInd.end(); it++) {
-			VertexPosColor v = it->first;
-			uint16_t i = it->second;
-
-			pOutVertices->at(i) = v;
-		}
-#endif 
+	pOutMesh->vertices.resize(vertexCount);
+	pOutMesh->indexData.resize(indexDataSize, 0);
+	ParallelFor(pool, 0, (uint32_t)tasks.size(), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+			ScatterFbxMesh(&tasks[i], pOutMesh->submeshes[i], i, pOutMesh);
+	});
 
-	}
+	pFbxScene->Destroy();
 	return true;
-}
\ No newline at end of file
+}
@@ -1,12 +1,23 @@
 #include <d3dcompiler.h> // D3DReadFileToBlob
 
 #include "..\DX12FrameWork\Utils\Utils.h"
+#include "..\DX12FrameWork\MeshTools\CookedMesh.h"
+#include "..\DX12FrameWork\MeshTools\Meshlet.h"
+#include "..\DX12FrameWork\MeshTools\ObjLoader.h"
+#include "..\DX12FrameWork\MeshTools\Overdraw.h"
+#include "..\DX12FrameWork\MeshTools\Simplify.h"
+#include "..\DX12FrameWork\MeshTools\VertexCache.h"
+#include "..\DX12FrameWork\MeshTools\VertexFetch.h"
+#include "..\DX12FrameWork\MeshTools\VertexQuantization.h"
 
 #include "Mesh.h"
 #include "FbxLoader/FbxHierarchyVisualizer.h"
 #include "FbxLoader/FbxLoader1.h"
 
-#include <set>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <functional>
 #include <iostream>
 
 using namespace DirectX;
@@ -14,113 +25,483 @@ using namespace DirectX;
 // ==============================================================================
 //								Global Vars 
 // ==============================================================================
-#define USE_FP32_NORMAL
-#define USE_FP32_UV
-
-std::vector<VertexPosColor> vertices;
-std::vector<uint16_t> indicies;
+// Vertex buffer format (VertexQuantization.h) - packed unless defined: 16-bit positions relative to
+// the submesh bounds, RGBA8 colors, octahedral normals, half uvs (20 instead of 44 bytes a vertex).
+// The cooked cache stores the format, a cache of another one is re-cooked.
+//#define USE_FP32_POSITION
+//#define USE_FP32_COLOR
+//#define USE_FP32_NORMAL
+//#define USE_FP32_UV
+// Cook-time overdraw ordering of the meshlets (costs a few % vertex cache efficiency).
+// Delete the .cooked files after toggling.
+#define OPTIMIZE_OVERDRAW
+// Per-frame CPU culling of the meshlets (frustum + normal cone); the visible ones are drawn as
+// index ranges. The culled-triangle ratio goes to the debugger output once per second.
+#define CULL_MESHLETS
+// Per-frame LOD selection: the coarsest cooked level (50/25/12.5% of the triangles) whose error
+// projects to at most kLodPixelError pixels. Meshlet culling only applies to the full level.
+#define USE_LODS
+static const float kLodPixelError = 1.0f;
+
+MeshData meshData;
 
 // ==============================================================================
-//									Init 
+//								Mesh Import 
 // ==============================================================================
-Mesh::Mesh(HINSTANCE hInstance, const wchar_t * wndTitle, int width, int height, bool vSync) :
-	Application(hInstance, wndTitle, width, height, vSync),
-	m_ScissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX)),
-	m_Viewport(CD3DX12_VIEWPORT(0.0f, 0.0f, (float)width, (float)height)),
-	m_FOV(45.0f)
+
+static_assert(sizeof(VertexPosColor) == sizeof(MeshTools::MeshVertex), "The OBJ loader output is uploaded as VertexPosColor");
+
+// OBJ files go through the native MeshTools importer, no FBX SDK involved
+static bool LoadOBJ(const char* objFilePath, MeshData* pOutMesh, ThreadPool* pPool = nullptr)
 {
-	// The first back buffer index will very likely be 0, but it depends
-	m_CurrentBackbufferIndex = Application::GetCurrentBackbufferIndex(); 
+	MeshTools::IndexedMesh mesh;
+	std::string error;
+	if (!MeshTools::LoadObj(objFilePath, &mesh, pPool ? pPool : &ThreadPool::GetDefault(), nullptr, &error))
+	{
+		OutputDebugStringA((error + "\n").c_str());
+		return false;
+	}
+
+	pOutMesh->Clear();
+	pOutMesh->vertices.resize(mesh.vertices.size());
+	memcpy(pOutMesh->vertices.data(), mesh.vertices.data(), mesh.vertices.size() * sizeof(VertexPosColor));
+	pOutMesh->indexData.swap(mesh.indexData);
+
+	for (size_t p = 0; p < mesh.parts.size(); p++)
+	{
+		const MeshTools::MeshPart& part = mesh.parts[p];
+		Submesh submesh;
+		submesh.name = part.name;
+		XMStoreFloat4x4(&submesh.world, XMMatrixIdentity());
+		submesh.baseVertex = part.baseVertex;
+		submesh.vertexCount = part.vertexCount;
+		submesh.indexByteOffset = part.indexByteOffset;
+		submesh.indexCount = part.indexCount;
+		submesh.use32BitIndices = part.indexSize == 4;
+		pOutMesh->submeshes.push_back(submesh);
+
+		// Debug colors like LoadFBX - the OBJ loader leaves them 0
+		std::minstd_rand random((uint32_t)p + 1);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		for (uint32_t i = 0; i < part.vertexCount; i++)
+		{
+			XMFLOAT3& color = pOutMesh->vertices[part.baseVertex + i].Color;
+			color.x = unit(random);
+			color.y = unit(random);
+			color.z = unit(random);
+		}
+	}
+	return true;
 }
-Mesh::~Mesh()
+
+// Picks the importer by the file extension: ".obj" - LoadOBJ, anything else - LoadFBX
+static bool ImportMesh(const std::string& filePath, MeshData* pOutMesh, ThreadPool* pPool = nullptr)
 {
+	const size_t dot = filePath.find_last_of('.');
+	std::string extension = dot == std::string::npos ? "" : filePath.substr(dot + 1);
+	for (char& c : extension)
+		c = (char)tolower((unsigned char)c);
+
+	if (extension == "obj")
+		return LoadOBJ(filePath.c_str(), pOutMesh, pPool);
+	return LoadFBX(filePath.c_str(), pOutMesh, pPool);
+}
+
+// ==============================================================================
+//								Cooked Mesh Cache 
+// ==============================================================================
 
+static MeshTools::VertexFormat GetVertexFormat()
+{
+	MeshTools::VertexFormat format = MeshTools::VertexFormat::Packed();
+#ifdef USE_FP32_POSITION
+	format.position = MeshTools::PositionFormat::Float32;
+#endif
+#ifdef USE_FP32_COLOR
+	format.color = MeshTools::ColorFormat::Float32;
+#endif
+#ifdef USE_FP32_NORMAL
+	format.normal = MeshTools::NormalFormat::Float32;
+#endif
+#ifdef USE_FP32_UV
+	format.uv = MeshTools::UvFormat::Float32;
+#endif
+	return format;
 }
+static const MeshTools::VertexFormat kVertexFormat = GetVertexFormat();
 
-// =====================================================================================
-//						      LoadContent & UnloadContent
-// =====================================================================================
+// The cache sits next to the source: "<name>.fbx.cooked", "<name>.obj.cooked"
+static std::string GetCookedPath(const std::string& sourceFilePath)
+{
+	return sourceFilePath + ".cooked";
+}
 
-void Mesh::UpdateBufferResource(
-	ComPtr<ID3D12GraphicsCommandList4> commandList,
-	ID3D12Resource** pDestinationResource,
-	ID3D12Resource** pIntermediateResource,
-	size_t numElements, size_t elementSize, const void* bufferData,
-	D3D12_RESOURCE_FLAGS flags)
+// Stats of the simulated GPU caches of a mesh, summed over the submeshes
+struct MeshCacheStats
 {
-	auto device = Application::GetDevice();
+	MeshTools::VertexCacheStats vertexCache;
+	MeshTools::OverdrawStats overdraw;
+	MeshTools::VertexFetchStats vertexFetch;
 
-	size_t bufferSize = numElements * elementSize;
+	void Add(const MeshCacheStats& other)
+	{
+		vertexCache.Add(other.vertexCache);
+		overdraw.Add(other.overdraw);
+		vertexFetch.Add(other.vertexFetch);
+	}
+};
 
-	// Create a committed resource for the GPU resource in a default heap.
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(pDestinationResource)));
+static MeshCacheStats AnalyzeSubmesh(const MeshData& mesh, const Submesh& submesh)
+{
+	const uint8_t* pIndices = &mesh.indexData[submesh.indexByteOffset];
+	MeshCacheStats stats;
+	stats.vertexCache = MeshTools::AnalyzeVertexCache(pIndices, submesh.GetIndexSize(), submesh.indexCount, submesh.vertexCount);
+	stats.overdraw = MeshTools::AnalyzeOverdraw(pIndices, submesh.GetIndexSize(), submesh.indexCount,
+		&mesh.vertices[submesh.baseVertex].Position.x, sizeof(VertexPosColor), submesh.vertexCount);
+	stats.vertexFetch = MeshTools::AnalyzeVertexFetch(pIndices, submesh.GetIndexSize(), submesh.indexCount,
+		submesh.vertexCount, sizeof(VertexPosColor));
+	return stats;
+}
 
-	// Create a committed resource for the upload.
-	if (bufferData)
+// Reorders every submesh for the GPU (FBX/OBJ polygon order is far from it): triangles for the
+// post-transform vertex cache, then into compact meshlets (optionally sorted against overdraw), and
+// last the vertices into first-use order for fetch locality. Returns the simulated stats before and after.
+static void OptimizeMesh(MeshData* pMesh, MeshCacheStats* pBefore, MeshCacheStats* pAfter)
+{
+	std::vector<MeshCacheStats> before(pMesh->submeshes.size()), after(pMesh->submeshes.size());
+	ParallelForWorkStealing(ThreadPool::GetDefault(), (uint32_t)pMesh->submeshes.size(), [&](uint32_t i, uint32_t)
 	{
-		ThrowIfFailed(device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(pIntermediateResource)));
-
-		D3D12_SUBRESOURCE_DATA subresourceData = {};
-		subresourceData.pData = bufferData;
-		subresourceData.RowPitch = bufferSize;
-		subresourceData.SlicePitch = subresourceData.RowPitch;
-
-		UpdateSubresources(commandList.Get(),
-			*pDestinationResource, *pIntermediateResource,
-			0, 0, 1, &subresourceData);
+		const Submesh& submesh = pMesh->submeshes[i];
+		if (submesh.vertexCount == 0)
+			return;
+
+		uint8_t* pIndices = &pMesh->indexData[submesh.indexByteOffset];
+		VertexPosColor* pVertices = &pMesh->vertices[submesh.baseVertex];
+
+		before[i] = AnalyzeSubmesh(*pMesh, submesh);
+		MeshTools::OptimizeVertexCache(pIndices, submesh.GetIndexSize(), submesh.indexCount, submesh.vertexCount);
+#ifdef OPTIMIZE_OVERDRAW
+		const bool sortForOverdraw = true;
+#else
+		const bool sortForOverdraw = false;
+#endif
+		MeshTools::OptimizeMeshletOrder(pIndices, submesh.GetIndexSize(), submesh.indexCount,
+			&pVertices->Position.x, sizeof(VertexPosColor), submesh.vertexCount, sortForOverdraw);
+		MeshTools::OptimizeVertexFetch(pVertices, submesh.vertexCount, sizeof(VertexPosColor),
+			pIndices, submesh.GetIndexSize(), submesh.indexCount);
+		after[i] = AnalyzeSubmesh(*pMesh, submesh);
+	});
+
+	*pBefore = MeshCacheStats();
+	*pAfter = MeshCacheStats();
+	for (size_t i = 0; i < before.size(); i++)
+	{
+		pBefore->Add(before[i]);
+		pAfter->Add(after[i]);
 	}
 }
 
+// Simplified levels of every submesh (Simplify.h), built from the optimized index runs and appended
+// to the index data in the submesh's index size. The errors stop at 5% of the submesh's radius -
+// beyond that a level would only be picked for a few pixels on screen anyway.
+static void BuildLods(MeshData* pMesh)
+{
+	const float kMaxRelativeError = 0.05f;
+	std::vector<std::vector<MeshTools::LodLevel>> levels(pMesh->submeshes.size());
+	ParallelForWorkStealing(ThreadPool::GetDefault(), (uint32_t)pMesh->submeshes.size(), [&](uint32_t i, uint32_t)
+	{
+		Submesh& submesh = pMesh->submeshes[i];
+		if (submesh.vertexCount == 0)
+			return;
+
+		const float* pPositions = &pMesh->vertices[submesh.baseVertex].Position.x;
+		MeshTools::ComputeBoundingSphere(pPositions, sizeof(VertexPosColor), submesh.vertexCount, &submesh.boundsCenter.x, &submesh.boundsRadius);
+		MeshTools::BuildLodChain(&pMesh->indexData[submesh.indexByteOffset], submesh.GetIndexSize(), submesh.indexCount,
+			pPositions, sizeof(VertexPosColor), submesh.vertexCount, MeshTools::kDefaultLodRatios, _countof(MeshTools::kDefaultLodRatios),
+			submesh.boundsRadius * kMaxRelativeError, &levels[i]);
+	});
+
+	pMesh->lods.clear();
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		Submesh& submesh = pMesh->submeshes[i];
+		submesh.firstLod = (uint32_t)pMesh->lods.size();
+		submesh.lodCount = (uint32_t)levels[i].size();
+		for (const MeshTools::LodLevel& level : levels[i])
+		{
+			MeshTools::MeshLod lod = {};
+			lod.indexByteOffset = (uint32_t)pMesh->indexData.size();
+			lod.indexCount = (uint32_t)level.indices.size();
+			lod.error = level.error;
+			pMesh->indexData.resize(pMesh->indexData.size() + MeshTools::GetIndexRunSize(lod.indexCount, submesh.GetIndexSize()));
+			MeshTools::WriteIndexRun(level.indices, submesh.GetIndexSize(), &pMesh->indexData[lod.indexByteOffset]);
+			pMesh->lods.push_back(lod);
+		}
+	}
+}
 
-bool Mesh::LoadContent(std::wstring shaderBlobPath, std::string fbxFilePath)
+// Encodes the vertices in kVertexFormat, submesh by submesh - Unorm16 positions relative to the
+// bounds of their submesh (written to Submesh::positionBounds). pError: decoded vs. original, optional.
+static void PackVertices(MeshData* pMesh, std::vector<uint8_t>* pOut, MeshTools::QuantizationError* pError = nullptr)
 {
-	auto device = Application::GetDevice();
-	auto commandQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-	auto commandList = commandQueue->GetCommandList();
+	const uint32_t stride = kVertexFormat.GetStride();
+	pOut->resize(pMesh->vertices.size() * stride);
 
+	std::vector<MeshTools::QuantizationError> errors(pMesh->submeshes.size());
+	ParallelForWorkStealing(ThreadPool::GetDefault(), (uint32_t)pMesh->submeshes.size(), [&](uint32_t i, uint32_t)
+	{
+		Submesh& submesh = pMesh->submeshes[i];
+		const MeshTools::MeshVertex* pVertices = reinterpret_cast<const MeshTools::MeshVertex*>(&pMesh->vertices[submesh.baseVertex]);
+		uint8_t* pPacked = &(*pOut)[(size_t)submesh.baseVertex * stride];
 
-	LoadFBX(fbxFilePath.c_str(), &vertices, &indicies);
+		submesh.positionBounds = kVertexFormat.position == MeshTools::PositionFormat::Unorm16
+			? MeshTools::ComputeQuantizationBounds(pVertices, submesh.vertexCount) : MeshTools::QuantizationBounds();
+		MeshTools::EncodeVertices(pVertices, submesh.vertexCount, kVertexFormat, submesh.positionBounds, pPacked);
 
-	// Vertex buffer
-	ComPtr<ID3D12Resource> intermediateVertexBuffer;
+		if (pError)
+		{
+			std::vector<MeshTools::MeshVertex> decoded(submesh.vertexCount);
+			MeshTools::DecodeVertices(pPacked, submesh.vertexCount, kVertexFormat, submesh.positionBounds, decoded.data());
+			errors[i] = MeshTools::MeasureQuantizationError(pVertices, decoded.data(), submesh.vertexCount);
+		}
+	});
+
+	if (pError)
 	{
-		// Upload vertex buffer data.
-		UpdateBufferResource(commandList,
-			&m_VertexBuffer, &intermediateVertexBuffer,
-			vertices.size(), sizeof(VertexPosColor), &vertices[0]);
+		*pError = MeshTools::QuantizationError();
+		for (const MeshTools::QuantizationError& error : errors)
+			pError->Add(error);
+	}
+}
 
-		// Create the vertex buffer view.
-		m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
-		m_VertexBufferView.SizeInBytes = (UINT) vertices.size() * sizeof(vertices[0]);
-		m_VertexBufferView.StrideInBytes = sizeof(VertexPosColor);
+// Imports the FBX or OBJ file into pOutMesh, optimizes it and writes it to the cooked cache
+static bool CookMesh(const std::string& sourceFilePath, uint64_t sourceHash, MeshData* pOutMesh)
+{
+	if (!ImportMesh(sourceFilePath, pOutMesh))
+		return false;
+
+	MeshCacheStats before, after;
+	OptimizeMesh(pOutMesh, &before, &after);
+
+	char line[1024];
+	snprintf(line, sizeof(line),
+		"%s:\n"
+		"    vertex cache (FIFO 32): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n"
+		"    overdraw (6 views):     %.3f -> %.3f\n"
+		"    vertex fetch (16 KB):   overfetch %.3f -> %.3f\n",
+		sourceFilePath.c_str(),
+		before.vertexCache.GetAcmr(), after.vertexCache.GetAcmr(), before.vertexCache.GetAtvr(), after.vertexCache.GetAtvr(),
+		before.overdraw.GetOverdraw(), after.overdraw.GetOverdraw(),
+		before.vertexFetch.GetOverfetch(), after.vertexFetch.GetOverfetch());
+	OutputDebugStringA(line);
+	std::cout << line;
+
+	// Meshlets last - they point into the final index order
+	pOutMesh->meshlets.Clear();
+	for (Submesh& submesh : pOutMesh->submeshes)
+	{
+		submesh.firstMeshlet = (uint32_t)pOutMesh->meshlets.meshlets.size();
+		submesh.meshletCount = submesh.vertexCount == 0 ? 0 : MeshTools::BuildMeshlets(&pOutMesh->indexData[submesh.indexByteOffset],
+			submesh.GetIndexSize(), submesh.indexCount, &pOutMesh->vertices[submesh.baseVertex].Position.x, sizeof(VertexPosColor),
+			submesh.vertexCount, &pOutMesh->meshlets);
 	}
 
-	// Index buffer
-	ComPtr<ID3D12Resource> intermediateIndexBuffer;
+	// LODs after the vertex order is final - their runs share the vertices
+	BuildLods(pOutMesh);
+	uint64_t triangleCount = 0, lodTriangleCounts[_countof(MeshTools::kDefaultLodRatios)] = {};
+	float maxLodErrors[_countof(MeshTools::kDefaultLodRatios)] = {};
+	for (const Submesh& submesh : pOutMesh->submeshes)
 	{
-		// Upload index buffer data.
-		UpdateBufferResource(commandList,
-			&m_IndexBuffer, &intermediateIndexBuffer,
-			indicies.size(), sizeof(uint16_t), &indicies[0]);
-
-		// Create index buffer view.
-		m_IndexBufferView.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
-		m_IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-		m_IndexBufferView.SizeInBytes = (UINT) indicies.size() * sizeof(indicies[0]);
+		triangleCount += submesh.indexCount / 3;
+		for (uint32_t l = 0; l < _countof(MeshTools::kDefaultLodRatios); l++)
+		{
+			// A submesh with a shorter chain draws its last level
+			if (submesh.lodCount == 0)
+				lodTriangleCounts[l] += submesh.indexCount / 3;
+			else
+			{
+				const MeshTools::MeshLod& lod = pOutMesh->lods[submesh.firstLod + std::min(l, submesh.lodCount - 1)];
+				lodTriangleCounts[l] += lod.indexCount / 3;
+				maxLodErrors[l] = std::max(maxLodErrors[l], lod.error);
+			}
+		}
+	}
+	snprintf(line, sizeof(line), "    LODs (triangles):       %llu -> %llu / %llu / %llu, max error %.2e / %.2e / %.2e\n",
+		(unsigned long long)triangleCount, (unsigned long long)lodTriangleCounts[0], (unsigned long long)lodTriangleCounts[1],
+		(unsigned long long)lodTriangleCounts[2], maxLodErrors[0], maxLodErrors[1], maxLodErrors[2]);
+	OutputDebugStringA(line);
+	std::cout << line;
+
+	// Packed after the meshlets - their bounds come from the float positions
+	std::vector<uint8_t> packedVertices;
+	MeshTools::QuantizationError error;
+	PackVertices(pOutMesh, &packedVertices, &error);
+	snprintf(line, sizeof(line),
+		"    vertex format:          %u -> %u bytes, max error: position %.2e, normal %.3f deg, uv %.2e, color %.4f\n",
+		(uint32_t)sizeof(VertexPosColor), kVertexFormat.GetStride(),
+		error.maxPosition, error.maxNormalDegrees, error.maxUv, error.maxColor);
+	OutputDebugStringA(line);
+	std::cout << line;
+
+	std::vector<MeshTools::CookedSubmesh> cookedSubmeshes(pOutMesh->submeshes.size());
+	for (size_t i = 0; i < cookedSubmeshes.size(); i++)
+	{
+		const Submesh& submesh = pOutMesh->submeshes[i];
+		MeshTools::CookedSubmesh& cooked = cookedSubmeshes[i];
+		memset(&cooked, 0, sizeof(cooked));
+
+		memcpy(cooked.name, submesh.name.c_str(), std::min(submesh.name.size(), sizeof(cooked.name) - 1));
+		memcpy(cooked.world, &submesh.world, sizeof(cooked.world));
+		cooked.baseVertex = submesh.baseVertex;
+		cooked.vertexCount = submesh.vertexCount;
+		cooked.indexByteOffset = submesh.indexByteOffset;
+		cooked.indexCount = submesh.indexCount;
+		cooked.indexSize = submesh.GetIndexSize();
+		cooked.firstMeshlet = submesh.firstMeshlet;
+		cooked.meshletCount = submesh.meshletCount;
+		memcpy(cooked.positionOffset, submesh.positionBounds.offset, sizeof(cooked.positionOffset));
+		memcpy(cooked.positionScale, submesh.positionBounds.scale, sizeof(cooked.positionScale));
+		cooked.firstLod = submesh.firstLod;
+		cooked.lodCount = submesh.lodCount;
+		memcpy(cooked.boundsCenter, &submesh.boundsCenter, sizeof(cooked.boundsCenter));
+		cooked.boundsRadius = submesh.boundsRadius;
 	}
 
+	return MeshTools::WriteCookedMesh(GetCookedPath(sourceFilePath).c_str(), sourceHash,
+		packedVertices.data(), (uint32_t)pOutMesh->vertices.size(), kVertexFormat.GetStride(),
+		pOutMesh->indexData.data(), pOutMesh->indexData.size(),
+		cookedSubmeshes.data(), (uint32_t)cookedSubmeshes.size(), &pOutMesh->meshlets, kVertexFormat,
+		pOutMesh->lods.data(), (uint32_t)pOutMesh->lods.size());
+}
+
+static Submesh ToSubmesh(const MeshTools::CookedSubmesh& cooked)
+{
+	Submesh submesh;
+	submesh.name = std::string(cooked.name, strnlen(cooked.name, sizeof(cooked.name)));
+	memcpy(&submesh.world, cooked.world, sizeof(cooked.world));
+	submesh.baseVertex = cooked.baseVertex;
+	submesh.vertexCount = cooked.vertexCount;
+	submesh.indexByteOffset = cooked.indexByteOffset;
+	submesh.indexCount = cooked.indexCount;
+	submesh.use32BitIndices = cooked.indexSize == 4;
+	submesh.firstMeshlet = cooked.firstMeshlet;
+	submesh.meshletCount = cooked.meshletCount;
+	memcpy(submesh.positionBounds.offset, cooked.positionOffset, sizeof(submesh.positionBounds.offset));
+	memcpy(submesh.positionBounds.scale, cooked.positionScale, sizeof(submesh.positionBounds.scale));
+	submesh.firstLod = cooked.firstLod;
+	submesh.lodCount = cooked.lodCount;
+	memcpy(&submesh.boundsCenter, cooked.boundsCenter, sizeof(cooked.boundsCenter));
+	submesh.boundsRadius = cooked.boundsRadius;
+	return submesh;
+}
+
+// ==============================================================================
+//								Mesh Streaming 
+// ==============================================================================
+
+// Output of the loader job - Render moves it into the Mesh once the direct queue waits for its copies
+struct MeshUpload
+{
+	MeshData mesh;
+	ComPtr<ID3D12Resource> vertexBuffer;
+	ComPtr<ID3D12Resource> indexBuffer;
+	UINT vertexBufferSize = 0;
+	UINT indexBufferSize = 0;
+	std::chrono::high_resolution_clock::time_point startTime;
+	UINT framesWhileLoading = 0;
+};
+
+// Runs on the loader thread of the AsyncUploader: cache or cook, then both buffers through its ring.
+// The cooked cache is used unless the source file changed - the FBX/OBJ import only runs then.
+// A cache hit is memory-mapped and staged from the mapping, without copies into vectors.
+static bool LoadMeshData(const std::string& sourceFilePath, UploadRingBuffer& uploadBuffer, MeshUpload* pOut)
+{
+	MeshData& mesh = pOut->mesh;
+	const std::string cookedPath = GetCookedPath(sourceFilePath);
+	const uint64_t sourceHash = MeshTools::HashSourceFile(sourceFilePath.c_str());
+
+	const uint32_t vertexStride = kVertexFormat.GetStride();
+	MeshTools::CookedMesh cookedMesh;
+	std::vector<uint8_t> packedVertices;
+	if (!cookedMesh.Open(cookedPath.c_str(), sourceHash, vertexStride, kVertexFormat))
+	{
+		if (!CookMesh(sourceFilePath, sourceHash, &mesh))
+			return false;
+		// Take the same path as a cache hit; if the cache couldn't be written the imported data is packed here
+		if (!cookedMesh.Open(cookedPath.c_str(), sourceHash, vertexStride, kVertexFormat))
+			PackVertices(&mesh, &packedVertices);
+	}
+
+	const void* pVertexData = packedVertices.data();
+	size_t vertexCount = mesh.vertices.size();
+	const void* pIndexData = mesh.indexData.data();
+	size_t indexDataSize = mesh.indexData.size();
+
+	if (cookedMesh.IsOpen())
+	{
+		mesh.Clear();
+		for (uint32_t i = 0; i < cookedMesh.GetSubmeshCount(); i++)
+			mesh.submeshes.push_back(ToSubmesh(cookedMesh.GetSubmeshes()[i]));
+		// Small next to the vertices - copied, Render culls them every frame
+		cookedMesh.GetMeshlets(&mesh.meshlets);
+		mesh.lods.assign(cookedMesh.GetLods(), cookedMesh.GetLods() + cookedMesh.GetLodCount());
+
+		pVertexData = cookedMesh.GetVertexData();
+		vertexCount = cookedMesh.GetVertexCount();
+		pIndexData = cookedMesh.GetIndexData();
+		indexDataSize = (size_t)cookedMesh.GetIndexDataSize();
+	}
+
+	if (mesh.submeshes.empty() || vertexCount == 0)
+		return false;
+
+	// Vertex buffer - all submeshes; index buffer - all submeshes, 16- and 32-bit runs mixed.
+	// Staged right away, the mapping may close when this returns.
+	pOut->vertexBufferSize = (UINT)(vertexCount * vertexStride);
+	pOut->vertexBuffer = uploadBuffer.CreateBuffer(pVertexData, pOut->vertexBufferSize);
+	pOut->indexBufferSize = (UINT)indexDataSize;
+	pOut->indexBuffer = uploadBuffer.CreateBuffer(pIndexData, pOut->indexBufferSize);
+
+	// The CPU copy of the vertices is only needed for cooking
+	mesh.vertices.clear();
+	mesh.vertices.shrink_to_fit();
+	return true;
+}
+
+// ==============================================================================
+//									Init 
+// ==============================================================================
+Mesh::Mesh(HINSTANCE hInstance, const wchar_t * wndTitle, int width, int height, bool vSync) :
+	Application(hInstance, wndTitle, width, height, vSync),
+	m_ScissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX)),
+	m_Viewport(CD3DX12_VIEWPORT(0.0f, 0.0f, (float)width, (float)height)),
+	m_FOV(45.0f)
+{
+	// The first back buffer index will very likely be 0, but it depends
+	m_CurrentBackbufferIndex = Application::GetCurrentBackbufferIndex(); 
+}
+Mesh::~Mesh()
+{
+
+}
+
+// =====================================================================================
+//						      LoadContent & UnloadContent
+// =====================================================================================
+
+bool Mesh::LoadContent(std::wstring shaderBlobPath, std::string fbxFilePath)
+{
+	auto device = Application::GetDevice();
+
+	// The mesh streams in on the loader thread, Render draws it once its copies are through
+	m_PendingMesh = std::make_shared<MeshUpload>();
+	m_PendingMesh->startTime = std::chrono::high_resolution_clock::now();
+	std::shared_ptr<MeshUpload> upload = m_PendingMesh;
+	m_MeshTicket = Application::GetAsyncUploader()->Enqueue([upload, fbxFilePath](UploadRingBuffer& uploadBuffer)
+	{
+		return LoadMeshData(fbxFilePath, uploadBuffer, upload.get());
+	});
+
 	// Create the descriptor heap for the depth-stencil view.
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
@@ -142,16 +523,17 @@ bool Mesh::LoadContent(std::wstring shaderBlobPath, std::string fbxFilePath)
 		blobPath = std::wstring(shaderBlobPath + L"PixelShader.cso");
 		ThrowIfFailed(D3DReadFileToBlob(blobPath.c_str(), &pixelShaderBlob));
 
-		// Create the vertex input layout
+		// Create the vertex input layout - the input assembler unpacks everything but the
+		// octahedral normals to floats, the shader reads float3/float3/float3/float2 either way
+		const DXGI_FORMAT positionFormat = kVertexFormat.position == MeshTools::PositionFormat::Unorm16 ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+		const DXGI_FORMAT colorFormat = kVertexFormat.color == MeshTools::ColorFormat::Unorm8 ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+		const DXGI_FORMAT normalFormat = kVertexFormat.normal == MeshTools::NormalFormat::Octahedral16 ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+		const DXGI_FORMAT uvFormat = kVertexFormat.uv == MeshTools::UvFormat::Half ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R32G32_FLOAT;
 		D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-#ifdef USE_FP32_NORMAL
-			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-#endif
-#ifdef USE_FP32_UV
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-#endif
+			{ "POSITION", 0, positionFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, colorFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, normalFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, uvFormat, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		};
 
 		// Create a root signature.
@@ -170,9 +552,10 @@ bool Mesh::LoadContent(std::wstring shaderBlobPath, std::string fbxFilePath)
 			D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
 			D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
 
-		// A single 32-bit constant root parameter that is used by the vertex shader.
-		CD3DX12_ROOT_PARAMETER1 rootParameters[1];
+		// Root constants of the vertex shader: the MVP matrix (b0) and the vertex format (b1)
+		CD3DX12_ROOT_PARAMETER1 rootParameters[2];
 		rootParameters[0].InitAsConstants(sizeof(XMMATRIX) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+		rootParameters[1].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
 		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
 		rootSignatureDescription.Init_1_1(_countof(rootParameters), rootParameters, 0, nullptr, rootSignatureFlags);
@@ -215,12 +598,6 @@ bool Mesh::LoadContent(std::wstring shaderBlobPath, std::string fbxFilePath)
 		ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
 	}
 
-	// Execute and Sync queue
-	{
-		auto fenceValue = commandQueue->ExecuteCommandList(commandList);
-		commandQueue->WaitForFenceValue(fenceValue);
-	}
-
 	m_ContentLoaded = true;
 
 	// Resize/Create the depth buffer.
@@ -229,6 +606,49 @@ bool Mesh::LoadContent(std::wstring shaderBlobPath, std::string fbxFilePath)
 	return true;
 }
 
+void Mesh::AcquireStreamedMesh(CommandQueue& commandQueue)
+{
+	const AsyncUploader::Status status = Application::GetAsyncUploader()->Acquire(m_MeshTicket, commandQueue);
+	if (status == AsyncUploader::Status::Pending)
+	{
+		m_PendingMesh->framesWhileLoading++;
+		return;
+	}
+
+	char line[256];
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_PendingMesh->startTime).count();
+	if (status == AsyncUploader::Status::Ready)
+	{
+		// The direct queue waits for the copies from here on - the buffers can be drawn this frame
+		MeshUpload& upload = *m_PendingMesh;
+		meshData = std::move(upload.mesh);
+
+		m_VertexBuffer = upload.vertexBuffer;
+		m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
+		m_VertexBufferView.SizeInBytes = upload.vertexBufferSize;
+		m_VertexBufferView.StrideInBytes = kVertexFormat.GetStride();
+
+		// Two views of the same buffer - a submesh picks the one matching its index size
+		m_IndexBuffer = upload.indexBuffer;
+		m_IndexBufferView16.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
+		m_IndexBufferView16.Format = DXGI_FORMAT_R16_UINT;
+		m_IndexBufferView16.SizeInBytes = upload.indexBufferSize;
+
+		m_IndexBufferView32 = m_IndexBufferView16;
+		m_IndexBufferView32.Format = DXGI_FORMAT_R32_UINT;
+
+		snprintf(line, sizeof(line), "Mesh streamed in: %.1f ms, %u frames rendered meanwhile, %u submeshes, %.1f MB\n",
+			ms, upload.framesWhileLoading, (uint32_t)meshData.submeshes.size(),
+			(upload.vertexBufferSize + upload.indexBufferSize) / (1024.0 * 1024.0));
+	}
+	else
+	{
+		snprintf(line, sizeof(line), "Mesh loading failed after %.1f ms\n", ms);
+	}
+	OutputDebugStringA(line);
+	m_PendingMesh = nullptr;
+}
+
 void Mesh::UnloadContent()
 {
 	m_ContentLoaded = false;
@@ -248,6 +668,7 @@ void Mesh::ResizeDepthBuffer(UINT32 width, UINT32 height)
 		height = std::max((UINT32)1, height);
 
 		auto device = Application::GetDevice();
+		Application::GetStateTracker().Unregister(m_DepthBuffer.Get());
 
 		D3D12_CLEAR_VALUE optimizedClearValue = {};
 		optimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
@@ -263,6 +684,7 @@ void Mesh::ResizeDepthBuffer(UINT32 width, UINT32 height)
 				IID_PPV_ARGS(&m_DepthBuffer)
 			)
 		);
+		Application::GetStateTracker().Register(m_DepthBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
 		D3D12_DEPTH_STENCIL_VIEW_DESC dsv;
 		dsv.Format = DXGI_FORMAT_D32_FLOAT;
@@ -312,24 +734,11 @@ void Mesh::Update()
 	m_ProjectionMatrix = XMMatrixPerspectiveFovLH(XMConvertToRadians(m_FOV), aspectRatio, 0.1f, 100.0f);
 }
 
-void Mesh::Render()
+// Clears the targets and draws the submeshes - the scene pass of the render graph
+void Mesh::DrawScene(ComPtr<ID3D12GraphicsCommandList4> commandList, D3D12_CPU_DESCRIPTOR_HANDLE rtv, D3D12_CPU_DESCRIPTOR_HANDLE dsv, double totalRenderTime)
 {
-	Application::Render();
-	double totalRenderTime = Application::GetRenderTotalTime();
-
-	auto commandQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-	auto commandList = commandQueue->GetCommandList();
-
-	m_CurrentBackbufferIndex = Application::GetCurrentBackbufferIndex();
-	auto backBuffer = Application::GetBackbuffer(m_CurrentBackbufferIndex);
-
-	auto rtv = Application::GetCurrentBackbufferRTV();
-	auto dsv = m_DsvHeap->GetCPUDescriptorHandleForHeapStart();
-
 	// Clear RT
 	{
-		TransitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-
 		FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
 		ClearRTV(commandList, rtv, clearColor);
 		ClearDepth(commandList, dsv);
@@ -338,33 +747,168 @@ void Mesh::Render()
 	// Set Graphics state
 	commandList->SetPipelineState(m_PipelineState.Get());
 	commandList->SetGraphicsRootSignature(m_RootSignature.Get());
+	commandList->SetGraphicsRoot32BitConstant(1, kVertexFormat.normal == MeshTools::NormalFormat::Octahedral16 ? 1 : 0, 0);
 
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	commandList->IASetVertexBuffers(0, 1, &m_VertexBufferView);
-	commandList->IASetIndexBuffer(&m_IndexBufferView);
 
 	commandList->RSSetViewports(1, &m_Viewport);
 	commandList->RSSetScissorRects(1, &m_ScissorRect);
 
 	commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
 
-	// Update the MVP matrix
-	XMMATRIX mvpMatrix = XMMatrixMultiply(m_ModelMatrix, m_ViewMatrix);
-	mvpMatrix = XMMatrixMultiply(mvpMatrix, m_ProjectionMatrix);
-	commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / 4, &mvpMatrix, 0);
+	// One draw per submesh from the shared buffers, the index view only changes with the index size
+	XMMATRIX viewProjMatrix = XMMatrixMultiply(m_ViewMatrix, m_ProjectionMatrix);
+	const D3D12_INDEX_BUFFER_VIEW* pBoundIndexView = nullptr;
+
+#ifdef CULL_MESHLETS
+	static double s_CullStatsTime = 0.0;
+	MeshTools::MeshletCullStats cullStats;
+	std::vector<uint32_t> visibleMeshlets;
+#endif
+#ifdef USE_LODS
+	static double s_LodStatsTime = 0.0;
+	// Projected size of one unit at distance 1, in pixels
+	const float pixelsPerUnit = m_Viewport.Height / (2.0f * tanf(XMConvertToRadians(m_FOV) * 0.5f));
+	uint32_t lodSubmeshCounts[_countof(MeshTools::kDefaultLodRatios) + 1] = {};
+	uint64_t drawnTriangles = 0, fullTriangles = 0;
+#endif
+
+	for (const Submesh& submesh : meshData.submeshes)
+	{
+		const D3D12_INDEX_BUFFER_VIEW* pIndexView = submesh.use32BitIndices ? &m_IndexBufferView32 : &m_IndexBufferView16;
+		if (pIndexView != pBoundIndexView)
+		{
+			commandList->IASetIndexBuffer(pIndexView);
+			pBoundIndexView = pIndexView;
+		}
+
+		// Update the MVP matrix - Unorm16 positions are scaled and moved back into the submesh's space first
+		XMMATRIX modelMatrix = XMMatrixMultiply(XMLoadFloat4x4(&submesh.world), m_ModelMatrix);
+		XMMATRIX mvpMatrix = XMMatrixMultiply(modelMatrix, viewProjMatrix);
+		const MeshTools::QuantizationBounds& bounds = submesh.positionBounds;
+		XMMATRIX dequantizeMatrix = XMMatrixMultiply(XMMatrixScaling(bounds.scale[0], bounds.scale[1], bounds.scale[2]),
+			XMMatrixTranslation(bounds.offset[0], bounds.offset[1], bounds.offset[2]));
+		XMMATRIX drawMatrix = XMMatrixMultiply(dequantizeMatrix, mvpMatrix);
+		commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / 4, &drawMatrix, 0);
+
+#if defined(CULL_MESHLETS) || defined(USE_LODS)
+		// The camera in the submesh's space, moved by the inverse model-view
+		XMMATRIX modelViewMatrix = XMMatrixMultiply(modelMatrix, m_ViewMatrix);
+		XMFLOAT3 cameraPosition;
+		XMStoreFloat3(&cameraPosition, XMVector3TransformCoord(XMVectorZero(), XMMatrixInverse(nullptr, modelViewMatrix)));
+#endif
+
+#ifdef USE_LODS
+		// Distance to the bounding sphere in the submesh's units - the ones of the LOD errors
+		const float centerDistance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&submesh.boundsCenter), XMLoadFloat3(&cameraPosition))));
+		const uint32_t lodIndex = MeshTools::SelectLod(meshData.lods.data() + submesh.firstLod, submesh.lodCount,
+			std::max(centerDistance - submesh.boundsRadius, 0.0f), pixelsPerUnit, kLodPixelError);
+		lodSubmeshCounts[lodIndex]++;
+		fullTriangles += submesh.indexCount / 3;
+		if (lodIndex > 0)
+		{
+			const MeshTools::MeshLod& lod = meshData.lods[submesh.firstLod + lodIndex - 1];
+			drawnTriangles += lod.indexCount / 3;
+			commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.indexByteOffset / submesh.GetIndexSize(), submesh.baseVertex, 0);
+			continue;
+		}
+		drawnTriangles += submesh.indexCount / 3;
+#endif
+
+#ifdef CULL_MESHLETS
+		if (submesh.meshletCount > 0)
+		{
+			// Culling in the submesh's space: planes of its MVP
+			XMFLOAT4X4 mvp;
+			XMStoreFloat4x4(&mvp, mvpMatrix);
+			float planes[6][4];
+			MeshTools::ExtractFrustumPlanes(&mvp.m[0][0], planes);
+
+			visibleMeshlets.clear();
+			MeshTools::CullMeshlets(meshData.meshlets, submesh.firstMeshlet, submesh.meshletCount, planes, &cameraPosition.x,
+				&visibleMeshlets, &cullStats);
+
+			// Meshlets are consecutive index ranges - neighbours that both survive share a draw
+			for (size_t i = 0; i < visibleMeshlets.size();)
+			{
+				const MeshTools::Meshlet& first = meshData.meshlets.meshlets[visibleMeshlets[i]];
+				uint32_t indexCount = first.primitiveCount * 3;
+				for (i++; i < visibleMeshlets.size() && visibleMeshlets[i] == visibleMeshlets[i - 1] + 1; i++)
+					indexCount += meshData.meshlets.meshlets[visibleMeshlets[i]].primitiveCount * 3;
+
+				commandList->DrawIndexedInstanced(indexCount, 1, submesh.GetStartIndex() + first.firstIndex, submesh.baseVertex, 0);
+			}
+			continue;
+		}
+#endif
+		commandList->DrawIndexedInstanced(submesh.indexCount, 1, submesh.GetStartIndex(), submesh.baseVertex, 0); // Indexed Draw
+	}
+
+#ifdef CULL_MESHLETS
+	// Stats of this frame, once per second
+	if (totalRenderTime - s_CullStatsTime > 1.0)
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "Meshlets: %u / %u visible (frustum culled %u, backface culled %u), culled triangles %.1f%%\n",
+			cullStats.meshletsVisible, cullStats.meshletCount, cullStats.frustumCulled, cullStats.backfaceCulled,
+			100.0 * cullStats.GetCulledTriangleRatio());
+		OutputDebugStringA(line);
+		s_CullStatsTime = totalRenderTime;
+	}
+#endif
+#ifdef USE_LODS
+	// Submeshes per level and triangles before meshlet culling, once per second
+	if (totalRenderTime - s_LodStatsTime > 1.0)
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "LODs: submeshes %u / %u / %u / %u (full / 50%% / 25%% / 12.5%%), triangles %llu of %llu (%.1f%%)\n",
+			lodSubmeshCounts[0], lodSubmeshCounts[1], lodSubmeshCounts[2], lodSubmeshCounts[3],
+			(unsigned long long)drawnTriangles, (unsigned long long)fullTriangles,
+			fullTriangles ? 100.0 * drawnTriangles / fullTriangles : 100.0);
+		OutputDebugStringA(line);
+		s_LodStatsTime = totalRenderTime;
+	}
+#endif
+}
 
+void Mesh::Render()
+{
+	Application::Render();
+	double totalRenderTime = Application::GetRenderTotalTime();
 
-	commandList->DrawIndexedInstanced((UINT)indicies.size(), 1, 0, 0, 0); // Indexed Draw
-	//commandList->DrawInstanced((UINT)vertices.size(), 1, 0, 0); // Non Indexed Draw
+	auto commandQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	auto commandList = commandQueue->GetCommandList();
 
+	m_CurrentBackbufferIndex = Application::GetCurrentBackbufferIndex();
+	auto backBuffer = Application::GetBackbuffer(m_CurrentBackbufferIndex);
+	ResourceStateTracker& stateTracker = Application::GetStateTracker();
+
+	// Until the streamed mesh is ready the frame is only cleared (no submeshes)
+	if (m_PendingMesh)
+		AcquireStreamedMesh(*commandQueue);
+
+	auto rtv = Application::GetCurrentBackbufferRTV();
+	auto dsv = m_DsvHeap->GetCPUDescriptorHandleForHeapStart();
+
+	// The frame as a render graph: the scene pass writes the backbuffer and the depth buffer,
+	// the graph transitions them and leaves the backbuffer in PRESENT
+	m_RenderGraph.Reset();
+	const RenderGraph::Handle backBufferTarget = m_RenderGraph.Import("backbuffer", backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT);
+	const RenderGraph::Handle depthTarget = m_RenderGraph.Import("depth", m_DepthBuffer.Get());
+	m_RenderGraph.AddPass("scene", [&]() { DrawScene(commandList, rtv, dsv, totalRenderTime); })
+		.Write(backBufferTarget, D3D12_RESOURCE_STATE_RENDER_TARGET)
+		.Write(depthTarget, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+	m_RenderGraph.Compile();
+	m_RenderGraph.Execute(stateTracker, [&]() { FlushBarriers(stateTracker, commandList); });
 
 	// PRESENT image
 	{
 		// After rendering the scene, the current back buffer is PRESENTed 
 		//     to the screen.
 		// !!! Before presenting, the back buffer resource must be 
-		//     transitioned to the PRESENT state.
-		TransitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+		//     transitioned to the PRESENT state (the graph's final state for it).
 
 		// Execute
 		m_FenceValues[m_CurrentBackbufferIndex] = commandQueue->ExecuteCommandList(commandList);
@@ -372,17 +916,147 @@ void Mesh::Render()
 		m_CurrentBackbufferIndex = Application::Present();
 		commandQueue->WaitForFenceValue(m_FenceValues[m_CurrentBackbufferIndex]);
 	}
+
+	// Submits of the direct queue in the frame just presented (streamed mesh waits included), once per second
+	static double s_SubmitStatsTime = 0.0;
+	const CommandQueue::SubmitStats submitStats = commandQueue->GetFrameSubmitStats();
+	if (totalRenderTime - s_SubmitStatsTime > 1.0)
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "Direct queue: %llu submits (%llu lists), %llu signals, %llu GPU waits per frame\n",
+			(unsigned long long)submitStats.submits, (unsigned long long)submitStats.commandLists,
+			(unsigned long long)submitStats.signals, (unsigned long long)submitStats.gpuWaits);
+		OutputDebugStringA(line);
+		s_SubmitStatsTime = totalRenderTime;
+	}
 }
 
 // ==============================================================================
 //										Main
 // ==============================================================================
 
+// "2_Mesh.exe -benchload [iterations]" - times LoadFBX (one thread and the default pool) and the
+// cooked cache on the meshes in Data\ (run from the project directory) and exits.
+// Results go to the debugger output and to stdout.
+static int RunLoadBenchmark(int iterations)
+{
+	const char* files[] = { "\\Data\\ExportScene01.fbx", "\\Data\\cone.fbx" };
+	ThreadPool singleThread(1);
+
+	for (const char* file : files)
+	{
+		std::string fbxFilePath = GetWorkingDirPath() + file;
+		size_t vertexCount = 0, indexCount = 0, submeshCount = 0;
+
+		// Returns the average, writes the fastest run to *pMinMs; a negative result means a load failed
+		auto timeLoad = [&](const std::function<bool()>& load, double* pMinMs)
+		{
+			double totalMs = 0.0;
+			*pMinMs = DBL_MAX;
+			for (int i = 0; i < iterations; i++)
+			{
+				auto startTime = std::chrono::steady_clock::now();
+				if (!load())
+					return -1.0;
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+				*pMinMs = std::min(*pMinMs, ms);
+				totalMs += ms;
+			}
+			return totalMs / iterations;
+		};
+
+		auto loadFbx = [&](ThreadPool* pPool)
+		{
+			MeshData benchMesh;
+			if (!LoadFBX(fbxFilePath.c_str(), &benchMesh, pPool))
+				return false;
+
+			vertexCount = benchMesh.vertices.size();
+			indexCount = 0;
+			for (const Submesh& submesh : benchMesh.submeshes)
+				indexCount += submesh.indexCount;
+			submeshCount = benchMesh.submeshes.size();
+			return true;
+		};
+
+		double minSerialMs, minParallelMs;
+		const double avgSerialMs = timeLoad([&]() { return loadFbx(&singleThread); }, &minSerialMs);
+		const double avgParallelMs = timeLoad([&]() { return loadFbx(nullptr); }, &minParallelMs);
+		if (avgSerialMs < 0.0 || avgParallelMs < 0.0)
+		{
+			std::cout << "Failed to load " << fbxFilePath << std::endl;
+			return 1;
+		}
+
+		// Cooked cache: source hash check + mapping + one pass over the data (stands in for the upload copy)
+		MeshData cookMesh;
+		if (!CookMesh(fbxFilePath, MeshTools::HashSourceFile(fbxFilePath.c_str()), &cookMesh))
+		{
+			std::cout << "Failed to cook " << fbxFilePath << std::endl;
+			return 1;
+		}
+
+		uint64_t checksum = 0;
+		double minCookedMs;
+		const double avgCookedMs = timeLoad([&]()
+		{
+			MeshTools::CookedMesh cookedMesh;
+			if (!cookedMesh.Open(GetCookedPath(fbxFilePath).c_str(), MeshTools::HashSourceFile(fbxFilePath.c_str()), kVertexFormat.GetStride(), kVertexFormat))
+				return false;
+			checksum ^= HashBytes(cookedMesh.GetVertexData(), (size_t)cookedMesh.GetVertexCount() * kVertexFormat.GetStride());
+			checksum ^= HashBytes(cookedMesh.GetIndexData(), (size_t)cookedMesh.GetIndexDataSize());
+			return true;
+		}, &minCookedMs);
+		if (avgCookedMs < 0.0)
+		{
+			std::cout << "Failed to open the cooked cache of " << fbxFilePath << std::endl;
+			return 1;
+		}
+
+		char line[1024];
+		snprintf(line, sizeof(line),
+			"%s: %zu submeshes, %zu vertices, %zu indices (%d runs, checksum %llx)\n"
+			"    FBX, 1 thread:   min %8.2f ms  avg %8.2f ms\n"
+			"    FBX, %2u threads: min %8.2f ms  avg %8.2f ms\n"
+			"    cooked:          min %8.3f ms  avg %8.3f ms\n",
+			file, submeshCount, vertexCount, indexCount, iterations, (unsigned long long)checksum,
+			minSerialMs, avgSerialMs,
+			ThreadPool::GetDefault().GetThreadCount(), minParallelMs, avgParallelMs,
+			minCookedMs, avgCookedMs);
+		OutputDebugStringA(line);
+		std::cout << line;
+	}
+	return 0;
+}
+
 #define USE
 #ifdef USE
 int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
 //int main(int argc, char** argv)
 {
+	if (wcsstr(lpCmdLine, L"-benchload"))
+	{
+		int iterations = _wtoi(wcsstr(lpCmdLine, L"-benchload") + wcslen(L"-benchload"));
+		return RunLoadBenchmark(iterations > 0 ? iterations : 10);
+	}
+
+	// "2_Mesh.exe -cook <file.fbx|file.obj>" - offline cook step, writes <file>.cooked and exits
+	if (const wchar_t* pCookArg = wcsstr(lpCmdLine, L"-cook"))
+	{
+		char path[MAX_PATH] = {};
+		WideCharToMultiByte(CP_ACP, 0, pCookArg + wcslen(L"-cook"), -1, path, MAX_PATH, nullptr, nullptr);
+
+		std::string fbxFilePath = path;
+		fbxFilePath.erase(0, fbxFilePath.find_first_not_of(" \t\""));
+		fbxFilePath.erase(fbxFilePath.find_last_not_of(" \t\"") + 1);
+
+		MeshData cookMesh;
+		const bool cooked = CookMesh(fbxFilePath, MeshTools::HashSourceFile(fbxFilePath.c_str()), &cookMesh);
+		std::cout << (cooked ? "Cooked " : "Failed to cook ") << fbxFilePath << std::endl;
+		return cooked ? 0 : 1;
+	}
+
 	std::wstring exeDir = GetExeDirW();
 	//std::string fbxFilePath = GetWorkingDirPath() + "\\Data\\PepeMocap.fbx";
 	//std::string fbxFilePath = GetWorkingDirPath() + "\\Data\\cone.fbx";
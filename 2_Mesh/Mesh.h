@@ -3,6 +3,9 @@
 
 #include "..\DX12FrameWork\Framework\Application.h"
 #include "..\DX12FrameWork\Framework\CommandQueue.h"
+#include "..\DX12FrameWork\Utils\RenderGraph.h"
+
+struct MeshUpload;
 
 class Mesh : public Application
 {
@@ -15,26 +18,29 @@ public:
 	void Render();
 
 	void ResizeDepthBuffer(UINT32 width, UINT32 height);
-	
-	// Create a GPU buffer.
-	void UpdateBufferResource(ComPtr<ID3D12GraphicsCommandList4> commandList,
-		ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource,
-		size_t numElements, size_t elementSize, const void* bufferData,
-		D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
 
 public:
 	bool LoadContent(std::wstring shaderBlobPath, std::string fbxFilePath);
 	void UnloadContent();
 
 private:
+	// Takes over the streamed mesh once its loader job is done
+	void AcquireStreamedMesh(CommandQueue& commandQueue);
+	void DrawScene(ComPtr<ID3D12GraphicsCommandList4> commandList, D3D12_CPU_DESCRIPTOR_HANDLE rtv, D3D12_CPU_DESCRIPTOR_HANDLE dsv, double totalRenderTime);
+
 	bool m_ContentLoaded = false;
 
-	// Vertex buffer for the cube.
+	// Mesh on its way through the loader thread of the AsyncUploader, null once it's drawn
+	std::shared_ptr<MeshUpload> m_PendingMesh;
+	AsyncUploader::Ticket m_MeshTicket = 0;
+
+	// Vertex buffer shared by all submeshes (a null view until the mesh streamed in).
 	ComPtr<ID3D12Resource> m_VertexBuffer;
-	D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
-	// Index buffer for the cube.
+	D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView = {};
+	// Index buffer shared by all submeshes, viewed as 16- and as 32-bit indices.
 	ComPtr<ID3D12Resource> m_IndexBuffer;
-	D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
+	D3D12_INDEX_BUFFER_VIEW m_IndexBufferView16;
+	D3D12_INDEX_BUFFER_VIEW m_IndexBufferView32;
 
 	// Depth buffer and DescriptorHeap for it 
 	ComPtr<ID3D12Resource> m_DepthBuffer;
@@ -46,6 +52,9 @@ private:
 	// Pipeline state object.
 	ComPtr<ID3D12PipelineState> m_PipelineState;
 
+	// Declared and executed per frame in Render()
+	RenderGraph m_RenderGraph;
+
 private:
 	// View params
 	D3D12_VIEWPORT m_Viewport;
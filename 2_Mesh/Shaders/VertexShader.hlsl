@@ -5,6 +5,15 @@ struct ModelViewProjection
 
 ConstantBuffer<ModelViewProjection> ModelViewProjectionCB : register(b0);
 
+// Packed vertex formats (MeshTools/VertexQuantization.h). Positions need nothing here - the
+// bounds of the submesh are part of the MVP matrix.
+struct VertexFormat
+{
+	uint OctahedralNormals;		// R16G16_SNORM normals, Normal.xy holds the octahedral coordinates
+};
+
+ConstantBuffer<VertexFormat> VertexFormatCB : register(b1);
+
 struct VertexPosColor
 {
     float3 Position : POSITION;
@@ -19,14 +28,24 @@ struct VertexShaderOutput
     float4 Position : SV_Position;
 };
 
+float3 OctahedralDecode(float2 e)
+{
+	float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
 VertexShaderOutput main(VertexPosColor IN)
 {
     VertexShaderOutput OUT;
 
+	float3 normal = VertexFormatCB.OctahedralNormals ? OctahedralDecode(IN.Normal.xy) : IN.Normal;
+
     OUT.Position = mul(ModelViewProjectionCB.MVP, float4(IN.Position, 1.0f));
 	//OUT.Color = float4(IN.Position, 1.0f);
 	//OUT.Color = float4(IN.Color, 1.0f);
-	OUT.Color = float4(IN.Normal, 1.0f);
+	OUT.Color = float4(normal, 1.0f);
 	//OUT.Color = float4(1 - IN.UV.x, IN.UV.x, IN.UV.y, 1.0f);
 
     return OUT;
@@ -1,4 +1,5 @@
 #include "DxrGame.h"
+#include "..\DX12FrameWork\Utils\Utils.h"
 
 #include "External/DXCAPI/dxcapi.use.h"
 #include <d3dcompiler.h>
@@ -84,7 +85,8 @@ DxrGame::DxrGame(HINSTANCE hInstance, const wchar_t * windowTitle, int width, in
 }
 DxrGame::~DxrGame()
 {
-
+	// The members go before Application's flush - the compute queue may still refit a TLAS
+	Application::Flush();
 }
 
 // =====================================================================================
@@ -231,7 +233,7 @@ DxrGame::AccelerationStructureBuffers CreateBottomLevelAS(ComPtr<ID3D12Device5>
 }
 
 void BuildTopLevelAS(ComPtr<ID3D12Device5> pDevice, ComPtr<ID3D12GraphicsCommandList4> pCmdList, ComPtr<ID3D12Resource> pBottomLevelAS[2], 
-	uint64_t& tlasSize, float rotation, bool update, DxrGame::AccelerationStructureBuffers& buffers)
+	uint64_t& tlasSize, float rotation, bool update, DxrGame::AccelerationStructureBuffers& buffers, bool uavBarriers = true)
 {
 	// First, get the size of the TLAS buffers and create them
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
@@ -246,10 +248,14 @@ void BuildTopLevelAS(ComPtr<ID3D12Device5> pDevice, ComPtr<ID3D12GraphicsCommand
 	if (update)
 	{
 		// If this a request for an update, then the TLAS was already used in a DispatchRay() call. We need a UAV barrier to make sure the read operation ends before updating the buffer
-		D3D12_RESOURCE_BARRIER uavBarrier = {};
-		uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-		uavBarrier.UAV.pResource = buffers.pResult.Get();
-		pCmdList->ResourceBarrier(1, &uavBarrier);
+		// (without uavBarriers the caller orders the accesses - the render graph does)
+		if (uavBarriers)
+		{
+			D3D12_RESOURCE_BARRIER uavBarrier = {};
+			uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			uavBarrier.UAV.pResource = buffers.pResult.Get();
+			pCmdList->ResourceBarrier(1, &uavBarrier);
+		}
 	}
 	else
 	{
@@ -323,6 +329,7 @@ void BuildTopLevelAS(ComPtr<ID3D12Device5> pDevice, ComPtr<ID3D12GraphicsCommand
 	}
 
 	// We need to insert a UAV barrier before using the acceleration structures in a raytracing operation
+	if (uavBarriers)
 	{
 		D3D12_RESOURCE_BARRIER uavBarrier = {};
 		uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
@@ -625,8 +632,23 @@ struct PipelineConfig
 // =====================================================================================
 
 
+void DxrGame::EnableTimelineTrace(const char* path, UINT32 frameCount)
+{
+	m_TracePath = path;
+	m_TraceFrameCount = frameCount;
+}
+
 void DxrGame::InitDXR()
 {
+	m_TlasCount = m_AsyncAccelerationStructures ? c_MaxTlasCount : 1;
+	m_TransientHeap = std::make_shared<TransientHeap>(Application::GetDevice(), Application::GetCommandQueue(), Application::GetStateTracker());
+	if (!m_TracePath.empty() && m_TraceFrameCount > 0)
+	{
+		m_DirectTimer.reset(new GpuTimer(Application::GetDevice(), Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT)));
+		m_ComputeTimer.reset(new GpuTimer(Application::GetDevice(), Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE)));
+		m_DirectTrack = m_Trace.AddTrack("direct queue");
+		m_ComputeTrack = m_Trace.AddTrack("compute queue");
+	}
 	createAccelerationStructures();         
 	createRtPipelineState();                
 	createShaderResources();                
@@ -637,7 +659,8 @@ void DxrGame::InitDXR()
 void DxrGame::createAccelerationStructures()
 {
 	ComPtr<ID3D12Device5> device = Application::GetDevice();
-	std::shared_ptr<CommandQueue> cmdQueue = Application::GetCommandQueue();
+	// Async: the builds on the queue that refits the TLAS later
+	std::shared_ptr<CommandQueue> cmdQueue = Application::GetCommandQueue(m_AsyncAccelerationStructures ? D3D12_COMMAND_LIST_TYPE_COMPUTE : D3D12_COMMAND_LIST_TYPE_DIRECT);
 	ComPtr<ID3D12GraphicsCommandList4> cmdList = cmdQueue->GetCommandList();
 
 	m_VertexBuffers[0] = CreateTriangleVB(device);
@@ -653,16 +676,27 @@ void DxrGame::createAccelerationStructures()
 	bottomLevelBuffers[1] = CreateBottomLevelAS(device, cmdList, m_VertexBuffers, vertexCount, 1);
 	m_BottomLevelAS[1] = bottomLevelBuffers[1].pResult;
 
-	// Create the TLAS
-	BuildTopLevelAS(device, cmdList, m_BottomLevelAS, c_TlasSize, 0, false, m_TopLevelBuffers);
+	// Create the TLAS (async: both of them)
+	for (UINT32 i = 0; i < m_TlasCount; i++)
+	{
+		BuildTopLevelAS(device, cmdList, m_BottomLevelAS, c_TlasSize, 0, false, m_TopLevelBuffers[i]);
+		// Acceleration structures stay in their state, the render graph imports the TLAS each frame
+		Application::GetStateTracker().Register(m_TopLevelBuffers[i].pResult.Get(), D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+	}
 
 	// The tutorial doesn't have any resource lifetime management, so we flush and sync here. This is not required by the DXR spec - you can submit the list whenever you like as long as you take care of the resources lifetime.
 	//mFenceValue = submitCommandList(mpCmdList, mpCmdQueue, mpFence, mFenceValue);
 	//mpFence->SetEventOnCompletion(mFenceValue, mFenceEvent);
 	//WaitForSingleObject(mFenceEvent, INFINITE);
 	//mpCmdList->Reset(mFrameObjects[0].pCmdAllocator, nullptr);
-	m_FenceValues[m_CurrentBackBufferIndex] = cmdQueue->ExecuteCommandList(cmdList);
-	cmdQueue->WaitForFenceValue(m_FenceValues[m_CurrentBackBufferIndex]);
+	const UINT64 fenceValue = cmdQueue->ExecuteCommandList(cmdList);
+	cmdQueue->WaitForFenceValue(fenceValue);
+	m_TlasIndex = 0;
+	for (UINT32 i = 0; i < m_TlasCount; i++)
+	{
+		m_TlasRefitFences[i] = m_AsyncAccelerationStructures ? fenceValue : 0;
+		m_TlasTraceFences[i] = 0;
+	}
 }
 
 void DxrGame::createRtPipelineState() 
@@ -764,11 +798,14 @@ void DxrGame::createShaderResources()
 {
 	ComPtr<ID3D12Device5> device = Application::GetDevice();
 
-	// Create an SRV/UAV descriptor heap. Need 2 entries - 1 SRV for the scene and 1 UAV for the output
-	m_SrvUavHeap = CreateDescriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 2, true);
+	// Create an SRV/UAV descriptor heap. Need 2 entries per TLAS - 1 UAV for the output and 1 SRV for the scene.
+	// Once: the shader table points into it (a resize only changes the output)
+	if (!m_SrvUavHeap)
+		m_SrvUavHeap = CreateDescriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, c_SrvUavHeapSize, true);
 
-	// Create the output resource. The dimensions and format should match the SWAP-CHAIN
-	D3D12_RESOURCE_DESC resDesc = {};
+	// The output resource: a transient of the render graph, placed each frame with this desc. The dimensions and format should match the SWAP-CHAIN
+	D3D12_RESOURCE_DESC& resDesc = m_OutputDesc;
+	resDesc = {};
 	resDesc.DepthOrArraySize = 1;
 	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 	resDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // The backbuffer is actually DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, but sRGB formats can't be used with UAVs. We will convert to sRGB ourselves in the shader
@@ -778,21 +815,21 @@ void DxrGame::createShaderResources()
 	resDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 	resDesc.MipLevels = 1;
 	resDesc.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateCommittedResource(&kDefaultHeapProps, D3D12_HEAP_FLAG_NONE, &resDesc, D3D12_RESOURCE_STATE_COPY_SOURCE, nullptr, IID_PPV_ARGS(&m_OutputResource))); // Starting as copy-source to simplify onFrameRender()
 
-	// Create the UAV. Based on the root signature we created it should be the first entry
-	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-	device->CreateUnorderedAccessView(m_OutputResource.Get(), nullptr, &uavDesc, m_SrvUavHeap->GetCPUDescriptorHandleForHeapStart());
+	// The UAV goes to the first entry of each TLAS (the root signature's), written by the raytrace pass for the output's resource
+	m_pOutputUavResource = nullptr;
 
 	// Create the TLAS SRV right after the UAV. Note that we are using a different SRV desc here
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;    // !!! for AS
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;		  // ??? Not sure why it's rquired
-	srvDesc.RaytracingAccelerationStructure.Location = m_TopLevelBuffers.pResult->GetGPUVirtualAddress();
-	D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_SrvUavHeap->GetCPUDescriptorHandleForHeapStart();
-	srvHandle.ptr += device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
+	for (UINT32 i = 0; i < m_TlasCount; i++)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;    // !!! for AS
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;		  // ??? Not sure why it's rquired
+		srvDesc.RaytracingAccelerationStructure.Location = m_TopLevelBuffers[i].pResult->GetGPUVirtualAddress();
+		D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_SrvUavHeap->GetCPUDescriptorHandleForHeapStart();
+		srvHandle.ptr += (i * 2 + 1) * device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
+	}
 }
 
 void DxrGame::createConstantBuffers()
@@ -849,10 +886,11 @@ void DxrGame::createShaderTable()
     c_ShaderTableEntrySize = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
     c_ShaderTableEntrySize += 8; // The hit shader constant-buffer descriptor
     c_ShaderTableEntrySize = align_to(D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, c_ShaderTableEntrySize);
-    uint32_t shaderTableSize = c_ShaderTableEntrySize * 11;
+    c_ShaderTableSize = align_to(D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, c_ShaderTableEntrySize * 11);
 
     // For simplicity, we create the shader-table on the upload heap. You can also create it on the default heap
-    m_ShaderTable = CreateBuffer(device, shaderTableSize, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, kUploadHeapProps);
+    // One table per TLAS, they differ in the descriptors (the TLAS SRV)
+    m_ShaderTable = CreateBuffer(device, c_ShaderTableSize * m_TlasCount, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, kUploadHeapProps);
 
     // Map the buffer
     uint8_t* pData;
@@ -911,6 +949,16 @@ void DxrGame::createShaderTable()
     uint8_t* pEntry10 = pData + c_ShaderTableEntrySize * 10;
     memcpy(pEntry10, pRtsoProps->GetShaderIdentifier(kShadowHitGroup), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
 
+    // The tables of the other TLAS: the same records, the descriptors of their TLAS
+    for (uint32_t table = 1; table < m_TlasCount; table++)
+    {
+        uint8_t* pTable = pData + table * c_ShaderTableSize;
+        const uint64_t descriptorOffset = table * 2 * device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        memcpy(pTable, pData, c_ShaderTableSize);
+        *(uint64_t*)(pTable + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) += descriptorOffset;
+        *(uint64_t*)(pTable + c_ShaderTableEntrySize * 5 + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) += descriptorOffset;
+    }
+
     // Unmap
     m_ShaderTable->Unmap(0, nullptr);
 }
@@ -948,70 +996,241 @@ void DxrGame::Render()
 	auto device = Application::GetDevice();
 	auto cmdQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
 	auto cmdList = cmdQueue->GetCommandList();
+	// Sync: the frame's acceleration structure work in a list of its own, batched with the scene list
+	ComPtr<ID3D12GraphicsCommandList4> asList;
+	if (!m_AsyncAccelerationStructures)
+		asList = cmdQueue->GetCommandList();
 
 	m_CurrentBackBufferIndex = Application::GetCurrentBackbufferIndex();
 	auto backBuffer = Application::GetBackbuffer(m_CurrentBackBufferIndex);
 	auto rtv = Application::GetCurrentBackbufferRTV();
+	ResourceStateTracker& stateTracker = Application::GetStateTracker();
 
 	// Bind the descriptor heaps
 	ID3D12DescriptorHeap* heaps[] = { m_SrvUavHeap.Get() };
 	cmdList->SetDescriptorHeaps(arraysize(heaps), heaps);
 
+	// Timeline trace: the frame's GPU time after the warm-up
+	const bool traceFrame = m_DirectTimer && m_TraceFrame >= c_TraceWarmupFrames;
+	if (traceFrame)
+	{
+		char regionName[64];
+		snprintf(regionName, sizeof(regionName), m_AsyncAccelerationStructures ? "raytrace %u" : "refit + raytrace %u", m_TraceFrame);
+		m_DirectTimer->Begin(m_AsyncAccelerationStructures ? cmdList.Get() : asList.Get(), regionName);
+	}
+
+	// The TLAS this frame traces (async: refitted by the compute queue during the last frame)
+	const UINT32 tlasIndex = m_TlasIndex;
+	AccelerationStructureBuffers& topLevelBuffers = m_TopLevelBuffers[tlasIndex];
+
+	// The frame as a render graph: the passes declare what they use, the graph orders the
+	// TLAS accesses with UAV barriers, transitions the output and the backbuffer and puts the
+	// output (a transient) in the transient heap
+	m_RenderGraph.Reset();
+	const RenderGraph::Handle tlas = m_RenderGraph.Import("TLAS", topLevelBuffers.pResult.Get());
+	const RenderGraph::Handle output = m_TransientHeap->CreateTransient(m_RenderGraph, "RT output", m_OutputDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	const RenderGraph::Handle backBufferTarget = m_RenderGraph.Import("backbuffer", backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT);
+
+	// The barriers go to the list of the pass that follows them
+	ComPtr<ID3D12GraphicsCommandList4> barrierList = m_AsyncAccelerationStructures ? cmdList : asList;
+
 	// Refit the top-level acceleration structure
-	BuildTopLevelAS(device, cmdList, m_BottomLevelAS, c_TlasSize, mRotation, true, m_TopLevelBuffers);
-	mRotation += 0.005f;
+	if (!m_AsyncAccelerationStructures)
+	{
+		m_RenderGraph.AddPass("TLAS refit", [&]()
+		{
+			BuildTopLevelAS(device, asList, m_BottomLevelAS, c_TlasSize, mRotation, true, topLevelBuffers, false);
+			mRotation += 0.005f;
+			barrierList = cmdList;
+		}).Write(tlas, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+	}
 
 	// Let's raytrace
-	TransitionResource(cmdList, m_OutputResource, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-	D3D12_DISPATCH_RAYS_DESC raytraceDesc = {};
-	raytraceDesc.Width = Application::GetClientWidth(); //mSwapChainSize.x;
-	raytraceDesc.Height = Application::GetClientHeight(); //mSwapChainSize.y;
-	raytraceDesc.Depth = 1;
-
-	// RayGen is the first entry in the shader-table
-	raytraceDesc.RayGenerationShaderRecord.StartAddress = m_ShaderTable->GetGPUVirtualAddress() + 0 * c_ShaderTableEntrySize;
-	raytraceDesc.RayGenerationShaderRecord.SizeInBytes = c_ShaderTableEntrySize;
-
-	// Miss is the second entry in the shader-table
-	size_t missOffset = 1 * c_ShaderTableEntrySize;
-	raytraceDesc.MissShaderTable.StartAddress = m_ShaderTable->GetGPUVirtualAddress() + missOffset;
-	raytraceDesc.MissShaderTable.StrideInBytes = c_ShaderTableEntrySize;
-	raytraceDesc.MissShaderTable.SizeInBytes = c_ShaderTableEntrySize * 2;   // 2 miss-entries
-
-	// Hit is the fourth entry in the shader-table
-	size_t hitOffset = 3 * c_ShaderTableEntrySize;
-	raytraceDesc.HitGroupTable.StartAddress = m_ShaderTable->GetGPUVirtualAddress() + hitOffset;
-	raytraceDesc.HitGroupTable.StrideInBytes = c_ShaderTableEntrySize;
-	raytraceDesc.HitGroupTable.SizeInBytes = c_ShaderTableEntrySize * 8;    // 8 hit-entries
-
-	// Bind the empty root signature
-	cmdList->SetComputeRootSignature(m_EmptyRootSig.Get());
-
-	// Dispatch
-	cmdList->SetPipelineState1(m_PipelineStateRtx.Get());
-	cmdList->DispatchRays(&raytraceDesc);
+	m_RenderGraph.AddPass("raytrace", [&]()
+	{
+		// The UAV descriptor follows the output's placed resource - a new one only comes with a
+		// new desc or heap (resize), after Resize() flushed the frames that read the descriptor
+		ID3D12Resource* pOutput = static_cast<ID3D12Resource*>(m_RenderGraph.GetResource(output));
+		if (pOutput != m_pOutputUavResource)
+		{
+			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+			for (UINT32 i = 0; i < m_TlasCount; i++)
+			{
+				D3D12_CPU_DESCRIPTOR_HANDLE uavHandle = m_SrvUavHeap->GetCPUDescriptorHandleForHeapStart();
+				uavHandle.ptr += i * 2 * device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+				device->CreateUnorderedAccessView(pOutput, nullptr, &uavDesc, uavHandle);
+			}
+			m_pOutputUavResource = pOutput;
+		}
+
+		// The shader table of the TLAS, with its descriptors
+		const D3D12_GPU_VIRTUAL_ADDRESS shaderTable = m_ShaderTable->GetGPUVirtualAddress() + tlasIndex * c_ShaderTableSize;
+
+		D3D12_DISPATCH_RAYS_DESC raytraceDesc = {};
+		raytraceDesc.Width = Application::GetClientWidth(); //mSwapChainSize.x;
+		raytraceDesc.Height = Application::GetClientHeight(); //mSwapChainSize.y;
+		raytraceDesc.Depth = 1;
+
+		// RayGen is the first entry in the shader-table
+		raytraceDesc.RayGenerationShaderRecord.StartAddress = shaderTable + 0 * c_ShaderTableEntrySize;
+		raytraceDesc.RayGenerationShaderRecord.SizeInBytes = c_ShaderTableEntrySize;
+
+		// Miss is the second entry in the shader-table
+		size_t missOffset = 1 * c_ShaderTableEntrySize;
+		raytraceDesc.MissShaderTable.StartAddress = shaderTable + missOffset;
+		raytraceDesc.MissShaderTable.StrideInBytes = c_ShaderTableEntrySize;
+		raytraceDesc.MissShaderTable.SizeInBytes = c_ShaderTableEntrySize * 2;   // 2 miss-entries
+
+		// Hit is the fourth entry in the shader-table
+		size_t hitOffset = 3 * c_ShaderTableEntrySize;
+		raytraceDesc.HitGroupTable.StartAddress = shaderTable + hitOffset;
+		raytraceDesc.HitGroupTable.StrideInBytes = c_ShaderTableEntrySize;
+		raytraceDesc.HitGroupTable.SizeInBytes = c_ShaderTableEntrySize * 8;    // 8 hit-entries
+
+		// Bind the empty root signature
+		cmdList->SetComputeRootSignature(m_EmptyRootSig.Get());
+
+		// Dispatch
+		cmdList->SetPipelineState1(m_PipelineStateRtx.Get());
+		cmdList->DispatchRays(&raytraceDesc);
+	}).Read(tlas, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE).Write(output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
 	// Copy the results to the back-buffer
-	TransitionResource(cmdList, m_OutputResource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	TransitionResource(cmdList, backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_COPY_DEST);
-	D3D12_RESOURCE_DESC rs1 = m_OutputResource.Get()->GetDesc();
-	D3D12_RESOURCE_DESC rs2 = backBuffer.Get()->GetDesc();
-	cmdList->CopyResource(backBuffer.Get(), m_OutputResource.Get());
+	m_RenderGraph.AddPass("copy to backbuffer", [&]()
+	{
+		cmdList->CopyResource(backBuffer.Get(), static_cast<ID3D12Resource*>(m_RenderGraph.GetResource(output)));
+	}).Read(output, D3D12_RESOURCE_STATE_COPY_SOURCE).Write(backBufferTarget, D3D12_RESOURCE_STATE_COPY_DEST);
+
+	m_RenderGraph.Compile();
+	m_TransientHeap->Allocate(m_RenderGraph);
+	m_RenderGraph.Execute(stateTracker, [&]() { FlushBarriers(stateTracker, barrierList); });
+
+	// Passes and transient memory, when they change (first frame, resize)
+	const RenderGraph::Stats& graphStats = m_RenderGraph.GetStats();
+	if (graphStats.heapBytes != m_LastGraphHeapBytes)
+	{
+		wchar_t buffer[256];
+		swprintf(buffer, 256, L"Render graph: %u passes (%u culled), %u transients %.1f MB in a %.1f MB heap\n",
+			graphStats.passes, graphStats.culledPasses, graphStats.transients,
+			graphStats.transientBytes / (1024.0 * 1024.0), graphStats.heapBytes / (1024.0 * 1024.0));
+		OutputDebugStringW(buffer);
+		m_LastGraphHeapBytes = graphStats.heapBytes;
+	}
 
 	// PRESENT image
 	{
 		// After rendering the scene, the current back buffer is PRESENTed 
 		//     to the screen.
 		// !!! Before presenting, the back buffer resource must be 
-		//     transitioned to the PRESENT state.
-		TransitionResource(cmdList, backBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PRESENT);
-
-		// Execute
-		m_FenceValues[m_CurrentBackBufferIndex] = cmdQueue->ExecuteCommandList(cmdList);
+		//     transitioned to the PRESENT state (the graph's final state for it).
+
+		if (traceFrame)
+			m_DirectTimer->End(cmdList.Get());
+
+		// Execute - async: once the compute queue refitted the frame's TLAS. Sync: the AS list
+		// and the scene list in one ExecuteCommandLists with one signal.
+		if (m_AsyncAccelerationStructures)
+			cmdQueue->Wait(*Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE), m_TlasRefitFences[tlasIndex]);
+		else
+			cmdQueue->AddToBatch(asList);
+		m_FenceValues[m_CurrentBackBufferIndex] = cmdQueue->AddToBatch(cmdList);
+		cmdQueue->SubmitBatch();
+		if (traceFrame)
+			m_DirectTimer->Submitted(m_FenceValues[m_CurrentBackBufferIndex]);
+
+		// ... while it traces, the compute queue refits the next frame's
+		if (m_AsyncAccelerationStructures)
+		{
+			m_TlasTraceFences[tlasIndex] = m_FenceValues[m_CurrentBackBufferIndex];
+			refitNextTopLevelAS(traceFrame);
+		}
 
 		m_CurrentBackBufferIndex = Application::Present();
 		cmdQueue->WaitForFenceValue(m_FenceValues[m_CurrentBackBufferIndex]);
 	}
+
+	if (m_DirectTimer)
+		collectTimelineTrace();
+
+	// Submits of the direct queue in the frame just presented, once per second
+	static double s_SubmitStatsTime = 0.0;
+	const CommandQueue::SubmitStats submitStats = cmdQueue->GetFrameSubmitStats();
+	if (totalRenderTime - s_SubmitStatsTime > 1.0)
+	{
+		wchar_t buffer[256];
+		swprintf(buffer, 256, L"Direct queue: %llu submits (%llu lists), %llu signals, %llu GPU waits per frame\n",
+			(unsigned long long)submitStats.submits, (unsigned long long)submitStats.commandLists,
+			(unsigned long long)submitStats.signals, (unsigned long long)submitStats.gpuWaits);
+		OutputDebugStringW(buffer);
+		s_SubmitStatsTime = totalRenderTime;
+	}
+}
+
+// Async: the compute queue refits the TLAS the next frame traces. The direct queue waits for the
+// refit (Render()), the refit for the direct queue's last frame that traced the TLAS.
+void DxrGame::refitNextTopLevelAS(bool traceRegion)
+{
+	auto device = Application::GetDevice();
+	auto directQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	auto computeQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+	const UINT32 next = (m_TlasIndex + 1) % m_TlasCount;
+
+	// The CPU rewrites the TLAS's instance descs - its last refit read them
+	computeQueue->WaitForFenceValue(m_TlasRefitFences[next]);
+	// The GPU rewrites the TLAS
+	computeQueue->Wait(*directQueue, m_TlasTraceFences[next]);
+
+	auto computeList = computeQueue->GetCommandList();
+	if (traceRegion)
+	{
+		char regionName[64];
+		snprintf(regionName, sizeof(regionName), "TLAS refit %u", m_TraceFrame + 1);
+		m_ComputeTimer->Begin(computeList.Get(), regionName);
+	}
+
+	// Without UAV barriers: the fences order the accesses of the two queues
+	BuildTopLevelAS(device, computeList, m_BottomLevelAS, c_TlasSize, mRotation, true, m_TopLevelBuffers[next], false);
+	mRotation += 0.005f;
+
+	if (traceRegion)
+		m_ComputeTimer->End(computeList.Get());
+	m_TlasRefitFences[next] = computeQueue->ExecuteCommandList(computeList);
+	if (traceRegion)
+		m_ComputeTimer->Submitted(m_TlasRefitFences[next]);
+
+	m_TlasIndex = next;
+}
+
+// Timeline trace: the regions the GPU finished, after the last traced frame all of them to the file
+void DxrGame::collectTimelineTrace()
+{
+	auto directQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	auto computeQueue = Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+	m_TraceFrame++;
+	const bool lastFrame = m_TraceFrame == c_TraceWarmupFrames + m_TraceFrameCount;
+	if (lastFrame)
+	{
+		directQueue->Flush();
+		computeQueue->Flush();
+	}
+	m_DirectTimer->Collect(m_Trace, m_DirectTrack);
+	m_ComputeTimer->Collect(m_Trace, m_ComputeTrack);
+	if (!lastFrame)
+		return;
+
+	const bool written = m_Trace.WriteChromeTrace(m_TracePath.c_str());
+	const double msPerFrame = 1e-3 / m_TraceFrameCount;
+	wchar_t buffer[512];
+	swprintf(buffer, 512, L"Timeline (%s TLAS refit), %u frames: direct queue %.3f ms, compute queue %.3f ms, both %.3f ms per frame. %S %s\n",
+		m_AsyncAccelerationStructures ? L"async" : L"sync", m_TraceFrameCount,
+		m_Trace.GetBusyUs(m_DirectTrack) * msPerFrame, m_Trace.GetBusyUs(m_ComputeTrack) * msPerFrame,
+		m_Trace.GetOverlapUs(m_DirectTrack, m_ComputeTrack) * msPerFrame, m_TracePath.c_str(), written ? L"written" : L"could not be written");
+	OutputDebugStringW(buffer);
+
+	m_DirectTimer.reset();
+	m_ComputeTimer.reset();
 }
 
 void DxrGame::Resize(UINT32 width, UINT32 height)
@@ -1040,17 +1259,6 @@ void DxrGame::Resize(UINT32 width, UINT32 height)
 //									Helper Funcs
 // =====================================================================================
 
-void DxrGame::TransitionResource(ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource> resource,
-	D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
-{
-	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition
-	(
-		resource.Get(), before, after
-	);
-
-	commandList->ResourceBarrier(1, &barrier);
-}
-
 void DxrGame::ClearRTV(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList,
 	D3D12_CPU_DESCRIPTOR_HANDLE rtv, FLOAT* clearColor)
 {
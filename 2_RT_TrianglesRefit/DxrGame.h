@@ -1,6 +1,10 @@
 #pragma once
 
 #include "../DX12FrameWork/Framework/Application.h"
+#include "../DX12FrameWork/Framework/GpuTimer.h"
+#include "../DX12FrameWork/Framework/TransientHeap.h"
+#include "../DX12FrameWork/Utils/RenderGraph.h"
+#include "../DX12FrameWork/Utils/TimelineTrace.h"
 
 #include <DirectXMath.h>
 
@@ -28,6 +32,12 @@ public:
 	virtual void Render();
 	virtual void Resize(UINT32 width, UINT32 height);
 
+	// Before InitDXR(). Async: the compute queue refits the TLAS of the next frame while the direct
+	// queue traces the current one (two TLAS), instead of a refit on the direct list before the rays
+	void SetAsyncAccelerationStructures(bool async) { m_AsyncAccelerationStructures = async; }
+	// Before InitDXR(): GPU timeline of both queues over frameCount frames to a Chrome trace at path
+	void EnableTimelineTrace(const char* path, UINT32 frameCount);
+
 	// DXR
 	void InitDXR();
 	void createAccelerationStructures();
@@ -35,11 +45,11 @@ public:
 	void createShaderResources();
 	void createConstantBuffers();
 	void createShaderTable();
+	void refitNextTopLevelAS(bool traceRegion);
+	void collectTimelineTrace();
 
 protected:			
 	// Helpers
-	void TransitionResource(ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource> resource,
-		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
 	void ClearRTV(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList,
 		D3D12_CPU_DESCRIPTOR_HANDLE rtv, FLOAT* clearColor);
 	void ClearDepth(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList,
@@ -54,7 +64,11 @@ private:
 	// createAccelerationStructures()
 	ComPtr <ID3D12Resource> m_VertexBuffers[2];
 	ComPtr <ID3D12Resource> m_BottomLevelAS[2];
-	AccelerationStructureBuffers m_TopLevelBuffers;
+	// Async: one TLAS traced by the direct queue, one refitted by the compute queue - they swap every frame
+	static const UINT32 c_MaxTlasCount = 2;
+	bool m_AsyncAccelerationStructures = false;
+	UINT32 m_TlasCount = 1;
+	AccelerationStructureBuffers m_TopLevelBuffers[c_MaxTlasCount];
 	uint64_t c_TlasSize = 0;
 
 	// createRtPipelineState()
@@ -62,16 +76,41 @@ private:
 	ComPtr<ID3D12RootSignature> m_EmptyRootSig;
 	
 	// createShaderResources()
-	ComPtr<ID3D12Resource> m_OutputResource;
+	D3D12_RESOURCE_DESC m_OutputDesc = {};
+	ID3D12Resource* m_pOutputUavResource = nullptr;		// the UAV descriptor's, the render graph's output
 	ComPtr<ID3D12DescriptorHeap> m_SrvUavHeap = nullptr;
-	static const uint32_t c_SrvUavHeapSize = 2;
+	static const uint32_t c_SrvUavHeapSize = 2 * c_MaxTlasCount;		// per TLAS: the output's UAV, the TLAS SRV
 
 	// createConstantBuffers()
 	ComPtr<ID3D12Resource> m_ConstantBuffer[3];
 
 	// createShaderTable()
-	ComPtr<ID3D12Resource> m_ShaderTable;
+	ComPtr<ID3D12Resource> m_ShaderTable;				// one table per TLAS (its descriptors)
 	uint32_t c_ShaderTableEntrySize = 0;
+	uint32_t c_ShaderTableSize = 0;
+
+	// Render()
+	RenderGraph m_RenderGraph;
+	std::shared_ptr<TransientHeap> m_TransientHeap;
+	uint64_t m_LastGraphHeapBytes = 0;
+
+	// Render(), async: the TLAS the next frame traces. Fences of the compute queue's last refit of each
+	// TLAS (the direct queue waits for it) and of the direct queue's last frame that traced it (the
+	// compute queue waits for it before the next refit)
+	UINT32 m_TlasIndex = 0;
+	UINT64 m_TlasRefitFences[c_MaxTlasCount] = {};
+	UINT64 m_TlasTraceFences[c_MaxTlasCount] = {};
+
+	// Timeline trace: the frames after a warm-up, timers released once the file is written
+	static const UINT32 c_TraceWarmupFrames = 60;
+	std::string m_TracePath;
+	UINT32 m_TraceFrameCount = 0;
+	UINT32 m_TraceFrame = 0;			// frames rendered, warm-up included
+	std::unique_ptr<GpuTimer> m_DirectTimer;
+	std::unique_ptr<GpuTimer> m_ComputeTimer;
+	TimelineTrace m_Trace;
+	uint32_t m_DirectTrack = 0;
+	uint32_t m_ComputeTrack = 0;
 
 private:
 	// View Settings
@@ -8,6 +8,16 @@ int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdL
 	const wchar_t* windowTitle = L"Learning DirectX 12";
 
 	DxrGame game (hInstance, windowTitle, 3500, 1800, false);
+
+	// -asyncAS: TLAS refits on the compute queue, one frame ahead
+	game.SetAsyncAccelerationStructures(wcsstr(lpCmdLine, L"-asyncAS") != nullptr);
+	// -trace [frames]: GPU timeline of the queues (default 120 frames) to DxrGame_timeline.json
+	if (const wchar_t* pTraceArg = wcsstr(lpCmdLine, L"-trace"))
+	{
+		const int frames = _wtoi(pTraceArg + wcslen(L"-trace"));
+		game.EnableTimelineTrace("DxrGame_timeline.json", frames > 0 ? (UINT32)frames : 120);
+	}
+
 	game.InitDXR();
 	game.Run();
 
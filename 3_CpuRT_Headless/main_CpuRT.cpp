@@ -0,0 +1,725 @@
+// Headless (no window, no GPU) tool for the CPU ray tracing code in DX12FrameWork/CpuRT.
+// Builds on Windows through the .vcxproj and on Linux with a plain compiler call, see README.md.
+//
+// Usage:
+//		3_CpuRT_Headless bvh [triangleCount] [threadCount]	- BLAS build time and BVH quality
+//		3_CpuRT_Headless refit [triangleCount] [frameCount]	- per-frame refit vs rebuild of an animated BLAS
+//		3_CpuRT_Headless lbvh [triangleCount] [threadCount]	- SAH vs Morton-code LBVH builds, per-frame LBVH rebuilds
+//		3_CpuRT_Headless render [width] [height] [out.ppm] [golden.ppm] [threadCount] [rotation]
+//																- CPU reference image of 14-Shaders.hlsl, Mrays/s
+//		3_CpuRT_Headless packet [width] [height] [threadCount] [triangleCount]
+//																- single-ray vs SIMD packet traversal, Mrays/s
+//		3_CpuRT_Headless wide [triangleCount] [width] [height]	- binary vs BVH4 vs BVH8: node visits, cache lines, Mrays/s
+//		3_CpuRT_Headless instances [instanceCount] [width] [height] [out.ppm] [threadCount]
+//																- two-level TLAS over many instances of the sample BLAS
+
+#include "../DX12FrameWork/CpuRT/BottomLevelAS.h"
+#include "../DX12FrameWork/CpuRT/SampleScene.h"
+#include "../DX12FrameWork/CpuRT/SampleShaders.h"
+#include "../DX12FrameWork/Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace CpuRT;
+
+// =====================================================================================
+//										Helpers
+// =====================================================================================
+
+static void PrintBvhStats(const char* name, const BvhStats& stats, uint32_t triangleCount)
+{
+	printf("%-28s tris: %9u  nodes: %9u  leaves: %9u  depth: %3u  avgLeaf: %5.2f  SAH: %8.3f  build: %9.2f ms  (%7.1f ms / Mtri)\n",
+		name, triangleCount, stats.nodeCount, stats.leafCount, stats.maxDepth, stats.avgLeafSize, stats.sahCost,
+		stats.buildMs, triangleCount ? stats.buildMs * 1e6 / triangleCount : 0.0);
+}
+
+static uint32_t ArgToUInt(int argc, char** argv, int index, uint32_t defaultValue)
+{
+	return argc > index ? (uint32_t)strtoul(argv[index], nullptr, 10) : defaultValue;
+}
+
+static const char* ArgToString(int argc, char** argv, int index, const char* defaultValue)
+{
+	return argc > index && argv[index][0] != '\0' && strcmp(argv[index], "-") != 0 ? argv[index] : defaultValue;
+}
+
+// =====================================================================================
+//										Commands
+// =====================================================================================
+
+static int RunBvhBenchmark(uint32_t triangleCount, uint32_t threadCount)
+{
+	ThreadPool pool(threadCount);
+	printf("Threads: %u\n", pool.GetThreadCount());
+
+	// The BLASes of the DXR sample - mainly a validation of the input path
+	for (uint32_t blas = 0; blas < 2; blas++)
+	{
+		std::vector<GeometryTrianglesDesc> descs;
+		SampleScene::GetBottomLevelDescs(blas, &descs);
+
+		BottomLevelAS as;
+		as.Build(descs.data(), (uint32_t)descs.size());
+
+		std::string error;
+		if (!as.GetBvh().Validate(as.GetTriangleBounds().data(), &error))
+		{
+			printf("Sample BLAS %u is invalid: %s\n", blas, error.c_str());
+			return 1;
+		}
+		PrintBvhStats(blas == 0 ? "Sample BLAS 0 (tri + plane)" : "Sample BLAS 1 (tri)", as.GetBvh().ComputeStats(), as.GetTriangleCount());
+	}
+
+	// Build time per million triangles
+	std::vector<float3> vertices;
+	std::vector<uint32_t> indices;
+	SampleScene::CreateGridMesh(triangleCount, &vertices, &indices);
+
+	GeometryTrianglesDesc desc;
+	desc.vertexData = vertices.data();
+	desc.vertexCount = (uint32_t)vertices.size();
+	desc.indexData = indices.data();
+	desc.indexFormat = IndexFormat::UInt32;
+	desc.indexCount = (uint32_t)indices.size();
+
+	BvhBuildSettings settings;
+	BottomLevelAS as;
+
+	as.Build(&desc, 1, settings);
+	PrintBvhStats("Grid, SAH, 1 thread", as.GetBvh().ComputeStats(), as.GetTriangleCount());
+
+	settings.pool = &pool;
+	as.Build(&desc, 1, settings);
+	PrintBvhStats("Grid, SAH, thread pool", as.GetBvh().ComputeStats(), as.GetTriangleCount());
+
+	std::string error;
+	if (!as.GetBvh().Validate(as.GetTriangleBounds().data(), &error))
+	{
+		printf("Grid BVH is invalid: %s\n", error.c_str());
+		return 1;
+	}
+	return 0;
+}
+
+// Animates the grid like a per-frame PERFORM_UPDATE: a travelling wave (refit-friendly)
+// plus a swirl that keeps moving triangles away from their BVH siblings (degrades the tree).
+static int RunRefitBenchmark(uint32_t triangleCount, uint32_t frameCount)
+{
+	std::vector<float3> restVertices, vertices;
+	std::vector<uint32_t> indices;
+	SampleScene::CreateGridMesh(triangleCount, &restVertices, &indices);
+	vertices = restVertices;
+
+	GeometryTrianglesDesc desc;
+	desc.vertexData = vertices.data();
+	desc.vertexCount = (uint32_t)vertices.size();
+	desc.indexData = indices.data();
+	desc.indexFormat = IndexFormat::UInt32;
+	desc.indexCount = (uint32_t)indices.size();
+
+	BottomLevelAS as;
+	as.Build(&desc, 1);
+	const double buildMs = as.GetBvh().GetLastBuildMs();
+
+	BvhRefitSettings refitSettings;
+	uint32_t rebuildCount = 0;
+	double totalMs = 0.0;
+
+	for (uint32_t frame = 1; frame <= frameCount; frame++)
+	{
+		const float t = frame * 0.05f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const float3& p = restVertices[i];
+			float r = std::sqrt(p.x * p.x + p.z * p.z);
+			float angle = 3.0f * t * r;
+			float c = std::cos(angle), s = std::sin(angle);
+			vertices[i] = float3(p.x * c - p.z * s, p.y + 0.1f * std::sin(r * 10.0f - t * 4.0f), p.x * s + p.z * c);
+		}
+
+		BvhUpdateResult result = as.Update(&desc, 1, refitSettings);
+		totalMs += result.ms;
+		rebuildCount += result.rebuilt ? 1 : 0;
+
+		printf("frame %4u  %s  SAH growth: %5.3f  %8.2f ms\n", frame, result.rebuilt ? "REBUILD" : "refit  ", result.sahGrowth, result.ms);
+	}
+
+	printf("Full build: %.2f ms, average update: %.2f ms, rebuilds: %u / %u frames (max SAH growth %.2f)\n",
+		buildMs, frameCount ? totalMs / frameCount : 0.0, rebuildCount, frameCount, refitSettings.maxSahGrowth);
+	return 0;
+}
+
+// SAH vs LBVH (30 and 63 bit Morton codes) on the grid: build time and tree quality, then
+// a full LBVH rebuild every frame of the refit animation - the dynamic geometry use case.
+static int RunLbvhBenchmark(uint32_t triangleCount, uint32_t threadCount)
+{
+	ThreadPool pool(threadCount);
+	printf("Threads: %u\n", pool.GetThreadCount());
+
+	std::vector<float3> restVertices, vertices;
+	std::vector<uint32_t> indices;
+	SampleScene::CreateGridMesh(triangleCount, &restVertices, &indices);
+	vertices = restVertices;
+
+	GeometryTrianglesDesc desc;
+	desc.vertexData = vertices.data();
+	desc.vertexCount = (uint32_t)vertices.size();
+	desc.indexData = indices.data();
+	desc.indexFormat = IndexFormat::UInt32;
+	desc.indexCount = (uint32_t)indices.size();
+
+	struct Config
+	{
+		const char* name;
+		BvhBuilder builder;
+		uint32_t mortonCodeBits;
+	};
+	const Config configs[] =
+	{
+		{ "Grid, SAH",     BvhBuilder::BinnedSah, 30 },
+		{ "Grid, LBVH 30", BvhBuilder::Lbvh,      30 },
+		{ "Grid, LBVH 63", BvhBuilder::Lbvh,      63 },
+	};
+
+	BottomLevelAS as;
+	for (const Config& config : configs)
+	{
+		BvhBuildSettings settings;
+		settings.builder = config.builder;
+		settings.mortonCodeBits = config.mortonCodeBits;
+		settings.pool = &pool;
+		as.Build(&desc, 1, settings);
+
+		std::string error;
+		if (!as.GetBvh().Validate(as.GetTriangleBounds().data(), &error))
+		{
+			printf("%s BVH is invalid: %s\n", config.name, error.c_str());
+			return 1;
+		}
+		PrintBvhStats(config.name, as.GetBvh().ComputeStats(), as.GetTriangleCount());
+	}
+
+	// Same animation as the refit command, but rebuilt from scratch every frame
+	const uint32_t frameCount = 20;
+	BvhBuildSettings settings;
+	settings.builder = BvhBuilder::Lbvh;
+	settings.pool = &pool;
+	double totalMs = 0.0, totalSah = 0.0;
+	for (uint32_t frame = 1; frame <= frameCount; frame++)
+	{
+		const float t = frame * 0.05f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const float3& p = restVertices[i];
+			float r = std::sqrt(p.x * p.x + p.z * p.z);
+			float angle = 3.0f * t * r;
+			float c = std::cos(angle), s = std::sin(angle);
+			vertices[i] = float3(p.x * c - p.z * s, p.y + 0.1f * std::sin(r * 10.0f - t * 4.0f), p.x * s + p.z * c);
+		}
+
+		as.Build(&desc, 1, settings);
+		totalMs += as.GetBvh().GetLastBuildMs();
+		totalSah += as.GetBvh().ComputeStats().sahCost;
+	}
+	printf("Animated grid, LBVH rebuild every frame: average %.2f ms, average SAH %.3f (%u frames)\n",
+		totalMs / frameCount, totalSah / frameCount, frameCount);
+	return 0;
+}
+
+// Renders the 2_RT_TrianglesRefit scene with the C++ port of 14-Shaders.hlsl.
+// With a golden image the exit code is non-zero if any pixel differs by more than 1/255
+// (rounding of the sRGB approximation may differ by one step between CPU and GPU).
+static int RunRender(uint32_t width, uint32_t height, const char* outPath, const char* goldenPath, uint32_t threadCount, float rotation)
+{
+	ThreadPool pool(threadCount);
+	printf("Threads: %u, %u x %u\n", pool.GetThreadCount(), width, height);
+
+	BottomLevelAS blas[2];
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		std::vector<GeometryTrianglesDesc> descs;
+		SampleScene::GetBottomLevelDescs(i, &descs);
+		blas[i].Build(descs.data(), (uint32_t)descs.size());
+	}
+
+	InstanceDesc instances[3];
+	SampleShaders::CreateInstanceDescs(rotation, &blas[0], &blas[1], instances);
+	TopLevelAS tlas;
+	tlas.Build(instances, 3);
+
+	ShaderTable shaderTable;
+	SampleShaders::CreateShaderTable(&shaderTable);
+
+	Image output;
+	output.Resize(width, height);
+
+	DispatchRaysDesc desc;
+	desc.pShaderTable = &shaderTable;
+	desc.pScene = &tlas;
+	desc.pOutput = &output;
+	desc.Width = width;
+	desc.Height = height;
+	desc.pool = &pool;
+
+	// First dispatch warms up the caches, the second one is measured
+	DispatchRays(desc);
+	DispatchStats stats = DispatchRays(desc);
+	printf("Rays: %llu  time: %.2f ms  %.2f Mrays/s\n", (unsigned long long)stats.rayCount, stats.ms, stats.GetMRaysPerSecond());
+
+	if (outPath)
+	{
+		if (!output.WritePPM(outPath))
+		{
+			printf("Failed to write %s\n", outPath);
+			return 1;
+		}
+		printf("Wrote %s\n", outPath);
+	}
+
+	if (goldenPath)
+	{
+		Image golden;
+		if (!golden.ReadPPM(goldenPath))
+		{
+			printf("Failed to read %s\n", goldenPath);
+			return 1;
+		}
+
+		ImageDiff diff = Image::Compare(output, golden, 1);
+		if (diff.sizeMismatch)
+		{
+			printf("Golden image %s has a different size\n", goldenPath);
+			return 1;
+		}
+		printf("Golden image: %u pixels differ (max channel difference %u)\n", diff.differentPixels, diff.maxChannelDiff);
+		return diff.differentPixels ? 1 : 0;
+	}
+	return 0;
+}
+
+// Camera of rayGen() generalized to any eye / target: for eye (0, 0, -2) and target (0, 0, 0)
+// the directions are exactly those of 14-Shaders.hlsl.
+struct PinholeCamera
+{
+	float3 eye, right, up, forward;
+
+	PinholeCamera(const float3& eye_, const float3& target) : eye(eye_)
+	{
+		forward = normalize(target - eye);
+		right = normalize(cross(float3(0, 1, 0), forward));
+		up = cross(forward, right);
+	}
+
+	RayDesc GetRay(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+	{
+		float dx = (float)x / width * 2.f - 1.f;
+		float dy = (float)y / height * 2.f - 1.f;
+		float aspectRatio = (float)width / height;
+
+		RayDesc ray;
+		ray.Origin = eye;
+		ray.Direction = normalize(right * (dx * aspectRatio) - up * dy + forward);
+		ray.TMin = 0;
+		ray.TMax = 100000;
+		return ray;
+	}
+};
+
+struct TraceResult
+{
+	std::vector<HitInfo> primaryHits;
+	std::vector<uint8_t> shadowed;
+	uint64_t rayCount = 0;
+	double ms = 0.0;
+};
+
+// Primary rays for every pixel plus a shadow ray (any hit, like planeChs) from every primary hit.
+// With packets the screen is walked in blocks of kSimdWidth pixels; the shadow rays of a block
+// are compacted into one packet.
+static void TraceScene(const TopLevelAS& tlas, const PinholeCamera& camera, uint32_t width, uint32_t height,
+	bool packets, ThreadPool& pool, TraceResult* pResult)
+{
+	const uint32_t blockH = kSimdWidth >= 4 ? 2 : 1;
+	const uint32_t blockW = kSimdWidth / blockH;
+	const uint32_t tileSize = 16;
+	const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+	const uint32_t tilesY = (height + tileSize - 1) / tileSize;
+	const float3 lightDir = normalize(float3(0.5f, 0.5f, -0.5f));
+	const uint32_t shadowFlags = RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER;
+
+	pResult->primaryHits.assign(width * height, HitInfo());
+	pResult->shadowed.assign(width * height, 0);
+	std::vector<uint64_t> rayCounters(pool.GetThreadCount() * 8, 0);
+
+	auto traceTile = [&](uint32_t tile, uint32_t worker)
+	{
+		const uint32_t x0 = (tile % tilesX) * tileSize, x1 = std::min(x0 + tileSize, width);
+		const uint32_t y0 = (tile / tilesX) * tileSize, y1 = std::min(y0 + tileSize, height);
+		uint64_t& rayCount = rayCounters[worker * 8];
+
+		for (uint32_t by = y0; by < y1; by += blockH)
+		{
+			for (uint32_t bx = x0; bx < x1; bx += blockW)
+			{
+				// Pixels of the block, clipped to the tile
+				RayDesc rays[kSimdWidth];
+				uint32_t pixels[kSimdWidth];
+				uint32_t count = 0;
+				for (uint32_t y = by; y < std::min(by + blockH, y1); y++)
+				{
+					for (uint32_t x = bx; x < std::min(bx + blockW, x1); x++)
+					{
+						rays[count] = camera.GetRay(x, y, width, height);
+						pixels[count++] = y * width + x;
+					}
+				}
+
+				HitInfo hits[kSimdWidth];
+				if (packets)
+				{
+					tlas.IntersectPacket(rays, count, RAY_FLAG_NONE, 0xFF, hits);
+				}
+				else
+				{
+					for (uint32_t i = 0; i < count; i++)
+						tlas.Intersect(rays[i], RAY_FLAG_NONE, 0xFF, &hits[i]);
+				}
+				rayCount += count;
+
+				RayDesc shadowRays[kSimdWidth];
+				uint32_t shadowPixels[kSimdWidth];
+				uint32_t shadowCount = 0;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					pResult->primaryHits[pixels[i]] = hits[i];
+					if (!hits[i].IsHit())
+						continue;
+
+					RayDesc& shadowRay = shadowRays[shadowCount];
+					shadowRay.Origin = rays[i].Origin + rays[i].Direction * hits[i].t;
+					shadowRay.Direction = lightDir;
+					shadowRay.TMin = 0.01f;
+					shadowRay.TMax = 100000;
+					shadowPixels[shadowCount++] = pixels[i];
+				}
+				if (shadowCount == 0)
+					continue;
+
+				HitInfo shadowHits[kSimdWidth];
+				if (packets)
+				{
+					uint32_t hitBits = tlas.IntersectPacket(shadowRays, shadowCount, shadowFlags, 0xFF, shadowHits);
+					for (uint32_t i = 0; i < shadowCount; i++)
+						pResult->shadowed[shadowPixels[i]] = (hitBits >> i) & 1u;
+				}
+				else
+				{
+					for (uint32_t i = 0; i < shadowCount; i++)
+						pResult->shadowed[shadowPixels[i]] = tlas.Intersect(shadowRays[i], shadowFlags, 0xFF, &shadowHits[i]) ? 1 : 0;
+				}
+				rayCount += shadowCount;
+			}
+		}
+	};
+
+	auto startTime = std::chrono::steady_clock::now();
+	ParallelForWorkStealing(pool, tilesX * tilesY, traceTile);
+	pResult->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	pResult->rayCount = 0;
+	for (uint32_t w = 0; w < pool.GetThreadCount(); w++)
+		pResult->rayCount += rayCounters[w * 8];
+}
+
+static void ComparePacketTraversal(const char* name, const TopLevelAS& tlas, const PinholeCamera& camera,
+	uint32_t width, uint32_t height, ThreadPool& pool)
+{
+	TraceResult single, packet;
+	// Warm-up, then the measured runs
+	TraceScene(tlas, camera, width, height, false, pool, &single);
+	TraceScene(tlas, camera, width, height, false, pool, &single);
+	TraceScene(tlas, camera, width, height, true, pool, &packet);
+
+	// Both must find the same surfaces - t may differ in the last bits, not the triangle
+	uint32_t mismatches = 0;
+	for (size_t i = 0; i < single.primaryHits.size(); i++)
+	{
+		const HitInfo& a = single.primaryHits[i];
+		const HitInfo& b = packet.primaryHits[i];
+		if (a.IsHit() != b.IsHit() || single.shadowed[i] != packet.shadowed[i] ||
+			(a.IsHit() && (a.instanceIndex != b.instanceIndex || a.geometryIndex != b.geometryIndex || a.primitiveIndex != b.primitiveIndex)))
+			mismatches++;
+	}
+
+	const double singleMrays = single.rayCount / (single.ms * 1000.0);
+	const double packetMrays = packet.rayCount / (packet.ms * 1000.0);
+	printf("%-28s rays: %9llu  single: %7.2f Mrays/s  packet: %7.2f Mrays/s  (x%.2f)  mismatching pixels: %u\n",
+		name, (unsigned long long)single.rayCount, singleMrays, packetMrays, singleMrays > 0.0 ? packetMrays / singleMrays : 0.0, mismatches);
+}
+
+static int RunPacketBenchmark(uint32_t width, uint32_t height, uint32_t threadCount, uint32_t triangleCount)
+{
+	ThreadPool pool(threadCount);
+	printf("Threads: %u, %u x %u, packets of %u rays\n", pool.GetThreadCount(), width, height, kSimdWidth);
+
+	// The 2_RT_TrianglesRefit scene with the camera of rayGen()
+	{
+		BottomLevelAS blas[2];
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			std::vector<GeometryTrianglesDesc> descs;
+			SampleScene::GetBottomLevelDescs(i, &descs);
+			blas[i].Build(descs.data(), (uint32_t)descs.size());
+		}
+
+		InstanceDesc instances[3];
+		SampleShaders::CreateInstanceDescs(30.0f, &blas[0], &blas[1], instances);
+		TopLevelAS tlas;
+		tlas.Build(instances, 3);
+
+		ComparePacketTraversal("Sample scene", tlas, PinholeCamera(float3(0, 0, -2), float3(0, 0, 0)), width, height, pool);
+	}
+
+	// A dense mesh seen from above
+	{
+		std::vector<float3> vertices;
+		std::vector<uint32_t> indices;
+		SampleScene::CreateGridMesh(triangleCount, &vertices, &indices);
+
+		GeometryTrianglesDesc desc;
+		desc.vertexData = vertices.data();
+		desc.vertexCount = (uint32_t)vertices.size();
+		desc.indexData = indices.data();
+		desc.indexFormat = IndexFormat::UInt32;
+		desc.indexCount = (uint32_t)indices.size();
+
+		BvhBuildSettings settings;
+		settings.pool = &pool;
+		BottomLevelAS blas;
+		blas.Build(&desc, 1, settings);
+
+		InstanceDesc instance;
+		instance.AccelerationStructure = &blas;
+		TopLevelAS tlas;
+		tlas.Build(&instance, 1);
+
+		char name[64];
+		snprintf(name, sizeof(name), "Grid, %u tris", blas.GetTriangleCount());
+		ComparePacketTraversal(name, tlas, PinholeCamera(float3(0, 1.5f, -1.8f), float3(0, 0, 0)), width, height, pool);
+	}
+	return 0;
+}
+
+// Single-threaded on purpose: the per-ray counters are the point of this benchmark
+static int RunWideBvhBenchmark(uint32_t triangleCount, uint32_t width, uint32_t height)
+{
+	std::vector<float3> vertices;
+	std::vector<uint32_t> indices;
+	SampleScene::CreateGridMesh(triangleCount, &vertices, &indices);
+
+	GeometryTrianglesDesc desc;
+	desc.vertexData = vertices.data();
+	desc.vertexCount = (uint32_t)vertices.size();
+	desc.indexData = indices.data();
+	desc.indexFormat = IndexFormat::UInt32;
+	desc.indexCount = (uint32_t)indices.size();
+
+	const PinholeCamera camera(float3(0, 1.5f, -1.8f), float3(0, 0, 0));
+	const float3 lightDir = normalize(float3(0.5f, 0.5f, -0.5f));
+	std::vector<HitInfo> referenceHits;
+
+	printf("%u triangles, %u x %u primary + shadow rays, SIMD width %u\n", (uint32_t)indices.size() / 3, width, height, kSimdWidth);
+
+	const uint32_t branchingFactors[] = { 2, 4, 8 };
+	for (uint32_t branchingFactor : branchingFactors)
+	{
+		BvhBuildSettings settings;
+		settings.branchingFactor = branchingFactor;
+		BottomLevelAS as;
+		as.Build(&desc, 1, settings);
+
+		size_t memory = as.GetBvh().GetNodes().size() * sizeof(BvhNode);
+		double collapseMs = 0.0;
+		if (branchingFactor == 4)
+		{
+			memory = as.GetBvh4().GetMemorySize();
+			collapseMs = as.GetBvh4().GetLastCollapseMs();
+		}
+		else if (branchingFactor == 8)
+		{
+			memory = as.GetBvh8().GetMemorySize();
+			collapseMs = as.GetBvh8().GetLastCollapseMs();
+		}
+
+		std::vector<HitInfo> hits(width * height);
+		BvhTraversalStats stats;
+		auto startTime = std::chrono::steady_clock::now();
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				RayDesc ray = camera.GetRay(x, y, width, height);
+				float tmax = ray.TMax;
+				HitInfo& hit = hits[y * width + x];
+				if (!as.Intersect(TraversalRay(ray.Origin, ray.Direction, ray.TMin, RAY_FLAG_NONE), tmax, &hit, &stats))
+					continue;
+
+				TraversalRay shadowRay(ray.Origin + ray.Direction * hit.t, lightDir, 0.01f, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH);
+				HitInfo shadowHit;
+				float shadowTMax = 100000.0f;
+				as.Intersect(shadowRay, shadowTMax, &shadowHit, &stats);
+			}
+		}
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+		uint32_t mismatches = 0;
+		if (referenceHits.empty())
+			referenceHits = hits;
+		for (size_t i = 0; i < hits.size(); i++)
+			mismatches += hits[i].IsHit() != referenceHits[i].IsHit() || hits[i].primitiveIndex != referenceHits[i].primitiveIndex;
+
+		const double rays = (double)std::max<uint64_t>(1, stats.rays);
+		printf("BVH%u  nodes: %8.2f MB  collapse: %6.2f ms  visits/ray: %6.2f  cache lines/ray: %6.2f  tris/ray: %5.2f  %6.2f Mrays/s  mismatches: %u\n",
+			branchingFactor, memory / (1024.0 * 1024.0), collapseMs, stats.nodeVisits / rays, stats.cacheLines / rays,
+			stats.primTests / rays, stats.rays / (ms * 1000.0), mismatches);
+	}
+	return 0;
+}
+
+// The sample scene with the triangle BLAS instanced 'instanceCount' - 1 times over the plane.
+// The instance descs go through the D3D12_RAYTRACING_INSTANCE_DESC layout, with made-up GPU
+// addresses standing in for the BLAS resources.
+static int RunInstancingBenchmark(uint32_t instanceCount, uint32_t width, uint32_t height, const char* outPath, uint32_t threadCount)
+{
+	ThreadPool pool(threadCount);
+	instanceCount = std::max(instanceCount, 1u);
+
+	BottomLevelAS blas[2];
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		std::vector<GeometryTrianglesDesc> descs;
+		SampleScene::GetBottomLevelDescs(i, &descs);
+		blas[i].Build(descs.data(), (uint32_t)descs.size());
+	}
+	const uint64_t kBlasAddress[2] = { 0x10000, 0x20000 };
+
+	// Instance 0 as in BuildTopLevelAS(), the rest on a grid in front of the camera
+	std::vector<D3D12InstanceDesc> instances(instanceCount);
+	const uint32_t columns = (uint32_t)std::ceil(std::sqrt((float)instanceCount));
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		D3D12InstanceDesc& desc = instances[i];
+		memset(&desc, 0, sizeof(desc));
+
+		float3x4 transform = float3x4::Identity();
+		if (i > 0)
+		{
+			const float x = -20.0f + 40.0f * ((i % columns) + 0.5f) / columns;
+			const float z = 2.0f + 60.0f * ((i / columns) + 0.5f) / columns;
+			transform = float3x4::RotationYTranslation(i * 0.7f, float3(x, 0, z));
+		}
+		memcpy(desc.Transform, transform.m, sizeof(desc.Transform));
+		desc.InstanceID = i;
+		desc.InstanceMask = 0xFF;
+		desc.InstanceContributionToHitGroupIndex = i == 0 ? 0 : (i % 2) * 2 + 4;
+		desc.AccelerationStructure = kBlasAddress[i == 0 ? 0 : 1];
+	}
+
+	BvhBuildSettings settings;
+	settings.pool = &pool;
+	TopLevelAS tlas;
+	tlas.Build(instances.data(), instanceCount, [&](uint64_t address) { return address == kBlasAddress[0] ? &blas[0] : &blas[1]; }, settings);
+
+	const size_t sharedBytes = (blas[0].GetTriangleCount() + blas[1].GetTriangleCount()) * sizeof(Triangle);
+	const size_t flattenedBytes = (blas[0].GetTriangleCount() + (size_t)(instanceCount - 1) * blas[1].GetTriangleCount()) * sizeof(Triangle);
+	printf("Threads: %u, %u instances, TLAS build: %.2f ms, geometry: %zu bytes shared instead of %zu flattened\n",
+		pool.GetThreadCount(), instanceCount, tlas.GetLastBuildMs(), sharedBytes, flattenedBytes);
+
+	// The two-level traversal must find what testing every instance finds
+	const PinholeCamera camera(float3(0, 0, -2), float3(0, 0, 0));
+	uint32_t mismatches = 0, checked = 0;
+	for (uint32_t y = 0; y < height; y += 7)
+	{
+		for (uint32_t x = 0; x < width; x += 7, checked++)
+		{
+			const RayDesc ray = camera.GetRay(x, y, width, height);
+			HitInfo hit;
+			tlas.Intersect(ray, RAY_FLAG_NONE, 0xFF, &hit);
+
+			float tmax = ray.TMax;
+			HitInfo reference;
+			for (uint32_t i = 0; i < tlas.GetInstanceCount(); i++)
+			{
+				const InstanceDesc& instance = tlas.GetInstance(i);
+				const float3x4 worldToObject = instance.Transform.Inverse();
+				TraversalRay objectRay(worldToObject.TransformPoint(ray.Origin), worldToObject.TransformVector(ray.Direction), ray.TMin, RAY_FLAG_NONE);
+				if (instance.AccelerationStructure->Intersect(objectRay, tmax, &reference))
+					reference.instanceIndex = i;
+			}
+
+			if (hit.IsHit() != reference.IsHit() || (hit.IsHit() && (hit.instanceIndex != reference.instanceIndex || hit.primitiveIndex != reference.primitiveIndex)))
+				mismatches++;
+		}
+	}
+	printf("Two-level vs brute-force traversal: %u / %u rays differ\n", mismatches, checked);
+
+	ShaderTable shaderTable;
+	SampleShaders::CreateShaderTable(&shaderTable);
+	Image output;
+	output.Resize(width, height);
+
+	DispatchRaysDesc desc;
+	desc.pShaderTable = &shaderTable;
+	desc.pScene = &tlas;
+	desc.pOutput = &output;
+	desc.Width = width;
+	desc.Height = height;
+	desc.pool = &pool;
+
+	DispatchRays(desc);
+	DispatchStats stats = DispatchRays(desc);
+	printf("Rays: %llu  time: %.2f ms  %.2f Mrays/s\n", (unsigned long long)stats.rayCount, stats.ms, stats.GetMRaysPerSecond());
+
+	if (outPath && !output.WritePPM(outPath))
+	{
+		printf("Failed to write %s\n", outPath);
+		return 1;
+	}
+	return mismatches ? 1 : 0;
+}
+
+// =====================================================================================
+//										Main
+// =====================================================================================
+
+int main(int argc, char** argv)
+{
+	const char* command = argc > 1 ? argv[1] : "bvh";
+
+	if (strcmp(command, "bvh") == 0)
+		return RunBvhBenchmark(ArgToUInt(argc, argv, 2, 1000000), ArgToUInt(argc, argv, 3, 0));
+	if (strcmp(command, "refit") == 0)
+		return RunRefitBenchmark(ArgToUInt(argc, argv, 2, 1000000), ArgToUInt(argc, argv, 3, 100));
+	if (strcmp(command, "lbvh") == 0)
+		return RunLbvhBenchmark(ArgToUInt(argc, argv, 2, 1000000), ArgToUInt(argc, argv, 3, 0));
+	if (strcmp(command, "render") == 0)
+		return RunRender(ArgToUInt(argc, argv, 2, 1280), ArgToUInt(argc, argv, 3, 720), ArgToString(argc, argv, 4, "cpurt.ppm"),
+			ArgToString(argc, argv, 5, nullptr), ArgToUInt(argc, argv, 6, 0), argc > 7 ? (float)atof(argv[7]) : 0.0f);
+	if (strcmp(command, "packet") == 0)
+		return RunPacketBenchmark(ArgToUInt(argc, argv, 2, 1280), ArgToUInt(argc, argv, 3, 720), ArgToUInt(argc, argv, 4, 0),
+			ArgToUInt(argc, argv, 5, 1000000));
+	if (strcmp(command, "wide") == 0)
+		return RunWideBvhBenchmark(ArgToUInt(argc, argv, 2, 1000000), ArgToUInt(argc, argv, 3, 1280), ArgToUInt(argc, argv, 4, 720));
+	if (strcmp(command, "instances") == 0)
+		return RunInstancingBenchmark(ArgToUInt(argc, argv, 2, 10000), ArgToUInt(argc, argv, 3, 1280), ArgToUInt(argc, argv, 4, 720),
+			ArgToString(argc, argv, 5, nullptr), ArgToUInt(argc, argv, 6, 0));
+
+	printf("Unknown command: %s\n", command);
+	return 1;
+}
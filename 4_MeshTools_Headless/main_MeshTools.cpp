@@ -0,0 +1,1067 @@
+// Headless (no window, no GPU) tool for the mesh processing code in DX12FrameWork/MeshTools.
+// Builds on Windows through the .vcxproj and on Linux with a plain compiler call, see README.md.
+//
+// Usage:
+//		4_MeshTools_Headless obj [file.obj] [threadCount]	- OBJ import throughput (MB/s), single thread vs pool
+//		4_MeshTools_Headless vcache [file.obj|file.cooked] [cacheSize]
+//																- vertex cache optimization, ACMR/ATVR before and after
+//		4_MeshTools_Headless optimize [file.obj|file.cooked] [overdrawThreshold]
+//																- vertex cache, overdraw or meshlet order, vertex fetch; stats per step
+//		4_MeshTools_Headless meshlets [file.obj|file.cooked] [cameraCount]
+//																- meshlet sizes, CPU cluster culling from orbit cameras
+//		4_MeshTools_Headless quantize [file.obj|file.cooked]	- packed vertex formats: size, encode/decode MB/s, error
+//		4_MeshTools_Headless simplify [file.obj|file.cooked] [pixelError]
+//																- LOD chain: triangles, errors, seams kept; LOD selection by distance
+
+#include "../DX12FrameWork/MeshTools/CookedMesh.h"
+#include "../DX12FrameWork/MeshTools/Meshlet.h"
+#include "../DX12FrameWork/MeshTools/ObjLoader.h"
+#include "../DX12FrameWork/MeshTools/Overdraw.h"
+#include "../DX12FrameWork/MeshTools/Simplify.h"
+#include "../DX12FrameWork/MeshTools/VertexCache.h"
+#include "../DX12FrameWork/MeshTools/VertexFetch.h"
+#include "../DX12FrameWork/MeshTools/VertexQuantization.h"
+#include "../DX12FrameWork/Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+
+using namespace MeshTools;
+
+// =====================================================================================
+//										Helpers
+// =====================================================================================
+
+static uint32_t ArgToUInt(int argc, char** argv, int index, uint32_t defaultValue)
+{
+	return argc > index ? (uint32_t)strtoul(argv[index], nullptr, 10) : defaultValue;
+}
+
+static const char* ArgToString(int argc, char** argv, int index, const char* defaultValue)
+{
+	return argc > index && argv[index][0] != '\0' && strcmp(argv[index], "-") != 0 ? argv[index] : defaultValue;
+}
+
+static void PrintObjStats(const char* name, const ObjLoadStats& stats)
+{
+	printf("%-22s chunks: %4u  parse: %8.2f ms  weld+pack: %8.2f ms  total: %8.2f ms  (%7.1f MB/s)\n",
+		name, stats.chunkCount, stats.parseMs, stats.weldMs, stats.totalMs,
+		stats.totalMs > 0.0 ? stats.bytes / (stats.totalMs * 1e3) : 0.0);
+}
+
+// Synthetic OBJ: objectCount wavy grids with positions, uvs and normals, quads only.
+// Every second object uses relative (negative) indices and CRLF line ends.
+static std::string GenerateObj(uint32_t objectCount, uint32_t gridSize, uint32_t* pExpectedTriangles, uint32_t* pExpectedVertices)
+{
+	std::string text = "# Generated by 4_MeshTools_Headless\nmtllib generated.mtl\n";
+	char line[256];
+	*pExpectedTriangles = 0;
+	*pExpectedVertices = 0;
+
+	uint32_t positionCount = 0;
+	for (uint32_t object = 0; object < objectCount; object++)
+	{
+		// Alternating sizes: parts with 16- and 32-bit indices
+		const uint32_t n = object % 2 ? gridSize : gridSize / 2;
+		const bool relative = object % 2 == 1;
+		const char* eol = relative ? "\r\n" : "\n";
+
+		snprintf(line, sizeof(line), "o Grid%u%susemtl Material%u%ss off%s", object, eol, object % 3, eol, eol);
+		text += line;
+
+		for (uint32_t y = 0; y <= n; y++)
+		{
+			for (uint32_t x = 0; x <= n; x++)
+			{
+				const float u = (float)x / n, v = (float)y / n;
+				const float h = 0.1f * sinf(u * 12.0f + object) * cosf(v * 9.0f);
+				snprintf(line, sizeof(line), "v %.6f %.6f %.6f%s", u * 10.0f + object * 11.0f, h, v * 10.0f, eol);
+				text += line;
+			}
+		}
+		for (uint32_t y = 0; y <= n; y++)
+		{
+			for (uint32_t x = 0; x <= n; x++)
+			{
+				snprintf(line, sizeof(line), "vt %.6f %.6f%s", (float)x / n, (float)y / n, eol);
+				text += line;
+			}
+		}
+		for (uint32_t y = 0; y <= n; y++)
+		{
+			for (uint32_t x = 0; x <= n; x++)
+			{
+				snprintf(line, sizeof(line), "vn %.5e %.5e %.5e%s", 0.01f * x / n, 0.9999f, -0.01f * y / n, eol);
+				text += line;
+			}
+		}
+
+		// Attributes of a vertex share the index (relative to the object's own block)
+		const int64_t rowVertices = n + 1, objectVertices = rowVertices * rowVertices;
+		auto index = [&](uint32_t x, uint32_t y) -> int64_t
+		{
+			const int64_t local = y * rowVertices + x;
+			return relative ? local - objectVertices : positionCount + local + 1;
+		};
+		for (uint32_t y = 0; y < n; y++)
+		{
+			for (uint32_t x = 0; x < n; x++)
+			{
+				const int64_t a = index(x, y), b = index(x + 1, y), c = index(x + 1, y + 1), d = index(x, y + 1);
+				snprintf(line, sizeof(line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld%s",
+					(long long)a, (long long)a, (long long)a, (long long)b, (long long)b, (long long)b,
+					(long long)c, (long long)c, (long long)c, (long long)d, (long long)d, (long long)d, eol);
+				text += line;
+			}
+		}
+
+		positionCount += (uint32_t)objectVertices;
+		*pExpectedTriangles += n * n * 2;
+		*pExpectedVertices += (uint32_t)objectVertices;
+	}
+	return text;
+}
+
+// Synthetic closed OBJ: objectCount tori (normals, no uvs) crossing each other, so that
+// some surfaces hide others from every direction - the case overdraw ordering is about.
+// uvSeams: with wrapping uvs, which splits the vertices along two circles of every torus.
+static std::string GenerateTorusObj(uint32_t objectCount, uint32_t ringCount, uint32_t sideCount, bool uvSeams = false)
+{
+	std::string text = "# Generated by 4_MeshTools_Headless\n";
+	char line[256];
+	const float kPi = 3.14159265f;
+
+	uint32_t positionCount = 0, uvCount = 0;
+	for (uint32_t object = 0; object < objectCount; object++)
+	{
+		snprintf(line, sizeof(line), "o Torus%u\n", object);
+		text += line;
+
+		// Tori around the origin, each one tilted differently
+		const float tilt = kPi * object / objectCount;
+		const float ct = cosf(tilt), st = sinf(tilt);
+		const float radius = 1.0f + 0.15f * object, thickness = 0.35f;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (uint32_t r = 0; r < ringCount; r++)
+			{
+				for (uint32_t s = 0; s < sideCount; s++)
+				{
+					const float u = 2.0f * kPi * r / ringCount, v = 2.0f * kPi * s / sideCount;
+					const float nx = cosf(u) * cosf(v), ny = sinf(u) * cosf(v), nz = sinf(v);
+					const float px = cosf(u) * radius + nx * thickness, py = sinf(u) * radius + ny * thickness, pz = nz * thickness;
+					if (pass == 0)
+						snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", px, py * ct - pz * st, py * st + pz * ct);
+					else
+						snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", nx, ny * ct - nz * st, ny * st + nz * ct);
+					text += line;
+				}
+			}
+		}
+
+		// (ringCount + 1) x (sideCount + 1) uvs: the last row/column repeats the positions of the first
+		if (uvSeams)
+		{
+			for (uint32_t r = 0; r <= ringCount; r++)
+			{
+				for (uint32_t s = 0; s <= sideCount; s++)
+				{
+					snprintf(line, sizeof(line), "vt %.6f %.6f\n", 4.0f * r / ringCount, (float)s / sideCount);
+					text += line;
+				}
+			}
+		}
+
+		auto index = [&](uint32_t r, uint32_t s) { return positionCount + (r % ringCount) * sideCount + (s % sideCount) + 1; };
+		auto uvIndex = [&](uint32_t r, uint32_t s) { return uvCount + r * (sideCount + 1) + s + 1; };
+		for (uint32_t r = 0; r < ringCount; r++)
+		{
+			for (uint32_t s = 0; s < sideCount; s++)
+			{
+				const uint32_t a = index(r, s), b = index(r + 1, s), c = index(r + 1, s + 1), d = index(r, s + 1);
+				if (uvSeams)
+				{
+					const uint32_t ta = uvIndex(r, s), tb = uvIndex(r + 1, s), tc = uvIndex(r + 1, s + 1), td = uvIndex(r, s + 1);
+					snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, ta, a, b, tb, b, c, tc, c, d, td, d);
+				}
+				else
+				{
+					snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u %u//%u\n", a, a, b, b, c, c, d, d);
+				}
+				text += line;
+			}
+		}
+		positionCount += ringCount * sideCount;
+		uvCount += uvSeams ? (ringCount + 1) * (sideCount + 1) : 0;
+	}
+	return text;
+}
+
+// Loads an OBJ file, a cooked mesh of 2_Mesh ("2_Mesh.exe -cook <file>") or, without a path, generatedText
+static bool LoadMesh(const char* path, const std::string& generatedText, IndexedMesh* pOutMesh)
+{
+	pOutMesh->Clear();
+	if (!path)
+		return ParseObj(generatedText.data(), generatedText.size(), pOutMesh, &ThreadPool::GetDefault());
+
+	const size_t length = strlen(path);
+	if (length < 7 || strcmp(path + length - 7, ".cooked") != 0)
+	{
+		std::string error;
+		if (!LoadObj(path, pOutMesh, &ThreadPool::GetDefault(), nullptr, &error))
+		{
+			printf("%s\n", error.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// The source file isn't needed here - accept whatever hash, stride and format the cache was written with
+	MappedFile file;
+	if (!file.Open(path) || file.GetSize() < sizeof(CookedMeshHeader))
+		return false;
+	const CookedMeshHeader header = *reinterpret_cast<const CookedMeshHeader*>(file.GetData());
+	file.Close();
+
+	CookedMesh cookedMesh;
+	if (!cookedMesh.Open(path, header.sourceHash, header.vertexStride, VertexFormat::FromBits(header.vertexFormat)))
+		return false;
+
+	// Vertices only come along in a MeshVertex format (VertexPosColor of 2_Mesh), packed ones
+	// are decoded part by part with the bounds of the part
+	const VertexFormat format = cookedMesh.GetVertexFormat();
+	if (cookedMesh.GetVertexStride() == format.GetStride())
+	{
+		const uint8_t* pVertexData = static_cast<const uint8_t*>(cookedMesh.GetVertexData());
+		pOutMesh->vertices.resize(cookedMesh.GetVertexCount());
+		for (uint32_t i = 0; i < cookedMesh.GetSubmeshCount(); i++)
+		{
+			const CookedSubmesh& cooked = cookedMesh.GetSubmeshes()[i];
+			if (cooked.baseVertex + (uint64_t)cooked.vertexCount > pOutMesh->vertices.size())
+				return false;
+			QuantizationBounds bounds;
+			memcpy(bounds.offset, cooked.positionOffset, sizeof(bounds.offset));
+			memcpy(bounds.scale, cooked.positionScale, sizeof(bounds.scale));
+			DecodeVertices(pVertexData + (size_t)cooked.baseVertex * format.GetStride(), cooked.vertexCount, format, bounds,
+				&pOutMesh->vertices[cooked.baseVertex]);
+		}
+	}
+
+	const uint8_t* pIndexData = static_cast<const uint8_t*>(cookedMesh.GetIndexData());
+	pOutMesh->indexData.assign(pIndexData, pIndexData + cookedMesh.GetIndexDataSize());
+	for (uint32_t i = 0; i < cookedMesh.GetSubmeshCount(); i++)
+	{
+		const CookedSubmesh& cooked = cookedMesh.GetSubmeshes()[i];
+		MeshPart part;
+		part.name = std::string(cooked.name, strnlen(cooked.name, sizeof(cooked.name)));
+		part.baseVertex = cooked.baseVertex;
+		part.vertexCount = cooked.vertexCount;
+		part.indexByteOffset = cooked.indexByteOffset;
+		part.indexCount = cooked.indexCount;
+		part.indexSize = cooked.indexSize;
+		pOutMesh->parts.push_back(part);
+	}
+	return true;
+}
+
+static void PrintVertexCacheStats(const char* name, const IndexedMesh& mesh, uint32_t cacheSize)
+{
+	const VertexCacheStats fifo = AnalyzeVertexCache(mesh, cacheSize, VertexCacheModel::Fifo);
+	const VertexCacheStats lru = AnalyzeVertexCache(mesh, cacheSize, VertexCacheModel::Lru);
+	printf("%-26s FIFO %2u: ACMR %6.3f  ATVR %6.3f    LRU %2u: ACMR %6.3f  ATVR %6.3f\n",
+		name, cacheSize, fifo.GetAcmr(), fifo.GetAtvr(), cacheSize, lru.GetAcmr(), lru.GetAtvr());
+}
+
+// Triangles of every part in a canonical form (rotated to the smallest index first, sorted),
+// to check that a reordering kept the triangles and their winding. byContent: vertices are
+// identified by a hash of their data instead of their index - survives a vertex remap.
+static std::vector<uint64_t> GetSortedTriangles(const IndexedMesh& mesh, bool byContent = false)
+{
+	std::vector<uint64_t> triangles;
+	for (uint32_t p = 0; p < (uint32_t)mesh.parts.size(); p++)
+	{
+		const MeshPart& part = mesh.parts[p];
+		auto key = [&](uint32_t t) -> uint64_t
+		{
+			const uint32_t index = mesh.GetIndex(part, t);
+			return byContent ? HashBytes(&mesh.vertices[part.baseVertex + index], sizeof(MeshVertex)) & 0xFFFFF : index;
+		};
+		for (uint32_t t = 0; t + 2 < part.indexCount; t += 3)
+		{
+			uint64_t i[3] = { key(t), key(t + 1), key(t + 2) };
+			const int first = i[0] <= i[1] && i[0] <= i[2] ? 0 : i[1] <= i[2] ? 1 : 2;
+			triangles.push_back(((uint64_t)p << 60) ^ (i[first] << 40) ^ (i[(first + 1) % 3] << 20) ^ i[(first + 2) % 3]);
+		}
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// =====================================================================================
+//										Commands
+// =====================================================================================
+
+static int RunObjBenchmark(const char* path, uint32_t threadCount)
+{
+	ThreadPool pool(threadCount);
+	printf("Threads: %u\n", pool.GetThreadCount());
+
+	std::string generated;
+	uint32_t expectedTriangles = 0, expectedVertices = 0;
+	if (!path)
+	{
+		generated = GenerateObj(16, 256, &expectedTriangles, &expectedVertices);
+		printf("Generated OBJ: %.1f MB, %u triangles, %u vertices\n", generated.size() / 1e6, expectedTriangles, expectedVertices);
+	}
+
+	IndexedMesh meshes[2];
+	const char* names[2] = { "OBJ (1 thread)", "OBJ (pool)" };
+	for (int run = 0; run < 2; run++)
+	{
+		ThreadPool* pPool = run == 0 ? nullptr : &pool;
+
+		// Best of 3 - the first run also pays for page faults of the file mapping
+		ObjLoadStats best;
+		for (int i = 0; i < 3; i++)
+		{
+			ObjLoadStats stats;
+			std::string error;
+			const bool ok = path
+				? LoadObj(path, &meshes[run], pPool, &stats, &error)
+				: ParseObj(generated.data(), generated.size(), &meshes[run], pPool, &stats, &error);
+			if (!ok)
+			{
+				printf("Load failed: %s\n", error.c_str());
+				return 1;
+			}
+			if (i == 0 || stats.totalMs < best.totalMs)
+				best = stats;
+		}
+		if (run == 0)
+		{
+			printf("%s: %.1f MB  v: %u  vt: %u  vn: %u  triangles: %u  parts: %u  vertices: %u\n", path ? path : "Generated",
+				best.bytes / 1e6, best.positionCount, best.uvCount, best.normalCount, best.triangleCount,
+				(uint32_t)meshes[run].parts.size(), (uint32_t)meshes[run].vertices.size());
+		}
+		PrintObjStats(names[run], best);
+	}
+
+	// The result must not depend on the chunking or the thread count
+	if (meshes[0].vertices.size() != meshes[1].vertices.size() || meshes[0].indexData != meshes[1].indexData ||
+		memcmp(meshes[0].vertices.data(), meshes[1].vertices.data(), meshes[0].vertices.size() * sizeof(MeshVertex)) != 0)
+	{
+		printf("Single-threaded and pooled results differ\n");
+		return 1;
+	}
+	if (!path && (meshes[0].GetIndexCount() != expectedTriangles * 3 || meshes[0].vertices.size() != expectedVertices))
+	{
+		printf("Expected %u triangles and %u vertices, got %u and %u\n", expectedTriangles, expectedVertices,
+			(uint32_t)(meshes[0].GetIndexCount() / 3), (uint32_t)meshes[0].vertices.size());
+		return 1;
+	}
+
+	// Number parsing alone: ParseObjFloat vs strtof over the same tokens
+	std::vector<std::string> tokens;
+	for (uint32_t i = 0; i < 1000000; i++)
+	{
+		char token[64];
+		const float value = (float)((i * 2654435761u) % 2000003) / 1000.0f - 1000.0f;
+		snprintf(token, sizeof(token), i % 4 == 3 ? "%.7e" : "%.6f", i % 8 == 7 ? value * 1e-30f : value);
+		tokens.push_back(token);
+	}
+
+	std::vector<float> fast(tokens.size()), reference(tokens.size());
+	auto startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < tokens.size(); i++)
+		ParseObjFloat(tokens[i].data(), tokens[i].data() + tokens[i].size(), &fast[i]);
+	auto fastTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < tokens.size(); i++)
+		reference[i] = strtof(tokens[i].c_str(), nullptr);
+	auto endTime = std::chrono::steady_clock::now();
+
+	uint32_t mismatches = 0, maxUlps = 0;
+	for (size_t i = 0; i < tokens.size(); i++)
+	{
+		int32_t a, b;
+		memcpy(&a, &fast[i], 4);
+		memcpy(&b, &reference[i], 4);
+		const uint32_t ulps = (uint32_t)std::abs((int64_t)a - b);
+		mismatches += ulps != 0;
+		maxUlps = std::max(maxUlps, ulps);
+	}
+	printf("Floats: ParseObjFloat %.2f ms, strtof %.2f ms (%u tokens, %u differ, max %u ulp)\n",
+		std::chrono::duration<double, std::milli>(fastTime - startTime).count(),
+		std::chrono::duration<double, std::milli>(endTime - fastTime).count(), (uint32_t)tokens.size(), mismatches, maxUlps);
+	return maxUlps > 1 ? 1 : 0;
+}
+
+static int RunVertexCacheBenchmark(const char* path, uint32_t cacheSize)
+{
+	uint32_t expectedTriangles, expectedVertices;
+	IndexedMesh mesh;
+	if (!LoadMesh(path, path ? std::string() : GenerateObj(4, 256, &expectedTriangles, &expectedVertices), &mesh))
+	{
+		printf("Failed to load %s\n", path);
+		return 1;
+	}
+	printf("%s: %u parts, %u triangles\n", path ? path : "Generated OBJ", (uint32_t)mesh.parts.size(), (uint32_t)(mesh.GetIndexCount() / 3));
+
+	std::vector<IndexedMesh> inputs(1, mesh);
+	std::vector<std::string> names(1, "Input order");
+	if (!path)
+	{
+		// The generated grids are emitted row by row, which is already cache-friendly. A shuffled
+		// copy stands in for an unordered import.
+		std::minstd_rand random(1);
+		for (const MeshPart& part : mesh.parts)
+		{
+			std::vector<uint32_t> indices(part.indexCount);
+			for (uint32_t i = 0; i < part.indexCount; i++)
+				indices[i] = mesh.GetIndex(part, i);
+			for (uint32_t t = part.indexCount / 3; t > 1; t--)
+			{
+				const uint32_t other = random() % t;
+				for (int c = 0; c < 3; c++)
+					std::swap(indices[(t - 1) * 3 + c], indices[other * 3 + c]);
+			}
+			for (uint32_t i = 0; i < part.indexCount; i++)
+			{
+				uint8_t* pIndex = &mesh.indexData[part.indexByteOffset + i * part.indexSize];
+				if (part.indexSize == 4)
+					memcpy(pIndex, &indices[i], 4);
+				else
+					*reinterpret_cast<uint16_t*>(pIndex) = (uint16_t)indices[i];
+			}
+		}
+		inputs.push_back(mesh);
+		names.push_back("Shuffled");
+	}
+
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		IndexedMesh& input = inputs[i];
+		const std::vector<uint64_t> triangles = GetSortedTriangles(input);
+		PrintVertexCacheStats(names[i].c_str(), input, cacheSize);
+
+		auto startTime = std::chrono::steady_clock::now();
+		OptimizeVertexCache(&input, &ThreadPool::GetDefault());
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+		PrintVertexCacheStats((names[i] + ", optimized").c_str(), input, cacheSize);
+		printf("%-26s %.2f ms (%.1f Mtri/s)\n", "Optimization", ms, ms > 0.0 ? input.GetIndexCount() / 3 / (ms * 1e3) : 0.0);
+
+		if (GetSortedTriangles(input) != triangles)
+		{
+			printf("The optimization changed the triangles\n");
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void PrintOptimizeStats(const char* name, const IndexedMesh& mesh)
+{
+	const VertexCacheStats cache = AnalyzeVertexCache(mesh);
+	const OverdrawStats overdraw = AnalyzeOverdraw(mesh);
+	const VertexFetchStats fetch = AnalyzeVertexFetch(mesh);
+	printf("%-26s ACMR %6.3f  ATVR %6.3f  overdraw %6.3f  overfetch %6.3f\n",
+		name, cache.GetAcmr(), cache.GetAtvr(), overdraw.GetOverdraw(), fetch.GetOverfetch());
+}
+
+static int RunOptimizePipeline(const char* path, float overdrawThreshold)
+{
+	IndexedMesh mesh;
+	if (!LoadMesh(path, path ? std::string() : GenerateTorusObj(6, 384, 96), &mesh))
+	{
+		printf("Failed to load %s\n", path);
+		return 1;
+	}
+	if (mesh.vertices.empty())
+	{
+		printf("%s has no vertices with the MeshVertex layout\n", path);
+		return 1;
+	}
+	printf("%s: %u parts, %u triangles, %u vertices, overdraw threshold %.2f\n", path ? path : "Generated tori",
+		(uint32_t)mesh.parts.size(), (uint32_t)(mesh.GetIndexCount() / 3), (uint32_t)mesh.vertices.size(), overdrawThreshold);
+
+	const std::vector<uint64_t> triangles = GetSortedTriangles(mesh, true);
+	PrintOptimizeStats("Input", mesh);
+
+	ThreadPool& pool = ThreadPool::GetDefault();
+	auto timeStep = [&](const char* name, IndexedMesh* pTarget, const std::function<void()>& step)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+		step();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+		char label[64];
+		snprintf(label, sizeof(label), "%s (%.1f ms)", name, ms);
+		PrintOptimizeStats(label, *pTarget);
+	};
+	timeStep("+ vertex cache", &mesh, [&]() { OptimizeVertexCache(&mesh, &pool); });
+
+	// The overdraw pass on its own, then the meshlet order 2_Mesh cooks with (sorts its clusters the same way)
+	IndexedMesh overdrawMesh = mesh;
+	timeStep("+ overdraw", &overdrawMesh, [&]() { OptimizeOverdraw(&overdrawMesh, overdrawThreshold, &pool); });
+	timeStep("  + vertex fetch", &overdrawMesh, [&]() { OptimizeVertexFetch(&overdrawMesh, &pool); });
+	timeStep("+ meshlet order", &mesh, [&]() { OptimizeMeshletOrder(&mesh, true, &pool); });
+	timeStep("  + vertex fetch", &mesh, [&]() { OptimizeVertexFetch(&mesh, &pool); });
+
+	if (GetSortedTriangles(overdrawMesh, true) != triangles || GetSortedTriangles(mesh, true) != triangles)
+	{
+		printf("The optimization changed the triangles\n");
+		return 1;
+	}
+	return 0;
+}
+
+// Row-vector matrices (clip = v * M) like XMMatrixLookAtLH / XMMatrixPerspectiveFovLH, no DirectXMath on Linux
+struct Matrix4
+{
+	float m[4][4];
+};
+
+static Matrix4 Multiply(const Matrix4& a, const Matrix4& b)
+{
+	Matrix4 result = {};
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			for (int k = 0; k < 4; k++)
+				result.m[i][j] += a.m[i][k] * b.m[k][j];
+	return result;
+}
+
+static Matrix4 LookAtLH(const float* eye, const float* target)
+{
+	float z[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	if (fabsf(z[1]) > 0.99f * sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]))
+	{
+		up[1] = 0.0f;
+		up[2] = 1.0f;
+	}
+	auto normalize = [](float* v)
+	{
+		const float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	};
+	normalize(z);
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+	normalize(x);
+	const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	Matrix4 view = {};
+	for (int i = 0; i < 3; i++)
+	{
+		view.m[i][0] = x[i];
+		view.m[i][1] = y[i];
+		view.m[i][2] = z[i];
+	}
+	view.m[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+	view.m[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+	view.m[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+	view.m[3][3] = 1.0f;
+	return view;
+}
+
+static Matrix4 PerspectiveFovLH(float fovY, float aspectRatio, float nearZ, float farZ)
+{
+	const float height = 1.0f / tanf(fovY * 0.5f);
+	Matrix4 projection = {};
+	projection.m[0][0] = height / aspectRatio;
+	projection.m[1][1] = height;
+	projection.m[2][2] = farZ / (farZ - nearZ);
+	projection.m[2][3] = 1.0f;
+	projection.m[3][2] = -nearZ * farZ / (farZ - nearZ);
+	return projection;
+}
+
+// The cook pipeline of 2_Mesh (meshletOrder: with OptimizeMeshletOrder), then meshlets of the final
+// index runs: checked against the runs, sizes, and culling from cameraCount cameras around the mesh
+static int MeasureMeshlets(IndexedMesh mesh, bool meshletOrder, uint32_t cameraCount)
+{
+	printf("%s\n", meshletOrder ? "Meshlet order:" : "Vertex cache order:");
+	const std::vector<uint64_t> triangles = GetSortedTriangles(mesh, true);
+
+	ThreadPool& pool = ThreadPool::GetDefault();
+	OptimizeVertexCache(&mesh, &pool);
+	double orderMs = 0.0;
+	if (meshletOrder)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+		OptimizeMeshletOrder(&mesh, true, &pool);
+		orderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	}
+	else
+	{
+		OptimizeOverdraw(&mesh, 1.05f, &pool);
+	}
+	OptimizeVertexFetch(&mesh, &pool);
+	PrintOptimizeStats("Optimized", mesh);
+	if (GetSortedTriangles(mesh, true) != triangles)
+	{
+		printf("The optimization changed the triangles\n");
+		return 1;
+	}
+
+	MeshletData meshlets;
+	std::vector<uint32_t> firstMeshlets, meshletCounts;
+	auto startTime = std::chrono::steady_clock::now();
+	for (const MeshPart& part : mesh.parts)
+	{
+		firstMeshlets.push_back((uint32_t)meshlets.meshlets.size());
+		meshletCounts.push_back(part.vertexCount == 0 ? 0 : BuildMeshlets(&mesh.indexData[part.indexByteOffset], part.indexSize,
+			part.indexCount, mesh.vertices[part.baseVertex].position, sizeof(MeshVertex), part.vertexCount, &meshlets));
+	}
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	// Every meshlet must decode to the triangles of its index range
+	uint32_t fullMeshlets = 0;
+	for (size_t p = 0; p < mesh.parts.size(); p++)
+	{
+		const MeshPart& part = mesh.parts[p];
+		uint32_t nextIndex = 0;
+		for (uint32_t m = firstMeshlets[p]; m < firstMeshlets[p] + meshletCounts[p]; m++)
+		{
+			const Meshlet& meshlet = meshlets.meshlets[m];
+			bool valid = meshlet.firstIndex == nextIndex && meshlet.vertexCount <= kMaxMeshletVertices &&
+				meshlet.primitiveCount <= kMaxMeshletTriangles;
+			for (uint32_t t = 0; t < meshlet.primitiveCount && valid; t++)
+			{
+				const uint32_t packed = meshlets.primitives[meshlet.primitiveOffset + t];
+				for (int c = 0; c < 3; c++)
+				{
+					const uint32_t local = (packed >> (10 * c)) & 0x3FF;
+					valid &= local < meshlet.vertexCount &&
+						meshlets.vertexIndices[meshlet.vertexOffset + local] == mesh.GetIndex(part, meshlet.firstIndex + t * 3 + c);
+				}
+			}
+			if (!valid)
+			{
+				printf("Meshlet %u of part %u doesn't match the index run\n", m - firstMeshlets[p], (uint32_t)p);
+				return 1;
+			}
+			nextIndex += meshlet.primitiveCount * 3;
+			fullMeshlets += meshlet.vertexCount == kMaxMeshletVertices || meshlet.primitiveCount == kMaxMeshletTriangles;
+		}
+		if (nextIndex != part.indexCount / 3 * 3)
+		{
+			printf("The meshlets of part %u don't cover its index run\n", (uint32_t)p);
+			return 1;
+		}
+	}
+
+	const size_t meshletCount = meshlets.meshlets.size();
+	double radiusSum = 0.0, coneSum = 0.0;
+	uint32_t coneCount = 0;
+	for (const MeshletBounds& bounds : meshlets.bounds)
+	{
+		radiusSum += bounds.radius;
+		if (bounds.coneCutoff <= 1.0f)
+		{
+			coneSum += asinf(bounds.coneCutoff) * 57.29578f;
+			coneCount++;
+		}
+	}
+	printf("%-26s %u meshlets (%.1f%% full), %.1f vertices, %.1f triangles per meshlet, order %.1f ms, build %.1f ms\n", "Build",
+		(uint32_t)meshletCount, meshletCount ? 100.0 * fullMeshlets / meshletCount : 0.0,
+		meshletCount ? (double)meshlets.vertexIndices.size() / meshletCount : 0.0,
+		meshletCount ? (double)meshlets.primitives.size() / meshletCount : 0.0, orderMs, ms);
+	printf("%-26s average radius %.4f, normal cone under 90 degrees: %.1f%% (average half angle %.1f)\n", "Bounds",
+		meshletCount ? radiusSum / meshletCount : 0.0, meshletCount ? 100.0 * coneCount / meshletCount : 0.0,
+		coneCount ? coneSum / coneCount : 0.0);
+
+	// Bounding sphere of the mesh for the camera placement
+	float boxMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boxMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const MeshVertex& vertex : mesh.vertices)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			boxMin[i] = std::min(boxMin[i], vertex.position[i]);
+			boxMax[i] = std::max(boxMax[i], vertex.position[i]);
+		}
+	}
+	const float center[3] = { (boxMin[0] + boxMax[0]) * 0.5f, (boxMin[1] + boxMax[1]) * 0.5f, (boxMin[2] + boxMax[2]) * 0.5f };
+	const float radius = 0.5f * sqrtf((boxMax[0] - boxMin[0]) * (boxMax[0] - boxMin[0]) +
+		(boxMax[1] - boxMin[1]) * (boxMax[1] - boxMin[1]) + (boxMax[2] - boxMin[2]) * (boxMax[2] - boxMin[2]));
+
+	// Cameras around the mesh at 0.5 - 3 bounding radii - the close ones see only part of it.
+	// Backface culling by cone is conservative: every culled meshlet is checked to face away completely.
+	MeshletCullStats total;
+	uint64_t backfacingTriangles = 0, wrongBackfaceCulls = 0;
+	double cullMs = 0.0;
+	std::minstd_rand random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<uint32_t> visible;
+	auto isOutsideFrustum = [](const MeshletBounds& bounds, const float planes[6][4])
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			if (planes[p][0] * bounds.center[0] + planes[p][1] * bounds.center[1] + planes[p][2] * bounds.center[2] + planes[p][3] < -bounds.radius)
+				return true;
+		}
+		return false;
+	};
+	for (uint32_t c = 0; c < cameraCount; c++)
+	{
+		const float z = 2.0f * unit(random) - 1.0f;
+		const float angle = 6.2831853f * unit(random);
+		const float distance = radius * (0.5f + 2.5f * unit(random));
+		const float planar = sqrtf(1.0f - z * z);
+		const float eye[3] = { center[0] + distance * planar * cosf(angle), center[1] + distance * z, center[2] + distance * planar * sinf(angle) };
+
+		const Matrix4 viewProjection = Multiply(LookAtLH(eye, center), PerspectiveFovLH(0.785398f, 16.0f / 9.0f, 0.01f * radius, 10.0f * radius));
+		float planes[6][4];
+		ExtractFrustumPlanes(&viewProjection.m[0][0], planes);
+
+		for (size_t p = 0; p < mesh.parts.size(); p++)
+		{
+			visible.clear();
+			startTime = std::chrono::steady_clock::now();
+			CullMeshlets(meshlets, firstMeshlets[p], meshletCounts[p], planes, eye, &visible, &total);
+			cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+			// Reference: triangles facing away one by one, and cone culls that hid a front face
+			const MeshPart& part = mesh.parts[p];
+			size_t nextVisible = 0;
+			for (uint32_t m = firstMeshlets[p]; m < firstMeshlets[p] + meshletCounts[p]; m++)
+			{
+				const Meshlet& meshlet = meshlets.meshlets[m];
+				const bool isVisible = nextVisible < visible.size() && visible[nextVisible] == m;
+				nextVisible += isVisible;
+
+				bool allBackfacing = true;
+				for (uint32_t t = 0; t < meshlet.primitiveCount; t++)
+				{
+					const float* a = mesh.vertices[part.baseVertex + mesh.GetIndex(part, meshlet.firstIndex + t * 3)].position;
+					const float* b = mesh.vertices[part.baseVertex + mesh.GetIndex(part, meshlet.firstIndex + t * 3 + 1)].position;
+					const float* d = mesh.vertices[part.baseVertex + mesh.GetIndex(part, meshlet.firstIndex + t * 3 + 2)].position;
+					const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+					const float ad[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+					const float normal[3] = { ab[1] * ad[2] - ab[2] * ad[1], ab[2] * ad[0] - ab[0] * ad[2], ab[0] * ad[1] - ab[1] * ad[0] };
+					const bool backfacing = normal[0] * (a[0] - eye[0]) + normal[1] * (a[1] - eye[1]) + normal[2] * (a[2] - eye[2]) >= 0.0f;
+					backfacingTriangles += backfacing;
+					allBackfacing &= backfacing;
+				}
+				wrongBackfaceCulls += !isVisible && !allBackfacing && !isOutsideFrustum(meshlets.bounds[m], planes);
+			}
+		}
+	}
+
+	printf("%-26s %u cameras, %.1f%% of the meshlets visible (%.1f%% frustum culled, %.1f%% backface culled), %.3f ms per camera\n", "Culling",
+		cameraCount, 100.0 * total.meshletsVisible / std::max(total.meshletCount, 1u), 100.0 * total.frustumCulled / std::max(total.meshletCount, 1u),
+		100.0 * total.backfaceCulled / std::max(total.meshletCount, 1u), cameraCount ? cullMs / cameraCount : 0.0);
+	printf("%-26s %.1f%% culled (per-triangle back faces alone: %.1f%%)\n", "Triangles",
+		100.0 * total.GetCulledTriangleRatio(), total.triangleCount ? 100.0 * backfacingTriangles / total.triangleCount : 0.0);
+
+	if (wrongBackfaceCulls > 0)
+	{
+		printf("%u meshlets were culled by their normal cone with front faces in them\n", (uint32_t)wrongBackfaceCulls);
+		return 1;
+	}
+	return 0;
+}
+
+static int RunMeshletBenchmark(const char* path, uint32_t cameraCount)
+{
+	IndexedMesh mesh;
+	if (!LoadMesh(path, path ? std::string() : GenerateTorusObj(6, 384, 96), &mesh))
+	{
+		printf("Failed to load %s\n", path);
+		return 1;
+	}
+	if (mesh.vertices.empty())
+	{
+		printf("%s has no vertices with the MeshVertex layout\n", path);
+		return 1;
+	}
+	printf("%s: %u parts, %u triangles, %u vertices\n", path ? path : "Generated tori",
+		(uint32_t)mesh.parts.size(), (uint32_t)(mesh.GetIndexCount() / 3), (uint32_t)mesh.vertices.size());
+
+	return MeasureMeshlets(mesh, false, cameraCount) || MeasureMeshlets(mesh, true, cameraCount);
+}
+
+static void PrintQuantizationError(const char* name, const QuantizationError& error, const float* extent)
+{
+	const float largest = std::max(extent[0], std::max(extent[1], extent[2]));
+	printf("%-26s position max %.2e (%.5f%% of the largest extent), rms %.2e; normal max %.3f deg; uv max %.2e; color max %.4f\n",
+		name, error.maxPosition, largest > 0.0f ? 100.0f * error.maxPosition / largest : 0.0f, error.GetRmsPosition(),
+		error.maxNormalDegrees, error.maxUv, error.maxColor);
+}
+
+static int RunQuantizationBenchmark(const char* path)
+{
+	IndexedMesh mesh;
+	if (!LoadMesh(path, path ? std::string() : GenerateTorusObj(6, 384, 96), &mesh))
+	{
+		printf("Failed to load %s\n", path);
+		return 1;
+	}
+	if (mesh.vertices.empty())
+	{
+		printf("%s has no vertices with the MeshVertex layout\n", path);
+		return 1;
+	}
+	printf("%s: %u parts, %u vertices\n", path ? path : "Generated tori", (uint32_t)mesh.parts.size(), (uint32_t)mesh.vertices.size());
+
+	// The generated tori have neither colors nor uvs - random ones (tiled uvs, up to +-8)
+	if (!path)
+	{
+		std::minstd_rand random(1);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f), tiled(-8.0f, 8.0f);
+		for (MeshVertex& vertex : mesh.vertices)
+		{
+			for (int i = 0; i < 3; i++)
+				vertex.color[i] = unit(random);
+			vertex.uv[0] = tiled(random);
+			vertex.uv[1] = tiled(random);
+		}
+	}
+
+	// Bounds per part, as the cook stores them
+	std::vector<QuantizationBounds> bounds(mesh.parts.size());
+	float extent[3] = {};
+	for (size_t p = 0; p < mesh.parts.size(); p++)
+	{
+		bounds[p] = ComputeQuantizationBounds(&mesh.vertices[mesh.parts[p].baseVertex], mesh.parts[p].vertexCount);
+		for (int i = 0; i < 3; i++)
+			extent[i] = std::max(extent[i], bounds[p].scale[i]);
+	}
+
+	VertexFormat positionsOnly;
+	positionsOnly.position = PositionFormat::Unorm16;
+	VertexFormat noPositions = VertexFormat::Packed();
+	noPositions.position = PositionFormat::Float32;
+	const VertexFormat formats[] = { VertexFormat(), VertexFormat::Packed(), positionsOnly, noPositions };
+	const char* names[] = { "Float32", "Packed", "Unorm16 positions", "Packed, float positions" };
+
+	const uint32_t vertexCount = (uint32_t)mesh.vertices.size();
+	const double inputMB = (double)vertexCount * sizeof(MeshVertex) / 1e6;
+	std::vector<uint8_t> encoded, encodedScalar;
+	std::vector<MeshVertex> decoded(vertexCount), decodedScalar(vertexCount);
+	for (int f = 0; f < 4; f++)
+	{
+		const VertexFormat& format = formats[f];
+		const uint32_t stride = format.GetStride();
+		encoded.assign((size_t)vertexCount * stride, 0);
+		encodedScalar.assign((size_t)vertexCount * stride, 0);
+
+		// Best of 5 of each path, over all parts
+		double ms[4] = { DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX };
+		for (int run = 0; run < 5; run++)
+		{
+			for (int step = 0; step < 4; step++)
+			{
+				const auto startTime = std::chrono::steady_clock::now();
+				for (size_t p = 0; p < mesh.parts.size(); p++)
+				{
+					const MeshPart& part = mesh.parts[p];
+					const size_t offset = (size_t)part.baseVertex * stride;
+					switch (step)
+					{
+					case 0: EncodeVertices(&mesh.vertices[part.baseVertex], part.vertexCount, format, bounds[p], &encoded[offset]); break;
+					case 1: EncodeVerticesScalar(&mesh.vertices[part.baseVertex], part.vertexCount, format, bounds[p], &encodedScalar[offset]); break;
+					case 2: DecodeVertices(&encoded[offset], part.vertexCount, format, bounds[p], &decoded[part.baseVertex]); break;
+					case 3: DecodeVerticesScalar(&encoded[offset], part.vertexCount, format, bounds[p], &decodedScalar[part.baseVertex]); break;
+					}
+				}
+				ms[step] = std::min(ms[step], std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+			}
+		}
+
+		printf("%-26s %2u bytes a vertex (%.0f%%), %.1f MB\n", names[f], stride, 100.0 * stride / sizeof(MeshVertex), (double)vertexCount * stride / 1e6);
+		printf("%-26s encode %7.1f MB/s (scalar %7.1f)  decode %7.1f MB/s (scalar %7.1f)  - of MeshVertex data\n", "",
+			inputMB / (ms[0] * 1e-3), inputMB / (ms[1] * 1e-3), inputMB / (ms[2] * 1e-3), inputMB / (ms[3] * 1e-3));
+
+		if (encoded != encodedScalar || memcmp(decoded.data(), decodedScalar.data(), decoded.size() * sizeof(MeshVertex)) != 0)
+		{
+			printf("SIMD and scalar results differ\n");
+			return 1;
+		}
+
+		QuantizationError error;
+		for (size_t p = 0; p < mesh.parts.size(); p++)
+		{
+			const MeshPart& part = mesh.parts[p];
+			error.Add(MeasureQuantizationError(&mesh.vertices[part.baseVertex], &decoded[part.baseVertex], part.vertexCount));
+		}
+		PrintQuantizationError("", error, extent);
+	}
+	return 0;
+}
+
+// Edges that only one triangle has, with the vertices identified by position: holes and borders
+// of the surface. Seams (vertices split by their attributes) don't count.
+static uint32_t CountOpenEdges(const IndexedMesh& mesh, const MeshPart& part, const std::vector<uint32_t>& indices)
+{
+	auto positionKey = [&](uint32_t index) { return HashBytes(mesh.vertices[part.baseVertex + index].position, sizeof(float) * 3); };
+	std::vector<std::pair<uint64_t, uint64_t>> edges;
+	edges.reserve(indices.size());
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		for (int k = 0; k < 3; k++)
+			edges.push_back({ positionKey(indices[t + k]), positionKey(indices[t + (k + 1) % 3]) });
+	}
+	std::sort(edges.begin(), edges.end());
+
+	uint32_t openCount = 0;
+	for (const auto& edge : edges)
+		openCount += !std::binary_search(edges.begin(), edges.end(), std::make_pair(edge.second, edge.first));
+	return openCount;
+}
+
+static int RunSimplifyBenchmark(const char* path, float maxPixelError)
+{
+	IndexedMesh mesh;
+	if (!LoadMesh(path, path ? std::string() : GenerateTorusObj(6, 384, 96, true), &mesh))
+	{
+		printf("Failed to load %s\n", path);
+		return 1;
+	}
+	if (mesh.vertices.empty())
+	{
+		printf("%s has no vertices with the MeshVertex layout\n", path);
+		return 1;
+	}
+	printf("%s: %u parts, %u triangles, %u vertices\n", path ? path : "Generated tori with uv seams",
+		(uint32_t)mesh.parts.size(), (uint32_t)(mesh.GetIndexCount() / 3), (uint32_t)mesh.vertices.size());
+
+	const uint32_t ratioCount = sizeof(kDefaultLodRatios) / sizeof(kDefaultLodRatios[0]);
+	std::vector<std::vector<LodLevel>> chains(mesh.parts.size());
+	const auto startTime = std::chrono::steady_clock::now();
+	ParallelForWorkStealing(ThreadPool::GetDefault(), (uint32_t)mesh.parts.size(), [&](uint32_t p, uint32_t)
+	{
+		const MeshPart& part = mesh.parts[p];
+		BuildLodChain(&mesh.indexData[part.indexByteOffset], part.indexSize, part.indexCount, mesh.vertices[part.baseVertex].position,
+			sizeof(MeshVertex), part.vertexCount, kDefaultLodRatios, ratioCount, FLT_MAX, &chains[p]);
+	});
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	// Level l of every part - the coarsest one it has where its chain ended early, as SelectLod would
+	float meshCenter[3], meshRadius;
+	ComputeBoundingSphere(mesh.vertices[0].position, sizeof(MeshVertex), (uint32_t)mesh.vertices.size(), meshCenter, &meshRadius);
+	uint64_t fullTriangles = 0;
+	uint32_t fullOpenEdges = 0;
+	std::vector<uint32_t> indices;
+	for (uint32_t level = 0; level <= ratioCount; level++)
+	{
+		uint64_t triangles = 0;
+		uint32_t openEdges = 0;
+		float maxError = 0.0f;
+		for (size_t p = 0; p < mesh.parts.size(); p++)
+		{
+			const MeshPart& part = mesh.parts[p];
+			const std::vector<LodLevel>& chain = chains[p];
+			const uint32_t l = std::min(level, (uint32_t)chain.size());
+			if (l == 0)
+				ReadIndexRun(&mesh.indexData[part.indexByteOffset], part.indexSize, part.indexCount, &indices);
+			else
+				indices = chain[l - 1].indices;
+
+			for (size_t t = 0; t + 2 < indices.size(); t += 3)
+			{
+				const float* a = mesh.vertices[part.baseVertex + indices[t]].position;
+				const float* b = mesh.vertices[part.baseVertex + indices[t + 1]].position;
+				const float* c = mesh.vertices[part.baseVertex + indices[t + 2]].position;
+				const bool inRange = indices[t] < part.vertexCount && indices[t + 1] < part.vertexCount && indices[t + 2] < part.vertexCount;
+				if (!inRange || (l > 0 && (memcmp(a, b, 12) == 0 || memcmp(b, c, 12) == 0 || memcmp(a, c, 12) == 0)))
+				{
+					printf("Part %u, level %u: invalid triangle %u\n", (uint32_t)p, l, (uint32_t)(t / 3));
+					return 1;
+				}
+			}
+			triangles += indices.size() / 3;
+			openEdges += CountOpenEdges(mesh, part, indices);
+			maxError = std::max(maxError, l > 0 ? chain[l - 1].error : 0.0f);
+		}
+
+		char name[64];
+		if (level == 0)
+		{
+			fullTriangles = triangles;
+			fullOpenEdges = openEdges;
+			snprintf(name, sizeof(name), "Full");
+			printf("%-26s %8u triangles, %u open edges, chains built in %.1f ms\n", name, (uint32_t)triangles, openEdges, ms);
+			continue;
+		}
+		snprintf(name, sizeof(name), "LOD %u (target %.1f%%)", level, 100.0f * kDefaultLodRatios[level - 1]);
+		printf("%-26s %8u triangles (%5.1f%%), max error %.2e (%.3f%% of the radius), %u open edges\n", name,
+			(uint32_t)triangles, 100.0 * triangles / std::max(fullTriangles, (uint64_t)1), maxError,
+			meshRadius > 0.0f ? 100.0f * maxError / meshRadius : 0.0f, openEdges);
+
+		// Seams and borders may get shorter, but a new open edge is a crack
+		if (openEdges > fullOpenEdges)
+		{
+			printf("Level %u has open edges the full mesh doesn't have\n", level);
+			return 1;
+		}
+	}
+
+	// Selection for a 1080 pixel high 45 degree view, the camera at multiples of the mesh radius
+	const float pixelsPerUnit = 1080.0f / (2.0f * tanf(0.5f * 0.785398f));
+	for (float distance = 1.0f; distance <= 64.0f; distance *= 2.0f)
+	{
+		uint64_t triangles = 0;
+		uint32_t levelCounts[4] = {};
+		for (size_t p = 0; p < mesh.parts.size(); p++)
+		{
+			const MeshPart& part = mesh.parts[p];
+			const std::vector<LodLevel>& chain = chains[p];
+			float center[3], radius;
+			ComputeBoundingSphere(mesh.vertices[part.baseVertex].position, sizeof(MeshVertex), part.vertexCount, center, &radius);
+
+			// The camera on the +z axis of the mesh, distance to the part's sphere
+			const float eye[3] = { meshCenter[0], meshCenter[1], meshCenter[2] - distance * meshRadius };
+			const float d[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+			const float partDistance = std::max(sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - radius, 0.0f);
+
+			std::vector<MeshLod> lods(chain.size());
+			for (size_t l = 0; l < chain.size(); l++)
+				lods[l] = { 0, (uint32_t)chain[l].indices.size(), chain[l].error, 0 };
+			const uint32_t level = SelectLod(lods.data(), (uint32_t)lods.size(), partDistance, pixelsPerUnit, maxPixelError);
+			triangles += level == 0 ? part.indexCount / 3 : lods[level - 1].indexCount / 3;
+			levelCounts[std::min(level, 3u)]++;
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "Distance %4.0f radii", distance);
+		printf("%-26s %5.1f%% of the triangles drawn (parts at LOD 0/1/2/3: %u/%u/%u/%u, %.1f px budget)\n", name,
+			100.0 * triangles / std::max(fullTriangles, (uint64_t)1), levelCounts[0], levelCounts[1], levelCounts[2], levelCounts[3], maxPixelError);
+	}
+	return 0;
+}
+
+// =====================================================================================
+//										Main
+// =====================================================================================
+
+int main(int argc, char** argv)
+{
+	const char* command = argc > 1 ? argv[1] : "obj";
+
+	if (strcmp(command, "obj") == 0)
+		return RunObjBenchmark(ArgToString(argc, argv, 2, nullptr), ArgToUInt(argc, argv, 3, 0));
+	if (strcmp(command, "vcache") == 0)
+		return RunVertexCacheBenchmark(ArgToString(argc, argv, 2, nullptr), ArgToUInt(argc, argv, 3, 32));
+	if (strcmp(command, "optimize") == 0)
+		return RunOptimizePipeline(ArgToString(argc, argv, 2, nullptr), argc > 3 ? (float)atof(argv[3]) : 1.05f);
+	if (strcmp(command, "meshlets") == 0)
+		return RunMeshletBenchmark(ArgToString(argc, argv, 2, nullptr), ArgToUInt(argc, argv, 3, 64));
+	if (strcmp(command, "quantize") == 0)
+		return RunQuantizationBenchmark(ArgToString(argc, argv, 2, nullptr));
+	if (strcmp(command, "simplify") == 0)
+		return RunSimplifyBenchmark(ArgToString(argc, argv, 2, nullptr), argc > 3 ? (float)atof(argv[3]) : 1.0f);
+
+	printf("Unknown command: %s\n", command);
+	return 1;
+}
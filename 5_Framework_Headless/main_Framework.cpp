@@ -0,0 +1,1434 @@
+// Headless (no window, no GPU) benchmarks of the submission code in DX12FrameWork/Framework.
+// The D3D12 objects are replaced by mock ones, so this builds on Linux as well, see README.md.
+//
+// Usage:
+//		5_Framework_Headless record [maxThreads] [lists] [commandsPerList]
+//																- parallel command list recording through CommandQueue's
+//																  code over mock objects, per-thread allocator pool vs
+//																  one locked allocator queue, 1..maxThreads
+//		5_Framework_Headless batch
+//																- CommandQueue's batching over a mock queue: submits,
+//																  signals, waits and allocator reuse, checked
+//		5_Framework_Headless ring [frames]
+//																- FenceRingAllocator against a fake fence: wrap, full
+//																  ring, reclaim, alignment, no overlaps, checked
+//		5_Framework_Headless pacing [framesInFlight] [cpuMs] [gpuMs] [frames]
+//																- frame loop on the null device: frame time, CPU waits,
+//																  GPU busy time and upload memory per frames in flight
+//		5_Framework_Headless barriers [frames]
+//																- frame graph through ResourceStateTracker: barriers and
+//																  ResourceBarrier calls vs per-use transitions, checked
+//		5_Framework_Headless graph [frames]
+//																- deferred frame through RenderGraph: culled passes,
+//																  transient memory aliasing, barriers, checked
+//		5_Framework_Headless overlap [raytraceMs] [refitMs] [frames] [trace.json]
+//																- TLAS refit on the direct queue vs one frame ahead on
+//																  the compute queue: frame time, queue overlap, checked
+
+#include "../DX12FrameWork/Backend/NullDevice.h"
+#include "../DX12FrameWork/Utils/CommandQueueCore.h"
+#include "../DX12FrameWork/Utils/FenceRingAllocator.h"
+#include "../DX12FrameWork/Utils/RenderGraph.h"
+#include "../DX12FrameWork/Utils/ResourceStateTracker.h"
+#include "../DX12FrameWork/Utils/ThreadPool.h"
+#include "../DX12FrameWork/Utils/TimelineTrace.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// =====================================================================================
+//										Helpers
+// =====================================================================================
+
+static uint32_t ArgToUInt(int argc, char** argv, int index, uint32_t defaultValue)
+{
+	return argc > index ? (uint32_t)strtoul(argv[index], nullptr, 10) : defaultValue;
+}
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// =====================================================================================
+//										Mock queue
+// =====================================================================================
+
+// Command memory like an ID3D12CommandAllocator: grows while lists record, Reset() keeps the capacity
+struct MockAllocator
+{
+	std::vector<uint8_t> memory;
+	// Executed, no signal since - the next one covers its commands
+	bool pending = false;
+	// The signal after its last execution - it must not be reset before the GPU passed it
+	uint64_t fenceValue = 0;
+};
+
+// Writes fixed size command packets into its allocator
+struct MockCommandList
+{
+	MockAllocator* pAllocator = nullptr;
+	bool recording = false;
+	// The private data CommandQueueCore sets: the allocator and pool slot it goes back to
+	MockAllocator* pPrivateAllocator = nullptr;
+	uint32_t privateSlot = 0;
+
+	void Record(uint32_t command)
+	{
+		uint8_t packet[48];
+		memset(packet, (int)(command & 0xff), sizeof(packet));
+		memcpy(packet, &command, sizeof(command));
+		pAllocator->memory.insert(pAllocator->memory.end(), packet, packet + sizeof(packet));
+	}
+};
+
+// A queue, its fence and the allocators and lists created for it. The GPU does nothing until told:
+// CompleteFenceValue() is the GPU reaching a signal, WaitForFenceValue() completes what it waits for.
+// Counts what would break on a real GPU: an allocator reset while its commands may still run, a list
+// reset while recording or executed while open, a CPU wait for a value that is never signaled.
+class MockQueue
+{
+public:
+	// What reached the queue, in order
+	struct Event
+	{
+		enum class Type { Execute, Signal, Wait };
+		Type type;
+		uint64_t value;		// Execute: lists, Signal/Wait: fence value
+	};
+
+	// Thread-safe like the device's creates
+	MockAllocator* CreateAllocator()
+	{
+		std::unique_ptr<MockAllocator> allocator(new MockAllocator());
+		allocator->memory.reserve(64 * 1024);
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Allocators.push_back(std::move(allocator));
+		return m_Allocators.back().get();
+	}
+
+	MockCommandList* CreateCommandList(MockAllocator* pAllocator)
+	{
+		std::unique_ptr<MockCommandList> commandList(new MockCommandList());
+		commandList->pAllocator = pAllocator;
+		commandList->recording = true;
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_CommandLists.push_back(std::move(commandList));
+		return m_CommandLists.back().get();
+	}
+
+	void ResetAllocator(MockAllocator* pAllocator)
+	{
+		if (pAllocator->pending || pAllocator->fenceValue > m_CompletedFenceValue)
+			m_Errors++;
+		pAllocator->memory.clear();
+	}
+
+	void ResetCommandList(MockCommandList* pCommandList, MockAllocator* pAllocator)
+	{
+		if (pCommandList->recording)
+			m_Errors++;
+		pCommandList->pAllocator = pAllocator;
+		pCommandList->recording = true;
+	}
+
+	void CloseCommandList(MockCommandList* pCommandList)
+	{
+		if (!pCommandList->recording)
+			m_Errors++;
+		pCommandList->recording = false;
+	}
+
+	void ExecuteCommandLists(MockCommandList* const* ppCommandLists, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (ppCommandLists[i]->recording)
+				m_Errors++;
+			ppCommandLists[i]->pAllocator->pending = true;
+			m_PendingAllocators.push_back(ppCommandLists[i]->pAllocator);
+		}
+		m_Events.push_back(Event{ Event::Type::Execute, count });
+	}
+
+	void Signal(uint64_t fenceValue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (MockAllocator* pAllocator : m_PendingAllocators)
+		{
+			pAllocator->pending = false;
+			pAllocator->fenceValue = fenceValue;
+		}
+		m_PendingAllocators.clear();
+		m_SignaledFenceValue = fenceValue;
+		m_Events.push_back(Event{ Event::Type::Signal, fenceValue });
+	}
+
+	void Wait(const MockQueue&, uint64_t fenceValue)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Events.push_back(Event{ Event::Type::Wait, fenceValue });
+	}
+
+	uint64_t GetCompletedFenceValue() const { return m_CompletedFenceValue; }
+
+	void WaitForFenceValue(uint64_t fenceValue)
+	{
+		if (fenceValue > GetSignaledFenceValue())
+		{
+			m_Errors++;
+			return;
+		}
+		CompleteFenceValue(fenceValue);
+	}
+
+	// The GPU reached fenceValue (signaled already)
+	void CompleteFenceValue(uint64_t fenceValue)
+	{
+		assert(fenceValue <= GetSignaledFenceValue());
+		if (fenceValue > m_CompletedFenceValue)
+			m_CompletedFenceValue = fenceValue;
+	}
+
+	uint64_t GetSignaledFenceValue()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_SignaledFenceValue;
+	}
+
+	std::vector<Event> TakeEvents()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::vector<Event> events;
+		events.swap(m_Events);
+		return events;
+	}
+
+	uint32_t GetAllocatorCount()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return (uint32_t)m_Allocators.size();
+	}
+
+	uint32_t GetErrors() const { return m_Errors; }
+
+private:
+	std::mutex m_Mutex;
+	std::vector<std::unique_ptr<MockAllocator>> m_Allocators;
+	std::vector<std::unique_ptr<MockCommandList>> m_CommandLists;
+	std::vector<MockAllocator*> m_PendingAllocators;
+	std::vector<Event> m_Events;
+	uint64_t m_SignaledFenceValue = 0;
+	std::atomic<uint64_t> m_CompletedFenceValue { 0 };
+	std::atomic<uint32_t> m_Errors { 0 };
+};
+
+// The calls of CommandQueueCore on a MockQueue - the logic of CommandQueue without D3D12
+struct MockQueueApi
+{
+	typedef MockAllocator* Allocator;
+	typedef MockCommandList* CommandList;
+
+	MockQueue* pQueue;
+
+	Allocator CreateAllocator() { return pQueue->CreateAllocator(); }
+	void ResetAllocator(Allocator allocator) { pQueue->ResetAllocator(allocator); }
+	CommandList CreateCommandList(Allocator allocator) { return pQueue->CreateCommandList(allocator); }
+	void ResetCommandList(CommandList commandList, Allocator allocator) { pQueue->ResetCommandList(commandList, allocator); }
+	void CloseCommandList(CommandList commandList) { pQueue->CloseCommandList(commandList); }
+
+	void SetListAllocator(CommandList commandList, Allocator allocator, uint32_t slot)
+	{
+		commandList->pPrivateAllocator = allocator;
+		commandList->privateSlot = slot;
+	}
+
+	void GetListAllocator(CommandList commandList, Allocator* pAllocator, uint32_t* pSlot)
+	{
+		*pAllocator = commandList->pPrivateAllocator;
+		*pSlot = commandList->privateSlot;
+	}
+
+	void ExecuteCommandLists(const CommandList* pCommandLists, uint32_t count) { pQueue->ExecuteCommandLists(pCommandLists, count); }
+	void Signal(uint64_t fenceValue) { pQueue->Signal(fenceValue); }
+	void Wait(const MockQueueApi& other, uint64_t fenceValue) { pQueue->Wait(*other.pQueue, fenceValue); }
+	uint64_t GetCompletedFenceValue() const { return pQueue->GetCompletedFenceValue(); }
+	void WaitForFenceValue(uint64_t fenceValue) { pQueue->WaitForFenceValue(fenceValue); }
+};
+
+typedef CommandQueueCore<MockQueueApi> MockCommandQueue;
+
+// =====================================================================================
+//										Recording
+// =====================================================================================
+
+struct RecordResult
+{
+	double msPerFrame;
+	uint32_t allocatorCount;
+	uint32_t errors;		// MockQueue's: allocators reset before the GPU was done with them, ...
+};
+
+// frameCount frames of listCount lists recorded on the threads of pool and submitted at once through
+// CommandQueue's code. perThreadSlots: CommandQueueCore::ExecuteParallel, every worker on its own slot
+// of the allocator pool. Otherwise all the workers take their allocators from slot 0 - one locked
+// FIFO, what CommandQueue had before the pool.
+static RecordResult RecordFrames(ThreadPool& pool, bool perThreadSlots, uint32_t frameCount, uint32_t listCount, uint32_t commandsPerList)
+{
+	const uint32_t kFramesInFlight = 2;
+	MockQueue queue;
+	MockCommandQueue commandQueue(MockQueueApi{ &queue }, pool.GetThreadCount());
+
+	auto record = [&](MockCommandList* pCommandList, uint32_t listIndex)
+	{
+		for (uint32_t i = 0; i < commandsPerList; i++)
+			pCommandList->Record(listIndex * commandsPerList + i);
+	};
+	std::vector<MockCommandList*> commandLists(listCount);
+
+	// The first frames create the allocators, they are not timed
+	const uint32_t warmupFrames = kFramesInFlight + 2;
+	std::chrono::high_resolution_clock::time_point start;
+	for (uint32_t frame = 0; frame < warmupFrames + frameCount; frame++)
+	{
+		if (frame == warmupFrames)
+			start = std::chrono::high_resolution_clock::now();
+
+		// Frame f signals f + 1, the GPU finishes it kFramesInFlight frames later
+		if (frame >= kFramesInFlight)
+			queue.CompleteFenceValue(frame + 1 - kFramesInFlight);
+
+		if (perThreadSlots)
+		{
+			commandQueue.ExecuteParallel(pool, listCount, record);
+		}
+		else
+		{
+			ParallelForWorkStealing(pool, listCount, [&](uint32_t listIndex, uint32_t)
+			{
+				commandLists[listIndex] = commandQueue.GetCommandList(0);
+				record(commandLists[listIndex], listIndex);
+			});
+			commandQueue.ExecuteCommandLists(commandLists.data(), listCount);
+		}
+	}
+
+	RecordResult result;
+	result.msPerFrame = MillisecondsSince(start) / frameCount;
+	result.allocatorCount = queue.GetAllocatorCount();
+	result.errors = queue.GetErrors();
+	// One submit and one signal per frame
+	const MockCommandQueue::SubmitStats stats = commandQueue.GetSubmitStats();
+	if (stats.submits != warmupFrames + frameCount || stats.signals != warmupFrames + frameCount)
+		result.errors++;
+	return result;
+}
+
+static int RunRecordBenchmark(uint32_t maxThreads, uint32_t listCount, uint32_t commandsPerList)
+{
+	if (maxThreads == 0)
+		maxThreads = ThreadPool::GetDefault().GetThreadCount();
+	if (listCount == 0 || commandsPerList == 0)
+	{
+		printf("lists and commandsPerList must not be 0\n");
+		return 1;
+	}
+
+	const uint32_t frameCount = 200;
+	printf("%u lists of %u commands per frame, %u frames, 2 frames in flight, %u hardware threads\n\n",
+		listCount, commandsPerList, frameCount, std::thread::hardware_concurrency());
+	printf("%-8s %-24s %10s %9s %11s %7s\n", "threads", "allocators", "ms/frame", "speedup", "allocators", "errors");
+
+	double singleThreadMs[2] = { 0.0, 0.0 };
+	uint32_t errors = 0;
+	for (uint32_t threadCount = 1;; threadCount = threadCount * 2 < maxThreads ? threadCount * 2 : maxThreads)
+	{
+		ThreadPool pool(threadCount);
+		const RecordResult results[2] =
+		{
+			RecordFrames(pool, false, frameCount, listCount, commandsPerList),
+			RecordFrames(pool, true, frameCount, listCount, commandsPerList),
+		};
+		const char* names[2] = { "one locked queue", "per-thread pool" };
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			if (threadCount == 1)
+				singleThreadMs[i] = results[i].msPerFrame;
+			printf("%-8u %-24s %10.3f %8.2fx %11u %7u\n", threadCount, names[i], results[i].msPerFrame,
+				singleThreadMs[i] / results[i].msPerFrame, results[i].allocatorCount, results[i].errors);
+			errors += results[i].errors;
+		}
+		if (threadCount == maxThreads)
+			break;
+	}
+
+	return errors == 0 ? 0 : 1;
+}
+
+// =====================================================================================
+//										Batching
+// =====================================================================================
+
+static bool SameEvents(const std::vector<MockQueue::Event>& events, std::initializer_list<MockQueue::Event> expected)
+{
+	if (events.size() != expected.size())
+		return false;
+	size_t i = 0;
+	for (const MockQueue::Event& event : expected)
+	{
+		if (events[i].type != event.type || events[i].value != event.value)
+			return false;
+		i++;
+	}
+	return true;
+}
+
+// CommandQueue's batching (AddToBatch, SubmitBatch and what submits a batch implicitly) over a
+// mock queue, step by step: what reaches the queue, the fence values handed out and when the
+// batched lists' allocators come back
+static int RunBatchCheck()
+{
+	typedef MockQueue::Event Event;
+	const Event::Type Execute = Event::Type::Execute;
+	const Event::Type Signal = Event::Type::Signal;
+	const Event::Type Wait = Event::Type::Wait;
+
+	MockQueue queue, otherQueue;
+	MockCommandQueue commandQueue(MockQueueApi{ &queue }, 8);
+	MockCommandQueue otherCommandQueue(MockQueueApi{ &otherQueue }, 8);
+	bool ok = true;
+	auto check = [&](bool condition, const char* what)
+	{
+		printf("%-72s %s\n", what, condition ? "ok" : "FAILED");
+		ok &= condition;
+	};
+
+	// Two lists batched: nothing reaches the queue, both get the value of the coming signal
+	MockCommandList* pFirst = commandQueue.GetCommandList(3);
+	MockCommandList* pSecond = commandQueue.GetCommandList(5);
+	// The lists are reused after their submit - their allocators are what to follow
+	MockAllocator* pFirstAllocator = pFirst->pAllocator;
+	MockAllocator* pSecondAllocator = pSecond->pAllocator;
+	const uint64_t firstValue = commandQueue.AddToBatch(pFirst);
+	const uint64_t secondValue = commandQueue.AddToBatch(pSecond);
+	check(firstValue == 1 && secondValue == 1 && queue.TakeEvents().empty(), "AddToBatch: no submit, both lists get fence value 1");
+
+	// A GPU wait submits the batch before it, without a signal
+	commandQueue.Wait(otherCommandQueue, 7);
+	check(SameEvents(queue.TakeEvents(), { { Execute, 2 }, { Wait, 7 } }), "Wait: the batch (2 lists) is submitted before the wait, no signal");
+
+	// The batch's allocators are in flight without a signal yet: a new list gets a new allocator
+	MockCommandList* pThird = commandQueue.GetCommandList(3);
+	check(pThird->pAllocator != pFirstAllocator && queue.GetAllocatorCount() == 3, "GetCommandList after the unsignaled submit: new allocator");
+
+	// The next batch's signal covers the lists the wait submitted too
+	const uint64_t thirdValue = commandQueue.AddToBatch(pThird);
+	const uint64_t batchValue = commandQueue.SubmitBatch();
+	check(thirdValue == 1 && batchValue == 1 && SameEvents(queue.TakeEvents(), { { Execute, 1 }, { Signal, 1 } }),
+		"SubmitBatch: one submit, one signal of the predicted value 1");
+	check(pFirstAllocator->fenceValue == 1 && !pFirstAllocator->pending, "the allocators of the waited-for batch are tagged with signal 1");
+
+	// Signaled but not reached: still no reuse, then the slot's oldest allocator comes back
+	MockCommandList* pFourth = commandQueue.GetCommandList(3);
+	const bool newBeforeFence = pFourth->pAllocator != pFirstAllocator;
+	commandQueue.ExecuteCommandList(pFourth);
+	queue.CompleteFenceValue(1);
+	MockCommandList* pFifth = commandQueue.GetCommandList(3);
+	MockCommandList* pSixth = commandQueue.GetCommandList(6);
+	check(newBeforeFence && pFifth->pAllocator == pFirstAllocator, "slot 3 reuses its allocator only after the GPU passed fence 1");
+	check(pSixth->pAllocator != pFirstAllocator && pSixth->pAllocator != pSecondAllocator,
+		"slot 6 doesn't get the allocators of slots 3 and 5");
+	queue.TakeEvents();
+
+	// A CPU wait for a batched value submits and signals it first
+	const uint64_t fifthValue = commandQueue.AddToBatch(pFifth);
+	commandQueue.WaitForFenceValue(fifthValue);
+	check(fifthValue == 3 && SameEvents(queue.TakeEvents(), { { Execute, 1 }, { Signal, 3 } }) && queue.GetCompletedFenceValue() == 3,
+		"WaitForFenceValue of a batched value: submits and signals 3, then waits");
+
+	// A submit takes the open batch along in the same ExecuteCommandLists
+	commandQueue.AddToBatch(pSixth);
+	MockCommandList* pSeventh = commandQueue.GetCommandList(6);
+	const uint64_t seventhValue = commandQueue.ExecuteCommandList(pSeventh);
+	check(seventhValue == 4 && SameEvents(queue.TakeEvents(), { { Execute, 2 }, { Signal, 4 } }), "ExecuteCommandList: the batch and the list in one submit, one signal");
+
+	// Nothing batched: no submit, no signal
+	check(commandQueue.SubmitBatch() == 4 && queue.TakeEvents().empty(), "SubmitBatch of an empty batch: last value 4, nothing submitted");
+
+	const MockCommandQueue::SubmitStats stats = commandQueue.GetSubmitStats();
+	check(stats.submits == 5 && stats.commandLists == 7 && stats.signals == 4 && stats.gpuWaits == 1,
+		"stats: 5 submits of 7 lists, 4 signals, 1 GPU wait");
+	check(queue.GetErrors() == 0, "no allocator reset in flight, no list reset while recording");
+
+	printf("\nChecks: %s\n", ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+// =====================================================================================
+//										Upload ring
+// =====================================================================================
+
+// A queue's fence without the queue: Signal() hands out the next value, the "GPU" reaches the
+// values when told (Complete)
+struct FakeFence
+{
+	uint64_t signaled = 0;
+	uint64_t completed = 0;
+
+	uint64_t Signal() { return ++signaled; }
+	void Complete(uint64_t fenceValue) { completed = fenceValue < signaled ? fenceValue : signaled; }
+};
+
+// FenceRingAllocator's allocations that aren't reclaimed yet, checked against every new one
+class RingRegions
+{
+public:
+	explicit RingRegions(uint64_t capacity) : m_Capacity(capacity) {}
+
+	// Inside the ring, aligned and clear of every live region
+	bool Add(uint64_t offset, uint64_t size, uint64_t alignment)
+	{
+		bool ok = offset != FenceRingAllocator::kInvalidOffset && offset + size <= m_Capacity && (offset & (alignment - 1)) == 0;
+		for (const Region& region : m_Regions)
+			ok &= offset + size <= region.offset || region.offset + region.size <= offset;
+		m_Regions.push_back(Region{ offset, size, 0 });
+		return ok;
+	}
+
+	// The regions since the last call go with fenceValue, like FinishBatch()
+	void FinishBatch(uint64_t fenceValue)
+	{
+		for (Region& region : m_Regions)
+		{
+			if (region.fenceValue == 0)
+				region.fenceValue = fenceValue;
+		}
+	}
+
+	void Reclaim(uint64_t completedFenceValue)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < m_Regions.size(); i++)
+		{
+			if (m_Regions[i].fenceValue == 0 || m_Regions[i].fenceValue > completedFenceValue)
+				m_Regions[kept++] = m_Regions[i];
+		}
+		m_Regions.resize(kept);
+	}
+
+	uint64_t GetLiveBytes() const
+	{
+		uint64_t bytes = 0;
+		for (const Region& region : m_Regions)
+			bytes += region.size;
+		return bytes;
+	}
+
+private:
+	struct Region
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint64_t fenceValue;	// 0: open batch
+	};
+
+	uint64_t m_Capacity;
+	std::vector<Region> m_Regions;
+};
+
+// FenceRingAllocator (UploadRingBuffer's ring) against a fake fence: the cases one by one, then
+// frameCount frames of uploads the way UploadRingBuffer makes them, the GPU framesInFlight frames behind
+static int RunRingCheck(uint32_t frameCount)
+{
+	bool ok = true;
+	auto check = [&](bool condition, const char* what)
+	{
+		printf("%-72s %s\n", what, condition ? "ok" : "FAILED");
+		ok &= condition;
+	};
+
+	// Alignment, a batch per submit
+	{
+		FenceRingAllocator ring(1024);
+		FakeFence fence;
+		const uint64_t first = ring.Allocate(10, 16);
+		const uint64_t second = ring.Allocate(100, 256);
+		const uint64_t third = ring.Allocate(8, 4);
+		check(first == 0 && second == 256 && third == 356 && ring.GetUsedBytes() == 364, "alignment: 0, 256, 356 - padding counted as used");
+
+		ring.FinishBatch(fence.Signal());
+		ring.FinishBatch(fence.Signal());
+		check(ring.GetStats().batches == 1 && ring.GetOldestPendingFence() == 1, "FinishBatch: one batch (fence 1), nothing for an empty one");
+	}
+
+	// Full ring: fails until the fence passes the batch in the way
+	{
+		FenceRingAllocator ring(1024);
+		FakeFence fence;
+		ring.Allocate(512);
+		ring.FinishBatch(fence.Signal());
+		ring.Allocate(384);
+		ring.FinishBatch(fence.Signal());
+		const uint64_t full = ring.Allocate(256);
+		check(full == FenceRingAllocator::kInvalidOffset && ring.GetStats().failedAllocations == 1, "full ring: Allocate fails, counted");
+
+		ring.Reclaim(fence.completed);
+		check(ring.Allocate(256) == FenceRingAllocator::kInvalidOffset && ring.GetUsedBytes() == 896, "fence not passed: Reclaim frees nothing");
+
+		// Wrap: the 128 bytes at the end are skipped, the allocation starts at 0
+		fence.Complete(1);
+		ring.Reclaim(fence.completed);
+		const uint64_t wrapped = ring.Allocate(256);
+		check(wrapped == 0 && ring.GetStats().wraps == 1 && ring.GetUsedBytes() == 384 + 128 + 256 && ring.GetOldestPendingFence() == 2,
+			"fence 1 passed: its batch is freed, the next allocation wraps to 0");
+
+		const uint64_t tooLarge = ring.Allocate(384);
+		check(tooLarge == FenceRingAllocator::kInvalidOffset, "wrapped: no room before the oldest batch (fence 2)");
+
+		ring.FinishBatch(fence.Signal());
+		fence.Complete(3);
+		ring.Reclaim(fence.completed);
+		check(!ring.HasPendingBatches() && ring.GetUsedBytes() == 0 && ring.Allocate(1024) == 0, "all passed: empty, starts over at 0, the whole ring fits");
+	}
+
+	// Uploads of random sizes and alignments, a submit per frame, the GPU framesInFlight frames
+	// behind. A full ring waits for its oldest batch like UploadRingBuffer.
+	{
+		const uint64_t kCapacity = 64 * 1024;
+		const uint32_t kFramesInFlight = 3;
+		FenceRingAllocator ring(kCapacity);
+		RingRegions regions(kCapacity);
+		FakeFence fence;
+		uint32_t random = 12345;
+		auto next = [&]() { random = random * 1664525u + 1013904223u; return random >> 8; };
+
+		bool clear = true, accounted = true;
+		uint32_t stalls = 0;
+		uint64_t frameFences[kFramesInFlight] = {};
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			// The GPU finished the frame that used this slot
+			fence.Complete(frameFences[frame % kFramesInFlight]);
+			ring.Reclaim(fence.completed);
+			regions.Reclaim(fence.completed);
+
+			const uint32_t uploads = next() % 8;
+			for (uint32_t i = 0; i < uploads; i++)
+			{
+				// Mostly small, now and then a quarter of the ring (UploadRingBuffer's largest chunk)
+				const uint64_t size = 1 + next() % (next() % 8 == 0 ? kCapacity / 4 : kCapacity / 16);
+				const uint64_t alignment = 1ull << (next() % 10);
+				uint64_t offset = ring.Allocate(size, alignment);
+				while (offset == FenceRingAllocator::kInvalidOffset)
+				{
+					// The open batch goes to the GPU, then the oldest one is waited for
+					const uint64_t fenceValue = fence.Signal();
+					ring.FinishBatch(fenceValue);
+					regions.FinishBatch(fenceValue);
+					fence.Complete(ring.GetOldestPendingFence());
+					ring.Reclaim(fence.completed);
+					regions.Reclaim(fence.completed);
+					stalls++;
+					offset = ring.Allocate(size, alignment);
+				}
+				clear &= regions.Add(offset, size, alignment);
+			}
+			frameFences[frame % kFramesInFlight] = fence.Signal();
+			ring.FinishBatch(frameFences[frame % kFramesInFlight]);
+			regions.FinishBatch(frameFences[frame % kFramesInFlight]);
+			accounted &= ring.GetUsedBytes() >= regions.GetLiveBytes() && ring.GetUsedBytes() <= kCapacity;
+		}
+		fence.Complete(fence.signaled);
+		ring.Reclaim(fence.completed);
+
+		const FenceRingAllocator::Stats& stats = ring.GetStats();
+		char line[128];
+		snprintf(line, sizeof(line), "%u frames, %llu allocations, %llu wraps, %u stalls: no overlaps",
+			frameCount, (unsigned long long)stats.allocations, (unsigned long long)stats.wraps, stalls);
+		check(clear, line);
+		check(accounted, "used bytes cover the live allocations, never above the capacity");
+		check(ring.GetUsedBytes() == 0 && !ring.HasPendingBatches(), "all fences passed: nothing left in use");
+	}
+
+	printf("\nChecks: %s\n", ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+// =====================================================================================
+//										Frame pacing
+// =====================================================================================
+
+struct PacingResult
+{
+	double msPerFrame;
+	double cpuWaitMsPerFrame;
+	double gpuBusyRatio;
+	uint64_t peakUploadBytes;
+	bool ok;
+};
+
+// The loop of the samples on the null device: CPU work, an upload on the copy queue the direct queue
+// waits for, one direct list, then the wait for the frame that reuses the next backbuffer
+static PacingResult RunFrames(uint32_t framesInFlight, double cpuMs, double gpuMs, uint32_t frameCount)
+{
+	using namespace Backend;
+	typedef std::chrono::high_resolution_clock Clock;
+
+	NullDevice device;
+	CommandQueue* pDirectQueue = device.GetQueue(QueueType::Direct);
+	CommandQueue* pCopyQueue = device.GetQueue(QueueType::Copy);
+	const uint32_t drawCount = (uint32_t)(gpuMs * 1000.0 / device.GetTiming().drawUs);
+	bool ok = true;
+
+	const uint64_t kUploadSize = 1024 * 1024;
+	BufferDesc bufferDesc;
+	bufferDesc.size = kUploadSize;
+	bufferDesc.initialState = ResourceState_CopyDest;
+	std::shared_ptr<Resource> constants = device.CreateBuffer(bufferDesc);
+
+	// Per backbuffer: the fence of its last frame and the upload buffer the frame used
+	std::vector<uint64_t> frameFences(framesInFlight, 0);
+	std::vector<std::shared_ptr<Resource>> frameUploads(framesInFlight);
+
+	double cpuWaitMs = 0.0;
+	const Clock::time_point start = Clock::now();
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		const uint32_t slot = frame % framesInFlight;
+		device.SetCaptureEnabled(frame == 0);
+
+		// Update
+		const Clock::time_point cpuEnd = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(cpuMs));
+		while (Clock::now() < cpuEnd)
+			;
+
+		// The slot's previous frame completed - its upload buffer can go
+		BufferDesc uploadDesc;
+		uploadDesc.size = kUploadSize;
+		uploadDesc.heapType = HeapType::Upload;
+		frameUploads[slot] = device.CreateBuffer(uploadDesc);
+		memset(frameUploads[slot]->Map(), (int)frame, (size_t)kUploadSize);
+		frameUploads[slot]->Unmap();
+
+		CommandList* pCopyList = pCopyQueue->GetCommandList();
+		pCopyList->CopyBufferRegion(constants.get(), 0, frameUploads[slot].get(), 0, kUploadSize);
+		pDirectQueue->Wait(*pCopyQueue, pCopyQueue->ExecuteCommandList(pCopyList));
+
+		// Render
+		CommandList* pCommandList = pDirectQueue->GetCommandList();
+		pCommandList->ResourceBarrier(constants.get(), ResourceState_CopyDest, ResourceState_VertexAndConstantBuffer);
+		for (uint32_t i = 0; i < drawCount; i++)
+			pCommandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+		pCommandList->ResourceBarrier(constants.get(), ResourceState_VertexAndConstantBuffer, ResourceState_CopyDest);
+		frameFences[slot] = pDirectQueue->ExecuteCommandList(pCommandList);
+
+		if (frame == 0)
+			ok &= device.TakeCapturedCommands(QueueType::Direct).size() == drawCount + 2;
+
+		// Present
+		const uint32_t nextSlot = (frame + 1) % framesInFlight;
+		const Clock::time_point waitStart = Clock::now();
+		pDirectQueue->WaitForFenceValue(frameFences[nextSlot]);
+		cpuWaitMs += MillisecondsSince(waitStart);
+	}
+	// The time includes the frames still in flight - the busy time counts their draws too
+	pDirectQueue->Flush();
+	const double totalMs = MillisecondsSince(start);
+
+	PacingResult result;
+	result.msPerFrame = totalMs / frameCount;
+	result.cpuWaitMsPerFrame = cpuWaitMs / frameCount;
+	result.gpuBusyRatio = device.GetBusyMs(QueueType::Direct) / totalMs;
+
+	// The GPU can't be busier than the clock, nor a frame take less than its draws
+	ok &= result.gpuBusyRatio <= 1.0 && result.msPerFrame >= drawCount * device.GetTiming().drawUs * 1e-3;
+
+	// One upload buffer per frame in flight, all of them released with the frames
+	const Device::MemoryStats memoryStats = device.GetMemoryStats();
+	result.peakUploadBytes = memoryStats.peakBytes[(int)HeapType::Upload];
+	frameUploads.clear();
+	const Device::MemoryStats releasedStats = device.GetMemoryStats();
+	ok &= result.peakUploadBytes <= (framesInFlight + 1) * kUploadSize;
+	ok &= releasedStats.currentBytes[(int)HeapType::Upload] == 0 && releasedStats.resourceCount == 1;
+
+	// One submit and one signal per frame and queue, one GPU wait on the direct queue
+	const CommandQueue::SubmitStats submitStats = pDirectQueue->GetSubmitStats();
+	ok &= submitStats.submits == frameCount && submitStats.gpuWaits == frameCount && submitStats.signals == frameCount + 1;
+	ok &= pDirectQueue->GetCompletedFenceValue() == frameCount + 1;
+
+	result.ok = ok;
+	return result;
+}
+
+static int RunPacingBenchmark(uint32_t framesInFlight, double cpuMs, double gpuMs, uint32_t frameCount)
+{
+	if (frameCount == 0)
+	{
+		printf("frames must not be 0\n");
+		return 1;
+	}
+
+	Backend::NullDevice::Timing timing;
+	printf("CPU %.2f ms, GPU %.2f ms (%u draws) per frame, %u frames, submit latency %.0f us\n\n",
+		cpuMs, gpuMs, (uint32_t)(gpuMs * 1000.0 / timing.drawUs), frameCount, timing.submitLatencyUs);
+	printf("%-16s %10s %14s %9s %12s %7s\n", "frames in flight", "ms/frame", "CPU wait ms", "GPU busy", "upload peak", "checks");
+
+	const uint32_t first = framesInFlight ? framesInFlight : 1;
+	const uint32_t last = framesInFlight ? framesInFlight : 3;
+	bool ok = true;
+	for (uint32_t count = first; count <= last; count++)
+	{
+		const PacingResult result = RunFrames(count, cpuMs, gpuMs, frameCount);
+		printf("%-16u %10.3f %14.3f %8.1f%% %9.1f MB %7s\n", count, result.msPerFrame, result.cpuWaitMsPerFrame,
+			100.0 * result.gpuBusyRatio, result.peakUploadBytes / (1024.0 * 1024.0), result.ok ? "ok" : "FAILED");
+		ok &= result.ok;
+	}
+
+	return ok ? 0 : 1;
+}
+
+// =====================================================================================
+//										Barriers
+// =====================================================================================
+
+// One resource in one state in a pass (all subresources or one)
+struct BarrierUse
+{
+	uint32_t resource;
+	uint32_t state;
+	uint32_t subresource;
+};
+
+struct BarrierPass
+{
+	const char* name;
+	std::vector<BarrierUse> uses;
+};
+
+struct BarrierResource
+{
+	const char* name;
+	uint32_t homeState;			// created in, and returned to after each use by the per-use transitions
+	uint32_t subresourceCount;
+};
+
+// Replays the tracker's barriers on its own copy of the states: every barrier has to start in the state the
+// subresource is in, and after a flush every use of the pass has to find its subresource in a state that allows it
+class BarrierValidator
+{
+public:
+	explicit BarrierValidator(const std::vector<BarrierResource>& resources)
+	{
+		for (const BarrierResource& resource : resources)
+			m_States.push_back(std::vector<uint32_t>(resource.subresourceCount, resource.homeState));
+	}
+
+	bool Apply(const std::vector<ResourceStateTracker::Barrier>& barriers, void* const* ppResources)
+	{
+		bool ok = true;
+		for (const ResourceStateTracker::Barrier& barrier : barriers)
+		{
+			if (barrier.type != ResourceStateTracker::BarrierType::Transition)
+				continue;
+			std::vector<uint32_t>& states = m_States[FindResource(barrier.pResource, ppResources)];
+			for (uint32_t i = 0; i < states.size(); i++)
+			{
+				if (barrier.subresource != ResourceStateTracker::kAllSubresources && barrier.subresource != i)
+					continue;
+				ok &= states[i] == barrier.before && barrier.before != barrier.after;
+				states[i] = barrier.after;
+			}
+		}
+		return ok;
+	}
+
+	bool Allows(const BarrierUse& use) const
+	{
+		// Read-only states of D3D12_RESOURCE_STATES (VB/CB, IB, depth read, shader resources, indirect, copy/resolve source)
+		const uint32_t kReadOnlyStates = 0x1 | 0x2 | 0x20 | 0x40 | 0x80 | 0x200 | 0x800 | 0x2000;
+
+		const std::vector<uint32_t>& states = m_States[use.resource];
+		bool ok = true;
+		for (uint32_t i = 0; i < states.size(); i++)
+		{
+			if (use.subresource != ResourceStateTracker::kAllSubresources && use.subresource != i)
+				continue;
+			const bool readOnly = states[i] != 0 && (states[i] & ~kReadOnlyStates) == 0;
+			ok &= states[i] == use.state || (readOnly && use.state != 0 && (states[i] & use.state) == use.state);
+		}
+		return ok;
+	}
+
+private:
+	size_t FindResource(void* pResource, void* const* ppResources) const
+	{
+		size_t index = 0;
+		while (ppResources[index] != pResource)
+			index++;
+		return index;
+	}
+
+	std::vector<std::vector<uint32_t>> m_States;
+};
+
+// The tracker's batching on its own: merges, round trips, read states and per-subresource barriers
+static bool CheckStateTracker()
+{
+	using namespace Backend;
+	int resources[2];
+	void* pA = &resources[0];
+	void* pB = &resources[1];
+	std::vector<ResourceStateTracker::Barrier> barriers;
+	ResourceStateTracker tracker;
+	bool ok = true;
+
+	// A->B, B->C in one batch is A->C
+	tracker.Register(pA, ResourceState_RenderTarget);
+	tracker.Transition(pA, ResourceState_CopySource);
+	tracker.Transition(pA, ResourceState_PixelShaderResource);
+	tracker.Flush(&barriers);
+	ok &= barriers.size() == 1 && barriers[0].before == ResourceState_RenderTarget && barriers[0].after == ResourceState_PixelShaderResource;
+
+	// A->B, B->A in one batch is nothing, a read state the current one includes is nothing
+	tracker.Register(pB, ResourceState_NonPixelShaderResource | ResourceState_PixelShaderResource);
+	tracker.Transition(pA, ResourceState_UnorderedAccess);
+	tracker.Transition(pA, ResourceState_PixelShaderResource);
+	tracker.Transition(pB, ResourceState_PixelShaderResource);
+	tracker.UavBarrier(pA);
+	tracker.UavBarrier(pA);
+	tracker.Flush(&barriers);
+	ok &= barriers.size() == 1 && barriers[0].type == ResourceStateTracker::BarrierType::Uav;
+	ok &= tracker.GetState(pB) == (ResourceState_NonPixelShaderResource | ResourceState_PixelShaderResource);
+
+	// Subresources apart, then all of them again: one barrier each
+	tracker.Register(pB, ResourceState_UnorderedAccess, 3);
+	tracker.Transition(pB, ResourceState_CopySource, 1);
+	tracker.Flush(&barriers);
+	ok &= barriers.size() == 1 && barriers[0].subresource == 1;
+	tracker.Transition(pB, ResourceState_PixelShaderResource);
+	tracker.Flush(&barriers);
+	ok &= barriers.size() == 3;
+	tracker.Transition(pB, ResourceState_UnorderedAccess);
+	tracker.Flush(&barriers);
+	ok &= barriers.size() == 1 && barriers[0].subresource == ResourceStateTracker::kAllSubresources;
+
+	// Unknown resources are in COMMON (PRESENT)
+	int unknown;
+	tracker.Transition(&unknown, ResourceState_Present);
+	tracker.Flush(&barriers);
+	ok &= barriers.empty();
+
+	const ResourceStateTracker::Stats& stats = tracker.GetStats();
+	ok &= stats.issued == 6 && stats.uavRequested == 2 && stats.uavIssued == 1 && stats.batches == 5;
+	return ok;
+}
+
+static int RunBarrierBenchmark(uint32_t frameCount)
+{
+	using namespace Backend;
+	typedef std::chrono::high_resolution_clock Clock;
+	const uint32_t kAll = ResourceStateTracker::kAllSubresources;
+	const uint32_t kShaderRead = ResourceState_NonPixelShaderResource | ResourceState_PixelShaderResource;
+
+	if (frameCount == 0)
+	{
+		printf("frames must not be 0\n");
+		return 1;
+	}
+
+	// A deferred frame: shadow map, G-buffer, compute lighting, bloom down/up the HDR mips, tonemap
+	// to the backbuffer, copy to the history. Two backbuffers, used in turn.
+	enum { BackBuffer0, BackBuffer1, ShadowMap, GBuffer0, GBuffer1, GBuffer2, Depth, Hdr, History, ResourceCount };
+	const uint32_t kHdrMips = 5;
+	const std::vector<BarrierResource> resources =
+	{
+		{ "backbuffer 0", ResourceState_Present, 1 },
+		{ "backbuffer 1", ResourceState_Present, 1 },
+		{ "shadow map", ResourceState_DepthWrite, 1 },
+		{ "gbuffer 0", ResourceState_RenderTarget, 1 },
+		{ "gbuffer 1", ResourceState_RenderTarget, 1 },
+		{ "gbuffer 2", ResourceState_RenderTarget, 1 },
+		{ "depth", ResourceState_DepthWrite, 1 },
+		{ "hdr", ResourceState_UnorderedAccess, kHdrMips },
+		{ "history", ResourceState_PixelShaderResource, 1 },
+	};
+
+	std::vector<BarrierPass> passes[2];
+	for (uint32_t backBufferIndex = 0; backBufferIndex < 2; backBufferIndex++)
+	{
+		const uint32_t backBuffer = BackBuffer0 + backBufferIndex;
+		std::vector<BarrierPass>& frame = passes[backBufferIndex];
+		frame.push_back({ "shadow", { { ShadowMap, ResourceState_DepthWrite, kAll } } });
+		frame.push_back({ "gbuffer", { { GBuffer0, ResourceState_RenderTarget, kAll }, { GBuffer1, ResourceState_RenderTarget, kAll },
+			{ GBuffer2, ResourceState_RenderTarget, kAll }, { Depth, ResourceState_DepthWrite, kAll } } });
+		frame.push_back({ "lighting", { { GBuffer0, kShaderRead, kAll }, { GBuffer1, kShaderRead, kAll }, { GBuffer2, kShaderRead, kAll },
+			{ Depth, ResourceState_DepthRead | kShaderRead, kAll }, { ShadowMap, kShaderRead, kAll }, { Hdr, ResourceState_UnorderedAccess, 0 } } });
+		for (uint32_t mip = 1; mip < kHdrMips; mip++)
+			frame.push_back({ "bloom down", { { Hdr, ResourceState_NonPixelShaderResource, mip - 1 }, { Hdr, ResourceState_UnorderedAccess, mip } } });
+		for (uint32_t mip = kHdrMips - 1; mip > 0; mip--)
+			frame.push_back({ "bloom up", { { Hdr, ResourceState_NonPixelShaderResource, mip }, { Hdr, ResourceState_UnorderedAccess, mip - 1 } } });
+		frame.push_back({ "tonemap", { { Hdr, ResourceState_PixelShaderResource, 0 }, { History, ResourceState_PixelShaderResource, kAll },
+			{ GBuffer0, ResourceState_PixelShaderResource, kAll }, { backBuffer, ResourceState_RenderTarget, kAll } } });
+		frame.push_back({ "history", { { backBuffer, ResourceState_CopySource, kAll }, { History, ResourceState_CopyDest, kAll } } });
+		frame.push_back({ "present", { { backBuffer, ResourceState_Present, kAll } } });
+	}
+
+	// Stand-ins for the ID3D12Resource pointers
+	int resourceObjects[ResourceCount];
+	void* ppResources[ResourceCount];
+	for (uint32_t i = 0; i < ResourceCount; i++)
+		ppResources[i] = &resourceObjects[i];
+
+	// How the samples wrote it: a transition from the home state before the use and back after it,
+	// one ResourceBarrier call each
+	uint64_t perUseBarriers = 0;
+	uint64_t useCount = 0;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		for (const BarrierPass& pass : passes[frame % 2])
+		{
+			for (const BarrierUse& use : pass.uses)
+			{
+				useCount++;
+				perUseBarriers += use.state != resources[use.resource].homeState ? 2 : 0;
+			}
+		}
+	}
+
+	// The tracker: requests per use, one flush per pass
+	ResourceStateTracker tracker;
+	for (uint32_t i = 0; i < ResourceCount; i++)
+		tracker.Register(ppResources[i], resources[i].homeState, resources[i].subresourceCount);
+
+	BarrierValidator validator(resources);
+	std::vector<ResourceStateTracker::Barrier> barriers;
+	bool ok = CheckStateTracker();
+	double trackerMs = 0.0;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		for (const BarrierPass& pass : passes[frame % 2])
+		{
+			const Clock::time_point start = Clock::now();
+			for (const BarrierUse& use : pass.uses)
+				tracker.Transition(ppResources[use.resource], use.state, use.subresource);
+			tracker.Flush(&barriers);
+			trackerMs += MillisecondsSince(start);
+
+			ok &= validator.Apply(barriers, ppResources);
+			for (const BarrierUse& use : pass.uses)
+				ok &= validator.Allows(use);
+		}
+	}
+
+	const ResourceStateTracker::Stats& stats = tracker.GetStats();
+	printf("%u passes, %llu resource uses per frame, %u frames\n\n", (uint32_t)passes[0].size(),
+		(unsigned long long)(useCount / frameCount), frameCount);
+	printf("%-24s %16s %28s\n", "", "barriers/frame", "ResourceBarrier calls/frame");
+	printf("%-24s %16.2f %28.2f\n", "per-use transitions", (double)perUseBarriers / frameCount, (double)perUseBarriers / frameCount);
+	printf("%-24s %16.2f %28.2f\n\n", "ResourceStateTracker", (double)stats.issued / frameCount, (double)stats.batches / frameCount);
+	printf("Requests %llu: %llu in the state already, %llu merged into a batched barrier - %llu eliminated (%.1f%%)\n",
+		(unsigned long long)stats.requested, (unsigned long long)stats.redundant, (unsigned long long)stats.merged,
+		(unsigned long long)stats.GetEliminated(), 100.0 * stats.GetEliminated() / stats.requested);
+	printf("Tracker: %.1f ns per request (flush included)\n", trackerMs * 1e6 / stats.requested);
+	printf("Checks: %s\n", ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
+
+// =====================================================================================
+//										Render graph
+// =====================================================================================
+
+static int RunRenderGraphBenchmark(uint32_t frameCount)
+{
+	using namespace Backend;
+	typedef std::chrono::high_resolution_clock Clock;
+	const uint32_t kAll = ResourceStateTracker::kAllSubresources;
+	const uint32_t kShaderRead = ResourceState_NonPixelShaderResource | ResourceState_PixelShaderResource;
+	const uint64_t kMB = 1024 * 1024;
+
+	if (frameCount == 0)
+	{
+		printf("frames must not be 0\n");
+		return 1;
+	}
+
+	// 1080p: resources in handle order, transients with their size and the state they are created in
+	enum { BackBuffer, ShadowMap, GBuffer0, GBuffer1, GBuffer2, Depth, Ssao, Hdr, BloomTemp, Ldr, DebugView, ResourceCount };
+	const uint32_t kHdrMips = 5;
+	struct ResourceInfo
+	{
+		BarrierResource resource;
+		uint64_t size;			// 0: imported
+	};
+	const ResourceInfo infos[ResourceCount] =
+	{
+		{ { "backbuffer", ResourceState_Present, 1 }, 0 },
+		{ { "shadow map", ResourceState_DepthWrite, 1 }, 16 * kMB },
+		{ { "gbuffer 0", ResourceState_RenderTarget, 1 }, 8 * kMB },
+		{ { "gbuffer 1", ResourceState_RenderTarget, 1 }, 8 * kMB },
+		{ { "gbuffer 2", ResourceState_RenderTarget, 1 }, 8 * kMB },
+		{ { "depth", ResourceState_DepthWrite, 1 }, 8 * kMB },
+		{ { "ssao", ResourceState_UnorderedAccess, 1 }, 2 * kMB },
+		{ { "hdr", ResourceState_UnorderedAccess, kHdrMips }, 22 * kMB },
+		{ { "bloom temp", ResourceState_UnorderedAccess, 1 }, 4 * kMB },
+		{ { "ldr", ResourceState_RenderTarget, 1 }, 8 * kMB },
+		{ { "debug view", ResourceState_RenderTarget, 1 }, 8 * kMB },
+	};
+	std::vector<BarrierResource> resources;
+	for (const ResourceInfo& info : infos)
+		resources.push_back(info.resource);
+
+	// Stand-ins for the ID3D12Resource pointers, the transients' placed once
+	int resourceObjects[ResourceCount];
+	void* ppResources[ResourceCount];
+	for (uint32_t i = 0; i < ResourceCount; i++)
+		ppResources[i] = &resourceObjects[i];
+
+	ResourceStateTracker tracker;
+	tracker.Register(ppResources[BackBuffer], ResourceState_Present);
+
+	BarrierValidator validator(resources);
+	std::vector<ResourceStateTracker::Barrier> barriers;
+	RenderGraph graph;
+	bool ok = true;
+	std::vector<uint32_t> executed;
+	double graphMs = 0.0;
+
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		const Clock::time_point start = Clock::now();
+		graph.Reset();
+		RenderGraph::Handle handles[ResourceCount];
+		for (uint32_t i = 0; i < ResourceCount; i++)
+		{
+			if (infos[i].size == 0)
+			{
+				handles[i] = graph.Import(infos[i].resource.name, ppResources[i], ResourceState_Present);
+				continue;
+			}
+			RenderGraph::TransientDesc desc;
+			desc.name = infos[i].resource.name;
+			desc.size = infos[i].size;
+			handles[i] = graph.CreateTransient(desc);
+		}
+
+		// The passes record nothing, they check the states the graph's barriers left
+		std::vector<std::vector<BarrierUse>> passUses;
+		executed.clear();
+		auto addPass = [&](const char* name, const std::vector<BarrierUse>& uses)
+		{
+			const uint32_t passIndex = (uint32_t)passUses.size();
+			passUses.push_back(uses);
+			RenderGraph::PassBuilder builder = graph.AddPass(name, [&, passIndex]()
+			{
+				for (const BarrierUse& use : passUses[passIndex])
+					ok &= validator.Allows(use);
+				executed.push_back(passIndex);
+			});
+			for (const BarrierUse& use : uses)
+			{
+				// Writes: the targets and UAVs
+				const bool write = use.state == ResourceState_RenderTarget || use.state == ResourceState_DepthWrite ||
+					use.state == ResourceState_UnorderedAccess || use.state == ResourceState_CopyDest;
+				if (write)
+					builder.Write(handles[use.resource], use.state, use.subresource);
+				else
+					builder.Read(handles[use.resource], use.state, use.subresource);
+			}
+		};
+
+		addPass("shadow", { { ShadowMap, ResourceState_DepthWrite, kAll } });
+		addPass("gbuffer", { { GBuffer0, ResourceState_RenderTarget, kAll }, { GBuffer1, ResourceState_RenderTarget, kAll },
+			{ GBuffer2, ResourceState_RenderTarget, kAll }, { Depth, ResourceState_DepthWrite, kAll } });
+		addPass("debug view", { { GBuffer1, ResourceState_PixelShaderResource, kAll }, { DebugView, ResourceState_RenderTarget, kAll } });
+		addPass("ssao", { { Depth, ResourceState_DepthRead | kShaderRead, kAll }, { GBuffer1, kShaderRead, kAll }, { Ssao, ResourceState_UnorderedAccess, kAll } });
+		addPass("lighting", { { GBuffer0, kShaderRead, kAll }, { GBuffer1, kShaderRead, kAll }, { GBuffer2, kShaderRead, kAll },
+			{ Depth, ResourceState_DepthRead | kShaderRead, kAll }, { ShadowMap, kShaderRead, kAll }, { Ssao, ResourceState_NonPixelShaderResource, kAll },
+			{ Hdr, ResourceState_UnorderedAccess, 0 } });
+		for (uint32_t mip = 1; mip < kHdrMips; mip++)
+			addPass("bloom down", { { Hdr, ResourceState_NonPixelShaderResource, mip - 1 }, { Hdr, ResourceState_UnorderedAccess, mip } });
+		addPass("bloom blur", { { Hdr, ResourceState_NonPixelShaderResource, kHdrMips - 1 }, { BloomTemp, ResourceState_UnorderedAccess, kAll } });
+		addPass("bloom blur", { { BloomTemp, ResourceState_NonPixelShaderResource, kAll }, { Hdr, ResourceState_UnorderedAccess, kHdrMips - 1 } });
+		for (uint32_t mip = kHdrMips - 1; mip > 0; mip--)
+			addPass("bloom up", { { Hdr, ResourceState_NonPixelShaderResource, mip }, { Hdr, ResourceState_UnorderedAccess, mip - 1 } });
+		addPass("tonemap", { { Hdr, ResourceState_PixelShaderResource, 0 }, { Ldr, ResourceState_RenderTarget, kAll } });
+		addPass("copy to backbuffer", { { Ldr, ResourceState_CopySource, kAll }, { BackBuffer, ResourceState_CopyDest, kAll } });
+
+		graph.Compile();
+		for (uint32_t i = 0; i < ResourceCount; i++)
+		{
+			if (graph.IsTransientUsed(handles[i]))
+			{
+				// Placed on the first frame, the same resources (same offsets) after
+				if (frame == 0)
+					tracker.Register(ppResources[i], infos[i].resource.homeState, infos[i].resource.subresourceCount);
+				graph.SetTransientResource(handles[i], ppResources[i], frame == 0);
+			}
+		}
+		graph.Execute(tracker, [&]()
+		{
+			tracker.Flush(&barriers);
+			ok &= validator.Apply(barriers, ppResources);
+		});
+		graphMs += MillisecondsSince(start);
+
+		// The debug view is culled (nothing reads it) and its transient unused, the rest ran in order
+		ok &= executed.size() == passUses.size() - 1 && graph.IsPassCulled(2) && !graph.IsTransientUsed(handles[DebugView]);
+		for (size_t i = 1; i < executed.size(); i++)
+			ok &= executed[i] > executed[i - 1];
+		ok &= tracker.GetState(ppResources[BackBuffer]) == ResourceState_Present;
+
+		// Transients sharing memory never live at the same time
+		for (uint32_t a = 0; a < ResourceCount; a++)
+		{
+			for (uint32_t b = a + 1; b < ResourceCount; b++)
+			{
+				if (!graph.IsTransientUsed(handles[a]) || !graph.IsTransientUsed(handles[b]))
+					continue;
+				const uint64_t offsetA = graph.GetTransientOffset(handles[a]);
+				const uint64_t offsetB = graph.GetTransientOffset(handles[b]);
+				if (!(offsetA < offsetB + infos[b].size && offsetB < offsetA + infos[a].size))
+					continue;
+
+				size_t firstA = passUses.size(), lastA = 0, firstB = passUses.size(), lastB = 0;
+				for (size_t pass = 0; pass < passUses.size(); pass++)
+				{
+					if (graph.IsPassCulled((uint32_t)pass))
+						continue;
+					for (const BarrierUse& use : passUses[pass])
+					{
+						if (use.resource == a)
+							firstA = std::min(firstA, pass), lastA = std::max(lastA, pass);
+						if (use.resource == b)
+							firstB = std::min(firstB, pass), lastB = std::max(lastB, pass);
+					}
+				}
+				ok &= lastA < firstB || lastB < firstA;
+			}
+		}
+	}
+
+	// A read of a transient nothing wrote is an error
+	bool threw = false;
+	try
+	{
+		RenderGraph badGraph;
+		RenderGraph::TransientDesc desc;
+		desc.name = "unwritten";
+		desc.size = kMB;
+		const RenderGraph::Handle unwritten = badGraph.CreateTransient(desc);
+		const RenderGraph::Handle target = badGraph.Import("target", ppResources[BackBuffer]);
+		badGraph.AddPass("reader", []() {}).Read(unwritten, ResourceState_PixelShaderResource).Write(target, ResourceState_RenderTarget);
+		badGraph.Compile();
+	}
+	catch (const std::logic_error&)
+	{
+		threw = true;
+	}
+	ok &= threw;
+
+	const RenderGraph::Stats& graphStats = graph.GetStats();
+	const ResourceStateTracker::Stats& trackerStats = tracker.GetStats();
+	printf("%u passes (%u culled), %u transients, %u frames\n\n", graphStats.passes, graphStats.culledPasses, graphStats.transients, frameCount);
+	printf("Transient memory: %.1f MB summed, %.1f MB heap (%.1f%% saved by aliasing)\n",
+		graphStats.transientBytes / (double)kMB, graphStats.heapBytes / (double)kMB,
+		100.0 * (1.0 - (double)graphStats.heapBytes / graphStats.transientBytes));
+	printf("Per frame: %.2f transitions, %.2f UAV and %.2f aliasing barriers in %.2f ResourceBarrier calls, %.2f eliminated requests\n",
+		(double)trackerStats.issued / frameCount, (double)trackerStats.uavIssued / frameCount, (double)trackerStats.aliasingIssued / frameCount,
+		(double)trackerStats.batches / frameCount, (double)trackerStats.GetEliminated() / frameCount);
+	printf("Declare + compile + execute: %.2f us per frame\n", graphMs * 1000.0 / frameCount);
+	printf("Checks: %s\n", ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
+
+// =====================================================================================
+//										Async compute overlap
+// =====================================================================================
+
+struct OverlapResult
+{
+	double msPerFrame;
+	double directBusyMs;		// per frame
+	double computeBusyMs;
+	double overlapMs;
+	bool ok;
+};
+
+// The raytracing sample's frame on the null device, 3 frames in flight. Sync: the TLAS refit and the
+// rays on one direct list. Async: two TLAS, the compute queue refits the one of frame N+1 while the
+// direct queue traces frame N - the refit waits for the direct frame that read the TLAS last (N-1),
+// the direct frame for the refit of its TLAS. The queues' busy intervals go to trace.
+static OverlapResult RunOverlapFrames(bool async, double raytraceMs, double refitMs, uint32_t frameCount, TimelineTrace& trace)
+{
+	using namespace Backend;
+	typedef std::chrono::high_resolution_clock Clock;
+	const uint32_t kFramesInFlight = 3;
+	const uint32_t kTlasCount = 2;
+
+	NullDevice device;
+	CommandQueue* pDirectQueue = device.GetQueue(QueueType::Direct);
+	CommandQueue* pComputeQueue = device.GetQueue(QueueType::Compute);
+	const uint32_t raytraceDispatches = (uint32_t)(raytraceMs * 1000.0 / device.GetTiming().dispatchUs);
+	const uint32_t refitDispatches = (uint32_t)(refitMs * 1000.0 / device.GetTiming().dispatchUs);
+	device.SetTraceEnabled(true);
+
+	const auto record = [](CommandQueue* pQueue, uint32_t dispatchCount)
+	{
+		CommandList* pCommandList = pQueue->GetCommandList();
+		for (uint32_t i = 0; i < dispatchCount; i++)
+			pCommandList->Dispatch(1, 1, 1);
+		return pCommandList;
+	};
+
+	// Fence values per frame: of its direct submit and of the refit of its TLAS (compute queue)
+	std::vector<uint64_t> frameFences(frameCount, 0);
+	std::vector<uint64_t> refitFences(frameCount + 1, 0);
+	uint64_t tlasReadFences[kTlasCount] = {};
+
+	// The builds of the TLAS before the first frame
+	if (async)
+		refitFences[0] = pComputeQueue->ExecuteCommandList(record(pComputeQueue, refitDispatches));
+
+	const Clock::time_point start = Clock::now();
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		const uint32_t tlas = frame % kTlasCount;
+		if (async)
+		{
+			pDirectQueue->Wait(*pComputeQueue, refitFences[frame]);
+			frameFences[frame] = pDirectQueue->ExecuteCommandList(record(pDirectQueue, raytraceDispatches));
+			tlasReadFences[tlas] = frameFences[frame];
+
+			// The next frame's TLAS, once the frame before this one is done tracing it
+			const uint32_t nextTlas = (frame + 1) % kTlasCount;
+			if (tlasReadFences[nextTlas])
+				pComputeQueue->Wait(*pDirectQueue, tlasReadFences[nextTlas]);
+			refitFences[frame + 1] = pComputeQueue->ExecuteCommandList(record(pComputeQueue, refitDispatches));
+		}
+		else
+		{
+			frameFences[frame] = pDirectQueue->ExecuteCommandList(record(pDirectQueue, refitDispatches + raytraceDispatches));
+		}
+
+		// The frame that used the next backbuffer
+		if (frame + 1 >= kFramesInFlight)
+			pDirectQueue->WaitForFenceValue(frameFences[frame + 1 - kFramesInFlight]);
+	}
+	pDirectQueue->Flush();
+	pComputeQueue->Flush();
+	const double totalMs = MillisecondsSince(start);
+
+	// Fence values are the submit order of each queue: the direct one's frame + 1, the compute
+	// one's frame + 1 (the builds before the first frame are 1)
+	const uint32_t directTrack = trace.AddTrack(async ? "async: direct queue" : "sync: direct queue");
+	const uint32_t computeTrack = trace.AddTrack(async ? "async: compute queue" : "sync: compute queue");
+	const std::vector<NullBusyInterval> directIntervals = device.TakeTrace(QueueType::Direct);
+	const std::vector<NullBusyInterval> computeIntervals = device.TakeTrace(QueueType::Compute);
+	char name[64];
+	for (const NullBusyInterval& interval : directIntervals)
+	{
+		snprintf(name, sizeof(name), async ? "raytrace %llu" : "refit + raytrace %llu", (unsigned long long)interval.fenceValue - 1);
+		trace.Add(directTrack, name, interval.beginUs, interval.endUs);
+	}
+	for (const NullBusyInterval& interval : computeIntervals)
+	{
+		snprintf(name, sizeof(name), interval.fenceValue == 1 ? "TLAS build" : "TLAS refit %llu", (unsigned long long)interval.fenceValue - 1);
+		trace.Add(computeTrack, name, interval.beginUs, interval.endUs);
+	}
+
+	bool ok = directIntervals.size() == frameCount && computeIntervals.size() == (async ? frameCount + 1 : 0);
+	if (ok && async)
+	{
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			// The frame traces its TLAS after the refit, the refit of the frame after the next one
+			// (same TLAS) waits until this frame is done with it
+			ok &= directIntervals[frame].beginUs >= computeIntervals[frame].endUs;
+			if (frame + 2 <= frameCount)
+				ok &= computeIntervals[frame + 2].beginUs >= directIntervals[frame].endUs;
+		}
+	}
+
+	OverlapResult result;
+	result.msPerFrame = totalMs / frameCount;
+	result.directBusyMs = trace.GetBusyUs(directTrack) * 1e-3 / frameCount;
+	result.computeBusyMs = trace.GetBusyUs(computeTrack) * 1e-3 / frameCount;
+	result.overlapMs = trace.GetOverlapUs(directTrack, computeTrack) * 1e-3 / frameCount;
+	result.ok = ok && (async ? result.overlapMs > 0.0 : result.overlapMs == 0.0);
+	return result;
+}
+
+
+static int RunOverlapBenchmark(double raytraceMs, double refitMs, uint32_t frameCount, const char* tracePath)
+{
+	if (frameCount == 0)
+	{
+		printf("frames must not be 0\n");
+		return 1;
+	}
+
+	printf("Raytrace %.2f ms, TLAS refit %.2f ms per frame, 3 frames in flight, %u frames\n", raytraceMs, refitMs, frameCount);
+	printf("(the null device's queues run side by side at full speed: the overlap a GPU can at best reach)\n\n");
+	printf("%-6s %10s %13s %14s %18s %7s\n", "refit", "ms/frame", "direct busy", "compute busy", "overlap", "checks");
+
+	TimelineTrace trace;
+	bool ok = true;
+	for (int async = 0; async < 2; async++)
+	{
+		const OverlapResult result = RunOverlapFrames(async != 0, raytraceMs, refitMs, frameCount, trace);
+		const double overlapRatio = result.computeBusyMs > 0.0 ? result.overlapMs / result.computeBusyMs : 0.0;
+		printf("%-6s %10.3f %10.3f ms %11.3f ms %8.3f ms %5.1f%% %7s\n", async ? "async" : "sync", result.msPerFrame,
+			result.directBusyMs, result.computeBusyMs, result.overlapMs, 100.0 * overlapRatio, result.ok ? "ok" : "FAILED");
+		ok &= result.ok;
+	}
+
+	if (tracePath)
+	{
+		const bool written = trace.WriteChromeTrace(tracePath);
+		printf("\nTimeline (chrome://tracing, ui.perfetto.dev): %s %s\n", tracePath, written ? "written" : "could not be written");
+		ok &= written;
+	}
+
+	return ok ? 0 : 1;
+}
+
+// =====================================================================================
+//										main
+// =====================================================================================
+
+int main(int argc, char** argv)
+{
+	const char* command = argc > 1 ? argv[1] : "record";
+
+	if (strcmp(command, "record") == 0)
+		return RunRecordBenchmark(ArgToUInt(argc, argv, 2, 0), ArgToUInt(argc, argv, 3, 64), ArgToUInt(argc, argv, 4, 2000));
+	if (strcmp(command, "batch") == 0)
+		return RunBatchCheck();
+	if (strcmp(command, "ring") == 0)
+		return RunRingCheck(ArgToUInt(argc, argv, 2, 10000));
+	if (strcmp(command, "pacing") == 0)
+		return RunPacingBenchmark(ArgToUInt(argc, argv, 2, 0), argc > 3 ? atof(argv[3]) : 4.0, argc > 4 ? atof(argv[4]) : 6.0, ArgToUInt(argc, argv, 5, 200));
+	if (strcmp(command, "barriers") == 0)
+		return RunBarrierBenchmark(ArgToUInt(argc, argv, 2, 1000));
+	if (strcmp(command, "graph") == 0)
+		return RunRenderGraphBenchmark(ArgToUInt(argc, argv, 2, 1000));
+	if (strcmp(command, "overlap") == 0)
+		return RunOverlapBenchmark(argc > 2 ? atof(argv[2]) : 6.0, argc > 3 ? atof(argv[3]) : 2.0, ArgToUInt(argc, argv, 4, 200), argc > 5 ? argv[5] : nullptr);
+
+	printf("Unknown command: %s\n", command);
+	return 1;
+}
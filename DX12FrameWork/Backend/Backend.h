@@ -0,0 +1,182 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) device / queue / command list interface.
+// Two implementations:
+//		- D3D12Device (D3D12Device.h)	- over the ID3D12Device5 and the CommandQueues of Application
+//		- NullDevice (NullDevice.h)		- no GPU: records the commands, simulates the fences with a
+//										  configurable GPU latency and tracks memory; runs on Linux
+// Code written against this interface (allocators, schedulers, frame pacing) can be benchmarked and
+// tested headless. It covers what that code needs, not all of D3D12 - native objects stay
+// reachable from the D3D12 implementation.
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace Backend
+{
+
+// threadIndex of CommandQueue::GetCommandList() < kMaxRecordingThreads
+static const uint32_t kMaxRecordingThreads = 64;
+
+enum class QueueType
+{
+	Direct,
+	Compute,
+	Copy,
+	Count
+};
+
+enum class HeapType
+{
+	Default,	// GPU memory
+	Upload,		// CPU write, GPU read
+	Readback,	// GPU write, CPU read
+	Count
+};
+
+// Bits of D3D12_RESOURCE_STATES (same values)
+enum ResourceState : uint32_t
+{
+	ResourceState_Common							= 0,
+	ResourceState_VertexAndConstantBuffer			= 0x1,
+	ResourceState_IndexBuffer						= 0x2,
+	ResourceState_RenderTarget						= 0x4,
+	ResourceState_UnorderedAccess					= 0x8,
+	ResourceState_DepthWrite						= 0x10,
+	ResourceState_DepthRead							= 0x20,
+	ResourceState_NonPixelShaderResource			= 0x40,
+	ResourceState_PixelShaderResource				= 0x80,
+	ResourceState_IndirectArgument					= 0x200,
+	ResourceState_CopyDest							= 0x400,
+	ResourceState_CopySource						= 0x800,
+	ResourceState_RaytracingAccelerationStructure	= 0x400000,
+	ResourceState_GenericRead						= 0x1 | 0x2 | 0x40 | 0x80 | 0x200 | 0x800,
+	ResourceState_Present							= 0,
+};
+
+struct BufferDesc
+{
+	uint64_t size = 0;
+	HeapType heapType = HeapType::Default;
+	bool allowUnorderedAccess = false;
+	// Initial state, Default heap only - Upload heaps start in GenericRead, Readback in CopyDest
+	ResourceState initialState = ResourceState_Common;
+};
+
+class Resource
+{
+public:
+	virtual ~Resource() {}
+
+	const BufferDesc& GetDesc() const { return m_Desc; }
+	// Upload and Readback heaps only
+	virtual void* Map() = 0;
+	virtual void Unmap() = 0;
+
+protected:
+	explicit Resource(const BufferDesc& desc) : m_Desc(desc) {}
+
+	BufferDesc m_Desc;
+};
+
+// A command list in the recording state. Owned by its queue: valid from GetCommandList() until
+// it has been passed to ExecuteCommandLists().
+class CommandList
+{
+public:
+	virtual ~CommandList() {}
+
+	virtual void ResourceBarrier(Resource* pResource, ResourceState before, ResourceState after) = 0;
+	// UAV barrier, pResource null for all of them
+	virtual void UavBarrier(Resource* pResource) = 0;
+	virtual void CopyBufferRegion(Resource* pDestination, uint64_t destinationOffset, Resource* pSource, uint64_t sourceOffset, uint64_t size) = 0;
+	virtual void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) = 0;
+	virtual void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
+};
+
+class CommandQueue
+{
+public:
+	struct SubmitStats
+	{
+		uint64_t submits = 0;		// ExecuteCommandLists calls
+		uint64_t commandLists = 0;
+		uint64_t signals = 0;
+		uint64_t gpuWaits = 0;
+	};
+
+	virtual ~CommandQueue() {}
+
+	// Thread-safe. Threads recording at the same time pass different threadIndex values.
+	virtual CommandList* GetCommandList(uint32_t threadIndex = 0) = 0;
+	// Closes and submits the lists in order, then signals. Returns the fence value of the signal.
+	virtual uint64_t ExecuteCommandLists(CommandList* const* ppCommandLists, uint32_t count) = 0;
+	uint64_t ExecuteCommandList(CommandList* pCommandList) { return ExecuteCommandLists(&pCommandList, 1); }
+
+	virtual uint64_t Signal() = 0;
+	virtual uint64_t GetCompletedFenceValue() = 0;
+	bool IsFenceComplete(uint64_t fenceValue) { return GetCompletedFenceValue() >= fenceValue; }
+	// Blocks the calling thread
+	virtual void WaitForFenceValue(uint64_t fenceValue) = 0;
+	void Flush() { WaitForFenceValue(Signal()); }
+	// GPU-side wait: work submitted afterwards starts once the fence of other reaches fenceValue.
+	// other has to be a queue of the same device.
+	virtual void Wait(CommandQueue& other, uint64_t fenceValue) = 0;
+
+	virtual SubmitStats GetSubmitStats() = 0;
+};
+
+class Device
+{
+public:
+	struct MemoryStats
+	{
+		// Per HeapType
+		uint64_t currentBytes[(int)HeapType::Count] = {};
+		uint64_t peakBytes[(int)HeapType::Count] = {};
+		uint64_t resourceCount = 0;
+		uint64_t createdResources = 0;
+	};
+
+	virtual ~Device() {}
+
+	virtual CommandQueue* GetQueue(QueueType type) = 0;
+	virtual std::shared_ptr<Resource> CreateBuffer(const BufferDesc& desc) = 0;
+	// Resources created through the device and not released yet
+	virtual MemoryStats GetMemoryStats() = 0;
+};
+
+// Memory counters of a device, shared with its resources (which may outlive the device)
+class MemoryTracker
+{
+public:
+	void OnCreate(HeapType heapType, uint64_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		uint64_t& current = m_Stats.currentBytes[(int)heapType];
+		current += bytes;
+		m_Stats.peakBytes[(int)heapType] = current > m_Stats.peakBytes[(int)heapType] ? current : m_Stats.peakBytes[(int)heapType];
+		m_Stats.resourceCount++;
+		m_Stats.createdResources++;
+	}
+
+	void OnRelease(HeapType heapType, uint64_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stats.currentBytes[(int)heapType] -= bytes;
+		m_Stats.resourceCount--;
+	}
+
+	Device::MemoryStats GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+private:
+	std::mutex m_Mutex;
+	Device::MemoryStats m_Stats;
+};
+
+} // namespace Backend
@@ -0,0 +1,198 @@
+#include "../Helpers/Helpers.h"
+#include "../Helpers/d3dx12.h"
+
+#include "D3D12Device.h"
+
+namespace Backend
+{
+
+static ID3D12Resource* GetNative(Resource* pResource)
+{
+	return pResource ? static_cast<D3D12Resource*>(pResource)->GetD3D12Resource() : nullptr;
+}
+
+// =====================================================================================
+//										D3D12Resource
+// =====================================================================================
+
+D3D12Resource::D3D12Resource(const BufferDesc& desc, ComPtr<ID3D12Resource> resource, UINT64 allocatedBytes, std::shared_ptr<MemoryTracker> memoryTracker)
+	: Resource(desc)
+	, m_Resource(resource)
+	, m_AllocatedBytes(allocatedBytes)
+	, m_MemoryTracker(memoryTracker)
+{
+	m_MemoryTracker->OnCreate(desc.heapType, m_AllocatedBytes);
+}
+
+D3D12Resource::~D3D12Resource()
+{
+	m_MemoryTracker->OnRelease(m_Desc.heapType, m_AllocatedBytes);
+}
+
+
+void* D3D12Resource::Map()
+{
+	// Readback buffers are read whole, upload buffers aren't read
+	void* pData = nullptr;
+	CD3DX12_RANGE readRange(0, m_Desc.heapType == HeapType::Readback ? (SIZE_T)m_Desc.size : 0);
+	ThrowIfFailed(m_Resource->Map(0, &readRange, &pData));
+	return pData;
+}
+
+
+void D3D12Resource::Unmap()
+{
+	CD3DX12_RANGE writtenRange(0, m_Desc.heapType == HeapType::Upload ? (SIZE_T)m_Desc.size : 0);
+	m_Resource->Unmap(0, &writtenRange);
+}
+
+// =====================================================================================
+//										D3D12CommandList
+// =====================================================================================
+
+void D3D12CommandList::ResourceBarrier(Resource* pResource, ResourceState before, ResourceState after)
+{
+	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(GetNative(pResource), (D3D12_RESOURCE_STATES)before, (D3D12_RESOURCE_STATES)after);
+	m_CommandList->ResourceBarrier(1, &barrier);
+}
+
+
+void D3D12CommandList::UavBarrier(Resource* pResource)
+{
+	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(GetNative(pResource));
+	m_CommandList->ResourceBarrier(1, &barrier);
+}
+
+
+void D3D12CommandList::CopyBufferRegion(Resource* pDestination, uint64_t destinationOffset, Resource* pSource, uint64_t sourceOffset, uint64_t size)
+{
+	m_CommandList->CopyBufferRegion(GetNative(pDestination), destinationOffset, GetNative(pSource), sourceOffset, size);
+}
+
+
+void D3D12CommandList::DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+	m_CommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+
+void D3D12CommandList::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	m_CommandList->Dispatch(groupCountX, groupCountY, groupCountZ);
+}
+
+// =====================================================================================
+//										D3D12Queue
+// =====================================================================================
+
+D3D12Queue::D3D12Queue(std::shared_ptr<::CommandQueue> commandQueue)
+	: m_CommandQueue(commandQueue)
+{
+}
+
+
+CommandList* D3D12Queue::GetCommandList(uint32_t threadIndex)
+{
+	ComPtr<ID3D12GraphicsCommandList4> commandList = m_CommandQueue->GetCommandList(threadIndex);
+
+	D3D12CommandList* pWrapper;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_FreeCommandLists.empty())
+		{
+			pWrapper = m_FreeCommandLists.back();
+			m_FreeCommandLists.pop_back();
+		}
+		else
+		{
+			m_CommandLists.emplace_back(new D3D12CommandList());
+			pWrapper = m_CommandLists.back().get();
+		}
+	}
+	pWrapper->m_CommandList = commandList;
+	return pWrapper;
+}
+
+
+uint64_t D3D12Queue::ExecuteCommandLists(CommandList* const* ppCommandLists, uint32_t count)
+{
+	std::vector<ComPtr<ID3D12GraphicsCommandList4>> commandLists(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		D3D12CommandList* pWrapper = static_cast<D3D12CommandList*>(ppCommandLists[i]);
+		commandLists[i].Swap(pWrapper->m_CommandList);
+	}
+
+	const uint64_t fenceValue = m_CommandQueue->ExecuteCommandLists(commandLists.data(), count);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (uint32_t i = 0; i < count; i++)
+		m_FreeCommandLists.push_back(static_cast<D3D12CommandList*>(ppCommandLists[i]));
+	return fenceValue;
+}
+
+
+void D3D12Queue::Wait(CommandQueue& other, uint64_t fenceValue)
+{
+	m_CommandQueue->Wait(*static_cast<D3D12Queue&>(other).m_CommandQueue, fenceValue);
+}
+
+
+CommandQueue::SubmitStats D3D12Queue::GetSubmitStats()
+{
+	const ::CommandQueue::SubmitStats queueStats = m_CommandQueue->GetSubmitStats();
+	SubmitStats stats;
+	stats.submits = queueStats.submits;
+	stats.commandLists = queueStats.commandLists;
+	stats.signals = queueStats.signals;
+	stats.gpuWaits = queueStats.gpuWaits;
+	return stats;
+}
+
+// =====================================================================================
+//										D3D12Device
+// =====================================================================================
+
+D3D12Device::D3D12Device(ComPtr<ID3D12Device5> device, std::shared_ptr<::CommandQueue> directQueue,
+	std::shared_ptr<::CommandQueue> computeQueue, std::shared_ptr<::CommandQueue> copyQueue)
+	: m_d3d12Device(device)
+	, m_MemoryTracker(std::make_shared<MemoryTracker>())
+{
+	m_Queues[(int)QueueType::Direct].reset(new D3D12Queue(directQueue));
+	m_Queues[(int)QueueType::Compute].reset(new D3D12Queue(computeQueue));
+	m_Queues[(int)QueueType::Copy].reset(new D3D12Queue(copyQueue));
+}
+
+
+std::shared_ptr<Resource> D3D12Device::CreateBuffer(const BufferDesc& desc)
+{
+	BufferDesc bufferDesc = desc;
+	D3D12_HEAP_TYPE heapType = D3D12_HEAP_TYPE_DEFAULT;
+	if (desc.heapType == HeapType::Upload)
+	{
+		heapType = D3D12_HEAP_TYPE_UPLOAD;
+		bufferDesc.initialState = ResourceState_GenericRead;
+	}
+	else if (desc.heapType == HeapType::Readback)
+	{
+		heapType = D3D12_HEAP_TYPE_READBACK;
+		bufferDesc.initialState = ResourceState_CopyDest;
+	}
+
+	const D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(desc.size,
+		desc.allowUnorderedAccess ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE);
+
+	ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(m_d3d12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(heapType),
+		D3D12_HEAP_FLAG_NONE,
+		&resourceDesc,
+		(D3D12_RESOURCE_STATES)bufferDesc.initialState,
+		nullptr,
+		IID_PPV_ARGS(&resource)));
+
+	const UINT64 allocatedBytes = m_d3d12Device->GetResourceAllocationInfo(0, 1, &resourceDesc).SizeInBytes;
+	return std::make_shared<D3D12Resource>(bufferDesc, resource, allocatedBytes, m_MemoryTracker);
+}
+
+} // namespace Backend
@@ -0,0 +1,94 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>    // For Microsoft::WRL::ComPtr
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Backend.h"
+#include "../Framework/CommandQueue.h"
+
+// Backend.h over D3D12. The queues forward to the framework's CommandQueues (Application's, so
+// both views of a queue share one fence), the native objects are reachable for everything the
+// interface doesn't cover.
+namespace Backend
+{
+
+using Microsoft::WRL::ComPtr;
+
+class D3D12Resource : public Resource
+{
+public:
+	D3D12Resource(const BufferDesc& desc, ComPtr<ID3D12Resource> resource, UINT64 allocatedBytes, std::shared_ptr<MemoryTracker> memoryTracker);
+	~D3D12Resource();
+
+	void* Map() override;
+	void Unmap() override;
+
+	ID3D12Resource* GetD3D12Resource() const { return m_Resource.Get(); }
+
+private:
+	ComPtr<ID3D12Resource> m_Resource;
+	UINT64 m_AllocatedBytes;
+	std::shared_ptr<MemoryTracker> m_MemoryTracker;
+};
+
+class D3D12CommandList : public CommandList
+{
+public:
+	void ResourceBarrier(Resource* pResource, ResourceState before, ResourceState after) override;
+	void UavBarrier(Resource* pResource) override;
+	void CopyBufferRegion(Resource* pDestination, uint64_t destinationOffset, Resource* pSource, uint64_t sourceOffset, uint64_t size) override;
+	void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+	void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
+
+	ID3D12GraphicsCommandList4* GetD3D12CommandList() const { return m_CommandList.Get(); }
+
+private:
+	friend class D3D12Queue;
+	ComPtr<ID3D12GraphicsCommandList4> m_CommandList;
+};
+
+class D3D12Queue : public CommandQueue
+{
+public:
+	explicit D3D12Queue(std::shared_ptr<::CommandQueue> commandQueue);
+
+	CommandList* GetCommandList(uint32_t threadIndex = 0) override;
+	uint64_t ExecuteCommandLists(CommandList* const* ppCommandLists, uint32_t count) override;
+	uint64_t Signal() override { return m_CommandQueue->Signal(); }
+	uint64_t GetCompletedFenceValue() override { return m_CommandQueue->GetCompletedFenceValue(); }
+	void WaitForFenceValue(uint64_t fenceValue) override { m_CommandQueue->WaitForFenceValue(fenceValue); }
+	void Wait(CommandQueue& other, uint64_t fenceValue) override;
+	SubmitStats GetSubmitStats() override;
+
+	std::shared_ptr<::CommandQueue> GetFrameworkQueue() const { return m_CommandQueue; }
+
+private:
+	std::shared_ptr<::CommandQueue> m_CommandQueue;
+
+	// Wrappers of the lists handed out, reused after they were executed
+	std::mutex m_Mutex;
+	std::vector<std::unique_ptr<D3D12CommandList>> m_CommandLists;
+	std::vector<D3D12CommandList*> m_FreeCommandLists;
+};
+
+class D3D12Device : public Device
+{
+public:
+	D3D12Device(ComPtr<ID3D12Device5> device, std::shared_ptr<::CommandQueue> directQueue,
+		std::shared_ptr<::CommandQueue> computeQueue, std::shared_ptr<::CommandQueue> copyQueue);
+
+	CommandQueue* GetQueue(QueueType type) override { return m_Queues[(int)type].get(); }
+	std::shared_ptr<Resource> CreateBuffer(const BufferDesc& desc) override;
+	MemoryStats GetMemoryStats() override { return m_MemoryTracker->GetStats(); }
+
+	ComPtr<ID3D12Device5> GetD3D12Device() const { return m_d3d12Device; }
+
+private:
+	ComPtr<ID3D12Device5> m_d3d12Device;
+	std::unique_ptr<D3D12Queue> m_Queues[(int)QueueType::Count];
+	std::shared_ptr<MemoryTracker> m_MemoryTracker;
+};
+
+} // namespace Backend
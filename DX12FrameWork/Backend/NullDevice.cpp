@@ -0,0 +1,484 @@
+#include "NullDevice.h"
+#include "../Utils/CommandAllocatorPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+
+namespace Backend
+{
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::duration Microseconds(double us)
+	{
+		return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(us));
+	}
+
+	class NullResource : public Resource
+	{
+	public:
+		NullResource(const BufferDesc& desc, std::shared_ptr<MemoryTracker> memoryTracker)
+			: Resource(desc)
+			, m_MemoryTracker(memoryTracker)
+		{
+			if (desc.heapType != HeapType::Default)
+				m_CpuMemory.resize((size_t)desc.size);
+			m_MemoryTracker->OnCreate(desc.heapType, desc.size);
+		}
+
+		~NullResource()
+		{
+			m_MemoryTracker->OnRelease(m_Desc.heapType, m_Desc.size);
+		}
+
+		void* Map() override
+		{
+			assert(m_Desc.heapType != HeapType::Default);
+			return m_CpuMemory.data();
+		}
+
+		void Unmap() override {}
+
+	private:
+		std::shared_ptr<MemoryTracker> m_MemoryTracker;
+		std::vector<uint8_t> m_CpuMemory;
+	};
+
+	// Storage of recorded commands, reused like an ID3D12CommandAllocator once its fence passed
+	struct NullAllocator
+	{
+		std::vector<NullCommand> commands;
+	};
+
+	class NullCommandList : public CommandList
+	{
+	public:
+		NullAllocator* pAllocator = nullptr;
+		uint32_t slot = 0;
+
+		void ResourceBarrier(Resource* pResource, ResourceState before, ResourceState after) override
+		{
+			Add(NullCommand{ NullCommand::Type::ResourceBarrier, { pResource, nullptr }, { before, after, 0 } });
+		}
+
+		void UavBarrier(Resource* pResource) override
+		{
+			Add(NullCommand{ NullCommand::Type::UavBarrier, { pResource, nullptr }, { 0, 0, 0 } });
+		}
+
+		void CopyBufferRegion(Resource* pDestination, uint64_t destinationOffset, Resource* pSource, uint64_t sourceOffset, uint64_t size) override
+		{
+			assert(destinationOffset + size <= pDestination->GetDesc().size && sourceOffset + size <= pSource->GetDesc().size);
+			Add(NullCommand{ NullCommand::Type::CopyBufferRegion, { pDestination, pSource }, { destinationOffset, sourceOffset, size } });
+		}
+
+		void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t, int32_t, uint32_t) override
+		{
+			Add(NullCommand{ NullCommand::Type::DrawIndexedInstanced, { nullptr, nullptr }, { indexCountPerInstance, instanceCount, 0 } });
+		}
+
+		void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override
+		{
+			Add(NullCommand{ NullCommand::Type::Dispatch, { nullptr, nullptr }, { groupCountX, groupCountY, groupCountZ } });
+		}
+
+	private:
+		void Add(const NullCommand& command)
+		{
+			assert(pAllocator && "The list was executed already");
+			pAllocator->commands.push_back(command);
+		}
+	};
+}
+
+// =====================================================================================
+//										NullQueue
+// =====================================================================================
+
+class NullQueue : public CommandQueue
+{
+public:
+	explicit NullQueue(NullDevice& device)
+		: m_Device(device)
+		, m_AllocatorPool(kMaxRecordingThreads)
+	{
+	}
+
+	CommandList* GetCommandList(uint32_t threadIndex) override;
+	uint64_t ExecuteCommandLists(CommandList* const* ppCommandLists, uint32_t count) override;
+	uint64_t Signal() override;
+	uint64_t GetCompletedFenceValue() override;
+	void WaitForFenceValue(uint64_t fenceValue) override;
+	void Wait(CommandQueue& other, uint64_t fenceValue) override;
+	SubmitStats GetSubmitStats() override;
+
+	// The rest with the device's mutex held
+
+	// Resolves submitted operations in order until one waits for a signal the other queue
+	// hasn't resolved. True if anything was resolved.
+	bool Advance();
+	// Completes the resolved signals reached at now
+	void Complete(Clock::time_point now);
+	// GPU time at which fenceValue is (was) reached, false if it isn't resolved yet
+	bool FindSignalTime(uint64_t fenceValue, Clock::time_point* pTime) const;
+
+	double busyUs = 0.0;
+	std::vector<NullCommand> capturedCommands;
+	std::vector<NullBusyInterval> trace;
+
+private:
+	double GetCost(const NullCommand& command) const;
+
+private:
+	struct Operation
+	{
+		enum class Type { Execute, Signal, Wait };
+		Type type;
+		Clock::time_point submitTime;	// Execute
+		double costUs;					// Execute
+		uint64_t fenceValue;			// Signal, Wait, Execute (its signal's)
+		NullQueue* pOther;				// Wait
+	};
+
+	NullDevice& m_Device;
+
+	// Submitted, not yet placed on the timeline
+	std::deque<Operation> m_Operations;
+	// End of the resolved work
+	Clock::time_point m_GpuTime;
+	// Resolved signals, not completed yet: fence value and GPU time
+	std::deque<std::pair<uint64_t, Clock::time_point>> m_Signals;
+	uint64_t m_FenceValue = 0;
+	uint64_t m_CompletedFenceValue = 0;
+	SubmitStats m_Stats;
+
+	// Allocators and lists belong to the queue. The pool has its own locks.
+	CommandAllocatorPool<NullAllocator*> m_AllocatorPool;
+	std::vector<std::unique_ptr<NullAllocator>> m_Allocators;
+	std::vector<std::unique_ptr<NullCommandList>> m_CommandLists;
+	std::vector<NullCommandList*> m_FreeCommandLists;
+};
+
+
+CommandList* NullQueue::GetCommandList(uint32_t threadIndex)
+{
+	NullAllocator* pAllocator;
+	const bool reused = m_AllocatorPool.Acquire(threadIndex, GetCompletedFenceValue(), &pAllocator);
+
+	std::lock_guard<std::mutex> lock(m_Device.m_Mutex);
+	if (reused)
+	{
+		pAllocator->commands.clear();
+	}
+	else
+	{
+		m_Allocators.emplace_back(new NullAllocator());
+		pAllocator = m_Allocators.back().get();
+	}
+
+	NullCommandList* pCommandList;
+	if (!m_FreeCommandLists.empty())
+	{
+		pCommandList = m_FreeCommandLists.back();
+		m_FreeCommandLists.pop_back();
+	}
+	else
+	{
+		m_CommandLists.emplace_back(new NullCommandList());
+		pCommandList = m_CommandLists.back().get();
+	}
+	pCommandList->pAllocator = pAllocator;
+	pCommandList->slot = threadIndex;
+	return pCommandList;
+}
+
+
+uint64_t NullQueue::ExecuteCommandLists(CommandList* const* ppCommandLists, uint32_t count)
+{
+	std::lock_guard<std::mutex> lock(m_Device.m_Mutex);
+	const Clock::time_point now = Clock::now();
+
+	double costUs = 0.0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const NullCommandList* pCommandList = static_cast<const NullCommandList*>(ppCommandLists[i]);
+		for (const NullCommand& command : pCommandList->pAllocator->commands)
+			costUs += GetCost(command);
+		if (m_Device.m_CaptureEnabled)
+			capturedCommands.insert(capturedCommands.end(), pCommandList->pAllocator->commands.begin(), pCommandList->pAllocator->commands.end());
+	}
+
+	const uint64_t fenceValue = ++m_FenceValue;
+	m_Operations.push_back(Operation{ Operation::Type::Execute, now, costUs, fenceValue, nullptr });
+	m_Operations.push_back(Operation{ Operation::Type::Signal, now, 0.0, fenceValue, nullptr });
+	m_Stats.submits++;
+	m_Stats.commandLists += count;
+	m_Stats.signals++;
+
+	// Under the device lock, the fence values of a slot stay in order
+	for (uint32_t i = 0; i < count; i++)
+	{
+		NullCommandList* pCommandList = static_cast<NullCommandList*>(ppCommandLists[i]);
+		m_AllocatorPool.Retire(pCommandList->slot, fenceValue, pCommandList->pAllocator);
+		pCommandList->pAllocator = nullptr;
+		m_FreeCommandLists.push_back(pCommandList);
+	}
+
+	m_Device.UpdateLocked(now);
+	return fenceValue;
+}
+
+
+uint64_t NullQueue::Signal()
+{
+	std::lock_guard<std::mutex> lock(m_Device.m_Mutex);
+	const uint64_t fenceValue = ++m_FenceValue;
+	m_Operations.push_back(Operation{ Operation::Type::Signal, Clock::now(), 0.0, fenceValue, nullptr });
+	m_Stats.signals++;
+
+	m_Device.UpdateLocked(Clock::now());
+	return fenceValue;
+}
+
+
+uint64_t NullQueue::GetCompletedFenceValue()
+{
+	std::lock_guard<std::mutex> lock(m_Device.m_Mutex);
+	m_Device.UpdateLocked(Clock::now());
+	return m_CompletedFenceValue;
+}
+
+
+void NullQueue::WaitForFenceValue(uint64_t fenceValue)
+{
+	for (;;)
+	{
+		Clock::time_point signalTime;
+		bool resolved;
+		{
+			std::lock_guard<std::mutex> lock(m_Device.m_Mutex);
+			// A GPU would hang - a test should fail instead
+			if (fenceValue > m_FenceValue)
+				throw std::logic_error("NullQueue::WaitForFenceValue: the fence value was never signaled");
+
+			m_Device.UpdateLocked(Clock::now());
+			if (m_CompletedFenceValue >= fenceValue)
+				return;
+			resolved = FindSignalTime(fenceValue, &signalTime);
+		}
+
+		// Unresolved: the queue waits for another one that hasn't signaled yet
+		if (resolved)
+			std::this_thread::sleep_until(signalTime);
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+
+void NullQueue::Wait(CommandQueue& other, uint64_t fenceValue)
+{
+	std::lock_guard<std::mutex> lock(m_Device.m_Mutex);
+	m_Operations.push_back(Operation{ Operation::Type::Wait, Clock::now(), 0.0, fenceValue, static_cast<NullQueue*>(&other) });
+	m_Stats.gpuWaits++;
+
+	m_Device.UpdateLocked(Clock::now());
+}
+
+
+CommandQueue::SubmitStats NullQueue::GetSubmitStats()
+{
+	std::lock_guard<std::mutex> lock(m_Device.m_Mutex);
+	return m_Stats;
+}
+
+
+bool NullQueue::Advance()
+{
+	const NullDevice::Timing& timing = m_Device.m_Timing;
+	bool advanced = false;
+	while (!m_Operations.empty())
+	{
+		const Operation& operation = m_Operations.front();
+		if (operation.type == Operation::Type::Execute)
+		{
+			const Clock::time_point start = std::max(m_GpuTime, operation.submitTime + Microseconds(timing.submitLatencyUs));
+			m_GpuTime = start + Microseconds(operation.costUs);
+			busyUs += operation.costUs;
+			if (m_Device.m_TraceEnabled)
+			{
+				const auto ToUs = [this](Clock::time_point time) { return std::chrono::duration<double, std::micro>(time - m_Device.m_StartTime).count(); };
+				trace.push_back(NullBusyInterval{ operation.fenceValue, ToUs(start), ToUs(m_GpuTime) });
+			}
+		}
+		else if (operation.type == Operation::Type::Signal)
+		{
+			// An idle queue signals right away
+			m_GpuTime = std::max(m_GpuTime, operation.submitTime);
+			m_Signals.push_back(std::make_pair(operation.fenceValue, m_GpuTime));
+		}
+		else
+		{
+			Clock::time_point signalTime;
+			if (!operation.pOther->FindSignalTime(operation.fenceValue, &signalTime))
+				break;
+			m_GpuTime = std::max(m_GpuTime, signalTime);
+		}
+		m_Operations.pop_front();
+		advanced = true;
+	}
+	return advanced;
+}
+
+
+void NullQueue::Complete(Clock::time_point now)
+{
+	while (!m_Signals.empty() && m_Signals.front().second <= now)
+	{
+		m_CompletedFenceValue = m_Signals.front().first;
+		m_Signals.pop_front();
+	}
+}
+
+
+bool NullQueue::FindSignalTime(uint64_t fenceValue, Clock::time_point* pTime) const
+{
+	if (fenceValue <= m_CompletedFenceValue)
+	{
+		*pTime = Clock::time_point();
+		return true;
+	}
+	for (const auto& signal : m_Signals)
+	{
+		if (signal.first >= fenceValue)
+		{
+			*pTime = signal.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+double NullQueue::GetCost(const NullCommand& command) const
+{
+	const NullDevice::Timing& timing = m_Device.m_Timing;
+	switch (command.type)
+	{
+	case NullCommand::Type::ResourceBarrier:
+	case NullCommand::Type::UavBarrier:				return timing.barrierUs;
+	case NullCommand::Type::CopyBufferRegion:		return command.args[2] / timing.copyBytesPerUs;
+	case NullCommand::Type::DrawIndexedInstanced:	return timing.drawUs;
+	case NullCommand::Type::Dispatch:				return timing.dispatchUs;
+	default:										return 0.0;
+	}
+}
+
+// =====================================================================================
+//										NullDevice
+// =====================================================================================
+
+NullDevice::NullDevice()
+	: NullDevice(Timing())
+{
+}
+
+NullDevice::NullDevice(const Timing& timing)
+	: m_Timing(timing)
+	, m_MemoryTracker(std::make_shared<MemoryTracker>())
+	, m_StartTime(Clock::now())
+{
+	for (auto& queue : m_Queues)
+		queue.reset(new NullQueue(*this));
+}
+
+NullDevice::~NullDevice()
+{
+}
+
+
+CommandQueue* NullDevice::GetQueue(QueueType type)
+{
+	return m_Queues[(int)type].get();
+}
+
+
+std::shared_ptr<Resource> NullDevice::CreateBuffer(const BufferDesc& desc)
+{
+	BufferDesc bufferDesc = desc;
+	if (desc.heapType == HeapType::Upload)
+		bufferDesc.initialState = ResourceState_GenericRead;
+	else if (desc.heapType == HeapType::Readback)
+		bufferDesc.initialState = ResourceState_CopyDest;
+	return std::make_shared<NullResource>(bufferDesc, m_MemoryTracker);
+}
+
+
+Device::MemoryStats NullDevice::GetMemoryStats()
+{
+	return m_MemoryTracker->GetStats();
+}
+
+
+double NullDevice::GetBusyMs(QueueType type)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	UpdateLocked(Clock::now());
+	return m_Queues[(int)type]->busyUs * 1e-3;
+}
+
+
+void NullDevice::SetCaptureEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_CaptureEnabled = enabled;
+}
+
+
+std::vector<NullCommand> NullDevice::TakeCapturedCommands(QueueType type)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::vector<NullCommand> commands;
+	commands.swap(m_Queues[(int)type]->capturedCommands);
+	return commands;
+}
+
+
+void NullDevice::SetTraceEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_TraceEnabled = enabled;
+}
+
+
+std::vector<NullBusyInterval> NullDevice::TakeTrace(QueueType type)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	UpdateLocked(Clock::now());
+	std::vector<NullBusyInterval> trace;
+	trace.swap(m_Queues[(int)type]->trace);
+	return trace;
+}
+
+
+void NullDevice::UpdateLocked(Clock::time_point now)
+{
+	// A wait may resolve once the other queue advanced - until nothing moves
+	bool advanced = true;
+	while (advanced)
+	{
+		advanced = false;
+		for (auto& queue : m_Queues)
+			advanced |= queue->Advance();
+	}
+
+	for (auto& queue : m_Queues)
+		queue->Complete(now);
+}
+
+} // namespace Backend
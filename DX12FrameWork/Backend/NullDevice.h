@@ -0,0 +1,110 @@
+#pragma once
+
+// Device without a GPU, for headless benchmarks and tests of code written against Backend.h.
+//
+// Command lists record into vectors of NullCommand (kept per queue when capturing is on). Each
+// queue simulates a GPU timeline: an ExecuteCommandLists starts submitLatencyUs after the call or
+// when the queue's previous work is done, whichever is later, and takes the summed cost of its
+// commands (Timing). Signals complete at the end of the work before them, GPU waits hold the
+// timeline until the other queue's signal. Fence values complete in real time - a CPU that waits
+// for a fence sleeps until the simulated GPU got there, so frame pacing behaves as on hardware.
+//
+// With tracing on, every ExecuteCommandLists leaves its place on the queue's timeline (NullBusyInterval)
+// - the overlap of the queues the simulation arrived at.
+//
+// Resources only count their bytes (MemoryTracker), Upload/Readback buffers get CPU memory for Map().
+// Copies are not executed.
+
+#include "Backend.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Backend
+{
+
+struct NullCommand
+{
+	enum class Type
+	{
+		ResourceBarrier,		// resources[0], args: before, after
+		UavBarrier,				// resources[0] (may be null)
+		CopyBufferRegion,		// resources: destination, source, args: destination offset, source offset, size
+		DrawIndexedInstanced,	// args: indices per instance, instances
+		Dispatch,				// args: group counts
+	};
+
+	Type type;
+	const Resource* resources[2];
+	uint64_t args[3];
+};
+
+// Simulated GPU time of one ExecuteCommandLists, microseconds since the device was created
+struct NullBusyInterval
+{
+	uint64_t fenceValue;		// of the submit's signal
+	double beginUs;
+	double endUs;
+};
+
+class NullQueue;
+
+class NullDevice : public Device
+{
+public:
+	// Simulated GPU costs
+	struct Timing
+	{
+		double submitLatencyUs = 20.0;		// ExecuteCommandLists until the GPU starts (idle queue)
+		double barrierUs = 0.5;				// per barrier
+		double drawUs = 2.0;				// per DrawIndexedInstanced
+		double dispatchUs = 2.0;			// per Dispatch
+		double copyBytesPerUs = 8000.0;		// 8 GB/s
+	};
+
+	NullDevice();
+	explicit NullDevice(const Timing& timing);
+	~NullDevice();
+	NullDevice(const NullDevice&) = delete;
+	NullDevice& operator=(const NullDevice&) = delete;
+
+	CommandQueue* GetQueue(QueueType type) override;
+	std::shared_ptr<Resource> CreateBuffer(const BufferDesc& desc) override;
+	MemoryStats GetMemoryStats() override;
+
+	const Timing& GetTiming() const { return m_Timing; }
+	// Simulated GPU time of the commands submitted to the queue so far
+	double GetBusyMs(QueueType type);
+
+	// Off by default: executed commands are kept per queue until taken
+	void SetCaptureEnabled(bool enabled);
+	std::vector<NullCommand> TakeCapturedCommands(QueueType type);
+
+	// Off by default: the busy intervals of the submits are kept per queue until taken. A submit's
+	// interval is known once the waits before it resolved.
+	void SetTraceEnabled(bool enabled);
+	std::vector<NullBusyInterval> TakeTrace(QueueType type);
+
+private:
+	friend class NullQueue;
+	typedef std::chrono::steady_clock Clock;
+
+	// With m_Mutex held: resolves the timelines as far as the submitted work allows and
+	// completes the fence values reached at now
+	void UpdateLocked(Clock::time_point now);
+
+private:
+	Timing m_Timing;
+	std::shared_ptr<MemoryTracker> m_MemoryTracker;
+
+	// The queues' timelines depend on each other (GPU waits) - one lock for all of them
+	std::mutex m_Mutex;
+	std::unique_ptr<NullQueue> m_Queues[(int)QueueType::Count];
+	bool m_CaptureEnabled = false;
+	bool m_TraceEnabled = false;
+	Clock::time_point m_StartTime;
+};
+
+} // namespace Backend
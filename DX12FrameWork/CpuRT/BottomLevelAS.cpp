@@ -0,0 +1,193 @@
+#include "BottomLevelAS.h"
+#include "../Utils/ThreadPool.h"
+
+#include <cstring>
+
+namespace CpuRT
+{
+
+namespace
+{
+	float3 LoadVertex(const GeometryTrianglesDesc& desc, uint32_t index)
+	{
+		float3 v;
+		memcpy(&v, (const uint8_t*)desc.vertexData + (size_t)index * desc.vertexStride, sizeof(float3));
+		return desc.transform ? desc.transform->TransformPoint(v) : v;
+	}
+
+	uint32_t LoadIndex(const GeometryTrianglesDesc& desc, uint32_t i)
+	{
+		switch (desc.indexFormat)
+		{
+		case IndexFormat::UInt16: return ((const uint16_t*)desc.indexData)[i];
+		case IndexFormat::UInt32: return ((const uint32_t*)desc.indexData)[i];
+		default:                  return i;
+		}
+	}
+}
+
+void BottomLevelAS::Build(const GeometryTrianglesDesc* geometryDescs, uint32_t geometryCount, const BvhBuildSettings& settings)
+{
+	GatherTriangles(geometryDescs, geometryCount, settings.pool);
+	m_Bvh.Build(m_TriangleBounds.data(), (uint32_t)m_TriangleBounds.size(), settings);
+	CollapseBvh(settings.branchingFactor);
+}
+
+BvhUpdateResult BottomLevelAS::Update(const GeometryTrianglesDesc* geometryDescs, uint32_t geometryCount,
+	const BvhRefitSettings& refitSettings, const BvhBuildSettings& settings)
+{
+	GatherTriangles(geometryDescs, geometryCount, settings.pool);
+	BvhUpdateResult result = m_Bvh.Update(m_TriangleBounds.data(), (uint32_t)m_TriangleBounds.size(), refitSettings, settings);
+
+	// A refit keeps the topology, so the wide tree only needs the new bounds
+	if (result.rebuilt || settings.branchingFactor != m_BranchingFactor)
+	{
+		CollapseBvh(settings.branchingFactor);
+	}
+	else if (m_BranchingFactor == 4)
+	{
+		m_Bvh4.Refit(m_Bvh);
+	}
+	else if (m_BranchingFactor == 8)
+	{
+		m_Bvh8.Refit(m_Bvh);
+	}
+	return result;
+}
+
+void BottomLevelAS::CollapseBvh(uint32_t branchingFactor)
+{
+	m_BranchingFactor = (branchingFactor == 4 || branchingFactor == 8) ? branchingFactor : 2;
+
+	m_Bvh4.Clear();
+	m_Bvh8.Clear();
+	if (m_BranchingFactor == 4)
+		m_Bvh4.Collapse(m_Bvh);
+	else if (m_BranchingFactor == 8)
+		m_Bvh8.Collapse(m_Bvh);
+}
+
+bool BottomLevelAS::Intersect(const TraversalRay& ray, float& tmax, HitInfo* pHit, BvhTraversalStats* pStats) const
+{
+	bool hit = false;
+	const bool acceptFirstHit = (ray.flags & RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH) != 0;
+
+	auto intersectTriangle = [&](uint32_t prim, float& t)
+	{
+		const Triangle& tri = m_Triangles[prim];
+		float2 bary;
+		bool frontFace;
+		if (!IntersectTriangle(ray, tri.v0, tri.v1, tri.v2, t, &t, &bary, &frontFace))
+			return false;
+
+		hit = true;
+		pHit->t = t;
+		pHit->barycentrics = bary;
+		pHit->hitKind = frontFace ? HIT_KIND_TRIANGLE_FRONT_FACE : HIT_KIND_TRIANGLE_BACK_FACE;
+		pHit->geometryIndex = m_GeometryIndices[prim];
+		pHit->primitiveIndex = GetPrimitiveIndex(prim);
+		return acceptFirstHit;
+	};
+
+	if (pStats)
+		pStats->rays++;
+
+	if (m_BranchingFactor == 4)
+		m_Bvh4.Traverse(ray, tmax, intersectTriangle, pStats);
+	else if (m_BranchingFactor == 8)
+		m_Bvh8.Traverse(ray, tmax, intersectTriangle, pStats);
+	else
+		m_Bvh.Traverse(ray, tmax, intersectTriangle, pStats);
+
+	return hit;
+}
+
+vmask BottomLevelAS::IntersectPacket(const RayPacket& packet, vfloat& tmax, vmask& active, HitInfo* pHits) const
+{
+	vmask hits(false);
+	const bool acceptFirstHit = (packet.flags & RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH) != 0;
+
+	m_Bvh.TraversePacket(packet, tmax, active, [&](uint32_t prim, vfloat& t, vmask& activeLanes)
+	{
+		const Triangle& tri = m_Triangles[prim];
+		vfloat triT, u, v;
+		vmask frontFace;
+		const vmask hit = activeLanes & IntersectTriangle(packet, tri.v0, tri.v1, tri.v2, t, &triT, &u, &v, &frontFace);
+
+		uint32_t hitBits = MoveMask(hit);
+		if (hitBits == 0)
+			return;
+
+		t = Select(hit, triT, t);
+		hits = hits | hit;
+		if (acceptFirstHit)
+			activeLanes = AndNot(activeLanes, hit);
+
+		// Hits are rare compared to tests - fill the records lane by lane
+		float tLanes[kSimdWidth], uLanes[kSimdWidth], vLanes[kSimdWidth];
+		triT.Store(tLanes);
+		u.Store(uLanes);
+		v.Store(vLanes);
+		const uint32_t frontBits = MoveMask(frontFace);
+		const uint32_t geometryIndex = m_GeometryIndices[prim];
+		const uint32_t primitiveIndex = GetPrimitiveIndex(prim);
+
+		while (hitBits)
+		{
+			const uint32_t lane = FirstBit(hitBits);
+			hitBits &= hitBits - 1;
+
+			HitInfo& h = pHits[lane];
+			h.t = tLanes[lane];
+			h.barycentrics = float2(uLanes[lane], vLanes[lane]);
+			h.hitKind = (frontBits >> lane) & 1u ? HIT_KIND_TRIANGLE_FRONT_FACE : HIT_KIND_TRIANGLE_BACK_FACE;
+			h.geometryIndex = geometryIndex;
+			h.primitiveIndex = primitiveIndex;
+		}
+	});
+
+	return hits;
+}
+
+void BottomLevelAS::GatherTriangles(const GeometryTrianglesDesc* geometryDescs, uint32_t geometryCount, ThreadPool* pool)
+{
+	m_GeometryFirstPrim.resize(geometryCount);
+
+	uint32_t triangleCount = 0;
+	for (uint32_t g = 0; g < geometryCount; g++)
+	{
+		m_GeometryFirstPrim[g] = triangleCount;
+		triangleCount += geometryDescs[g].GetTriangleCount();
+	}
+
+	m_Triangles.resize(triangleCount);
+	m_TriangleBounds.resize(triangleCount);
+	m_GeometryIndices.resize(triangleCount);
+
+	for (uint32_t g = 0; g < geometryCount; g++)
+	{
+		const GeometryTrianglesDesc& desc = geometryDescs[g];
+		const uint32_t firstPrim = m_GeometryFirstPrim[g];
+
+		auto gather = [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t t = begin; t < end; t++)
+			{
+				Triangle& tri = m_Triangles[firstPrim + t];
+				tri.v0 = LoadVertex(desc, LoadIndex(desc, t * 3 + 0));
+				tri.v1 = LoadVertex(desc, LoadIndex(desc, t * 3 + 1));
+				tri.v2 = LoadVertex(desc, LoadIndex(desc, t * 3 + 2));
+
+				m_TriangleBounds[firstPrim + t] = tri.Bounds();
+				m_GeometryIndices[firstPrim + t] = g;
+			}
+		};
+
+		if (pool)
+			ParallelFor(*pool, 0, desc.GetTriangleCount(), 16 * 1024, gather);
+		else
+			gather(0, desc.GetTriangleCount());
+	}
+}
+
+} // namespace CpuRT
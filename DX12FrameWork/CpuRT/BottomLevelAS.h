@@ -0,0 +1,113 @@
+#pragma once
+
+// CPU counterpart of a DXR bottom-level acceleration structure.
+// The input mirrors D3D12_RAYTRACING_GEOMETRY_DESC / D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC
+// so the same vertex arrays that CreateBottomLevelAS() hands to the driver
+// (see 2_RT_TrianglesRefit/DxrGame.cpp) can be fed to the CPU builder as they are.
+
+#include "WideBvh.h"
+
+#include <vector>
+
+namespace CpuRT
+{
+
+enum class IndexFormat
+{
+	None,		// DXGI_FORMAT_UNKNOWN - non-indexed, every 3 vertices make a triangle
+	UInt16,		// DXGI_FORMAT_R16_UINT
+	UInt32,		// DXGI_FORMAT_R32_UINT
+};
+
+// D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC with CPU pointers instead of GPU virtual addresses.
+// Only DXGI_FORMAT_R32G32B32_FLOAT vertices are supported (the only format used by the samples).
+struct GeometryTrianglesDesc
+{
+	const void* vertexData = nullptr;
+	uint32_t vertexStride = sizeof(float3);
+	uint32_t vertexCount = 0;
+
+	const void* indexData = nullptr;
+	IndexFormat indexFormat = IndexFormat::None;
+	uint32_t indexCount = 0;
+
+	// Optional, applied to the vertices at build time (Transform3x4)
+	const float3x4* transform = nullptr;
+
+	// D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE
+	bool opaque = true;
+
+	uint32_t GetTriangleCount() const { return (indexFormat == IndexFormat::None ? vertexCount : indexCount) / 3; }
+};
+
+struct Triangle
+{
+	float3 v0, v1, v2;
+
+	Aabb Bounds() const
+	{
+		Aabb b;
+		b.Grow(v0); b.Grow(v1); b.Grow(v2);
+		return b;
+	}
+};
+
+class BottomLevelAS
+{
+public:
+	// BuildRaytracingAccelerationStructure() for D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL.
+	// The vertex/index data is copied, the descs don't have to outlive the call.
+	void Build(const GeometryTrianglesDesc* geometryDescs, uint32_t geometryCount,
+		const BvhBuildSettings& settings = BvhBuildSettings());
+
+	// BuildRaytracingAccelerationStructure() with PERFORM_UPDATE: the same geometries with moved
+	// vertices (deformation or a new Transform3x4). The BVH is refitted in place unless
+	// refitSettings decide the tree has degraded enough to be rebuilt.
+	BvhUpdateResult Update(const GeometryTrianglesDesc* geometryDescs, uint32_t geometryCount,
+		const BvhRefitSettings& refitSettings = BvhRefitSettings(), const BvhBuildSettings& settings = BvhBuildSettings());
+
+	uint32_t GetTriangleCount() const { return (uint32_t)m_Triangles.size(); }
+	uint32_t GetGeometryCount() const { return (uint32_t)m_GeometryFirstPrim.size(); }
+
+	// Triangles are stored in the order of the input: geometry by geometry, so
+	// GeometryIndex() and PrimitiveIndex() of the HLSL intrinsics can be recovered.
+	const std::vector<Triangle>& GetTriangles() const { return m_Triangles; }
+	const std::vector<Aabb>& GetTriangleBounds() const { return m_TriangleBounds; }
+	uint32_t GetGeometryIndex(uint32_t triangle) const { return m_GeometryIndices[triangle]; }
+	uint32_t GetPrimitiveIndex(uint32_t triangle) const { return triangle - m_GeometryFirstPrim[m_GeometryIndices[triangle]]; }
+
+	// Closest hit (or first hit for RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH) in object space.
+	// Fills t, barycentrics, hitKind, geometryIndex and primitiveIndex of pHit; tmax shrinks on a hit.
+	// Uses the wide BVH when the BLAS was built with branchingFactor 4 or 8.
+	bool Intersect(const TraversalRay& ray, float& tmax, HitInfo* pHit, BvhTraversalStats* pStats = nullptr) const;
+
+	// Intersect() for the active lanes of a packet. pHits has kSimdWidth entries, the ones of
+	// the returned lanes are filled like pHit above; any-hit lanes are removed from 'active'.
+	vmask IntersectPacket(const RayPacket& packet, vfloat& tmax, vmask& active, HitInfo* pHits) const;
+
+	const Bvh& GetBvh() const { return m_Bvh; }
+	const WideBvh<4>& GetBvh4() const { return m_Bvh4; }
+	const WideBvh<8>& GetBvh8() const { return m_Bvh8; }
+	// 2, 4 or 8 - the tree Intersect() traverses
+	uint32_t GetBranchingFactor() const { return m_BranchingFactor; }
+	Aabb GetBounds() const { return m_Bvh.IsEmpty() ? Aabb() : m_Bvh.GetRoot().bounds; }
+
+private:
+	void GatherTriangles(const GeometryTrianglesDesc* geometryDescs, uint32_t geometryCount, ThreadPool* pool);
+	void CollapseBvh(uint32_t branchingFactor);
+
+private:
+	std::vector<Triangle> m_Triangles;
+	std::vector<Aabb> m_TriangleBounds;
+	std::vector<uint32_t> m_GeometryIndices;
+	// Index of the first triangle of every geometry
+	std::vector<uint32_t> m_GeometryFirstPrim;
+
+	Bvh m_Bvh;
+	// Collapsed copies of m_Bvh, at most one of them is in use
+	WideBvh<4> m_Bvh4;
+	WideBvh<8> m_Bvh8;
+	uint32_t m_BranchingFactor = 2;
+};
+
+} // namespace CpuRT
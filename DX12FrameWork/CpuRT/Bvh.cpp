@@ -0,0 +1,421 @@
+#include "Bvh.h"
+#include "../Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace CpuRT
+{
+
+// =====================================================================================
+//										Build
+// =====================================================================================
+
+struct Bvh::BuildContext
+{
+	const Aabb* primBounds;
+	std::vector<float3> centroids;
+	BvhBuildSettings settings;
+
+	// Nodes are allocated in pairs (siblings are always adjacent), possibly from several threads
+	std::atomic<uint32_t> nodeCount;
+	// Only the subtrees with more than settings.parallelThreshold primitives spawn tasks
+	TaskGroup* pTaskGroup = nullptr;
+};
+
+namespace
+{
+	struct Bin
+	{
+		Aabb bounds;
+		uint32_t count = 0;
+	};
+
+	// Bins live on the stack of the recursive BuildNode(), keep them small
+	// (worker threads on Windows get 1MB of stack only)
+	const uint32_t kMaxBinCount = 64;
+
+	struct SplitCandidate
+	{
+		int axis = -1;
+		// Primitives with bin index < splitBin go to the left child
+		uint32_t splitBin = 0;
+		float cost = FLT_MAX;
+	};
+}
+
+void Bvh::Build(const Aabb* primBounds, uint32_t primCount, const BvhBuildSettings& settings)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	Clear();
+	if (primCount == 0)
+		return;
+
+	if (settings.builder == BvhBuilder::Lbvh)
+		BuildLbvh(primBounds, primCount, settings);
+	else
+		BuildBinnedSah(primBounds, primCount, settings);
+
+	m_TraversalCost = settings.traversalCost;
+	m_IntersectionCost = settings.intersectionCost;
+	const BvhStats stats = ComputeStats(m_TraversalCost, m_IntersectionCost);
+	m_BuildSahCost = m_SahCost = stats.sahCost;
+	// Refits keep the topology - the traversal stacks are sized from this
+	m_MaxDepth = stats.maxDepth;
+	m_RefitsSinceBuild = 0;
+
+	m_LastBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Bvh::BuildBinnedSah(const Aabb* primBounds, uint32_t primCount, const BvhBuildSettings& settings)
+{
+	BuildContext ctx;
+	ctx.primBounds = primBounds;
+	ctx.settings = settings;
+	ctx.settings.maxLeafSize = std::max(1u, settings.maxLeafSize);
+	ctx.settings.binCount = std::max(2u, settings.binCount);
+	ctx.nodeCount = 1;
+
+	// A binary tree with N leaves never has more than 2N-1 nodes
+	m_Nodes.resize(2 * primCount - 1);
+	m_PrimIndices.resize(primCount);
+	ctx.centroids.resize(primCount);
+
+	auto initPrims = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			m_PrimIndices[i] = i;
+			ctx.centroids[i] = primBounds[i].Centroid();
+		}
+	};
+
+	if (settings.pool)
+	{
+		ParallelFor(*settings.pool, 0, primCount, 16 * 1024, initPrims);
+
+		TaskGroup group(*settings.pool);
+		ctx.pTaskGroup = &group;
+		BuildNode(ctx, 0, 0, primCount, 0);
+		group.Wait();
+	}
+	else
+	{
+		initPrims(0, primCount);
+		BuildNode(ctx, 0, 0, primCount, 0);
+	}
+
+	m_Nodes.resize(ctx.nodeCount.load());
+	m_Nodes.shrink_to_fit();
+}
+
+void Bvh::BuildNode(BuildContext& ctx, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+{
+	const BvhBuildSettings& s = ctx.settings;
+
+	Aabb bounds, centroidBounds;
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		uint32_t prim = m_PrimIndices[i];
+		bounds.Grow(ctx.primBounds[prim]);
+		centroidBounds.Grow(ctx.centroids[prim]);
+	}
+
+	BvhNode& node = m_Nodes[nodeIndex];
+	node.bounds = bounds;
+	node.leftFirst = first;
+	node.primCount = count;
+
+	if (count == 1)
+		return;
+
+	// ----------------------------- Binned SAH
+	// Primitives are binned by their centroids, the cost of every split plane
+	// between two bins is evaluated with two sweeps (left-to-right, right-to-left).
+	SplitCandidate best;
+	const float3 cExtent = centroidBounds.Extent();
+	const uint32_t usedBins = std::min(s.binCount, kMaxBinCount);
+	Bin bins[3][kMaxBinCount];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (cExtent[axis] <= 0.0f)
+			continue;
+
+		const float scale = usedBins / cExtent[axis];
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			uint32_t prim = m_PrimIndices[i];
+			uint32_t b = std::min(usedBins - 1, (uint32_t)((ctx.centroids[prim][axis] - centroidBounds.bmin[axis]) * scale));
+			bins[axis][b].count++;
+			bins[axis][b].bounds.Grow(ctx.primBounds[prim]);
+		}
+
+		// Sweep from the right, storing the cost of the right part of every split
+		float rightCost[kMaxBinCount];
+		Aabb rightBox;
+		uint32_t rightCount = 0;
+		for (uint32_t b = usedBins - 1; b > 0; b--)
+		{
+			rightBox.Grow(bins[axis][b].bounds);
+			rightCount += bins[axis][b].count;
+			rightCost[b] = rightCount * rightBox.HalfArea();
+		}
+
+		Aabb leftBox;
+		uint32_t leftCount = 0;
+		for (uint32_t b = 1; b < usedBins; b++)
+		{
+			leftBox.Grow(bins[axis][b - 1].bounds);
+			leftCount += bins[axis][b - 1].count;
+			float cost = leftCount * leftBox.HalfArea() + rightCost[b];
+			if (leftCount != 0 && leftCount != count && cost < best.cost)
+			{
+				best.cost = cost;
+				best.axis = axis;
+				best.splitBin = b;
+			}
+		}
+	}
+
+	// SAH cost of the split relative to keeping all primitives in one leaf
+	const float parentArea = bounds.HalfArea();
+	const float leafCost = s.intersectionCost * count;
+	float splitCost = FLT_MAX;
+	if (best.axis >= 0 && parentArea > 0.0f)
+		splitCost = s.traversalCost + s.intersectionCost * best.cost / parentArea;
+
+	if (splitCost >= leafCost && count <= s.maxLeafSize)
+		return;
+
+	// ----------------------------- Partition
+	uint32_t leftCount;
+	if (best.axis >= 0)
+	{
+		const int axis = best.axis;
+		const float scale = usedBins / cExtent[axis];
+		const float cmin = centroidBounds.bmin[axis];
+		auto middle = std::partition(m_PrimIndices.begin() + first, m_PrimIndices.begin() + first + count,
+			[&](uint32_t prim)
+			{
+				uint32_t b = std::min(usedBins - 1, (uint32_t)((ctx.centroids[prim][axis] - cmin) * scale));
+				return b < best.splitBin;
+			});
+		leftCount = (uint32_t)(middle - (m_PrimIndices.begin() + first));
+	}
+	else
+	{
+		// All centroids coincide - no plane separates them, split the range in half
+		leftCount = count / 2;
+	}
+
+	const uint32_t leftIndex = ctx.nodeCount.fetch_add(2, std::memory_order_relaxed);
+	node.leftFirst = leftIndex;
+	node.primCount = 0;
+
+	const uint32_t rightCount = count - leftCount;
+	if (ctx.pTaskGroup && count >= s.parallelThreshold)
+	{
+		BuildContext* pCtx = &ctx;
+		ctx.pTaskGroup->Run([this, pCtx, leftIndex, first, leftCount, depth]()
+		{
+			BuildNode(*pCtx, leftIndex, first, leftCount, depth + 1);
+		});
+	}
+	else
+	{
+		BuildNode(ctx, leftIndex, first, leftCount, depth + 1);
+	}
+	BuildNode(ctx, leftIndex + 1, first + leftCount, rightCount, depth + 1);
+}
+
+void Bvh::Clear()
+{
+	m_Nodes.clear();
+	m_PrimIndices.clear();
+	m_MaxDepth = 0;
+	m_LastBuildMs = 0.0;
+	m_LastRefitMs = 0.0;
+	m_BuildSahCost = m_SahCost = 0.0f;
+	m_RefitsSinceBuild = 0;
+}
+
+// =====================================================================================
+//										Refit
+// =====================================================================================
+
+float Bvh::Refit(const Aabb* primBounds)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	if (m_Nodes.empty())
+		return 0.0f;
+
+	// Children are always allocated after their parent, so walking the node array
+	// backwards visits every node after both of its children - no stack needed.
+	// The (unnormalized) SAH cost is accumulated in the same pass.
+	double cost = 0.0;
+	for (size_t i = m_Nodes.size(); i-- > 0;)
+	{
+		BvhNode& node = m_Nodes[i];
+		if (node.IsLeaf())
+		{
+			Aabb bounds;
+			for (uint32_t p = node.leftFirst; p < node.leftFirst + node.primCount; p++)
+				bounds.Grow(primBounds[m_PrimIndices[p]]);
+			node.bounds = bounds;
+			cost += m_IntersectionCost * node.primCount * bounds.HalfArea();
+		}
+		else
+		{
+			Aabb bounds = m_Nodes[node.leftFirst].bounds;
+			bounds.Grow(m_Nodes[node.leftFirst + 1].bounds);
+			node.bounds = bounds;
+			cost += m_TraversalCost * bounds.HalfArea();
+		}
+	}
+
+	const float rootArea = m_Nodes[0].bounds.HalfArea();
+	m_SahCost = rootArea > 0.0f ? (float)(cost / rootArea) : 0.0f;
+	m_RefitsSinceBuild++;
+
+	m_LastRefitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	return m_SahCost;
+}
+
+BvhUpdateResult Bvh::Update(const Aabb* primBounds, uint32_t primCount, const BvhRefitSettings& refitSettings,
+	const BvhBuildSettings& settings)
+{
+	BvhUpdateResult result;
+
+	// A refit is only possible for the very same set of primitives
+	bool rebuild = m_Nodes.empty() || primCount != m_PrimIndices.size();
+	if (!rebuild && refitSettings.maxRefitsBeforeRebuild != 0)
+		rebuild = m_RefitsSinceBuild >= refitSettings.maxRefitsBeforeRebuild;
+
+	if (!rebuild)
+	{
+		Refit(primBounds);
+		result.ms = m_LastRefitMs;
+		result.sahGrowth = GetSahGrowth();
+		rebuild = result.sahGrowth > refitSettings.maxSahGrowth;
+	}
+
+	if (rebuild)
+	{
+		Build(primBounds, primCount, settings);
+		result.ms += m_LastBuildMs;
+		result.rebuilt = true;
+	}
+
+	return result;
+}
+
+// =====================================================================================
+//									Stats & Validation
+// =====================================================================================
+
+BvhStats Bvh::ComputeStats(float traversalCost, float intersectionCost) const
+{
+	BvhStats stats;
+	stats.buildMs = m_LastBuildMs;
+	if (m_Nodes.empty())
+		return stats;
+
+	const float rootArea = m_Nodes[0].bounds.HalfArea();
+	const float invRootArea = rootArea > 0.0f ? 1.0f / rootArea : 0.0f;
+
+	struct Entry { uint32_t node; uint32_t depth; };
+	std::vector<Entry> stack;
+	stack.push_back({ 0, 1 });
+
+	double cost = 0.0;
+	while (!stack.empty())
+	{
+		Entry e = stack.back();
+		stack.pop_back();
+
+		const BvhNode& node = m_Nodes[e.node];
+		const float relArea = node.bounds.HalfArea() * invRootArea;
+
+		stats.nodeCount++;
+		stats.maxDepth = std::max(stats.maxDepth, e.depth);
+
+		if (node.IsLeaf())
+		{
+			stats.leafCount++;
+			stats.primCount += node.primCount;
+			cost += intersectionCost * node.primCount * relArea;
+		}
+		else
+		{
+			cost += traversalCost * relArea;
+			stack.push_back({ node.leftFirst, e.depth + 1 });
+			stack.push_back({ node.leftFirst + 1, e.depth + 1 });
+		}
+	}
+
+	stats.sahCost = (float)cost;
+	stats.avgLeafSize = stats.leafCount ? (float)stats.primCount / stats.leafCount : 0.0f;
+	return stats;
+}
+
+bool Bvh::Validate(const Aabb* primBounds, std::string* pError) const
+{
+	auto fail = [pError](const std::string& msg)
+	{
+		if (pError)
+			*pError = msg;
+		return false;
+	};
+
+	if (m_Nodes.empty())
+		return m_PrimIndices.empty() ? true : fail("primitives without nodes");
+
+	std::vector<uint8_t> referenced(m_PrimIndices.size(), 0);
+	std::vector<uint32_t> stack;
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		uint32_t nodeIndex = stack.back();
+		stack.pop_back();
+		const BvhNode& node = m_Nodes[nodeIndex];
+
+		if (node.IsLeaf())
+		{
+			if (node.leftFirst + node.primCount > m_PrimIndices.size())
+				return fail("leaf range out of bounds at node " + std::to_string(nodeIndex));
+
+			for (uint32_t i = node.leftFirst; i < node.leftFirst + node.primCount; i++)
+			{
+				uint32_t prim = m_PrimIndices[i];
+				if (prim >= referenced.size() || referenced[prim]++)
+					return fail("primitive " + std::to_string(prim) + " referenced twice or out of range");
+				if (!node.bounds.Contains(primBounds[prim]))
+					return fail("leaf " + std::to_string(nodeIndex) + " doesn't enclose primitive " + std::to_string(prim));
+			}
+			continue;
+		}
+
+		if (node.leftFirst + 1 >= m_Nodes.size() || node.leftFirst <= nodeIndex)
+			return fail("bad child index at node " + std::to_string(nodeIndex));
+
+		for (uint32_t c = 0; c < 2; c++)
+		{
+			if (!node.bounds.Contains(m_Nodes[node.leftFirst + c].bounds))
+				return fail("child of node " + std::to_string(nodeIndex) + " sticks out of its parent");
+			stack.push_back(node.leftFirst + c);
+		}
+	}
+
+	for (size_t i = 0; i < referenced.size(); i++)
+		if (!referenced[i])
+			return fail("primitive " + std::to_string(i) + " is not referenced");
+
+	return true;
+}
+
+} // namespace CpuRT
@@ -0,0 +1,358 @@
+#pragma once
+
+// Binary bounding volume hierarchy over arbitrary primitives (given by their AABBs).
+// It is the CPU counterpart of the structure the driver builds in
+// BuildRaytracingAccelerationStructure() - used by BottomLevelAS (triangles).
+
+#include "CpuRTMath.h"
+#include "RayPacket.h"
+
+#include <cassert>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+namespace CpuRT
+{
+
+// 32 bytes - two sibling nodes share one 64-byte cache line.
+struct BvhNode
+{
+	Aabb bounds;
+	// Inner node: index of the left child, the right child is always leftFirst + 1.
+	// Leaf node:  index of the first primitive in Bvh::GetPrimIndices().
+	uint32_t leftFirst;
+	// 0 for inner nodes
+	uint32_t primCount;
+
+	bool IsLeaf() const { return primCount != 0; }
+};
+
+enum class BvhBuilder
+{
+	// Top-down binned SAH - best trees, for static geometry
+	BinnedSah,
+	// Linear BVH: primitives sorted along a Morton curve, hierarchy emitted from the
+	// sorted codes (Karras 2012). Several times faster, lower quality - for geometry
+	// that is rebuilt every frame.
+	Lbvh,
+};
+
+struct BvhBuildSettings
+{
+	BvhBuilder builder = BvhBuilder::BinnedSah;
+
+	// Leaves are created as soon as the SAH says splitting is not worth it,
+	// but never hold more than maxLeafSize primitives (LBVH: every subtree with
+	// at most maxLeafSize primitives becomes a leaf).
+	uint32_t maxLeafSize = 4;
+	// Number of bins per axis used to evaluate the SAH
+	uint32_t binCount = 16;
+	// LBVH: 30 (10 bits per axis, 4 radix sort passes) or 63 (21 bits per axis, 8 passes).
+	// 63 bits keep large or very unevenly distributed meshes from collapsing into equal codes.
+	uint32_t mortonCodeBits = 30;
+	// SAH constants - cost of one node visit and one primitive intersection
+	float traversalCost = 1.0f;
+	float intersectionCost = 1.0f;
+
+	// 2 - the binary tree is traversed as it is. 4 or 8 - BottomLevelAS collapses it into
+	// a WideBvh (SoA child bounds tested with SIMD) used for single-ray traversal.
+	uint32_t branchingFactor = 2;
+
+	// nullptr - build on the calling thread only
+	ThreadPool* pool = nullptr;
+	// Subtrees with fewer primitives than this are built by a single task
+	uint32_t parallelThreshold = 4096;
+};
+
+// Quality/size numbers used to compare BVHs between builders and settings
+struct BvhStats
+{
+	uint32_t nodeCount = 0;
+	uint32_t leafCount = 0;
+	uint32_t maxDepth = 0;
+	uint32_t primCount = 0;
+	float avgLeafSize = 0.0f;
+	// Expected cost of a random ray, relative to the root surface area
+	float sahCost = 0.0f;
+	// Wall-clock time of the last Build()
+	double buildMs = 0.0;
+};
+
+// Memory traffic of traversal, counted when a stats pointer is passed in.
+// cacheLines are the 64-byte lines the visited nodes span - the misses a cold cache would take.
+struct BvhTraversalStats
+{
+	uint64_t rays = 0;
+	uint64_t nodeVisits = 0;
+	uint64_t cacheLines = 0;
+	uint64_t primTests = 0;
+
+	void Add(const BvhTraversalStats& b) { rays += b.rays; nodeVisits += b.nodeVisits; cacheLines += b.cacheLines; primTests += b.primTests; }
+};
+
+// Number of 64-byte cache lines [p, p + size) touches
+inline uint32_t CacheLinesSpanned(const void* p, size_t size)
+{
+	const uintptr_t first = (uintptr_t)p / 64;
+	const uintptr_t last = ((uintptr_t)p + size - 1) / 64;
+	return (uint32_t)(last - first + 1);
+}
+
+// Stack of the nodes a traversal still has to visit. The tree's depth bounds how many entries
+// can be pending at once: trees up to kLocalSize deep use the array on the thread's stack,
+// deeper ones (LBVH over clustered or duplicate primitives) get a heap block of their size.
+template<typename T, uint32_t kLocalSize = 64>
+class TraversalStack
+{
+public:
+	explicit TraversalStack(uint32_t capacity)
+		: m_pEntries(m_Local)
+		, m_Capacity(kLocalSize)
+	{
+		if (capacity > kLocalSize)
+		{
+			m_Heap.resize(capacity);
+			m_pEntries = m_Heap.data();
+			m_Capacity = capacity;
+		}
+	}
+
+	void Push(const T& entry)
+	{
+		assert(m_Size < m_Capacity && "Traversal stack sized below the depth of the tree");
+		m_pEntries[m_Size++] = entry;
+	}
+	T Pop() { return m_pEntries[--m_Size]; }
+
+	bool IsEmpty() const { return m_Size == 0; }
+	uint32_t GetSize() const { return m_Size; }
+	T& operator[](uint32_t i) { return m_pEntries[i]; }
+
+private:
+	T m_Local[kLocalSize];
+	std::vector<T> m_Heap;
+	T* m_pEntries;
+	uint32_t m_Capacity;
+	uint32_t m_Size = 0;
+};
+
+// When to turn a refit into a full rebuild - the CPU side of the
+// ALLOW_UPDATE / PERFORM_UPDATE decision the samples make by hand
+struct BvhRefitSettings
+{
+	// Refitting keeps the topology of the last build, so the tree gets worse when the
+	// primitives move relative to each other. Rebuild as soon as the SAH cost has grown
+	// by this factor since the last full build.
+	float maxSahGrowth = 1.3f;
+	// Rebuild at least every N refits (0 - never force)
+	uint32_t maxRefitsBeforeRebuild = 0;
+};
+
+struct BvhUpdateResult
+{
+	bool rebuilt = false;
+	// SAH cost of the refitted tree divided by the cost right after the last full build.
+	// Stays at the refit value when the growth triggered a rebuild (1.0 if there was no refit).
+	float sahGrowth = 1.0f;
+	double ms = 0.0;
+};
+
+class Bvh
+{
+public:
+	// Builds the hierarchy with a binned SAH, top-down.
+	// primBounds - one AABB per primitive; the BVH stores indices into this array.
+	void Build(const Aabb* primBounds, uint32_t primCount, const BvhBuildSettings& settings = BvhBuildSettings());
+
+	// Recomputes the node bounds bottom-up for moved primitives, keeping the topology.
+	// primBounds must describe the same primitives (same count and order) as in Build().
+	// Returns the SAH cost of the refitted tree, see GetSahGrowth().
+	float Refit(const Aabb* primBounds);
+
+	// Refit() or Build(), whichever the policy picks
+	BvhUpdateResult Update(const Aabb* primBounds, uint32_t primCount, const BvhRefitSettings& refitSettings,
+		const BvhBuildSettings& settings = BvhBuildSettings());
+
+	// Closest-first traversal. intersectPrim(primIndex, float& tmax) tests one primitive,
+	// shrinks tmax on a hit and returns true to terminate the traversal (any-hit rays).
+	template<typename IntersectPrimFunc>
+	void Traverse(const TraversalRay& ray, float& tmax, IntersectPrimFunc&& intersectPrim, BvhTraversalStats* pStats = nullptr) const;
+
+	// Packet traversal: a node is entered when any active lane hits it, so every node and
+	// primitive is fetched once for the whole packet. intersectPrim(primIndex, vfloat& tmax,
+	// vmask& active) tests one primitive against the active lanes, shrinks tmax in the lanes
+	// that hit and clears lanes that are done (any-hit rays). Returns when no lane is active.
+	template<typename IntersectPrimFunc>
+	void TraversePacket(const RayPacket& packet, vfloat& tmax, vmask& active, IntersectPrimFunc&& intersectPrim) const;
+
+	// SAH cost and size/depth statistics of the current tree
+	BvhStats ComputeStats(float traversalCost = 1.0f, float intersectionCost = 1.0f) const;
+
+	// Checks the structural invariants: every primitive is referenced exactly once,
+	// children are contained in their parents, leaves enclose their primitives.
+	bool Validate(const Aabb* primBounds, std::string* pError = nullptr) const;
+
+	void Clear();
+
+	const std::vector<BvhNode>& GetNodes() const { return m_Nodes; }
+	const std::vector<uint32_t>& GetPrimIndices() const { return m_PrimIndices; }
+	const BvhNode& GetRoot() const { return m_Nodes[0]; }
+	bool IsEmpty() const { return m_Nodes.empty(); }
+	double GetLastBuildMs() const { return m_LastBuildMs; }
+	double GetLastRefitMs() const { return m_LastRefitMs; }
+	// Levels of the longest root-to-leaf path (1 for a single leaf)
+	uint32_t GetMaxDepth() const { return m_MaxDepth; }
+	uint32_t GetRefitsSinceBuild() const { return m_RefitsSinceBuild; }
+	// Degradation of the tree since the last full build (1.0 right after Build())
+	float GetSahGrowth() const { return m_BuildSahCost > 0.0f ? m_SahCost / m_BuildSahCost : 1.0f; }
+
+private:
+	struct BuildContext;
+	void BuildBinnedSah(const Aabb* primBounds, uint32_t primCount, const BvhBuildSettings& settings);
+	void BuildNode(BuildContext& ctx, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth);
+
+	// Lbvh.cpp
+	struct LbvhContext;
+	void BuildLbvh(const Aabb* primBounds, uint32_t primCount, const BvhBuildSettings& settings);
+	void EmitLbvhNode(LbvhContext& ctx, uint32_t ref, uint32_t nodeIndex, uint32_t descendantsFirst);
+
+private:
+	std::vector<BvhNode> m_Nodes;
+	// Primitive order - leaves reference contiguous ranges of this array
+	std::vector<uint32_t> m_PrimIndices;
+	uint32_t m_MaxDepth = 0;
+	double m_LastBuildMs = 0.0;
+
+	// Refit state
+	float m_TraversalCost = 1.0f;
+	float m_IntersectionCost = 1.0f;
+	float m_BuildSahCost = 0.0f;
+	float m_SahCost = 0.0f;
+	uint32_t m_RefitsSinceBuild = 0;
+	double m_LastRefitMs = 0.0;
+};
+
+template<typename IntersectPrimFunc>
+void Bvh::Traverse(const TraversalRay& ray, float& tmax, IntersectPrimFunc&& intersectPrim, BvhTraversalStats* pStats) const
+{
+	if (m_Nodes.empty() || IntersectAabb(ray, m_Nodes[0].bounds, tmax) == FLT_MAX)
+		return;
+
+	// At most one far child per inner node on the path to the current node
+	TraversalStack<uint32_t> stack(m_MaxDepth);
+	uint32_t nodeIndex = 0;
+
+	for (;;)
+	{
+		const BvhNode& node = m_Nodes[nodeIndex];
+		if (node.IsLeaf())
+		{
+			if (pStats)
+				pStats->primTests += node.primCount;
+			for (uint32_t i = node.leftFirst; i < node.leftFirst + node.primCount; i++)
+				if (intersectPrim(m_PrimIndices[i], tmax))
+					return;
+		}
+		else
+		{
+			if (pStats)
+			{
+				pStats->nodeVisits++;
+				pStats->cacheLines += CacheLinesSpanned(&m_Nodes[node.leftFirst], 2 * sizeof(BvhNode));
+			}
+
+			// Visit the nearer child first, the farther one is culled
+			// later if a hit closer than its entry distance is found meanwhile
+			uint32_t near = node.leftFirst, far = node.leftFirst + 1;
+			float tNear = IntersectAabb(ray, m_Nodes[near].bounds, tmax);
+			float tFar = IntersectAabb(ray, m_Nodes[far].bounds, tmax);
+			if (tFar < tNear)
+			{
+				std::swap(near, far);
+				std::swap(tNear, tFar);
+			}
+
+			if (tNear != FLT_MAX)
+			{
+				if (tFar != FLT_MAX)
+					stack.Push(far);
+				nodeIndex = near;
+				continue;
+			}
+		}
+
+		// Pop the next node that is still in front of the closest hit
+		for (;;)
+		{
+			if (stack.IsEmpty())
+				return;
+			nodeIndex = stack.Pop();
+			if (IntersectAabb(ray, m_Nodes[nodeIndex].bounds, tmax) != FLT_MAX)
+				break;
+		}
+	}
+}
+
+template<typename IntersectPrimFunc>
+void Bvh::TraversePacket(const RayPacket& packet, vfloat& tmax, vmask& active, IntersectPrimFunc&& intersectPrim) const
+{
+	vfloat tNear;
+	if (m_Nodes.empty() || None(active & IntersectAabb(packet, m_Nodes[0].bounds, tmax, &tNear)))
+		return;
+
+	TraversalStack<uint32_t> stack(m_MaxDepth);
+	uint32_t nodeIndex = 0;
+
+	for (;;)
+	{
+		const BvhNode& node = m_Nodes[nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.leftFirst; i < node.leftFirst + node.primCount; i++)
+			{
+				intersectPrim(m_PrimIndices[i], tmax, active);
+				if (None(active))
+					return;
+			}
+		}
+		else
+		{
+			uint32_t near = node.leftFirst, far = node.leftFirst + 1;
+			vfloat tNearL, tNearR;
+			const vmask hitL = active & IntersectAabb(packet, m_Nodes[near].bounds, tmax, &tNearL);
+			const vmask hitR = active & IntersectAabb(packet, m_Nodes[far].bounds, tmax, &tNearR);
+
+			if (Any(hitL) || Any(hitR))
+			{
+				// Coherent rays agree on the order, the closest entry distance of any lane decides
+				if (Any(hitL) && Any(hitR))
+				{
+					if (ReduceMin(Select(hitR, tNearR, FLT_MAX)) < ReduceMin(Select(hitL, tNearL, FLT_MAX)))
+						std::swap(near, far);
+					stack.Push(far);
+				}
+				else if (Any(hitR))
+				{
+					near = far;
+				}
+				nodeIndex = near;
+				continue;
+			}
+		}
+
+		// Pop the next node that some active lane still reaches in front of its closest hit
+		for (;;)
+		{
+			if (stack.IsEmpty())
+				return;
+			nodeIndex = stack.Pop();
+			if (Any(active & IntersectAabb(packet, m_Nodes[nodeIndex].bounds, tmax, &tNear)))
+				break;
+		}
+	}
+}
+
+} // namespace CpuRT
@@ -0,0 +1,206 @@
+#pragma once
+
+// Minimal vector math for the CPU ray tracer.
+// DirectXMath is not used here on purpose - the CpuRT code must compile
+// without the Windows SDK (headless Linux machines).
+// Names follow HLSL (float3, dot, cross, normalize) so the code can be compared
+// line by line with Shaders/14-Shaders.hlsl.
+
+#include <cmath>
+#include <cstdint>
+#include <cfloat>
+
+namespace CpuRT
+{
+
+struct float2
+{
+	float x, y;
+
+	float2() : x(0), y(0) {}
+	float2(float x_, float y_) : x(x_), y(y_) {}
+};
+
+struct float3
+{
+	float x, y, z;
+
+	float3() : x(0), y(0), z(0) {}
+	float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+	explicit float3(float s) : x(s), y(s), z(s) {}
+
+	float  operator[](int i) const { return (&x)[i]; }
+	float& operator[](int i) { return (&x)[i]; }
+
+	float3& operator+=(const float3& b) { x += b.x; y += b.y; z += b.z; return *this; }
+	float3& operator-=(const float3& b) { x -= b.x; y -= b.y; z -= b.z; return *this; }
+	float3& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+};
+
+inline float3 operator+(const float3& a, const float3& b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline float3 operator-(const float3& a, const float3& b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline float3 operator-(const float3& a) { return float3(-a.x, -a.y, -a.z); }
+inline float3 operator*(const float3& a, const float3& b) { return float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+inline float3 operator*(const float3& a, float s) { return float3(a.x * s, a.y * s, a.z * s); }
+inline float3 operator*(float s, const float3& a) { return float3(a.x * s, a.y * s, a.z * s); }
+inline float3 operator/(const float3& a, float s) { float inv = 1.0f / s; return a * inv; }
+
+inline float dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float3 cross(const float3& a, const float3& b)
+{
+	return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+inline float length(const float3& a) { return std::sqrt(dot(a, a)); }
+inline float3 normalize(const float3& a) { return a / length(a); }
+
+// Component-wise min/max. Named with a capital letter to stay clear of
+// the min/max macros Windows.h defines when NOMINMAX is not set.
+inline float Min(float a, float b) { return a < b ? a : b; }
+inline float Max(float a, float b) { return a > b ? a : b; }
+inline float3 Min(const float3& a, const float3& b) { return float3(Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z)); }
+inline float3 Max(const float3& a, const float3& b) { return float3(Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z)); }
+
+// Axis aligned bounding box
+struct Aabb
+{
+	float3 bmin;
+	float3 bmax;
+
+	Aabb() : bmin(FLT_MAX), bmax(-FLT_MAX) {}
+	Aabb(const float3& mn, const float3& mx) : bmin(mn), bmax(mx) {}
+
+	void Grow(const float3& p) { bmin = Min(bmin, p); bmax = Max(bmax, p); }
+	void Grow(const Aabb& b) { bmin = Min(bmin, b.bmin); bmax = Max(bmax, b.bmax); }
+
+	bool IsEmpty() const { return bmin.x > bmax.x || bmin.y > bmax.y || bmin.z > bmax.z; }
+	float3 Extent() const { return bmax - bmin; }
+	float3 Centroid() const { return (bmin + bmax) * 0.5f; }
+
+	// Half of the surface area is enough for the SAH (only ratios are used)
+	float HalfArea() const
+	{
+		if (IsEmpty())
+			return 0.0f;
+		float3 e = Extent();
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	bool Contains(const Aabb& b) const
+	{
+		return b.bmin.x >= bmin.x && b.bmin.y >= bmin.y && b.bmin.z >= bmin.z &&
+			b.bmax.x <= bmax.x && b.bmax.y <= bmax.y && b.bmax.z <= bmax.z;
+	}
+
+	int LargestAxis() const
+	{
+		float3 e = Extent();
+		return (e.x > e.y && e.x > e.z) ? 0 : (e.y > e.z ? 1 : 2);
+	}
+};
+
+// Row-major 3x4 affine transform - same layout as
+// D3D12_RAYTRACING_INSTANCE_DESC::Transform and
+// D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC::Transform3x4
+struct float3x4
+{
+	float m[3][4];
+
+	static float3x4 Identity()
+	{
+		float3x4 t = {};
+		t.m[0][0] = t.m[1][1] = t.m[2][2] = 1.0f;
+		return t;
+	}
+
+	float3 TransformPoint(const float3& p) const
+	{
+		return float3(
+			m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+			m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+			m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+	}
+
+	float3 TransformVector(const float3& v) const
+	{
+		return float3(
+			m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+			m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+			m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+	}
+
+	// WorldToObject3x4() from ObjectToWorld3x4() - inverse of the affine transform
+	float3x4 Inverse() const
+	{
+		// Inverse of the 3x3 part through the adjugate
+		float3x4 r;
+		float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+		float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+
+		r.m[0][0] = c00 * invDet;
+		r.m[1][0] = c01 * invDet;
+		r.m[2][0] = c02 * invDet;
+		r.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+		r.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+		r.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+		r.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+		r.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+		r.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+
+		// -R^-1 * t
+		for (int i = 0; i < 3; i++)
+			r.m[i][3] = -(r.m[i][0] * m[0][3] + r.m[i][1] * m[1][3] + r.m[i][2] * m[2][3]);
+		return r;
+	}
+
+	// Bounds of the transformed box (Arvo's method - tight for an affine transform of an AABB)
+	Aabb TransformAabb(const Aabb& b) const
+	{
+		if (b.IsEmpty())
+			return b;
+
+		Aabb r;
+		for (int i = 0; i < 3; i++)
+		{
+			r.bmin[i] = r.bmax[i] = m[i][3];
+			for (int j = 0; j < 3; j++)
+			{
+				float e = m[i][j] * b.bmin[j];
+				float f = m[i][j] * b.bmax[j];
+				r.bmin[i] += Min(e, f);
+				r.bmax[i] += Max(e, f);
+			}
+		}
+		return r;
+	}
+
+	// Rotation about Y followed by a translation, i.e. the transposed
+	// XMMatrixRotationAxis(Y, angle) * XMMatrixTranslation(t) used by BuildTopLevelAS()
+	static float3x4 RotationYTranslation(float angleRadians, const float3& t)
+	{
+		float c = std::cos(angleRadians), s = std::sin(angleRadians);
+		float3x4 r = {};
+		r.m[0][0] = c;  r.m[0][2] = s;  r.m[0][3] = t.x;
+		r.m[1][1] = 1;                  r.m[1][3] = t.y;
+		r.m[2][0] = -s; r.m[2][2] = c;  r.m[2][3] = t.z;
+		return r;
+	}
+};
+
+struct float4
+{
+	float x, y, z, w;
+
+	float4() : x(0), y(0), z(0), w(0) {}
+	float4(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+	float4(const float3& v, float w_) : x(v.x), y(v.y), z(v.z), w(w_) {}
+
+	float3 xyz() const { return float3(x, y, z); }
+};
+
+inline float saturate(float v) { return Min(Max(v, 0.0f), 1.0f); }
+inline float3 sqrt(const float3& v) { return float3(std::sqrt(v.x), std::sqrt(v.y), std::sqrt(v.z)); }
+
+} // namespace CpuRT
@@ -0,0 +1,96 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace CpuRT
+{
+
+void Image::Resize(uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_Pixels.assign((size_t)width * height, 0);
+}
+
+bool Image::WritePPM(const std::string& path) const
+{
+	FILE* pFile = fopen(path.c_str(), "wb");
+	if (!pFile)
+		return false;
+
+	fprintf(pFile, "P6\n%u %u\n255\n", m_Width, m_Height);
+
+	std::vector<uint8_t> row(m_Width * 3);
+	for (uint32_t y = 0; y < m_Height; y++)
+	{
+		for (uint32_t x = 0; x < m_Width; x++)
+		{
+			uint32_t p = Load(x, y);
+			row[x * 3 + 0] = (uint8_t)(p & 0xFF);
+			row[x * 3 + 1] = (uint8_t)((p >> 8) & 0xFF);
+			row[x * 3 + 2] = (uint8_t)((p >> 16) & 0xFF);
+		}
+		fwrite(row.data(), 1, row.size(), pFile);
+	}
+
+	bool ok = ferror(pFile) == 0;
+	fclose(pFile);
+	return ok;
+}
+
+bool Image::ReadPPM(const std::string& path)
+{
+	FILE* pFile = fopen(path.c_str(), "rb");
+	if (!pFile)
+		return false;
+
+	uint32_t width = 0, height = 0, maxValue = 0;
+	bool ok = fscanf(pFile, "P6 %u %u %u", &width, &height, &maxValue) == 3 && maxValue == 255;
+	// Exactly one whitespace character separates the header from the data
+	ok = ok && fgetc(pFile) != EOF;
+
+	if (ok)
+	{
+		Resize(width, height);
+		std::vector<uint8_t> row(width * 3);
+		for (uint32_t y = 0; y < height && ok; y++)
+		{
+			ok = fread(row.data(), 1, row.size(), pFile) == row.size();
+			for (uint32_t x = 0; x < width && ok; x++)
+				m_Pixels[y * width + x] = row[x * 3] | (row[x * 3 + 1] << 8) | (row[x * 3 + 2] << 16) | 0xFF000000u;
+		}
+	}
+
+	fclose(pFile);
+	return ok;
+}
+
+ImageDiff Image::Compare(const Image& a, const Image& b, uint32_t tolerance)
+{
+	ImageDiff diff;
+	if (a.m_Width != b.m_Width || a.m_Height != b.m_Height)
+	{
+		diff.sizeMismatch = true;
+		return diff;
+	}
+
+	for (size_t i = 0; i < a.m_Pixels.size(); i++)
+	{
+		uint32_t pixelDiff = 0;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			int ca = (a.m_Pixels[i] >> (c * 8)) & 0xFF;
+			int cb = (b.m_Pixels[i] >> (c * 8)) & 0xFF;
+			pixelDiff = std::max(pixelDiff, (uint32_t)std::abs(ca - cb));
+		}
+
+		diff.maxChannelDiff = std::max(diff.maxChannelDiff, pixelDiff);
+		if (pixelDiff > tolerance)
+			diff.differentPixels++;
+	}
+	return diff;
+}
+
+} // namespace CpuRT
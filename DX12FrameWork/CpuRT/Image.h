@@ -0,0 +1,54 @@
+#pragma once
+
+// RGBA8 render target of the CPU ray tracer - the equivalent of the
+// DXGI_FORMAT_R8G8B8A8_UNORM output UAV created in DxrGame::createShaderResources().
+// Saved as binary PPM so golden images can be diffed on any machine.
+
+#include "CpuRTMath.h"
+
+#include <string>
+#include <vector>
+
+namespace CpuRT
+{
+
+struct ImageDiff
+{
+	uint32_t differentPixels = 0;
+	uint32_t maxChannelDiff = 0;
+	bool sizeMismatch = false;
+};
+
+class Image
+{
+public:
+	Image() = default;
+	Image(uint32_t width, uint32_t height) { Resize(width, height); }
+
+	void Resize(uint32_t width, uint32_t height);
+
+	// gOutput[xy] = value - UNORM conversion as done by the UAV store
+	void Store(uint32_t x, uint32_t y, const float4& value)
+	{
+		auto toUnorm = [](float v) { return (uint32_t)(saturate(v) * 255.0f + 0.5f); };
+		m_Pixels[y * m_Width + x] = toUnorm(value.x) | (toUnorm(value.y) << 8) | (toUnorm(value.z) << 16) | (toUnorm(value.w) << 24);
+	}
+	uint32_t Load(uint32_t x, uint32_t y) const { return m_Pixels[y * m_Width + x]; }
+
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+
+	// RGB only, alpha is dropped
+	bool WritePPM(const std::string& path) const;
+	bool ReadPPM(const std::string& path);
+
+	// Pixels are "different" when any RGB channel differs by more than 'tolerance'
+	static ImageDiff Compare(const Image& a, const Image& b, uint32_t tolerance = 0);
+
+private:
+	uint32_t m_Width = 0;
+	uint32_t m_Height = 0;
+	std::vector<uint32_t> m_Pixels;
+};
+
+} // namespace CpuRT
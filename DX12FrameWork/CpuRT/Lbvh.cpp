@@ -0,0 +1,392 @@
+// Linear BVH builder (BvhBuilder::Lbvh):
+//		1. Morton code of every primitive centroid (30 or 63 bits)
+//		2. Parallel LSD radix sort of the codes
+//		3. Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees" (2012):
+//		   every internal node of the radix tree is found independently from the sorted codes
+//		4. Bottom-up pass computing the bounds and subtree sizes (the last child to arrive continues)
+//		5. Top-down emission into the BvhNode layout of the SAH builder (sibling pairs, children after
+//		   their parent) - so Traverse, Refit, the wide collapse etc. work on both trees unchanged.
+
+#include "Bvh.h"
+#include "../Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace CpuRT
+{
+
+namespace
+{
+	const uint32_t kLeafRef = 0x80000000;
+	const uint32_t kNoParent = 0xFFFFFFFF;
+
+	int CountLeadingZeros(uint64_t x)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+	#if defined(_M_X64) || defined(_M_ARM64)
+		return _BitScanReverse64(&index, x) ? 63 - (int)index : 64;
+	#else
+		if (_BitScanReverse(&index, (unsigned long)(x >> 32)))
+			return 31 - (int)index;
+		return _BitScanReverse(&index, (unsigned long)x) ? 63 - (int)index : 64;
+	#endif
+#else
+		return x ? __builtin_clzll(x) : 64;
+#endif
+	}
+
+	// Inserts two zero bits between the lowest 10 bits of v
+	uint64_t ExpandBits10(uint32_t v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	// Inserts two zero bits between the lowest 21 bits of v
+	uint64_t ExpandBits21(uint64_t v)
+	{
+		v &= 0x1FFFFF;
+		v = (v | v << 32) & 0x1F00000000FFFFull;
+		v = (v | v << 16) & 0x1F0000FF0000FFull;
+		v = (v | v << 8) & 0x100F00F00F00F00Full;
+		v = (v | v << 4) & 0x10C30C30C30C30C3ull;
+		v = (v | v << 2) & 0x1249249249249249ull;
+		return v;
+	}
+
+	void ForRange(ThreadPool* pool, uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& body)
+	{
+		if (pool)
+			ParallelFor(*pool, 0, count, grain, body);
+		else
+			body(0, count);
+	}
+
+	// Stable LSD radix sort of (key, value) pairs by the lowest keyBits bits of the keys, 8 bits per pass.
+	// Every pass: per-block digit histograms, one prefix sum over (digit, block), per-block scatter.
+	void RadixSort(ThreadPool* pool, std::vector<uint64_t>& keys, std::vector<uint32_t>& values, uint32_t keyBits)
+	{
+		const uint32_t count = (uint32_t)keys.size();
+		const uint32_t kRadix = 256;
+		const uint32_t blockCount = pool ? std::max(1u, std::min(pool->GetThreadCount() * 4, count / 16384)) : 1;
+		const uint32_t blockSize = (count + blockCount - 1) / blockCount;
+
+		std::vector<uint64_t> tmpKeys(count);
+		std::vector<uint32_t> tmpValues(count);
+		std::vector<uint32_t> offsets(blockCount * kRadix);
+
+		for (uint32_t shift = 0; shift < keyBits; shift += 8)
+		{
+			ForRange(pool, blockCount, 1, [&](uint32_t blockBegin, uint32_t blockEnd)
+			{
+				for (uint32_t b = blockBegin; b < blockEnd; b++)
+				{
+					uint32_t* histogram = &offsets[b * kRadix];
+					std::fill(histogram, histogram + kRadix, 0u);
+					const uint32_t end = std::min(count, (b + 1) * blockSize);
+					for (uint32_t i = b * blockSize; i < end; i++)
+						histogram[(keys[i] >> shift) & (kRadix - 1)]++;
+				}
+			});
+
+			// Digit-major prefix sum; a pass where all keys share the digit changes nothing
+			bool skipPass = false;
+			uint32_t sum = 0;
+			for (uint32_t d = 0; d < kRadix; d++)
+			{
+				const uint32_t digitStart = sum;
+				for (uint32_t b = 0; b < blockCount; b++)
+				{
+					const uint32_t c = offsets[b * kRadix + d];
+					offsets[b * kRadix + d] = sum;
+					sum += c;
+				}
+				skipPass |= sum - digitStart == count;
+			}
+			if (skipPass)
+				continue;
+
+			ForRange(pool, blockCount, 1, [&](uint32_t blockBegin, uint32_t blockEnd)
+			{
+				for (uint32_t b = blockBegin; b < blockEnd; b++)
+				{
+					uint32_t* offset = &offsets[b * kRadix];
+					const uint32_t end = std::min(count, (b + 1) * blockSize);
+					for (uint32_t i = b * blockSize; i < end; i++)
+					{
+						const uint32_t dst = offset[(keys[i] >> shift) & (kRadix - 1)]++;
+						tmpKeys[dst] = keys[i];
+						tmpValues[dst] = values[i];
+					}
+				}
+			});
+
+			keys.swap(tmpKeys);
+			values.swap(tmpValues);
+		}
+	}
+}
+
+struct Bvh::LbvhContext
+{
+	const Aabb* primBounds;
+	BvhBuildSettings settings;
+	uint32_t primCount;
+
+	// Sorted Morton codes, m_PrimIndices holds the matching primitives
+	std::vector<uint64_t> codes;
+
+	// Internal nodes of the radix tree (primCount - 1 of them). Children are internal node
+	// indices or kLeafRef | position in the sorted order.
+	std::vector<uint32_t> rangeFirst, rangeLast;
+	std::vector<uint32_t> left, right;
+	std::vector<uint32_t> internalParent, leafParent;
+
+	// Filled bottom-up
+	std::vector<Aabb> bounds;
+	// Number of BvhNodes the subtree turns into (subtrees with <= maxLeafSize primitives become one leaf)
+	std::vector<uint32_t> subtreeNodes;
+	std::unique_ptr<std::atomic<uint32_t>[]> arrivals;
+
+	TaskGroup* pTaskGroup = nullptr;
+
+	// Length of the common prefix of the keys at i and j, -1 outside of the array.
+	// Equal codes are told apart by their positions, which makes all keys unique.
+	int Delta(int i, int j) const
+	{
+		if (j < 0 || j >= (int)primCount)
+			return -1;
+		const uint64_t x = codes[i] ^ codes[j];
+		return x ? CountLeadingZeros(x) : 64 + CountLeadingZeros((uint64_t)(i ^ j));
+	}
+
+	uint32_t SubtreeNodes(uint32_t ref) const { return (ref & kLeafRef) ? 1 : subtreeNodes[ref]; }
+	const Aabb& Bounds(uint32_t ref, const std::vector<uint32_t>& primIndices) const
+	{
+		return (ref & kLeafRef) ? primBounds[primIndices[ref & ~kLeafRef]] : bounds[ref];
+	}
+};
+
+void Bvh::BuildLbvh(const Aabb* primBounds, uint32_t primCount, const BvhBuildSettings& settings)
+{
+	ThreadPool* pool = settings.pool;
+	const uint32_t grain = 16 * 1024;
+
+	LbvhContext ctx;
+	ctx.primBounds = primBounds;
+	ctx.settings = settings;
+	ctx.settings.maxLeafSize = std::max(1u, settings.maxLeafSize);
+	ctx.primCount = primCount;
+
+	// ----------------------------- Morton codes
+	Aabb centroidBounds;
+	std::mutex boundsMutex;
+	ForRange(pool, primCount, grain, [&](uint32_t begin, uint32_t end)
+	{
+		Aabb local;
+		for (uint32_t i = begin; i < end; i++)
+			local.Grow(primBounds[i].Centroid());
+		std::lock_guard<std::mutex> lock(boundsMutex);
+		centroidBounds.Grow(local);
+	});
+
+	const bool wideCodes = settings.mortonCodeBits > 30;
+	const float cellCount = wideCodes ? (float)(1u << 21) : 1024.0f;
+	const float3 extent = centroidBounds.Extent();
+	const float3 scale(
+		extent.x > 0.0f ? cellCount / extent.x : 0.0f,
+		extent.y > 0.0f ? cellCount / extent.y : 0.0f,
+		extent.z > 0.0f ? cellCount / extent.z : 0.0f);
+
+	ctx.codes.resize(primCount);
+	m_PrimIndices.resize(primCount);
+	ForRange(pool, primCount, grain, [&](uint32_t begin, uint32_t end)
+	{
+		const float maxCell = cellCount - 1.0f;
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const float3 c = (primBounds[i].Centroid() - centroidBounds.bmin) * scale;
+			const uint32_t x = (uint32_t)Min(Max(c.x, 0.0f), maxCell);
+			const uint32_t y = (uint32_t)Min(Max(c.y, 0.0f), maxCell);
+			const uint32_t z = (uint32_t)Min(Max(c.z, 0.0f), maxCell);
+			ctx.codes[i] = wideCodes
+				? (ExpandBits21(x) << 2) | (ExpandBits21(y) << 1) | ExpandBits21(z)
+				: (ExpandBits10(x) << 2) | (ExpandBits10(y) << 1) | ExpandBits10(z);
+			m_PrimIndices[i] = i;
+		}
+	});
+
+	RadixSort(pool, ctx.codes, m_PrimIndices, wideCodes ? 63 : 30);
+
+	// ----------------------------- Radix tree
+	const uint32_t internalCount = primCount - 1;
+	ctx.rangeFirst.resize(internalCount);
+	ctx.rangeLast.resize(internalCount);
+	ctx.left.resize(internalCount);
+	ctx.right.resize(internalCount);
+	ctx.internalParent.assign(internalCount, kNoParent);
+	ctx.leafParent.assign(primCount, kNoParent);
+
+	ForRange(pool, internalCount, grain, [&](uint32_t begin, uint32_t end)
+	{
+		for (int i = (int)begin; i < (int)end; i++)
+		{
+			// Direction of the range: towards the neighbour sharing the longer prefix
+			const int d = ctx.Delta(i, i + 1) - ctx.Delta(i, i - 1) >= 0 ? 1 : -1;
+
+			// Other end of the range - exponential, then binary search
+			const int deltaMin = ctx.Delta(i, i - d);
+			int lengthMax = 2;
+			while (ctx.Delta(i, i + lengthMax * d) > deltaMin)
+				lengthMax *= 2;
+			int length = 0;
+			for (int t = lengthMax / 2; t >= 1; t /= 2)
+			{
+				if (ctx.Delta(i, i + (length + t) * d) > deltaMin)
+					length += t;
+			}
+			const int j = i + length * d;
+
+			// Split position - the highest differing bit within the range
+			const int deltaNode = ctx.Delta(i, j);
+			int split = 0;
+			int t = length;
+			do
+			{
+				t = (t + 1) / 2;
+				if (ctx.Delta(i, i + (split + t) * d) > deltaNode)
+					split += t;
+			} while (t > 1);
+			const int gamma = i + split * d + std::min(d, 0);
+
+			const uint32_t first = (uint32_t)std::min(i, j);
+			const uint32_t last = (uint32_t)std::max(i, j);
+			ctx.rangeFirst[i] = first;
+			ctx.rangeLast[i] = last;
+
+			if (first == (uint32_t)gamma)
+			{
+				ctx.left[i] = kLeafRef | (uint32_t)gamma;
+				ctx.leafParent[gamma] = (uint32_t)i;
+			}
+			else
+			{
+				ctx.left[i] = (uint32_t)gamma;
+				ctx.internalParent[gamma] = (uint32_t)i;
+			}
+
+			if (last == (uint32_t)gamma + 1)
+			{
+				ctx.right[i] = kLeafRef | (uint32_t)(gamma + 1);
+				ctx.leafParent[gamma + 1] = (uint32_t)i;
+			}
+			else
+			{
+				ctx.right[i] = (uint32_t)(gamma + 1);
+				ctx.internalParent[gamma + 1] = (uint32_t)i;
+			}
+		}
+	});
+
+	// ----------------------------- Bounds, bottom-up
+	// Every leaf walks towards the root; the first child to reach a node stops there,
+	// the second one (which sees both children finished) computes the node and goes on.
+	ctx.bounds.resize(internalCount);
+	ctx.subtreeNodes.resize(internalCount);
+	ctx.arrivals.reset(new std::atomic<uint32_t>[internalCount]);
+	for (uint32_t i = 0; i < internalCount; i++)
+		ctx.arrivals[i].store(0, std::memory_order_relaxed);
+
+	ForRange(pool, primCount, grain, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t leaf = begin; leaf < end; leaf++)
+		{
+			uint32_t node = ctx.leafParent[leaf];
+			while (node != kNoParent && ctx.arrivals[node].fetch_add(1, std::memory_order_acq_rel) == 1)
+			{
+				Aabb b = ctx.Bounds(ctx.left[node], m_PrimIndices);
+				b.Grow(ctx.Bounds(ctx.right[node], m_PrimIndices));
+				ctx.bounds[node] = b;
+
+				const uint32_t count = ctx.rangeLast[node] - ctx.rangeFirst[node] + 1;
+				ctx.subtreeNodes[node] = count <= ctx.settings.maxLeafSize ? 1 :
+					1 + ctx.SubtreeNodes(ctx.left[node]) + ctx.SubtreeNodes(ctx.right[node]);
+
+				node = ctx.internalParent[node];
+			}
+		}
+	});
+
+	// ----------------------------- Emission
+	const uint32_t root = primCount == 1 ? kLeafRef : 0;
+	m_Nodes.resize(ctx.SubtreeNodes(root));
+
+	if (pool)
+	{
+		TaskGroup group(*pool);
+		ctx.pTaskGroup = &group;
+		EmitLbvhNode(ctx, root, 0, 1);
+		group.Wait();
+	}
+	else
+	{
+		EmitLbvhNode(ctx, root, 0, 1);
+	}
+}
+
+// Writes the subtree of 'ref' with its root at nodeIndex and all deeper nodes from
+// descendantsFirst on: the children pair first, then the left subtree, then the right one.
+void Bvh::EmitLbvhNode(LbvhContext& ctx, uint32_t ref, uint32_t nodeIndex, uint32_t descendantsFirst)
+{
+	BvhNode& node = m_Nodes[nodeIndex];
+	node.bounds = ctx.Bounds(ref, m_PrimIndices);
+
+	if (ref & kLeafRef)
+	{
+		node.leftFirst = ref & ~kLeafRef;
+		node.primCount = 1;
+		return;
+	}
+
+	const uint32_t count = ctx.rangeLast[ref] - ctx.rangeFirst[ref] + 1;
+	if (count <= ctx.settings.maxLeafSize)
+	{
+		node.leftFirst = ctx.rangeFirst[ref];
+		node.primCount = count;
+		return;
+	}
+
+	node.leftFirst = descendantsFirst;
+	node.primCount = 0;
+
+	const uint32_t leftRef = ctx.left[ref];
+	const uint32_t rightRef = ctx.right[ref];
+	const uint32_t leftDescendants = ctx.SubtreeNodes(leftRef) - 1;
+
+	if (ctx.pTaskGroup && count >= ctx.settings.parallelThreshold)
+	{
+		LbvhContext* pCtx = &ctx;
+		ctx.pTaskGroup->Run([this, pCtx, leftRef, descendantsFirst]()
+		{
+			EmitLbvhNode(*pCtx, leftRef, descendantsFirst, descendantsFirst + 2);
+		});
+	}
+	else
+	{
+		EmitLbvhNode(ctx, leftRef, descendantsFirst, descendantsFirst + 2);
+	}
+	EmitLbvhNode(ctx, rightRef, descendantsFirst + 1, descendantsFirst + 2 + leftDescendants);
+}
+
+} // namespace CpuRT
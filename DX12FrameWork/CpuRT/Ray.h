@@ -0,0 +1,129 @@
+#pragma once
+
+// Ray and hit records of the CPU ray tracer. Names follow the HLSL side
+// (RayDesc, RAY_FLAG_*, HIT_KIND_*) to keep the CPU shaders close to 14-Shaders.hlsl.
+
+#include "CpuRTMath.h"
+
+namespace CpuRT
+{
+
+struct RayDesc
+{
+	float3 Origin;
+	float TMin = 0.0f;
+	float3 Direction;
+	float TMax = FLT_MAX;
+};
+
+// Subset of the HLSL RAY_FLAG enum that the CPU traversal honours
+enum RayFlags : uint32_t
+{
+	RAY_FLAG_NONE								= 0x00,
+	RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH	= 0x04,
+	RAY_FLAG_SKIP_CLOSEST_HIT_SHADER			= 0x08,
+	RAY_FLAG_CULL_BACK_FACING_TRIANGLES			= 0x10,
+	RAY_FLAG_CULL_FRONT_FACING_TRIANGLES		= 0x20,
+};
+
+enum HitKind : uint32_t
+{
+	HIT_KIND_TRIANGLE_FRONT_FACE	= 0xFE,
+	HIT_KIND_TRIANGLE_BACK_FACE		= 0xFF,
+};
+
+// Everything the hit shaders can query through the HLSL intrinsics
+struct HitInfo
+{
+	float t = FLT_MAX;						// RayTCurrent()
+	float2 barycentrics;					// BuiltInTriangleIntersectionAttributes::barycentrics
+	uint32_t hitKind = HIT_KIND_TRIANGLE_FRONT_FACE;	// HitKind()
+	uint32_t primitiveIndex = 0;			// PrimitiveIndex()
+	uint32_t geometryIndex = 0;				// GeometryIndex()
+	uint32_t instanceIndex = 0;				// InstanceIndex()
+	uint32_t instanceID = 0;				// InstanceID()
+	// InstanceContributionToHitGroupIndex of the hit instance - needed to pick the hit group
+	uint32_t instanceContribution = 0;
+
+	bool IsHit() const { return t != FLT_MAX; }
+};
+
+// Ray with the per-ray constants the traversal needs
+struct TraversalRay
+{
+	float3 origin;
+	float3 dir;
+	float3 invDir;
+	float tmin;
+	uint32_t flags;
+
+	TraversalRay(const float3& o, const float3& d, float tmin_, uint32_t flags_)
+		: origin(o), dir(d), tmin(tmin_), flags(flags_)
+	{
+		invDir = float3(SafeInverse(d.x), SafeInverse(d.y), SafeInverse(d.z));
+	}
+
+	// 1/0 = inf would make the slab test compute 0 * inf = NaN (a miss) for an axis-parallel
+	// ray that lies exactly in the plane of a box face - common on grids and with the
+	// straight-down rays of tools. A huge finite value keeps such rays inside the slab.
+	static float SafeInverse(float d)
+	{
+		const float kMinComponent = 1e-20f;
+		return 1.0f / (std::fabs(d) < kMinComponent ? (d < 0.0f ? -kMinComponent : kMinComponent) : d);
+	}
+};
+
+// Slab test. Returns the entry distance, FLT_MAX on a miss.
+inline float IntersectAabb(const TraversalRay& ray, const Aabb& box, float tmax)
+{
+	float tx1 = (box.bmin.x - ray.origin.x) * ray.invDir.x, tx2 = (box.bmax.x - ray.origin.x) * ray.invDir.x;
+	float tnear = Min(tx1, tx2), tfar = Max(tx1, tx2);
+	float ty1 = (box.bmin.y - ray.origin.y) * ray.invDir.y, ty2 = (box.bmax.y - ray.origin.y) * ray.invDir.y;
+	tnear = Max(tnear, Min(ty1, ty2)); tfar = Min(tfar, Max(ty1, ty2));
+	float tz1 = (box.bmin.z - ray.origin.z) * ray.invDir.z, tz2 = (box.bmax.z - ray.origin.z) * ray.invDir.z;
+	tnear = Max(tnear, Min(tz1, tz2)); tfar = Min(tfar, Max(tz1, tz2));
+
+	return (tfar >= tnear && tfar >= ray.tmin && tnear <= tmax) ? tnear : FLT_MAX;
+}
+
+// Moller-Trumbore. On a hit closer than tmax fills t, the DXR barycentrics
+// (weights of v1 and v2) and the front-face flag, and returns true.
+// Front faces are clockwise, as for D3D12 without TRIANGLE_FRONT_COUNTERCLOCKWISE.
+inline bool IntersectTriangle(const TraversalRay& ray, const float3& v0, const float3& v1, const float3& v2,
+	float tmax, float* pT, float2* pBary, bool* pFrontFace)
+{
+	const float3 e1 = v1 - v0;
+	const float3 e2 = v2 - v0;
+	const float3 p = cross(ray.dir, e2);
+	const float det = dot(e1, p);
+
+	const bool frontFace = det > 0.0f;
+	if (det == 0.0f)
+		return false;
+	if ((ray.flags & RAY_FLAG_CULL_BACK_FACING_TRIANGLES) && !frontFace)
+		return false;
+	if ((ray.flags & RAY_FLAG_CULL_FRONT_FACING_TRIANGLES) && frontFace)
+		return false;
+
+	const float invDet = 1.0f / det;
+	const float3 s = ray.origin - v0;
+	const float u = dot(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	const float3 q = cross(s, e1);
+	const float v = dot(ray.dir, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	const float t = dot(e2, q) * invDet;
+	if (t < ray.tmin || t >= tmax)
+		return false;
+
+	*pT = t;
+	*pBary = float2(u, v);
+	*pFrontFace = frontFace;
+	return true;
+}
+
+} // namespace CpuRT
@@ -0,0 +1,145 @@
+#pragma once
+
+// Packets of kSimdWidth coherent rays (a screen-space block of primary rays, or the
+// shadow rays fired from it) that are traced together: every BVH node and triangle is
+// fetched once per packet and tested against all lanes with one SIMD instruction stream.
+
+#include "Ray.h"
+#include "Simd.h"
+
+namespace CpuRT
+{
+
+struct RayPacket
+{
+	vfloat3 origin;
+	vfloat3 dir;
+	vfloat3 invDir;
+	vfloat tmin;
+	// The same RAY_FLAG_* for the whole packet
+	uint32_t flags = RAY_FLAG_NONE;
+
+	RayPacket() {}
+	RayPacket(const vfloat3& o, const vfloat3& d, const vfloat& tmin_, uint32_t flags_)
+		: origin(o), dir(d), tmin(tmin_), flags(flags_)
+	{
+		invDir = vfloat3(SafeInverse(d.x), SafeInverse(d.y), SafeInverse(d.z));
+	}
+
+	// Same as TraversalRay::SafeInverse(), per lane
+	static vfloat SafeInverse(const vfloat& d)
+	{
+		const vfloat kMinComponent(1e-20f);
+		const vfloat absD = Max(d, vfloat(0.0f) - d);
+		const vfloat safeD = Select(absD < kMinComponent, Select(d < vfloat(0.0f), vfloat(0.0f) - kMinComponent, kMinComponent), d);
+		return vfloat(1.0f) / safeD;
+	}
+
+	// Gathers up to kSimdWidth rays. Unused lanes get a copy of ray 0, pActive /
+	// pTMax (optional) receive the lane mask and the TMax of every lane.
+	static RayPacket FromRays(const RayDesc* rays, uint32_t rayCount, uint32_t flags, vmask* pActive = nullptr, vfloat* pTMax = nullptr)
+	{
+		float o[3][kSimdWidth], d[3][kSimdWidth], tmin[kSimdWidth], tmax[kSimdWidth];
+		uint32_t activeBits = 0;
+		for (uint32_t lane = 0; lane < kSimdWidth; lane++)
+		{
+			const RayDesc& ray = rays[lane < rayCount ? lane : 0];
+			for (int c = 0; c < 3; c++)
+			{
+				o[c][lane] = ray.Origin[c];
+				d[c][lane] = ray.Direction[c];
+			}
+			tmin[lane] = ray.TMin;
+			tmax[lane] = ray.TMax;
+			activeBits |= lane < rayCount ? (1u << lane) : 0u;
+		}
+
+		if (pActive)
+			*pActive = LaneMask(activeBits);
+		if (pTMax)
+			*pTMax = vfloat::Load(tmax);
+
+		return RayPacket(
+			vfloat3(vfloat::Load(o[0]), vfloat::Load(o[1]), vfloat::Load(o[2])),
+			vfloat3(vfloat::Load(d[0]), vfloat::Load(d[1]), vfloat::Load(d[2])),
+			vfloat::Load(tmin), flags);
+	}
+
+	// Mask with lane i set <=> bit i set
+	static vmask LaneMask(uint32_t bits)
+	{
+		float lanes[kSimdWidth];
+		for (uint32_t lane = 0; lane < kSimdWidth; lane++)
+			lanes[lane] = (bits >> lane) & 1u ? 1.0f : 0.0f;
+		return vfloat::Load(lanes) != vfloat(0.0f);
+	}
+
+	// The packet in another space (world -> object), as for one ray in TopLevelAS::Intersect()
+	RayPacket Transformed(const float3x4& t) const
+	{
+		vfloat3 o(
+			vfloat(t.m[0][0]) * origin.x + vfloat(t.m[0][1]) * origin.y + vfloat(t.m[0][2]) * origin.z + vfloat(t.m[0][3]),
+			vfloat(t.m[1][0]) * origin.x + vfloat(t.m[1][1]) * origin.y + vfloat(t.m[1][2]) * origin.z + vfloat(t.m[1][3]),
+			vfloat(t.m[2][0]) * origin.x + vfloat(t.m[2][1]) * origin.y + vfloat(t.m[2][2]) * origin.z + vfloat(t.m[2][3]));
+		vfloat3 d(
+			vfloat(t.m[0][0]) * dir.x + vfloat(t.m[0][1]) * dir.y + vfloat(t.m[0][2]) * dir.z,
+			vfloat(t.m[1][0]) * dir.x + vfloat(t.m[1][1]) * dir.y + vfloat(t.m[1][2]) * dir.z,
+			vfloat(t.m[2][0]) * dir.x + vfloat(t.m[2][1]) * dir.y + vfloat(t.m[2][2]) * dir.z);
+		return RayPacket(o, d, tmin, flags);
+	}
+};
+
+// Slab test of all lanes against one box. Returns the lanes that hit it before tmax,
+// pTNear receives their entry distances.
+inline vmask IntersectAabb(const RayPacket& packet, const Aabb& box, const vfloat& tmax, vfloat* pTNear)
+{
+	vfloat tx1 = (vfloat(box.bmin.x) - packet.origin.x) * packet.invDir.x;
+	vfloat tx2 = (vfloat(box.bmax.x) - packet.origin.x) * packet.invDir.x;
+	vfloat tnear = Min(tx1, tx2), tfar = Max(tx1, tx2);
+	vfloat ty1 = (vfloat(box.bmin.y) - packet.origin.y) * packet.invDir.y;
+	vfloat ty2 = (vfloat(box.bmax.y) - packet.origin.y) * packet.invDir.y;
+	tnear = Max(tnear, Min(ty1, ty2)); tfar = Min(tfar, Max(ty1, ty2));
+	vfloat tz1 = (vfloat(box.bmin.z) - packet.origin.z) * packet.invDir.z;
+	vfloat tz2 = (vfloat(box.bmax.z) - packet.origin.z) * packet.invDir.z;
+	tnear = Max(tnear, Min(tz1, tz2)); tfar = Min(tfar, Max(tz1, tz2));
+
+	*pTNear = tnear;
+	return (tfar >= tnear) & (tfar >= packet.tmin) & (tnear <= tmax);
+}
+
+// Moller-Trumbore for all lanes against one triangle, same conventions as the single-ray
+// IntersectTriangle(). Returns the lanes with a hit in [tmin, tmax); t, the barycentrics
+// and the front-face mask are valid in those lanes only.
+inline vmask IntersectTriangle(const RayPacket& packet, const float3& v0, const float3& v1, const float3& v2,
+	const vfloat& tmax, vfloat* pT, vfloat* pU, vfloat* pV, vmask* pFrontFace)
+{
+	const vfloat3 e1(v1 - v0);
+	const vfloat3 e2(v2 - v0);
+	const vfloat3 p = cross(packet.dir, e2);
+	const vfloat det = dot(e1, p);
+
+	const vmask frontFace = det > vfloat(0.0f);
+	vmask hit = det != vfloat(0.0f);
+	if (packet.flags & RAY_FLAG_CULL_BACK_FACING_TRIANGLES)
+		hit = hit & frontFace;
+	if (packet.flags & RAY_FLAG_CULL_FRONT_FACING_TRIANGLES)
+		hit = AndNot(hit, frontFace);
+
+	const vfloat invDet = vfloat(1.0f) / det;
+	const vfloat3 s = packet.origin - vfloat3(v0);
+	const vfloat u = dot(s, p) * invDet;
+	const vfloat3 q = cross(s, e1);
+	const vfloat v = dot(packet.dir, q) * invDet;
+	const vfloat t = dot(e2, q) * invDet;
+
+	hit = hit & (u >= vfloat(0.0f)) & (v >= vfloat(0.0f)) & (u + v <= vfloat(1.0f));
+	hit = hit & (t >= packet.tmin) & (t < tmax);
+
+	*pT = t;
+	*pU = u;
+	*pV = v;
+	*pFrontFace = frontFace;
+	return hit;
+}
+
+} // namespace CpuRT
@@ -0,0 +1,107 @@
+#include "RayTracingPipeline.h"
+#include "../Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace CpuRT
+{
+
+void ShaderContext::TraceRay(uint32_t rayFlags, uint32_t instanceInclusionMask, uint32_t rayContributionToHitGroupIndex,
+	uint32_t multiplierForGeometryContributionToHitGroupIndex, uint32_t missShaderIndex,
+	const RayDesc& ray, void* pPayload)
+{
+	// On the GPU exceeding MaxTraceRecursionDepth removes the device
+	assert(m_RecursionDepth < m_pDesc->maxTraceRecursionDepth && "MaxTraceRecursionDepth exceeded");
+	if (m_RecursionDepth >= m_pDesc->maxTraceRecursionDepth)
+		return;
+
+	(*m_pRayCounter)++;
+
+	// The invoked shader gets its own context - the caller's RayTCurrent() etc. must survive the call
+	ShaderContext callee(*this);
+	callee.m_RecursionDepth = m_RecursionDepth + 1;
+	callee.m_Ray = ray;
+	callee.m_Hit = HitInfo();
+
+	const ShaderTable& table = *m_pDesc->pShaderTable;
+
+	if (m_pDesc->pScene->Intersect(ray, rayFlags, instanceInclusionMask, &callee.m_Hit))
+	{
+		if (rayFlags & RAY_FLAG_SKIP_CLOSEST_HIT_SHADER)
+			return;
+
+		uint32_t recordIndex = callee.m_Hit.instanceContribution +
+			callee.m_Hit.geometryIndex * multiplierForGeometryContributionToHitGroupIndex +
+			rayContributionToHitGroupIndex;
+		assert(recordIndex < table.hitGroups.size() && "Hit group index outside of the shader table");
+
+		const ShaderRecord& record = table.hitGroups[recordIndex];
+		if (record.closestHit)
+		{
+			BuiltInTriangleIntersectionAttributes attribs;
+			attribs.barycentrics = callee.m_Hit.barycentrics;
+			callee.m_pLocalRootArguments = record.localRootArguments;
+			record.closestHit(callee, pPayload, attribs);
+		}
+	}
+	else
+	{
+		assert(missShaderIndex < table.missShaders.size() && "Miss shader index outside of the shader table");
+
+		const ShaderRecord& record = table.missShaders[missShaderIndex];
+		callee.m_pLocalRootArguments = record.localRootArguments;
+		if (record.miss)
+			record.miss(callee, pPayload);
+	}
+}
+
+DispatchStats DispatchRays(const DispatchRaysDesc& desc)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	const uint32_t tileSize = std::max(1u, desc.tileSize);
+	const uint32_t tilesX = (desc.Width + tileSize - 1) / tileSize;
+	const uint32_t tilesY = (desc.Height + tileSize - 1) / tileSize;
+	const ShaderRecord& rayGen = desc.pShaderTable->rayGeneration;
+
+	// One counter per worker, on separate cache lines
+	const uint32_t workerCount = desc.pool ? desc.pool->GetThreadCount() : 1;
+	std::vector<uint64_t> rayCounters(workerCount * 8, 0);
+
+	auto traceTile = [&](uint32_t tile, uint32_t worker)
+	{
+		const uint32_t x0 = (tile % tilesX) * tileSize;
+		const uint32_t y0 = (tile / tilesX) * tileSize;
+		const uint32_t x1 = std::min(x0 + tileSize, desc.Width);
+		const uint32_t y1 = std::min(y0 + tileSize, desc.Height);
+
+		for (uint32_t y = y0; y < y1; y++)
+		{
+			for (uint32_t x = x0; x < x1; x++)
+			{
+				ShaderContext ctx(desc, x, y, &rayCounters[worker * 8]);
+				rayGen.rayGen(ctx);
+			}
+		}
+	};
+
+	if (desc.pool)
+	{
+		ParallelForWorkStealing(*desc.pool, tilesX * tilesY, traceTile);
+	}
+	else
+	{
+		for (uint32_t tile = 0; tile < tilesX * tilesY; tile++)
+			traceTile(tile, 0);
+	}
+
+	DispatchStats stats;
+	for (uint32_t w = 0; w < workerCount; w++)
+		stats.rayCount += rayCounters[w * 8];
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	return stats;
+}
+
+} // namespace CpuRT
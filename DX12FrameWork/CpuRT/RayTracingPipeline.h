@@ -0,0 +1,123 @@
+#pragma once
+
+// Software DispatchRays(): runs ray generation / miss / closest hit "shaders" written in C++
+// against a CpuRT::TopLevelAS, with the same shader-table indexing rules as DXR:
+//
+//		hit group record  = InstanceContributionToHitGroupIndex
+//						  + GeometryIndex * MultiplierForGeometryContributionToHitGroupIndex
+//						  + RayContributionToHitGroupIndex
+//		miss record		  = MissShaderIndex
+//
+// (both relative to the start of the hit-group / miss table, exactly like the offsets
+//  passed in D3D12_DISPATCH_RAYS_DESC). The screen is split into tiles that are traced
+// on all cores with work stealing.
+
+#include "Image.h"
+#include "TopLevelAS.h"
+
+#include <vector>
+
+class ThreadPool;
+
+namespace CpuRT
+{
+
+struct BuiltInTriangleIntersectionAttributes
+{
+	float2 barycentrics;
+};
+
+class ShaderContext;
+typedef void (*RayGenShader)(ShaderContext& ctx);
+typedef void (*MissShader)(ShaderContext& ctx, void* pPayload);
+typedef void (*ClosestHitShader)(ShaderContext& ctx, void* pPayload, const BuiltInTriangleIntersectionAttributes& attribs);
+
+// Program identifier + local root arguments of one shader-table entry
+struct ShaderRecord
+{
+	RayGenShader rayGen = nullptr;
+	MissShader miss = nullptr;
+	ClosestHitShader closestHit = nullptr;		// Hit group with a closest-hit shader only
+	const void* localRootArguments = nullptr;	// e.g. the constant buffer bound through the record
+};
+
+// The three ranges of D3D12_DISPATCH_RAYS_DESC
+struct ShaderTable
+{
+	ShaderRecord rayGeneration;
+	std::vector<ShaderRecord> missShaders;
+	std::vector<ShaderRecord> hitGroups;
+};
+
+struct DispatchRaysDesc
+{
+	const ShaderTable* pShaderTable = nullptr;
+	const TopLevelAS* pScene = nullptr;		// gRtScene
+	Image* pOutput = nullptr;				// gOutput, must be Width x Height
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+
+	// D3D12_RAYTRACING_PIPELINE_CONFIG::MaxTraceRecursionDepth
+	uint32_t maxTraceRecursionDepth = 2;
+	uint32_t tileSize = 16;
+	// nullptr - trace on the calling thread only
+	ThreadPool* pool = nullptr;
+};
+
+struct DispatchStats
+{
+	uint64_t rayCount = 0;		// TraceRay() calls
+	double ms = 0.0;
+
+	double GetMRaysPerSecond() const { return ms > 0.0 ? rayCount / (ms * 1000.0) : 0.0; }
+};
+
+DispatchStats DispatchRays(const DispatchRaysDesc& desc);
+
+// What the HLSL intrinsics return for the shader being executed
+class ShaderContext
+{
+public:
+	ShaderContext(const DispatchRaysDesc& desc, uint32_t x, uint32_t y, uint64_t* pRayCounter)
+		: m_pDesc(&desc), m_LaunchX(x), m_LaunchY(y), m_pRayCounter(pRayCounter) {}
+
+	// Ray generation
+	uint32_t DispatchRaysIndexX() const { return m_LaunchX; }
+	uint32_t DispatchRaysIndexY() const { return m_LaunchY; }
+	uint32_t DispatchRaysDimensionsX() const { return m_pDesc->Width; }
+	uint32_t DispatchRaysDimensionsY() const { return m_pDesc->Height; }
+	Image& GetOutput() const { return *m_pDesc->pOutput; }
+
+	// TraceRay(gRtScene, ...) - the scene is the one of the dispatch
+	void TraceRay(uint32_t rayFlags, uint32_t instanceInclusionMask, uint32_t rayContributionToHitGroupIndex,
+		uint32_t multiplierForGeometryContributionToHitGroupIndex, uint32_t missShaderIndex,
+		const RayDesc& ray, void* pPayload);
+
+	// Hit / miss shaders
+	float RayTCurrent() const { return m_Hit.t; }
+	float RayTMin() const { return m_Ray.TMin; }
+	float3 WorldRayOrigin() const { return m_Ray.Origin; }
+	float3 WorldRayDirection() const { return m_Ray.Direction; }
+	uint32_t InstanceID() const { return m_Hit.instanceID; }
+	uint32_t InstanceIndex() const { return m_Hit.instanceIndex; }
+	uint32_t GeometryIndex() const { return m_Hit.geometryIndex; }
+	uint32_t PrimitiveIndex() const { return m_Hit.primitiveIndex; }
+	uint32_t HitKind() const { return m_Hit.hitKind; }
+
+	// Local root arguments of the record that is executing
+	template<typename T>
+	const T& GetLocalRootArguments() const { return *(const T*)m_pLocalRootArguments; }
+
+private:
+	const DispatchRaysDesc* m_pDesc;
+	uint32_t m_LaunchX;
+	uint32_t m_LaunchY;
+	uint64_t* m_pRayCounter;
+	uint32_t m_RecursionDepth = 0;
+
+	RayDesc m_Ray;
+	HitInfo m_Hit;
+	const void* m_pLocalRootArguments = nullptr;
+};
+
+} // namespace CpuRT
@@ -0,0 +1,90 @@
+#include "SampleScene.h"
+
+#include <algorithm>
+
+namespace CpuRT
+{
+
+const std::vector<float3>& SampleScene::GetTriangleVertices()
+{
+	static const std::vector<float3> vertices =
+	{
+		float3(0,          1,  0),
+		float3(0.866f,  -0.5f, 0),
+		float3(-0.866f, -0.5f, 0),
+	};
+	return vertices;
+}
+
+const std::vector<float3>& SampleScene::GetPlaneVertices()
+{
+	static const std::vector<float3> vertices =
+	{
+		float3(-100, -1,  -2),
+		float3(100, -1,  100),
+		float3(-100, -1,  100),
+
+		float3(-100, -1,  -2),
+		float3(100, -1,  -2),
+		float3(100, -1,  100),
+	};
+	return vertices;
+}
+
+void SampleScene::GetBottomLevelDescs(uint32_t blasIndex, std::vector<GeometryTrianglesDesc>* pOutDescs)
+{
+	const std::vector<float3>* geometries[] = { &GetTriangleVertices(), &GetPlaneVertices() };
+
+	// The first bottom-level AS is for the plane and the triangle, the second one is for the triangle only
+	const uint32_t geometryCount = blasIndex == 0 ? 2 : 1;
+
+	pOutDescs->resize(geometryCount);
+	for (uint32_t i = 0; i < geometryCount; i++)
+	{
+		GeometryTrianglesDesc& desc = (*pOutDescs)[i];
+		desc = GeometryTrianglesDesc();
+		desc.vertexData = geometries[i]->data();
+		desc.vertexStride = sizeof(float3);
+		desc.vertexCount = (uint32_t)geometries[i]->size();
+		desc.opaque = true;
+	}
+}
+
+void SampleScene::CreateGridMesh(uint32_t triangleCount, std::vector<float3>* pOutVertices, std::vector<uint32_t>* pOutIndices)
+{
+	// 2 triangles per quad
+	const uint32_t quadsPerSide = std::max(1u, (uint32_t)std::sqrt(triangleCount / 2.0f));
+	const uint32_t vertsPerSide = quadsPerSide + 1;
+	const float step = 2.0f / quadsPerSide;
+
+	pOutVertices->resize(vertsPerSide * vertsPerSide);
+	for (uint32_t z = 0; z < vertsPerSide; z++)
+	{
+		for (uint32_t x = 0; x < vertsPerSide; x++)
+		{
+			float fx = -1.0f + x * step;
+			float fz = -1.0f + z * step;
+			// A few octaves of waves - keeps the triangles from lying in one plane
+			float fy = 0.1f * std::sin(fx * 7.0f) * std::cos(fz * 5.0f) + 0.02f * std::sin(fx * 41.0f + fz * 37.0f);
+			(*pOutVertices)[z * vertsPerSide + x] = float3(fx, fy, fz);
+		}
+	}
+
+	pOutIndices->clear();
+	pOutIndices->reserve(quadsPerSide * quadsPerSide * 6);
+	for (uint32_t z = 0; z < quadsPerSide; z++)
+	{
+		for (uint32_t x = 0; x < quadsPerSide; x++)
+		{
+			uint32_t i0 = z * vertsPerSide + x;
+			uint32_t i1 = i0 + 1;
+			uint32_t i2 = i0 + vertsPerSide;
+			uint32_t i3 = i2 + 1;
+
+			pOutIndices->push_back(i0); pOutIndices->push_back(i2); pOutIndices->push_back(i1);
+			pOutIndices->push_back(i1); pOutIndices->push_back(i2); pOutIndices->push_back(i3);
+		}
+	}
+}
+
+} // namespace CpuRT
@@ -0,0 +1,27 @@
+#pragma once
+
+// Geometry of the 2_RT_TrianglesRefit sample (CreateTriangleVB / CreatePlaneVB and the
+// BLAS layout of DxrGame::createAccelerationStructures) plus procedural meshes
+// used to benchmark the CPU builders with millions of triangles.
+
+#include "BottomLevelAS.h"
+
+#include <vector>
+
+namespace CpuRT
+{
+
+namespace SampleScene
+{
+	// Same vertices as CreateTriangleVB() / CreatePlaneVB()
+	const std::vector<float3>& GetTriangleVertices();
+	const std::vector<float3>& GetPlaneVertices();
+
+	// BLAS 0 - triangle + plane (2 geometries), BLAS 1 - triangle only
+	void GetBottomLevelDescs(uint32_t blasIndex, std::vector<GeometryTrianglesDesc>* pOutDescs);
+
+	// Displaced grid ("terrain") with roughly 'triangleCount' triangles, indexed with 32-bit indices
+	void CreateGridMesh(uint32_t triangleCount, std::vector<float3>* pOutVertices, std::vector<uint32_t>* pOutIndices);
+}
+
+} // namespace CpuRT
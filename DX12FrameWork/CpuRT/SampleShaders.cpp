@@ -0,0 +1,183 @@
+#include "SampleShaders.h"
+
+namespace CpuRT
+{
+
+namespace
+{
+	struct RayPayload
+	{
+		float3 color;
+	};
+
+	struct ShadowPayload
+	{
+		bool hit;
+	};
+
+	float3 linearToSrgb(const float3& c)
+	{
+		// Based on http://chilliant.blogspot.com/2012/08/srgb-approximations-for-hlsl.html
+		float3 sq1 = sqrt(c);
+		float3 sq2 = sqrt(sq1);
+		float3 sq3 = sqrt(sq2);
+		float3 srgb = 0.662002687f * sq1 + 0.684122060f * sq2 - 0.323583601f * sq3 - 0.0225411470f * c;
+		return srgb;
+	}
+}
+
+// =====================================================================================
+//										Shaders
+// =====================================================================================
+
+void SampleShaders::rayGen(ShaderContext& ctx)
+{
+	float2 crd = float2((float)ctx.DispatchRaysIndexX(), (float)ctx.DispatchRaysIndexY());
+	float2 dims = float2((float)ctx.DispatchRaysDimensionsX(), (float)ctx.DispatchRaysDimensionsY());
+
+	float2 d = float2(crd.x / dims.x * 2.f - 1.f, crd.y / dims.y * 2.f - 1.f);
+	float aspectRatio = dims.x / dims.y;
+
+	RayDesc ray;
+	ray.Origin = float3(0, 0, -2);
+	ray.Direction = normalize(float3(d.x * aspectRatio, -d.y, 1));
+
+	ray.TMin = 0;
+	ray.TMax = 100000;
+
+	RayPayload payload;
+
+	// Primary ray: hit group = InstanceContribution + GeometryIndex * 2 + 0, miss shader 0
+	ctx.TraceRay(RAY_FLAG_NONE, 0xFF, 0 /* ray index*/, 2, 0, ray, &payload);
+	float3 col = linearToSrgb(payload.color);
+	ctx.GetOutput().Store(ctx.DispatchRaysIndexX(), ctx.DispatchRaysIndexY(), float4(col, 1));
+}
+
+void SampleShaders::miss(ShaderContext& /*ctx*/, void* pPayload)
+{
+	RayPayload& payload = *(RayPayload*)pPayload;
+	payload.color = float3(0.4f, 0.6f, 0.2f);
+}
+
+void SampleShaders::triangleChs(ShaderContext& ctx, void* pPayload, const BuiltInTriangleIntersectionAttributes& attribs)
+{
+	RayPayload& payload = *(RayPayload*)pPayload;
+	const PerFrame& cb = ctx.GetLocalRootArguments<PerFrame>();
+
+	float3 barycentrics = float3(1.0f - attribs.barycentrics.x - attribs.barycentrics.y, attribs.barycentrics.x, attribs.barycentrics.y);
+	payload.color = cb.A * barycentrics.x + cb.B * barycentrics.y + cb.C * barycentrics.z;
+}
+
+void SampleShaders::planeChs(ShaderContext& ctx, void* pPayload, const BuiltInTriangleIntersectionAttributes& /*attribs*/)
+{
+	RayPayload& payload = *(RayPayload*)pPayload;
+
+	float hitT = ctx.RayTCurrent();
+	float3 rayDirW = ctx.WorldRayDirection();
+	float3 rayOriginW = ctx.WorldRayOrigin();
+
+	// Find the world-space hit position
+	float3 posW = rayOriginW + hitT * rayDirW;
+
+	// Fire a shadow ray. The direction is hard-coded here, but can be fetched from a constant-buffer
+	RayDesc ray;
+	ray.Origin = posW;
+	ray.Direction = normalize(float3(0.5f, 0.5f, -0.5f));
+	ray.TMin = 0.01f;
+	ray.TMax = 100000;
+	ShadowPayload shadowPayload;
+
+	// Shadow ray: hit group = InstanceContribution + 1, miss shader 1
+	ctx.TraceRay(RAY_FLAG_NONE, 0xFF, 1 /* ray index*/, 0, 1, ray, &shadowPayload);
+
+	float factor = shadowPayload.hit ? 0.1f : 1.0f;
+	payload.color = float3(0.9f, 0.9f, 0.9f) * factor;
+}
+
+void SampleShaders::shadowChs(ShaderContext& /*ctx*/, void* pPayload, const BuiltInTriangleIntersectionAttributes& /*attribs*/)
+{
+	ShadowPayload& payload = *(ShadowPayload*)pPayload;
+	payload.hit = true;
+}
+
+void SampleShaders::shadowMiss(ShaderContext& /*ctx*/, void* pPayload)
+{
+	ShadowPayload& payload = *(ShadowPayload*)pPayload;
+	payload.hit = false;
+}
+
+// =====================================================================================
+//								Shader table & instances
+// =====================================================================================
+
+const SampleShaders::PerFrame* SampleShaders::GetConstantBuffers()
+{
+	static const PerFrame constantBuffers[3] =
+	{
+		// Instance 0
+		{ float3(1.0f, 0.0f, 0.0f), float3(1.0f, 1.0f, 0.0f), float3(1.0f, 0.0f, 1.0f) },
+		// Instance 1
+		{ float3(0.0f, 1.0f, 0.0f), float3(0.0f, 1.0f, 1.0f), float3(1.0f, 1.0f, 0.0f) },
+		// Instance 2
+		{ float3(0.0f, 0.0f, 1.0f), float3(1.0f, 0.0f, 1.0f), float3(0.0f, 1.0f, 1.0f) },
+	};
+	return constantBuffers;
+}
+
+void SampleShaders::CreateShaderTable(ShaderTable* pOutTable)
+{
+	*pOutTable = ShaderTable();
+
+	// Entry 0 - ray-gen program
+	pOutTable->rayGeneration.rayGen = rayGen;
+
+	// Entries 1, 2 - primary ray miss, shadow-ray miss
+	pOutTable->missShaders.resize(2);
+	pOutTable->missShaders[0].miss = miss;
+	pOutTable->missShaders[1].miss = shadowMiss;
+
+	// Entries 3..10 - hit programs, primary followed by shadow
+	pOutTable->hitGroups.resize(8);
+	ShaderRecord* hit = pOutTable->hitGroups.data();
+
+	// Triangle 0
+	hit[0].closestHit = triangleChs;
+	hit[0].localRootArguments = &GetConstantBuffers()[0];
+	hit[1].closestHit = shadowChs;
+	// Plane
+	hit[2].closestHit = planeChs;
+	hit[3].closestHit = shadowChs;
+	// Triangle 1
+	hit[4].closestHit = triangleChs;
+	hit[4].localRootArguments = &GetConstantBuffers()[1];
+	hit[5].closestHit = shadowChs;
+	// Triangle 2
+	hit[6].closestHit = triangleChs;
+	hit[6].localRootArguments = &GetConstantBuffers()[2];
+	hit[7].closestHit = shadowChs;
+}
+
+void SampleShaders::CreateInstanceDescs(float rotationDegrees, const BottomLevelAS* pBlas0, const BottomLevelAS* pBlas1, InstanceDesc outInstances[3])
+{
+	const float angle = rotationDegrees * 3.14159265358979f / 180.0f;
+
+	outInstances[0] = InstanceDesc();
+	outInstances[0].Transform = float3x4::Identity();
+	outInstances[0].InstanceID = 0;
+	outInstances[0].InstanceContributionToHitGroupIndex = 0;
+	outInstances[0].InstanceMask = 0xFF;
+	outInstances[0].AccelerationStructure = pBlas0;
+
+	for (uint32_t i = 1; i < 3; i++)
+	{
+		outInstances[i] = InstanceDesc();
+		outInstances[i].Transform = float3x4::RotationYTranslation(angle, float3(i == 1 ? -2.0f : 2.0f, 0, 0));
+		outInstances[i].InstanceID = i;
+		// The indices are relative to the start of the hit-table entries, so we need 4 and 6
+		outInstances[i].InstanceContributionToHitGroupIndex = (i * 2) + 2;
+		outInstances[i].InstanceMask = 0xFF;
+		outInstances[i].AccelerationStructure = pBlas1;
+	}
+}
+
+} // namespace CpuRT
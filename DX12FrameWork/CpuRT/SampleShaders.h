@@ -0,0 +1,42 @@
+#pragma once
+
+// C++ port of 2_RT_TrianglesRefit/Shaders/14-Shaders.hlsl plus the shader table,
+// constant buffers and instance descs DxrGame sets up for it
+// (createShaderTable, createConstantBuffers, BuildTopLevelAS).
+// Keep it in sync with the HLSL - it is the reference the GPU output is compared against.
+
+#include "RayTracingPipeline.h"
+
+namespace CpuRT
+{
+
+namespace SampleShaders
+{
+	// cbuffer PerFrame : register(b0) - bound through the triangle hit-group records
+	struct PerFrame
+	{
+		float3 A;
+		float3 B;
+		float3 C;
+	};
+
+	void rayGen(ShaderContext& ctx);
+	void miss(ShaderContext& ctx, void* pPayload);
+	void triangleChs(ShaderContext& ctx, void* pPayload, const BuiltInTriangleIntersectionAttributes& attribs);
+	void planeChs(ShaderContext& ctx, void* pPayload, const BuiltInTriangleIntersectionAttributes& attribs);
+	void shadowChs(ShaderContext& ctx, void* pPayload, const BuiltInTriangleIntersectionAttributes& attribs);
+	void shadowMiss(ShaderContext& ctx, void* pPayload);
+
+	// Constant buffers of the 3 instances, as filled by DxrGame::createConstantBuffers()
+	const PerFrame* GetConstantBuffers();
+
+	// Same layout as DxrGame::createShaderTable():
+	//		ray-gen | 2 miss (primary, shadow) | 8 hit groups (triangle 0, plane, triangle 1, triangle 2; primary + shadow each)
+	void CreateShaderTable(ShaderTable* pOutTable);
+
+	// The 3 instances of BuildTopLevelAS(): BLAS 0 at the origin, BLAS 1 rotated by 'rotationDegrees'
+	// about Y and moved to x = -2 / +2
+	void CreateInstanceDescs(float rotationDegrees, const BottomLevelAS* pBlas0, const BottomLevelAS* pBlas1, InstanceDesc outInstances[3]);
+}
+
+} // namespace CpuRT
@@ -0,0 +1,308 @@
+#pragma once
+
+// SIMD wrapper for the packet code of the CPU ray tracer: one vfloat holds the same
+// quantity for kSimdWidth rays (structure of arrays).
+//
+//		AVX / AVX2 (/arch:AVX2, -mavx2)	- 8 lanes
+//		SSE2 (any x86 / x64 build)		- 4 lanes
+//		anything else					- 1 lane, plain floats
+//
+// The width is a compile-time choice, so the packet code is written once against vfloat/vmask.
+// vfloat4/vmask4 are always 4 lanes wide (one ray against the 4 children of a BVH4 node).
+// LoadBytes() widens unsigned bytes to float lanes (the quantized child bounds of a BVH8 node).
+
+#include "CpuRTMath.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__) || defined(__AVX2__)
+	#define CPURT_SIMD_AVX 1
+	#include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CPURT_SIMD_SSE 1
+	#include <emmintrin.h>
+#else
+	#define CPURT_SIMD_SCALAR 1
+#endif
+
+namespace CpuRT
+{
+
+#if defined(CPURT_SIMD_AVX)
+
+static const uint32_t kSimdWidth = 8;
+
+struct vmask
+{
+	__m256 m;
+
+	vmask() {}
+	explicit vmask(__m256 m_) : m(m_) {}
+	explicit vmask(bool b) : m(_mm256_castsi256_ps(_mm256_set1_epi32(b ? -1 : 0))) {}
+};
+
+struct vfloat
+{
+	__m256 v;
+
+	vfloat() {}
+	explicit vfloat(__m256 v_) : v(v_) {}
+	vfloat(float s) : v(_mm256_set1_ps(s)) {}
+
+	static vfloat Load(const float* p) { return vfloat(_mm256_loadu_ps(p)); }
+	static vfloat LoadBytes(const uint8_t* p)
+	{
+		// AVX has no 256-bit integer unpack - two SSE4.1 halves
+		const __m128i bytes = _mm_loadl_epi64((const __m128i*)p);
+		const __m128i lo = _mm_cvtepu8_epi32(bytes), hi = _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4));
+		return vfloat(_mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1)));
+	}
+	void Store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline vfloat operator+(const vfloat& a, const vfloat& b) { return vfloat(_mm256_add_ps(a.v, b.v)); }
+inline vfloat operator-(const vfloat& a, const vfloat& b) { return vfloat(_mm256_sub_ps(a.v, b.v)); }
+inline vfloat operator*(const vfloat& a, const vfloat& b) { return vfloat(_mm256_mul_ps(a.v, b.v)); }
+inline vfloat operator/(const vfloat& a, const vfloat& b) { return vfloat(_mm256_div_ps(a.v, b.v)); }
+inline vfloat Min(const vfloat& a, const vfloat& b) { return vfloat(_mm256_min_ps(a.v, b.v)); }
+inline vfloat Max(const vfloat& a, const vfloat& b) { return vfloat(_mm256_max_ps(a.v, b.v)); }
+
+inline vmask operator<(const vfloat& a, const vfloat& b) { return vmask(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+inline vmask operator<=(const vfloat& a, const vfloat& b) { return vmask(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+inline vmask operator>(const vfloat& a, const vfloat& b) { return vmask(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+inline vmask operator>=(const vfloat& a, const vfloat& b) { return vmask(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+inline vmask operator!=(const vfloat& a, const vfloat& b) { return vmask(_mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ)); }
+
+inline vmask operator&(const vmask& a, const vmask& b) { return vmask(_mm256_and_ps(a.m, b.m)); }
+inline vmask operator|(const vmask& a, const vmask& b) { return vmask(_mm256_or_ps(a.m, b.m)); }
+// a & ~b
+inline vmask AndNot(const vmask& a, const vmask& b) { return vmask(_mm256_andnot_ps(b.m, a.m)); }
+
+// Lane i of the result is 'a' where the mask is set, 'b' elsewhere
+inline vfloat Select(const vmask& m, const vfloat& a, const vfloat& b) { return vfloat(_mm256_blendv_ps(b.v, a.v, m.m)); }
+// Bit i set <=> lane i set
+inline uint32_t MoveMask(const vmask& m) { return (uint32_t)_mm256_movemask_ps(m.m); }
+
+struct vmask4
+{
+	__m128 m;
+
+	vmask4() {}
+	explicit vmask4(__m128 m_) : m(m_) {}
+};
+
+struct vfloat4
+{
+	__m128 v;
+
+	vfloat4() {}
+	explicit vfloat4(__m128 v_) : v(v_) {}
+	vfloat4(float s) : v(_mm_set1_ps(s)) {}
+
+	static vfloat4 Load(const float* p) { return vfloat4(_mm_loadu_ps(p)); }
+	static vfloat4 LoadBytes(const uint8_t* p)
+	{
+		int32_t bytes;
+		memcpy(&bytes, p, sizeof(bytes));
+		return vfloat4(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes))));
+	}
+	void Store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline vfloat4 operator+(const vfloat4& a, const vfloat4& b) { return vfloat4(_mm_add_ps(a.v, b.v)); }
+inline vfloat4 operator-(const vfloat4& a, const vfloat4& b) { return vfloat4(_mm_sub_ps(a.v, b.v)); }
+inline vfloat4 operator*(const vfloat4& a, const vfloat4& b) { return vfloat4(_mm_mul_ps(a.v, b.v)); }
+inline vfloat4 Min(const vfloat4& a, const vfloat4& b) { return vfloat4(_mm_min_ps(a.v, b.v)); }
+inline vfloat4 Max(const vfloat4& a, const vfloat4& b) { return vfloat4(_mm_max_ps(a.v, b.v)); }
+inline vmask4 operator<=(const vfloat4& a, const vfloat4& b) { return vmask4(_mm_cmple_ps(a.v, b.v)); }
+inline vmask4 operator>=(const vfloat4& a, const vfloat4& b) { return vmask4(_mm_cmpge_ps(a.v, b.v)); }
+inline vmask4 operator&(const vmask4& a, const vmask4& b) { return vmask4(_mm_and_ps(a.m, b.m)); }
+inline uint32_t MoveMask(const vmask4& m) { return (uint32_t)_mm_movemask_ps(m.m); }
+
+#elif defined(CPURT_SIMD_SSE)
+
+static const uint32_t kSimdWidth = 4;
+
+struct vmask
+{
+	__m128 m;
+
+	vmask() {}
+	explicit vmask(__m128 m_) : m(m_) {}
+	explicit vmask(bool b) : m(_mm_castsi128_ps(_mm_set1_epi32(b ? -1 : 0))) {}
+};
+
+struct vfloat
+{
+	__m128 v;
+
+	vfloat() {}
+	explicit vfloat(__m128 v_) : v(v_) {}
+	vfloat(float s) : v(_mm_set1_ps(s)) {}
+
+	static vfloat Load(const float* p) { return vfloat(_mm_loadu_ps(p)); }
+	static vfloat LoadBytes(const uint8_t* p)
+	{
+		// SSE2 has no pmovzx - unpack against zero twice
+		int32_t bytes;
+		memcpy(&bytes, p, sizeof(bytes));
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+		return vfloat(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)));
+	}
+	void Store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline vfloat operator+(const vfloat& a, const vfloat& b) { return vfloat(_mm_add_ps(a.v, b.v)); }
+inline vfloat operator-(const vfloat& a, const vfloat& b) { return vfloat(_mm_sub_ps(a.v, b.v)); }
+inline vfloat operator*(const vfloat& a, const vfloat& b) { return vfloat(_mm_mul_ps(a.v, b.v)); }
+inline vfloat operator/(const vfloat& a, const vfloat& b) { return vfloat(_mm_div_ps(a.v, b.v)); }
+inline vfloat Min(const vfloat& a, const vfloat& b) { return vfloat(_mm_min_ps(a.v, b.v)); }
+inline vfloat Max(const vfloat& a, const vfloat& b) { return vfloat(_mm_max_ps(a.v, b.v)); }
+
+inline vmask operator<(const vfloat& a, const vfloat& b) { return vmask(_mm_cmplt_ps(a.v, b.v)); }
+inline vmask operator<=(const vfloat& a, const vfloat& b) { return vmask(_mm_cmple_ps(a.v, b.v)); }
+inline vmask operator>(const vfloat& a, const vfloat& b) { return vmask(_mm_cmpgt_ps(a.v, b.v)); }
+inline vmask operator>=(const vfloat& a, const vfloat& b) { return vmask(_mm_cmpge_ps(a.v, b.v)); }
+inline vmask operator!=(const vfloat& a, const vfloat& b) { return vmask(_mm_cmpneq_ps(a.v, b.v)); }
+
+inline vmask operator&(const vmask& a, const vmask& b) { return vmask(_mm_and_ps(a.m, b.m)); }
+inline vmask operator|(const vmask& a, const vmask& b) { return vmask(_mm_or_ps(a.m, b.m)); }
+inline vmask AndNot(const vmask& a, const vmask& b) { return vmask(_mm_andnot_ps(b.m, a.m)); }
+
+// SSE2 has no blendv
+inline vfloat Select(const vmask& m, const vfloat& a, const vfloat& b)
+{
+	return vfloat(_mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)));
+}
+inline uint32_t MoveMask(const vmask& m) { return (uint32_t)_mm_movemask_ps(m.m); }
+
+typedef vfloat vfloat4;
+typedef vmask vmask4;
+
+#else
+
+static const uint32_t kSimdWidth = 1;
+
+struct vmask
+{
+	bool m;
+
+	vmask() {}
+	explicit vmask(bool b) : m(b) {}
+};
+
+struct vfloat
+{
+	float v;
+
+	vfloat() {}
+	vfloat(float s) : v(s) {}
+
+	static vfloat Load(const float* p) { return vfloat(*p); }
+	static vfloat LoadBytes(const uint8_t* p) { return vfloat((float)*p); }
+	void Store(float* p) const { *p = v; }
+};
+
+inline vfloat operator+(const vfloat& a, const vfloat& b) { return vfloat(a.v + b.v); }
+inline vfloat operator-(const vfloat& a, const vfloat& b) { return vfloat(a.v - b.v); }
+inline vfloat operator*(const vfloat& a, const vfloat& b) { return vfloat(a.v * b.v); }
+inline vfloat operator/(const vfloat& a, const vfloat& b) { return vfloat(a.v / b.v); }
+inline vfloat Min(const vfloat& a, const vfloat& b) { return vfloat(a.v < b.v ? a.v : b.v); }
+inline vfloat Max(const vfloat& a, const vfloat& b) { return vfloat(a.v > b.v ? a.v : b.v); }
+
+inline vmask operator<(const vfloat& a, const vfloat& b) { return vmask(a.v < b.v); }
+inline vmask operator<=(const vfloat& a, const vfloat& b) { return vmask(a.v <= b.v); }
+inline vmask operator>(const vfloat& a, const vfloat& b) { return vmask(a.v > b.v); }
+inline vmask operator>=(const vfloat& a, const vfloat& b) { return vmask(a.v >= b.v); }
+inline vmask operator!=(const vfloat& a, const vfloat& b) { return vmask(a.v != b.v); }
+
+inline vmask operator&(const vmask& a, const vmask& b) { return vmask(a.m && b.m); }
+inline vmask operator|(const vmask& a, const vmask& b) { return vmask(a.m || b.m); }
+inline vmask AndNot(const vmask& a, const vmask& b) { return vmask(a.m && !b.m); }
+
+inline vfloat Select(const vmask& m, const vfloat& a, const vfloat& b) { return m.m ? a : b; }
+inline uint32_t MoveMask(const vmask& m) { return m.m ? 1u : 0u; }
+
+struct vmask4
+{
+	bool m[4];
+};
+
+struct vfloat4
+{
+	float v[4];
+
+	vfloat4() {}
+	vfloat4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+
+	static vfloat4 Load(const float* p) { vfloat4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+	static vfloat4 LoadBytes(const uint8_t* p) { vfloat4 r; for (int i = 0; i < 4; i++) r.v[i] = (float)p[i]; return r; }
+	void Store(float* p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+};
+
+inline vfloat4 operator+(const vfloat4& a, const vfloat4& b) { vfloat4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+inline vfloat4 operator-(const vfloat4& a, const vfloat4& b) { vfloat4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] - b.v[i]; return r; }
+inline vfloat4 operator*(const vfloat4& a, const vfloat4& b) { vfloat4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] * b.v[i]; return r; }
+inline vfloat4 Min(const vfloat4& a, const vfloat4& b) { vfloat4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline vfloat4 Max(const vfloat4& a, const vfloat4& b) { vfloat4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline vmask4 operator<=(const vfloat4& a, const vfloat4& b) { vmask4 r; for (int i = 0; i < 4; i++) r.m[i] = a.v[i] <= b.v[i]; return r; }
+inline vmask4 operator>=(const vfloat4& a, const vfloat4& b) { vmask4 r; for (int i = 0; i < 4; i++) r.m[i] = a.v[i] >= b.v[i]; return r; }
+inline vmask4 operator&(const vmask4& a, const vmask4& b) { vmask4 r; for (int i = 0; i < 4; i++) r.m[i] = a.m[i] && b.m[i]; return r; }
+inline uint32_t MoveMask(const vmask4& m) { return (m.m[0] ? 1u : 0u) | (m.m[1] ? 2u : 0u) | (m.m[2] ? 4u : 0u) | (m.m[3] ? 8u : 0u); }
+
+#endif
+
+inline bool Any(const vmask& m) { return MoveMask(m) != 0; }
+inline bool None(const vmask& m) { return MoveMask(m) == 0; }
+
+// Lane i, for the scalar bookkeeping around a packet
+inline float GetLane(const vfloat& a, uint32_t lane)
+{
+	float lanes[kSimdWidth];
+	a.Store(lanes);
+	return lanes[lane];
+}
+
+inline float ReduceMin(const vfloat& a)
+{
+	float lanes[kSimdWidth];
+	a.Store(lanes);
+	float m = lanes[0];
+	for (uint32_t i = 1; i < kSimdWidth; i++)
+		m = lanes[i] < m ? lanes[i] : m;
+	return m;
+}
+
+// Index of the lowest set bit, bits != 0
+inline uint32_t FirstBit(uint32_t bits)
+{
+	uint32_t i = 0;
+	while ((bits & 1u) == 0)
+	{
+		bits >>= 1;
+		i++;
+	}
+	return i;
+}
+
+struct vfloat3
+{
+	vfloat x, y, z;
+
+	vfloat3() {}
+	vfloat3(const vfloat& x_, const vfloat& y_, const vfloat& z_) : x(x_), y(y_), z(z_) {}
+	// Broadcast
+	vfloat3(const float3& s) : x(s.x), y(s.y), z(s.z) {}
+};
+
+inline vfloat3 operator+(const vfloat3& a, const vfloat3& b) { return vfloat3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline vfloat3 operator-(const vfloat3& a, const vfloat3& b) { return vfloat3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline vfloat dot(const vfloat3& a, const vfloat3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline vfloat3 cross(const vfloat3& a, const vfloat3& b)
+{
+	return vfloat3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+} // namespace CpuRT
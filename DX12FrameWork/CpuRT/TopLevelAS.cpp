@@ -0,0 +1,157 @@
+#include "TopLevelAS.h"
+#include "../Utils/ThreadPool.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace CpuRT
+{
+
+// =====================================================================================
+//										Build
+// =====================================================================================
+
+void TopLevelAS::Build(const InstanceDesc* instances, uint32_t instanceCount, const BvhBuildSettings& settings)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	m_Instances.resize(instanceCount);
+	m_InstanceBounds.resize(instanceCount);
+
+	auto prepareInstances = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			Instance& instance = m_Instances[i];
+			instance.desc = instances[i];
+			instance.worldToObject = instances[i].Transform.Inverse();
+
+			// Instances without a BLAS stay in the array (InstanceIndex() must not shift) but are never hit
+			const BottomLevelAS* pBlas = instances[i].AccelerationStructure;
+			m_InstanceBounds[i] = pBlas ? instances[i].Transform.TransformAabb(pBlas->GetBounds()) : Aabb();
+		}
+	};
+
+	if (settings.pool)
+		ParallelFor(*settings.pool, 0, instanceCount, 4096, prepareInstances);
+	else
+		prepareInstances(0, instanceCount);
+
+	// One instance per leaf: every leaf primitive costs a full BLAS traversal
+	BvhBuildSettings tlasSettings = settings;
+	tlasSettings.maxLeafSize = 1;
+	tlasSettings.branchingFactor = 2;
+	m_Bvh.Build(m_InstanceBounds.data(), instanceCount, tlasSettings);
+
+	m_LastBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void TopLevelAS::Build(const D3D12InstanceDesc* instances, uint32_t instanceCount,
+	const std::function<const BottomLevelAS*(uint64_t gpuAddress)>& resolveBlas, const BvhBuildSettings& settings)
+{
+	std::vector<InstanceDesc> descs(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		memcpy(descs[i].Transform.m, instances[i].Transform, sizeof(descs[i].Transform.m));
+		descs[i].InstanceID = instances[i].InstanceID;
+		descs[i].InstanceMask = instances[i].InstanceMask;
+		descs[i].InstanceContributionToHitGroupIndex = instances[i].InstanceContributionToHitGroupIndex;
+		descs[i].Flags = instances[i].Flags;
+		descs[i].AccelerationStructure = resolveBlas(instances[i].AccelerationStructure);
+	}
+	Build(descs.data(), instanceCount, settings);
+}
+
+// =====================================================================================
+//										Traversal
+// =====================================================================================
+
+uint32_t TopLevelAS::GetObjectRayFlags(const Instance& instance, uint32_t rayFlags)
+{
+	const uint32_t cullFlags = RAY_FLAG_CULL_BACK_FACING_TRIANGLES | RAY_FLAG_CULL_FRONT_FACING_TRIANGLES;
+	if (instance.desc.Flags & INSTANCE_FLAG_TRIANGLE_CULL_DISABLE)
+		return rayFlags & ~cullFlags;
+
+	// The BLAS tests facing with the clockwise convention - swap what "front" means
+	if ((instance.desc.Flags & INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE) && (rayFlags & cullFlags) != 0 && (rayFlags & cullFlags) != cullFlags)
+		return rayFlags ^ cullFlags;
+
+	return rayFlags;
+}
+
+void TopLevelAS::ApplyInstance(const Instance& instance, uint32_t instanceIndex, HitInfo* pHit)
+{
+	pHit->instanceIndex = instanceIndex;
+	pHit->instanceID = instance.desc.InstanceID;
+	pHit->instanceContribution = instance.desc.InstanceContributionToHitGroupIndex;
+
+	if (instance.desc.Flags & INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE)
+		pHit->hitKind = pHit->hitKind == HIT_KIND_TRIANGLE_FRONT_FACE ? HIT_KIND_TRIANGLE_BACK_FACE : HIT_KIND_TRIANGLE_FRONT_FACE;
+}
+
+bool TopLevelAS::Intersect(const RayDesc& ray, uint32_t rayFlags, uint32_t instanceInclusionMask, HitInfo* pHit) const
+{
+	float tmax = ray.TMax;
+	bool hit = false;
+	const bool acceptFirstHit = (rayFlags & RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH) != 0;
+	const TraversalRay worldRay(ray.Origin, ray.Direction, ray.TMin, rayFlags);
+
+	m_Bvh.Traverse(worldRay, tmax, [&](uint32_t i, float& t)
+	{
+		const Instance& instance = m_Instances[i];
+		if ((instance.desc.InstanceMask & instanceInclusionMask) == 0 || !instance.desc.AccelerationStructure)
+			return false;
+
+		// ObjectRayOrigin() / ObjectRayDirection()
+		TraversalRay objectRay(
+			instance.worldToObject.TransformPoint(ray.Origin),
+			instance.worldToObject.TransformVector(ray.Direction),
+			ray.TMin, GetObjectRayFlags(instance, rayFlags));
+
+		if (!instance.desc.AccelerationStructure->Intersect(objectRay, t, pHit))
+			return false;
+
+		hit = true;
+		ApplyInstance(instance, i, pHit);
+		return acceptFirstHit;
+	});
+
+	return hit;
+}
+
+uint32_t TopLevelAS::IntersectPacket(const RayDesc* rays, uint32_t rayCount, uint32_t rayFlags, uint32_t instanceInclusionMask, HitInfo* pHits) const
+{
+	vmask active;
+	vfloat tmax;
+	const RayPacket worldPacket = RayPacket::FromRays(rays, rayCount, rayFlags, &active, &tmax);
+
+	HitInfo laneHits[kSimdWidth];
+	vmask hits(false);
+
+	m_Bvh.TraversePacket(worldPacket, tmax, active, [&](uint32_t i, vfloat& t, vmask& activeLanes)
+	{
+		const Instance& instance = m_Instances[i];
+		if ((instance.desc.InstanceMask & instanceInclusionMask) == 0 || !instance.desc.AccelerationStructure)
+			return;
+
+		RayPacket objectPacket = worldPacket.Transformed(instance.worldToObject);
+		objectPacket.flags = GetObjectRayFlags(instance, rayFlags);
+		const vmask instanceHits = instance.desc.AccelerationStructure->IntersectPacket(objectPacket, t, activeLanes, laneHits);
+
+		uint32_t hitBits = MoveMask(instanceHits);
+		hits = hits | instanceHits;
+		while (hitBits)
+		{
+			const uint32_t lane = FirstBit(hitBits);
+			hitBits &= hitBits - 1;
+			ApplyInstance(instance, i, &laneHits[lane]);
+		}
+	});
+
+	const uint32_t hitBits = MoveMask(hits) & ((1u << rayCount) - 1);
+	for (uint32_t lane = 0; lane < rayCount; lane++)
+		pHits[lane] = laneHits[lane];
+	return hitBits;
+}
+
+} // namespace CpuRT
@@ -0,0 +1,95 @@
+#pragma once
+
+// CPU counterpart of a DXR top-level acceleration structure: a BVH over the world bounds
+// of the instances. Rays are transformed into the space of every instance they reach and
+// traverse its BLAS there, so any number of instances share one copy of the geometry.
+
+#include "BottomLevelAS.h"
+
+#include <functional>
+#include <vector>
+
+namespace CpuRT
+{
+
+// D3D12_RAYTRACING_INSTANCE_FLAGS
+enum InstanceFlags : uint32_t
+{
+	INSTANCE_FLAG_NONE								= 0x0,
+	INSTANCE_FLAG_TRIANGLE_CULL_DISABLE				= 0x1,
+	INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE	= 0x2,
+	INSTANCE_FLAG_FORCE_OPAQUE						= 0x4,
+	INSTANCE_FLAG_FORCE_NON_OPAQUE					= 0x8,
+};
+
+// D3D12_RAYTRACING_INSTANCE_DESC with a CPU pointer instead of the BLAS GPU virtual address
+struct InstanceDesc
+{
+	float3x4 Transform = float3x4::Identity();
+	uint32_t InstanceID = 0;								// 24 bits on the GPU
+	uint32_t InstanceMask = 0xFF;							// 8 bits
+	uint32_t InstanceContributionToHitGroupIndex = 0;		// 24 bits
+	uint32_t Flags = 0;										// InstanceFlags
+	const BottomLevelAS* AccelerationStructure = nullptr;
+};
+
+// Bit-exact copy of D3D12_RAYTRACING_INSTANCE_DESC, so the buffer BuildTopLevelAS() writes
+// for the GPU can be handed to the CPU TLAS as it is (d3d12.h can't be included here)
+struct D3D12InstanceDesc
+{
+	float Transform[3][4];
+	uint32_t InstanceID : 24;
+	uint32_t InstanceMask : 8;
+	uint32_t InstanceContributionToHitGroupIndex : 24;
+	uint32_t Flags : 8;
+	uint64_t AccelerationStructure;		// D3D12_GPU_VIRTUAL_ADDRESS
+};
+static_assert(sizeof(D3D12InstanceDesc) == 64, "Must match D3D12_RAYTRACING_INSTANCE_DESC");
+
+class TopLevelAS
+{
+public:
+	// BuildRaytracingAccelerationStructure() for D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL.
+	// The BLASes are referenced, not copied - they must outlive the TLAS.
+	// Instances are cheap to rebuild: call it again whenever a transform changes.
+	void Build(const InstanceDesc* instances, uint32_t instanceCount, const BvhBuildSettings& settings = BvhBuildSettings());
+
+	// The same from the GPU instance descs. resolveBlas maps the AccelerationStructure
+	// GPU address of every desc to the matching CPU BLAS.
+	void Build(const D3D12InstanceDesc* instances, uint32_t instanceCount,
+		const std::function<const BottomLevelAS*(uint64_t gpuAddress)>& resolveBlas,
+		const BvhBuildSettings& settings = BvhBuildSettings());
+
+	// Closest hit over all instances whose InstanceMask & instanceInclusionMask != 0.
+	// Fills every field of pHit; t is the same in world and object space (the ray direction
+	// is transformed, not normalized).
+	bool Intersect(const RayDesc& ray, uint32_t rayFlags, uint32_t instanceInclusionMask, HitInfo* pHit) const;
+
+	// Intersect() for up to kSimdWidth coherent rays traced as one packet.
+	// pHits[i] receives the result of rays[i]; returns a bit per ray that hit something.
+	uint32_t IntersectPacket(const RayDesc* rays, uint32_t rayCount, uint32_t rayFlags, uint32_t instanceInclusionMask, HitInfo* pHits) const;
+
+	uint32_t GetInstanceCount() const { return (uint32_t)m_Instances.size(); }
+	const InstanceDesc& GetInstance(uint32_t index) const { return m_Instances[index].desc; }
+	const Bvh& GetBvh() const { return m_Bvh; }
+	double GetLastBuildMs() const { return m_LastBuildMs; }
+
+private:
+	struct Instance
+	{
+		InstanceDesc desc;
+		float3x4 worldToObject;
+	};
+
+	// RAY_FLAG_CULL_* as seen by the BLAS of the instance
+	static uint32_t GetObjectRayFlags(const Instance& instance, uint32_t rayFlags);
+	static void ApplyInstance(const Instance& instance, uint32_t instanceIndex, HitInfo* pHit);
+
+	std::vector<Instance> m_Instances;
+	// World bounds of the instances, the primitives of m_Bvh
+	std::vector<Aabb> m_InstanceBounds;
+	Bvh m_Bvh;
+	double m_LastBuildMs = 0.0;
+};
+
+} // namespace CpuRT
@@ -0,0 +1,209 @@
+#include "WideBvh.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace CpuRT
+{
+
+namespace
+{
+	// bounds[N]: the children of the node, empty Aabbs for unused slots
+	template<uint32_t N>
+	void SetNodeBounds(WideBvhNode<N>& node, const Aabb* bounds)
+	{
+		for (uint32_t slot = 0; slot < N; slot++)
+		{
+			node.bminX[slot] = bounds[slot].bmin.x; node.bminY[slot] = bounds[slot].bmin.y; node.bminZ[slot] = bounds[slot].bmin.z;
+			node.bmaxX[slot] = bounds[slot].bmax.x; node.bmaxY[slot] = bounds[slot].bmax.y; node.bmaxZ[slot] = bounds[slot].bmax.z;
+		}
+	}
+
+	void SetNodeBounds(WideBvhNode<8>& node, const Aabb* bounds)
+	{
+		typedef WideBvhNode<8> Node;
+
+		Aabb nodeBounds;
+		for (uint32_t slot = 0; slot < 8; slot++)
+			if (!bounds[slot].IsEmpty())
+				nodeBounds.Grow(bounds[slot]);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// Smallest power of two step with which 255 steps from the origin cover the node
+			const float origin = nodeBounds.bmin[axis];
+			const float extent = nodeBounds.bmax[axis] - origin;
+			int exponent = -126;
+			if (extent > 0.0f)
+				std::frexp(extent / 255.0f, &exponent);
+			exponent = std::min(std::max(exponent, -126), 127);
+			while (exponent < 127 && origin + 255.0f * Node::GridStep(exponent) < nodeBounds.bmax[axis])
+				exponent++;
+			const float step = Node::GridStep(exponent);
+
+			node.origin[axis] = origin;
+			node.exponent[axis] = (int8_t)exponent;
+			for (uint32_t slot = 0; slot < 8; slot++)
+			{
+				if (bounds[slot].IsEmpty())
+				{
+					node.qmin[axis][slot] = 255;
+					node.qmax[axis][slot] = 0;
+					continue;
+				}
+
+				// Round outwards, checked with the sum the traversal computes
+				const float bmin = bounds[slot].bmin[axis], bmax = bounds[slot].bmax[axis];
+				int qmin = std::min(std::max((int)std::floor((bmin - origin) / step), 0), 255);
+				while (qmin > 0 && origin + (float)qmin * step > bmin)
+					qmin--;
+				int qmax = std::min(std::max((int)std::ceil((bmax - origin) / step), 0), 255);
+				while (qmax < 255 && origin + (float)qmax * step < bmax)
+					qmax++;
+				node.qmin[axis][slot] = (uint8_t)qmin;
+				node.qmax[axis][slot] = (uint8_t)qmax;
+			}
+		}
+	}
+}
+
+// =====================================================================================
+//										Collapse
+// =====================================================================================
+
+template<uint32_t N>
+void WideBvh<N>::Collapse(const Bvh& bvh)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	Clear();
+	if (bvh.IsEmpty())
+		return;
+
+	const std::vector<BvhNode>& binaryNodes = bvh.GetNodes();
+	m_PrimIndices = bvh.GetPrimIndices();
+
+	// Every wide node replaces at least one binary inner node
+	m_Nodes.reserve(binaryNodes.size() / 2 + 1);
+	m_SourceNodes.reserve((binaryNodes.size() / 2 + 1) * N);
+
+	struct Pending
+	{
+		uint32_t wideIndex;
+		uint32_t binaryIndex;
+		uint32_t depth;
+	};
+	std::vector<Pending> pending;
+	pending.push_back({ 0, 0, 1 });
+	m_Nodes.emplace_back();
+	m_SourceNodes.resize(N);
+
+	while (!pending.empty())
+	{
+		const Pending p = pending.back();
+		pending.pop_back();
+		m_MaxDepth = std::max(m_MaxDepth, p.depth);
+
+		// Open the largest inner child until the node is full. A binary leaf root stays a single leaf child.
+		uint32_t slots[N];
+		uint32_t slotCount = 0;
+		const BvhNode& source = binaryNodes[p.binaryIndex];
+		if (source.IsLeaf())
+		{
+			slots[slotCount++] = p.binaryIndex;
+		}
+		else
+		{
+			slots[slotCount++] = source.leftFirst;
+			slots[slotCount++] = source.leftFirst + 1;
+		}
+
+		while (slotCount < N)
+		{
+			int best = -1;
+			float bestArea = -1.0f;
+			for (uint32_t s = 0; s < slotCount; s++)
+			{
+				const BvhNode& child = binaryNodes[slots[s]];
+				if (!child.IsLeaf() && child.bounds.HalfArea() > bestArea)
+				{
+					best = (int)s;
+					bestArea = child.bounds.HalfArea();
+				}
+			}
+			if (best < 0)
+				break;
+
+			const uint32_t opened = binaryNodes[slots[best]].leftFirst;
+			slots[best] = opened;
+			slots[slotCount++] = opened + 1;
+		}
+
+		Aabb bounds[N];
+		for (uint32_t s = 0; s < N; s++)
+		{
+			// m_Nodes may grow below - no references into it across the loop
+			uint32_t childIndex = Node::kEmptySlot;
+			uint32_t primCount = 0;
+
+			if (s < slotCount)
+			{
+				const BvhNode& child = binaryNodes[slots[s]];
+				bounds[s] = child.bounds;
+				if (child.IsLeaf())
+				{
+					childIndex = child.leftFirst;
+					primCount = child.primCount;
+				}
+				else
+				{
+					childIndex = (uint32_t)m_Nodes.size();
+					m_Nodes.emplace_back();
+					m_SourceNodes.resize(m_SourceNodes.size() + N);
+					pending.push_back({ childIndex, slots[s], p.depth + 1 });
+				}
+			}
+
+			Node& node = m_Nodes[p.wideIndex];
+			node.child[s] = childIndex;
+			node.primCount[s] = primCount;
+			m_SourceNodes[p.wideIndex * N + s] = s < slotCount ? slots[s] : Node::kEmptySlot;
+		}
+		// BVH8 quantizes against the bounds of all children
+		SetNodeBounds(m_Nodes[p.wideIndex], bounds);
+	}
+
+	m_LastCollapseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+template<uint32_t N>
+void WideBvh<N>::Refit(const Bvh& bvh)
+{
+	const std::vector<BvhNode>& binaryNodes = bvh.GetNodes();
+	for (size_t n = 0; n < m_Nodes.size(); n++)
+	{
+		Aabb bounds[N];
+		for (uint32_t s = 0; s < N; s++)
+		{
+			const uint32_t source = m_SourceNodes[n * N + s];
+			if (source != Node::kEmptySlot)
+				bounds[s] = binaryNodes[source].bounds;
+		}
+		SetNodeBounds(m_Nodes[n], bounds);
+	}
+}
+
+template<uint32_t N>
+void WideBvh<N>::Clear()
+{
+	m_Nodes.clear();
+	m_PrimIndices.clear();
+	m_SourceNodes.clear();
+	m_MaxDepth = 0;
+	m_LastCollapseMs = 0.0;
+}
+
+template class WideBvh<4>;
+template class WideBvh<8>;
+
+} // namespace CpuRT
@@ -0,0 +1,256 @@
+#pragma once
+
+// 4- or 8-wide BVH collapsed from the binary Bvh. Every node stores the bounds of all its
+// children as structure of arrays, so one ray is tested against all of them with a few SIMD
+// instructions, and a traversal step touches one 128-byte node (2 cache lines) instead of
+// walking 2-3 levels of 64-byte binary node pairs. BVH8 only fits in 128 bytes with its child
+// bounds quantized to 8 bits relative to the node's own bounds.
+//
+// The binary tree stays the master copy: it is what the SAH builder and Refit() produce,
+// the wide tree is derived from it (Collapse) and follows its refits (Refit).
+
+#include "Bvh.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace CpuRT
+{
+
+template<uint32_t N>
+struct alignas(64) WideBvhNode
+{
+	float bminX[N], bminY[N], bminZ[N];
+	float bmaxX[N], bmaxY[N], bmaxZ[N];
+	// Inner child: index of the child node. Leaf child: first primitive in GetPrimIndices().
+	// kEmptySlot when the node has fewer than N children.
+	uint32_t child[N];
+	// 0 for inner children
+	uint32_t primCount[N];
+
+	static const uint32_t kEmptySlot = 0xFFFFFFFF;
+};
+
+// Child bound = origin + q * 2^exponent per axis. The grid spans the node's bounds in 255 steps
+// and the child bounds are rounded outwards to it, so a quantized box never misses a hit.
+template<>
+struct alignas(64) WideBvhNode<8>
+{
+	float origin[3];
+	int8_t exponent[3];
+	uint8_t padding;
+	uint8_t qmin[3][8];
+	uint8_t qmax[3][8];
+	uint32_t child[8];
+	uint32_t primCount[8];
+
+	static const uint32_t kEmptySlot = 0xFFFFFFFF;
+
+	// 2^exponent, exponent in [-126, 127]
+	static float GridStep(int exponent)
+	{
+		const uint32_t bits = (uint32_t)(exponent + 127) << 23;
+		float step;
+		memcpy(&step, &bits, sizeof(step));
+		return step;
+	}
+};
+
+static_assert(sizeof(WideBvhNode<4>) == 128 && sizeof(WideBvhNode<8>) == 128, "a wide node is one cache line pair");
+
+// std::allocator ignores alignas() before C++17
+template<typename T, size_t Alignment>
+struct AlignedAllocator
+{
+	typedef T value_type;
+	template<typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() {}
+	template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count)
+	{
+		// Over-allocate and keep the original pointer right in front of the aligned block
+		void* p = std::malloc(count * sizeof(T) + Alignment + sizeof(void*));
+		if (!p)
+			throw std::bad_alloc();
+		uintptr_t aligned = ((uintptr_t)p + sizeof(void*) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+		((void**)aligned)[-1] = p;
+		return (T*)aligned;
+	}
+
+	void deallocate(T* p, size_t) { std::free(((void**)p)[-1]); }
+
+	bool operator==(const AlignedAllocator&) const { return true; }
+	bool operator!=(const AlignedAllocator&) const { return false; }
+};
+
+template<uint32_t N>
+class WideBvh
+{
+public:
+	typedef WideBvhNode<N> Node;
+
+	// Greedy collapse: every wide node takes the children of its binary node and keeps
+	// opening the largest (by surface area) inner child until it has N children.
+	void Collapse(const Bvh& bvh);
+
+	// Copies the bounds of a refitted binary tree - the topology must be the one of the last Collapse()
+	void Refit(const Bvh& bvh);
+
+	// Same contract as Bvh::Traverse()
+	template<typename IntersectPrimFunc>
+	void Traverse(const TraversalRay& ray, float& tmax, IntersectPrimFunc&& intersectPrim, BvhTraversalStats* pStats = nullptr) const;
+
+	void Clear();
+
+	const std::vector<Node, AlignedAllocator<Node, 64>>& GetNodes() const { return m_Nodes; }
+	const std::vector<uint32_t>& GetPrimIndices() const { return m_PrimIndices; }
+	bool IsEmpty() const { return m_Nodes.empty(); }
+	size_t GetMemorySize() const { return m_Nodes.size() * sizeof(Node); }
+	double GetLastCollapseMs() const { return m_LastCollapseMs; }
+
+private:
+	// Bitmask of the children of 'node' the ray enters before tmax, entry distances in tNear
+	static uint32_t IntersectChildren(const Node& node, const TraversalRay& ray, float tmax, float* tNear);
+
+private:
+	std::vector<Node, AlignedAllocator<Node, 64>> m_Nodes;
+	std::vector<uint32_t> m_PrimIndices;
+	// Binary node every child slot was made from, N per wide node (kEmptySlot for unused slots)
+	std::vector<uint32_t> m_SourceNodes;
+	// Wide levels of the longest path - bounds the traversal stack
+	uint32_t m_MaxDepth = 0;
+	double m_LastCollapseMs = 0.0;
+};
+
+// =====================================================================================
+//										Traversal
+// =====================================================================================
+
+namespace WideBvhDetail
+{
+	// Slab test of one ray against the boxes in the lanes of V
+	template<typename V>
+	uint32_t IntersectBoxes(const V* bmin, const V* bmax, const TraversalRay& ray, float tmax, float* tNear)
+	{
+		const V ox(ray.origin.x), oy(ray.origin.y), oz(ray.origin.z);
+		const V idx(ray.invDir.x), idy(ray.invDir.y), idz(ray.invDir.z);
+
+		V tx1 = (bmin[0] - ox) * idx, tx2 = (bmax[0] - ox) * idx;
+		V tnear = Min(tx1, tx2), tfar = Max(tx1, tx2);
+		V ty1 = (bmin[1] - oy) * idy, ty2 = (bmax[1] - oy) * idy;
+		tnear = Max(tnear, Min(ty1, ty2)); tfar = Min(tfar, Max(ty1, ty2));
+		V tz1 = (bmin[2] - oz) * idz, tz2 = (bmax[2] - oz) * idz;
+		tnear = Max(tnear, Min(tz1, tz2)); tfar = Min(tfar, Max(tz1, tz2));
+
+		tnear.Store(tNear);
+		return MoveMask((tfar >= tnear) & (tfar >= V(ray.tmin)) & (tnear <= V(tmax)));
+	}
+
+	// The children [first, first + lanes of V) of a node
+	template<typename V, uint32_t N>
+	uint32_t IntersectChildBoxes(const WideBvhNode<N>& node, uint32_t first, const TraversalRay& ray, float tmax, float* tNear)
+	{
+		const V bmin[3] = { V::Load(node.bminX + first), V::Load(node.bminY + first), V::Load(node.bminZ + first) };
+		const V bmax[3] = { V::Load(node.bmaxX + first), V::Load(node.bmaxY + first), V::Load(node.bmaxZ + first) };
+		return IntersectBoxes(bmin, bmax, ray, tmax, tNear + first);
+	}
+
+	// BVH8: dequantized to exactly the values WideBvh.cpp checked while rounding outwards
+	// (q * 2^e is exact, the add rounds once - with or without FMA contraction). Moving the ray
+	// to the node's grid instead would save the adds but lose that guarantee, e.g. for a ray in
+	// the plane of a box face.
+	template<typename V>
+	uint32_t IntersectChildBoxes(const WideBvhNode<8>& node, uint32_t first, const TraversalRay& ray, float tmax, float* tNear)
+	{
+		V bmin[3], bmax[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const V origin(node.origin[axis]), step(WideBvhNode<8>::GridStep(node.exponent[axis]));
+			bmin[axis] = origin + V::LoadBytes(node.qmin[axis] + first) * step;
+			bmax[axis] = origin + V::LoadBytes(node.qmax[axis] + first) * step;
+		}
+		return IntersectBoxes(bmin, bmax, ray, tmax, tNear + first);
+	}
+}
+
+template<uint32_t N>
+uint32_t WideBvh<N>::IntersectChildren(const Node& node, const TraversalRay& ray, float tmax, float* tNear)
+{
+	// BVH8 in one AVX register, everything else in SSE registers of 4 children
+	if (N == 8 && kSimdWidth == 8)
+		return WideBvhDetail::IntersectChildBoxes<vfloat>(node, 0, ray, tmax, tNear);
+
+	uint32_t hitBits = 0;
+	for (uint32_t first = 0; first < N; first += 4)
+		hitBits |= WideBvhDetail::IntersectChildBoxes<vfloat4>(node, first, ray, tmax, tNear) << first;
+	return hitBits;
+}
+
+template<uint32_t N>
+template<typename IntersectPrimFunc>
+void WideBvh<N>::Traverse(const TraversalRay& ray, float& tmax, IntersectPrimFunc&& intersectPrim, BvhTraversalStats* pStats) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	struct StackEntry
+	{
+		uint32_t index;
+		uint32_t primCount;
+		float tNear;
+	};
+
+	// Up to N - 1 siblings are left behind per level
+	TraversalStack<StackEntry, 64 * (N - 1) + 1> stack((N - 1) * m_MaxDepth + 1);
+	stack.Push({ 0, 0, -FLT_MAX });
+
+	while (!stack.IsEmpty())
+	{
+		const StackEntry entry = stack.Pop();
+		// Culled by a hit found after the entry was pushed
+		if (entry.tNear > tmax)
+			continue;
+
+		if (entry.primCount)
+		{
+			if (pStats)
+				pStats->primTests += entry.primCount;
+			for (uint32_t i = entry.index; i < entry.index + entry.primCount; i++)
+				if (intersectPrim(m_PrimIndices[i], tmax))
+					return;
+			continue;
+		}
+
+		const Node& node = m_Nodes[entry.index];
+		if (pStats)
+		{
+			pStats->nodeVisits++;
+			pStats->cacheLines += CacheLinesSpanned(&node, sizeof(Node));
+		}
+
+		float tNear[N];
+		uint32_t hitBits = IntersectChildren(node, ray, tmax, tNear);
+
+		// Push the children far to near, so the nearest is popped first
+		const uint32_t first = stack.GetSize();
+		while (hitBits)
+		{
+			const uint32_t i = FirstBit(hitBits);
+			hitBits &= hitBits - 1;
+			if (node.child[i] == Node::kEmptySlot)
+				continue;
+
+			const StackEntry child = { node.child[i], node.primCount[i], tNear[i] };
+			stack.Push(child);
+			uint32_t j = stack.GetSize() - 1;
+			for (; j > first && stack[j - 1].tNear < child.tNear; j--)
+				stack[j] = stack[j - 1];
+			stack[j] = child;
+		}
+	}
+}
+
+} // namespace CpuRT
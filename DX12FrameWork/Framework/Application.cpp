@@ -42,6 +42,8 @@ Application::Application(HINSTANCE hInstance, const wchar_t* windowTitle, int wi
 			m_DirectCommandQueue  = std::make_shared<CommandQueue> (m_d3d12Device, D3D12_COMMAND_LIST_TYPE_DIRECT);
 			m_ComputeCommandQueue = std::make_shared<CommandQueue> (m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COMPUTE);
 			m_CopyCommandQueue    = std::make_shared<CommandQueue> (m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COPY);
+			m_UploadBuffer        = std::make_shared<UploadRingBuffer> (m_d3d12Device, m_CopyCommandQueue);
+			m_BackendDevice       = std::make_shared<Backend::D3D12Device> (m_d3d12Device, m_DirectCommandQueue, m_ComputeCommandQueue, m_CopyCommandQueue);
 		}
 	}
 
@@ -136,6 +138,13 @@ std::shared_ptr<CommandQueue> Application::GetCommandQueue(D3D12_COMMAND_LIST_TY
 	return commandQueue;
 }
 
+std::shared_ptr<AsyncUploader> Application::GetAsyncUploader()
+{
+	if (!m_AsyncUploader)
+		m_AsyncUploader = std::make_shared<AsyncUploader>(m_d3d12Device);
+	return m_AsyncUploader;
+}
+
 ComPtr<ID3D12Resource> Application::GetBackbuffer(UINT BackBufferIndex)
 {
 	return m_Window->GetBackBuffer(BackBufferIndex);
@@ -176,6 +185,16 @@ void Application::Update()
 		swprintf(buffer, 500, L"FPS: %f\n", fps);
 		OutputDebugStringW(buffer);
 
+		// Barriers of the last second, requested through the state tracker
+		static ResourceStateTracker::Stats lastStats;
+		const ResourceStateTracker::Stats& stats = m_StateTracker.GetStats();
+		const uint64_t requested = stats.requested - lastStats.requested;
+		const uint64_t issued = stats.issued - lastStats.issued;
+		swprintf(buffer, 500, L"Barriers: %llu requested, %llu issued, %llu eliminated, %llu ResourceBarrier calls\n",
+			requested, issued, requested - issued, stats.batches - lastStats.batches);
+		OutputDebugStringW(buffer);
+		lastStats = stats;
+
 		frameCount = 0;
 		totalTime = 0.0;
 	}
@@ -201,6 +220,8 @@ void Application::Resize(UINT32 width, UINT32 height)
 		// are not being referenced by an in-flight command list.
 		Flush();
 
+		for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; ++i)
+			m_StateTracker.Unregister(GetBackbuffer(i).Get());
 		m_Window->ResizeBackBuffers(width, height);
 
 		// After the swap chain buffers have been resized, the descriptors 
@@ -222,6 +243,7 @@ void Application::UpdateRenderTargetViews(ComPtr<ID3D12Device5> device, ComPtr<I
 	for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; ++i)
 	{
 		ComPtr<ID3D12Resource> backBuffer = m_Window->UpdateBackBufferCache(i);
+		m_StateTracker.Register(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT);
 		// nullptr - description is used to create a default descriptor for the resource
 		device->CreateRenderTargetView(backBuffer.Get(), nullptr, rtvHandle);
 
@@ -252,6 +274,7 @@ void Application::Flush()
 {
 	m_DirectCommandQueue->Flush();
 	m_ComputeCommandQueue->Flush();
+	m_UploadBuffer->Submit();
 	m_CopyCommandQueue->Flush();
 }
 
@@ -21,6 +21,10 @@ using namespace Microsoft::WRL;
 // Framework
 #include "Window.h"
 #include "CommandQueue.h"
+#include "UploadRingBuffer.h"
+#include "AsyncUploader.h"
+#include "../Backend/D3D12Device.h"
+#include "../Utils/ResourceStateTracker.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -65,6 +69,14 @@ protected:
 	UINT32 GetClientHeight() const { return m_Window->GetClientHeight(); }
 	ComPtr<ID3D12Device5> GetDevice() const { return m_d3d12Device; }
 	std::shared_ptr<CommandQueue> GetCommandQueue(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) const;
+	// Staging ring of the copy queue for buffer uploads
+	std::shared_ptr<UploadRingBuffer> GetUploadBuffer() const { return m_UploadBuffer; }
+	// Loader thread with its own copy queue, started on the first call
+	std::shared_ptr<AsyncUploader> GetAsyncUploader();
+	// The device and queues behind the Backend interface (same queues and fences as above)
+	std::shared_ptr<Backend::Device> GetBackendDevice() const { return m_BackendDevice; }
+	// States of the resources used on the direct queue (back buffers registered), see Utils.h
+	ResourceStateTracker& GetStateTracker() { return m_StateTracker; }
 	UINT GetCurrentBackbufferIndex() const { return m_Window->GetCurrentBackBufferIndex(); }
 	ComPtr<ID3D12Resource> GetBackbuffer(UINT BackBufferIndex);
 	D3D12_CPU_DESCRIPTOR_HANDLE GetCurrentBackbufferRTV();
@@ -92,6 +104,11 @@ private:
 	std::shared_ptr<CommandQueue> m_DirectCommandQueue = nullptr;
 	std::shared_ptr<CommandQueue> m_ComputeCommandQueue = nullptr;
 	std::shared_ptr<CommandQueue> m_CopyCommandQueue = nullptr;
+	// After the queues - released before them, it waits for its copies
+	std::shared_ptr<UploadRingBuffer> m_UploadBuffer = nullptr;
+	std::shared_ptr<AsyncUploader> m_AsyncUploader = nullptr;
+	std::shared_ptr<Backend::D3D12Device> m_BackendDevice = nullptr;
+	ResourceStateTracker m_StateTracker;
 
 	// Heap with RTVs
 	ComPtr<ID3D12DescriptorHeap> m_RTVDescriptorHeap;
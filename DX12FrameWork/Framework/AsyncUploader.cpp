@@ -0,0 +1,102 @@
+#include "../Helpers/Helpers.h"
+
+#include "AsyncUploader.h"
+
+
+AsyncUploader::AsyncUploader(ComPtr<ID3D12Device5> device, UINT64 ringSize)
+	: m_CommandQueue(std::make_shared<CommandQueue>(device, D3D12_COMMAND_LIST_TYPE_COPY))
+	, m_UploadBuffer(new UploadRingBuffer(device, m_CommandQueue, ringSize))
+	, m_Thread(&AsyncUploader::LoaderLoop, this)
+{
+}
+
+AsyncUploader::~AsyncUploader()
+{
+	// A running job is finished, queued ones are dropped
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+		m_Jobs.clear();
+	}
+	m_WakeUp.notify_all();
+	m_Thread.join();
+
+	// Releases the ring after its copies completed
+	m_UploadBuffer.reset();
+	m_CommandQueue->Flush();
+}
+
+
+AsyncUploader::Ticket AsyncUploader::Enqueue(Job job)
+{
+	Ticket ticket;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		ticket = m_NextTicket++;
+		m_Jobs.push_back(JobEntry{ ticket, std::move(job) });
+		m_Results[ticket] = JobResult{ Status::Pending, 0 };
+	}
+	m_WakeUp.notify_one();
+	return ticket;
+}
+
+
+AsyncUploader::Status AsyncUploader::Acquire(Ticket ticket, CommandQueue& queue)
+{
+	JobResult result;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto it = m_Results.find(ticket);
+		if (it == m_Results.end())
+			return Status::Failed;
+		result = it->second;
+		if (result.status != Status::Pending)
+			m_Results.erase(it);
+	}
+
+	if (result.status == Status::Ready)
+		queue.Wait(*m_CommandQueue, result.fenceValue);
+	return result.status;
+}
+
+
+UINT32 AsyncUploader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	UINT32 count = 0;
+	for (const auto& result : m_Results)
+		count += result.second.status == Status::Pending ? 1 : 0;
+	return count;
+}
+
+
+void AsyncUploader::LoaderLoop()
+{
+	for (;;)
+	{
+		JobEntry entry;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WakeUp.wait(lock, [this]() { return m_Quit || !m_Jobs.empty(); });
+			if (m_Quit)
+				return;
+			entry = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+		}
+
+		bool ok = false;
+		try
+		{
+			ok = entry.job(*m_UploadBuffer);
+		}
+		catch (const std::exception&)
+		{
+			ok = false;
+		}
+		// Also after a failure - the copies recorded so far have to go out before the ring is reused
+		const UINT64 fenceValue = m_UploadBuffer->Submit();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Results[entry.ticket] = JobResult{ ok ? Status::Ready : Status::Failed, fenceValue };
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>    // For Microsoft::WRL::ComPtr
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "CommandQueue.h"
+#include "UploadRingBuffer.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Content loading off the frame loop. Jobs run on a loader thread: they read/convert their data
+// and create resources through an UploadRingBuffer of a copy queue owned by the uploader (no other
+// thread records on it). After a job its copies are submitted and the fence value is kept.
+//
+// The render thread polls Acquire() once per frame. A finished job makes the render queue wait on
+// the GPU for the copy fence (ID3D12CommandQueue::Wait) - the CPU never blocks, and everything the
+// render queue executes afterwards may use the job's resources. Jobs hand their resources over
+// through state they share with the caller (written on the loader thread before the job returns,
+// read after Acquire() returned Ready).
+//
+// Copy queue resources decay to COMMON once the copies completed: buffers are promoted to any read
+// state implicitly, textures need a transition on the render queue.
+class AsyncUploader
+{
+public:
+	typedef UINT64 Ticket;
+	// Runs on the loader thread, false (or an exception) if the content couldn't be loaded
+	typedef std::function<bool(UploadRingBuffer& uploadBuffer)> Job;
+
+	enum class Status
+	{
+		Pending,	// queued or running
+		Ready,		// copies submitted, the queue passed to Acquire() waits for them
+		Failed,
+	};
+
+	AsyncUploader(ComPtr<ID3D12Device5> device, UINT64 ringSize = 32 * 1024 * 1024);
+	~AsyncUploader();
+	AsyncUploader(const AsyncUploader&) = delete;
+	AsyncUploader& operator=(const AsyncUploader&) = delete;
+
+	// Queues a job, jobs run in order
+	Ticket Enqueue(Job job);
+
+	// Pending until the job finished. Ready/Failed are reported once, the ticket is released then.
+	// Ready: queue waits (GPU side) for the job's copies before the work submitted to it next.
+	Status Acquire(Ticket ticket, CommandQueue& queue);
+
+	// Jobs queued or running
+	UINT32 GetPendingCount();
+
+private:
+	void LoaderLoop();
+
+private:
+	struct JobEntry
+	{
+		Ticket ticket;
+		Job job;
+	};
+	struct JobResult
+	{
+		Status status;
+		UINT64 fenceValue;
+	};
+
+	std::shared_ptr<CommandQueue> m_CommandQueue;
+	// Used by the loader thread only
+	std::unique_ptr<UploadRingBuffer> m_UploadBuffer;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WakeUp;
+	std::deque<JobEntry> m_Jobs;
+	std::unordered_map<Ticket, JobResult> m_Results;
+	Ticket m_NextTicket = 1;
+	bool m_Quit = false;
+
+	// Last member - started when everything else is constructed
+	std::thread m_Thread;
+};
@@ -1,126 +1,189 @@
 #include <cassert>
 #include "../Helpers/Helpers.h"
+#include "../Utils/ThreadPool.h"
 
 #include "CommandQueue.h"
 
 
+// Private data of a command list: the slot of the allocator pool its allocator goes back to
+// {6E1B5A3C-42D7-4F8E-9C05-B3A1D27E84F6}
+static const GUID kAllocatorSlotGuid = { 0x6e1b5a3c, 0x42d7, 0x4f8e, { 0x9c, 0x05, 0xb3, 0xa1, 0xd2, 0x7e, 0x84, 0xf6 } };
+
 
 CommandQueue::CommandQueue(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type) 
-	: m_d3d12Device(device)
-	, m_CommandListType(type)
-	, m_FenceValue(0)
+	: m_Core(CreateApi(device, type), kMaxRecordingThreads)
+{
+}
+
+CommandQueue::~CommandQueue()
+{
+}
+
+
+CommandQueue::D3D12Api CommandQueue::CreateApi(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type)
 {
+	D3D12Api api;
+	api.device = device;
+	api.type = type;
+
 	D3D12_COMMAND_QUEUE_DESC desc;
 	desc.Type = type;
 	desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
 	desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
 	desc.NodeMask = 0;
 
-	ThrowIfFailed(m_d3d12Device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_d3d12CommandQueue)));
-	ThrowIfFailed(m_d3d12Device->CreateFence(m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_d3d12Fence)));
+	ThrowIfFailed(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&api.queue)));
+	ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&api.fence)));
+	return api;
+}
 
-	m_FenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-	assert(m_FenceEvent && "Failed to create fence event handle.");
+
+UINT64 CommandQueue::Signal() {
+	return m_Core.Signal();
 }
 
-CommandQueue::~CommandQueue()
+
+bool CommandQueue::IsFenceComplete(UINT64 fenceValue)
 {
-	// Releasing the handle to the fence event object.
-	::CloseHandle(m_FenceEvent);
+	return m_Core.IsFenceComplete(fenceValue);
 }
 
 
-UINT64 CommandQueue::Signal() {
-	UINT64 fenceValue = ++m_FenceValue;
-	m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValue);
-	return fenceValue;
+UINT64 CommandQueue::GetCompletedFenceValue() const
+{
+	return m_Core.GetCompletedFenceValue();
 }
 
 
-bool CommandQueue::IsFenceComplete(UINT64 fenceValue)
+void CommandQueue::WaitForFenceValue(UINT64 fenceValue) 
 {
-	return m_d3d12Fence->GetCompletedValue() >= fenceValue;
+	m_Core.WaitForFenceValue(fenceValue);
 }
 
 
-void CommandQueue::WaitForFenceValue(UINT64 fenceValue) 
+void CommandQueue::Flush()
+{
+	m_Core.Flush();
+}
+
+
+void CommandQueue::Wait(const CommandQueue& other, UINT64 fenceValue)
+{
+	m_Core.Wait(other.m_Core, fenceValue);
+}
+
+
+// This method returns a command list that can be directly used to issue GPU drawing (or dispatch) commands.
+//		The command list will be in the recording state so there is no need for the user to reset the command list
+//		before using it. A command allocator will already be associated with the command list but the CommandQueue 
+//		class needs a way to keep track of which command allocator is associated with which command list. Since there
+//		is no way to directly query the command allocator that was used to reset the command list, a pointer 
+//		to the command allocator is stored in the private data space of the command list.
+//		threadIndex selects the slot of the allocator pool: threads recording at the same time should
+//		pass different indices (any index is safe, a shared one only costs lock contention).
+ComPtr<ID3D12GraphicsCommandList4> CommandQueue::GetCommandList(UINT32 threadIndex)
+{
+	return m_Core.GetCommandList(threadIndex);
+}
+
+
+UINT64 CommandQueue::ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList4> commandList)
 {
-	if (!IsFenceComplete(fenceValue)) 
+	return m_Core.ExecuteCommandList(commandList);
+}
+
+
+UINT64 CommandQueue::ExecuteCommandLists(const ComPtr<ID3D12GraphicsCommandList4>* pCommandLists, UINT32 count)
+{
+	return m_Core.ExecuteCommandLists(pCommandLists, count);
+}
+
+
+UINT64 CommandQueue::ExecuteParallel(ThreadPool& pool, UINT32 listCount, const RecordFunction& record)
+{
+	assert(pool.GetThreadCount() <= kMaxRecordingThreads);
+	return m_Core.ExecuteParallel(pool, listCount, [&](const ComPtr<ID3D12GraphicsCommandList4>& commandList, uint32_t listIndex)
 	{
-		m_d3d12Fence->SetEventOnCompletion(fenceValue, m_FenceEvent);
-		::WaitForSingleObject(m_FenceEvent, DWORD_MAX);
-	}
+		record(commandList.Get(), listIndex);
+	});
 }
 
 
-void CommandQueue::Flush()
+UINT64 CommandQueue::AddToBatch(ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	return m_Core.AddToBatch(commandList);
+}
+
+
+UINT64 CommandQueue::SubmitBatch()
 {
-	WaitForFenceValue(Signal());
+	return m_Core.SubmitBatch();
 }
 
 
-ComPtr<ID3D12CommandAllocator> CommandQueue::CreateCommandAllocator()
+CommandQueue::SubmitStats CommandQueue::GetSubmitStats()
+{
+	return m_Core.GetSubmitStats();
+}
+
+
+CommandQueue::SubmitStats CommandQueue::GetFrameSubmitStats()
+{
+	return m_Core.GetFrameSubmitStats();
+}
+
+
+ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue() const
+{
+	return m_Core.GetApi().queue;
+}
+
+// =====================================================================================
+//										D3D12 calls
+// =====================================================================================
+
+CommandQueue::D3D12Api::Allocator CommandQueue::D3D12Api::CreateAllocator()
 {
 	ComPtr<ID3D12CommandAllocator> commandAllocator;
 	ThrowIfFailed(
-		m_d3d12Device->CreateCommandAllocator(m_CommandListType, IID_PPV_ARGS(&commandAllocator))
+		device->CreateCommandAllocator(type, IID_PPV_ARGS(&commandAllocator))
 	);
 
 	return commandAllocator;
 }
 
 
-ComPtr<ID3D12GraphicsCommandList4> CommandQueue::CreateCommandList(ComPtr<ID3D12CommandAllocator> allocator)
+void CommandQueue::D3D12Api::ResetAllocator(const Allocator& allocator)
+{
+	ThrowIfFailed(allocator->Reset());
+}
+
+
+CommandQueue::D3D12Api::CommandList CommandQueue::D3D12Api::CreateCommandList(const Allocator& allocator)
 {
 	ComPtr<ID3D12GraphicsCommandList4> commandList;
 	ThrowIfFailed(
-		m_d3d12Device->CreateCommandList(0, m_CommandListType, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList))
+		device->CreateCommandList(0, type, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList))
 	);
 
 	return commandList;
 }
 
 
-// This method returns a command list that can be directly used to issue GPU drawing (or dispatch) commands.
-//		The command list will be in the recording state so there is no need for the user to reset the command list
-//		before using it. A command allocator will already be associated with the command list but the CommandQueue 
-//		class needs a way to keep track of which command allocator is associated with which command list. Since there
-//		is no way to directly query the command allocator that was used to reset the command list, a pointer 
-//		to the command allocator is stored in the private data space of the command list.
-ComPtr<ID3D12GraphicsCommandList4> CommandQueue::GetCommandList()
+void CommandQueue::D3D12Api::ResetCommandList(const CommandList& commandList, const Allocator& allocator)
 {
-	ComPtr<ID3D12CommandAllocator> commandAllocator;
-	ComPtr<ID3D12GraphicsCommandList4> commandList;
-
-	// Before the command list can be reset, an unused command allocator is required 
-	//		as CommandList->Reset requires CommandAllocator as a parameter.
-	// The Command allocator can be reused as long as it is not currently in-flight
-	//      on the command queue.
-	if (!m_CommandAllocatorQueue.empty() && IsFenceComplete(m_CommandAllocatorQueue.front().fenceValue))
-	{
-		commandAllocator = m_CommandAllocatorQueue.front().commandAllocator;
-		m_CommandAllocatorQueue.pop();
+	ThrowIfFailed(commandList->Reset(allocator.Get(), nullptr));
+}
 
-		ThrowIfFailed(commandAllocator->Reset());
-	}
-	else
-	{
-		commandAllocator = CreateCommandAllocator();
-	}
 
-	// With a valid command allocator, the command list is created next.
-	if (!m_CommandListQueue.empty())
-	{
-		commandList = m_CommandListQueue.front();
-		m_CommandListQueue.pop();
+void CommandQueue::D3D12Api::CloseCommandList(const CommandList& commandList)
+{
+	commandList->Close();
+}
 
-		ThrowIfFailed(commandList->Reset(commandAllocator.Get(), nullptr));
-	}
-	else
-	{
-		commandList = CreateCommandList(commandAllocator);
-	}
 
+void CommandQueue::D3D12Api::SetListAllocator(const CommandList& commandList, const Allocator& allocator, uint32_t slot)
+{
 	// Associate the command allocator with the command list so that it can be
 	//		retrieved when the command list is executed.
 	// When the command list will be executed, the command allocator can be retrieved
@@ -133,44 +196,54 @@ ComPtr<ID3D12GraphicsCommandList4> CommandQueue::GetCommandList()
 	//		object is only decremented if either the owning ID3D12Object object is destroyed 
 	//		or the instance of the COM object with the same interface is replaced with another 
 	//		COM object of the same interface or a NULL pointer.
-	ThrowIfFailed(commandList->SetPrivateDataInterface(__uuidof(ID3D12CommandAllocator), commandAllocator.Get()));
-
-	return commandList;
+	ThrowIfFailed(commandList->SetPrivateDataInterface(__uuidof(ID3D12CommandAllocator), allocator.Get()));
+	ThrowIfFailed(commandList->SetPrivateData(kAllocatorSlotGuid, sizeof(slot), &slot));
 }
 
 
-UINT64 CommandQueue::ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList4> commandList)
+void CommandQueue::D3D12Api::GetListAllocator(const CommandList& commandList, Allocator* pAllocator, uint32_t* pSlot)
 {
-	commandList->Close();
-
 	// Be aware that retrieving a COM pointer of a COM object associated with the private data
 	// of the ID3D12Object object will also increment the reference counter of that COM object.
-	ID3D12CommandAllocator* commandAllocator;
-	UINT dataSize = sizeof(commandAllocator);
-	ThrowIfFailed(commandList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
+	// The ComPtr takes over that reference.
+	UINT dataSize = sizeof(ID3D12CommandAllocator*);
+	*pAllocator = nullptr;
+	ThrowIfFailed(commandList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, pAllocator->GetAddressOf()));
+	dataSize = sizeof(UINT32);
+	ThrowIfFailed(commandList->GetPrivateData(kAllocatorSlotGuid, &dataSize, pSlot));
+}
 
-	ID3D12CommandList* const ppCommandLists[] = {
-		commandList.Get()
-	};
 
-	m_d3d12CommandQueue->ExecuteCommandLists(1, ppCommandLists);
-	uint64_t fenceValue = Signal();
+void CommandQueue::D3D12Api::ExecuteCommandLists(const CommandList* pCommandLists, uint32_t count)
+{
+	std::vector<ID3D12CommandList*> ppCommandLists(count);
+	for (uint32_t i = 0; i < count; i++)
+		ppCommandLists[i] = pCommandLists[i].Get();
+	queue->ExecuteCommandLists(count, ppCommandLists.data());
+}
 
-	m_CommandAllocatorQueue.emplace(CommandAllocatorEntry{ fenceValue, commandAllocator });
-	m_CommandListQueue.push(commandList);
 
-	// The temporary pointer to the command allocator needs to be DECREMENTED by 
-	//		releasing the COM pointer.
-	// The ownership of the command allocator has been transferred to the ComPtr
-	//		in the command allocator queue. It is safe to release the reference 
-	//		in this temporary COM pointer here.
-	commandAllocator->Release();
+void CommandQueue::D3D12Api::Signal(uint64_t fenceValue)
+{
+	queue->Signal(fence.Get(), fenceValue);
+}
+
 
-	return fenceValue;
+void CommandQueue::D3D12Api::Wait(const D3D12Api& other, uint64_t fenceValue)
+{
+	ThrowIfFailed(queue->Wait(other.fence.Get(), fenceValue));
 }
 
 
-ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue() const
+uint64_t CommandQueue::D3D12Api::GetCompletedFenceValue() const
+{
+	return fence->GetCompletedValue();
+}
+
+
+void CommandQueue::D3D12Api::WaitForFenceValue(uint64_t fenceValue)
 {
-	return m_d3d12CommandQueue;
-}
\ No newline at end of file
+	// Without an event the call blocks until the fence reaches the value - several threads
+	// may wait at once, a shared event would wake only one of them
+	ThrowIfFailed(fence->SetEventOnCompletion(fenceValue, nullptr));
+}
@@ -1,65 +1,99 @@
 #pragma once
 #include <d3d12.h>
 #include <wrl.h>    // For Microsoft::WRL::ComPtr
-#include <queue>
+#include <functional>
+
+#include "../Utils/CommandQueueCore.h"
 
 using Microsoft::WRL::ComPtr;
 
+class ThreadPool;
+
+// Thread-safe: command lists may be taken, recorded and executed on any thread. Every recording
+// thread passes its own threadIndex to GetCommandList() so it gets allocators from its own slot
+// of the pool, without waiting on the other threads.
+//
+// Lists may also be batched: AddToBatch() closes a list and keeps it, SubmitBatch() executes all
+// of them with one ExecuteCommandLists and one Signal. Anything else that submits or signals on
+// the queue submits the batch first, so the queue's order is the order of the calls.
+//
+// The logic is CommandQueueCore's (portable, benchmarked and checked by 5_Framework_Headless over
+// mock objects), this class gives it the D3D12 objects.
 class CommandQueue
 {
 public:
+	// Slots of the allocator pool, threadIndex < kMaxRecordingThreads
+	static const UINT32 kMaxRecordingThreads = 64;
+
+	// Records list listIndex (of ExecuteParallel()) into commandList, on a worker thread
+	typedef std::function<void(ID3D12GraphicsCommandList4* commandList, UINT32 listIndex)> RecordFunction;
+
 	CommandQueue(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type);
 	~CommandQueue();
 
 	UINT64 Signal();
 	bool IsFenceComplete(UINT64 fenceValue);
+	UINT64 GetCompletedFenceValue() const;
 	void WaitForFenceValue(UINT64 fenceValue);
 	void Flush();
+	// GPU-side wait: work submitted to this queue afterwards starts once the fence of other reaches fenceValue
+	void Wait(const CommandQueue& other, UINT64 fenceValue);
 
-	// Get an available command list from the command queue.
-	ComPtr<ID3D12GraphicsCommandList4> GetCommandList();
+	// Get an available command list from the command queue, its allocator from the slot of threadIndex.
+	ComPtr<ID3D12GraphicsCommandList4> GetCommandList(UINT32 threadIndex = 0);
 	UINT64 ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList4> commandList);
-	ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
+	// Closes the lists and submits them in order (after the open batch) with one ExecuteCommandLists and one Signal
+	UINT64 ExecuteCommandLists(const ComPtr<ID3D12GraphicsCommandList4>* pCommandLists, UINT32 count);
+	// Records listCount lists on the threads of pool (record(list, listIndex) per list, in any order
+	// and concurrently) and submits them in listIndex order. Returns the fence value of the submit.
+	UINT64 ExecuteParallel(ThreadPool& pool, UINT32 listCount, const RecordFunction& record);
 
-protected:
-	ComPtr<ID3D12CommandAllocator> CreateCommandAllocator();
-	ComPtr<ID3D12GraphicsCommandList4> CreateCommandList(ComPtr<ID3D12CommandAllocator> allocator);
+	// Closes the list and adds it to the open batch. Returns the fence value that signals its
+	// completion - the one of the batch's submit, which also a Signal() or another submit does.
+	UINT64 AddToBatch(ComPtr<ID3D12GraphicsCommandList4> commandList);
+	// Executes the batched lists with one ExecuteCommandLists and one Signal and returns the fence
+	// value. An empty batch signals nothing and returns the last signaled value.
+	UINT64 SubmitBatch();
 
 private /*helpers*/:
-	// Keep track of command allocators that are "in-flight":
-	//		Struct is used to associate a fence value with a command allocator.
-	//		It is known that - the command list can be reused immediately after it has been executed
-	//		on the command queue, but the command allocator cannot be reused unless the commands 
-	//		stored in the command allocator have finished executing on the command queue.
-	//		To guarantee that the command allocator is no longer in-flight on the command queue, 
-	//		a fence value is signaled on the command queue and that fence value 
-	//		(together with the associated command allocator) is stored for later reuse.
-	struct CommandAllocatorEntry
+	// The D3D12 calls of CommandQueueCore
+	struct D3D12Api
 	{
-		UINT64 fenceValue;
-		ComPtr<ID3D12CommandAllocator> commandAllocator;
+		typedef ComPtr<ID3D12CommandAllocator> Allocator;
+		typedef ComPtr<ID3D12GraphicsCommandList4> CommandList;
+
+		ComPtr<ID3D12Device5> device;
+		D3D12_COMMAND_LIST_TYPE type;
+		ComPtr<ID3D12CommandQueue> queue;
+		ComPtr<ID3D12Fence> fence;
+
+		Allocator CreateAllocator();
+		void ResetAllocator(const Allocator& allocator);
+		CommandList CreateCommandList(const Allocator& allocator);
+		void ResetCommandList(const CommandList& commandList, const Allocator& allocator);
+		void CloseCommandList(const CommandList& commandList);
+		void SetListAllocator(const CommandList& commandList, const Allocator& allocator, uint32_t slot);
+		void GetListAllocator(const CommandList& commandList, Allocator* pAllocator, uint32_t* pSlot);
+		void ExecuteCommandLists(const CommandList* pCommandLists, uint32_t count);
+		void Signal(uint64_t fenceValue);
+		void Wait(const D3D12Api& other, uint64_t fenceValue);
+		uint64_t GetCompletedFenceValue() const;
+		void WaitForFenceValue(uint64_t fenceValue);
 	};
-	typedef ComPtr<ID3D12GraphicsCommandList4> CommandListEntry;
+	typedef CommandQueueCore<D3D12Api> Core;
 
-	using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
-	using CommandListQueue = std::queue<CommandListEntry>;
+	static D3D12Api CreateApi(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type);
+
+public:
+	typedef Core::SubmitStats SubmitStats;
+
+	// Counters since the queue was created
+	SubmitStats GetSubmitStats();
+	// Counters since the previous call (once per frame)
+	SubmitStats GetFrameSubmitStats();
+
+	ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
 
 private /*main*/:
-	// There is no need to associate a fence value with the command lists since 
-	// they can be reused right after they have been executed on the command queue.
-	CommandListQueue	                        m_CommandListQueue;
-	CommandAllocatorQueue                       m_CommandAllocatorQueue;
-
-	// CommandQueue
-	D3D12_COMMAND_LIST_TYPE m_CommandListType;
-	ComPtr<ID3D12CommandQueue> m_d3d12CommandQueue;
-
-	// Synchronization objects
-	ComPtr<ID3D12Fence> m_d3d12Fence;
-	UINT64 m_FenceValue = 0;
-	HANDLE m_FenceEvent;
-
-	// Device
-	ComPtr<ID3D12Device5> m_d3d12Device;
+	Core m_Core;
 };
-
@@ -0,0 +1,110 @@
+#include <cassert>
+#include "../Helpers/Helpers.h"
+#include "../Helpers/d3dx12.h"
+
+#include "GpuTimer.h"
+
+
+GpuTimer::GpuTimer(ComPtr<ID3D12Device5> device, std::shared_ptr<CommandQueue> commandQueue, UINT32 maxRegions)
+	: m_d3d12Device(device)
+	, m_CommandQueue(commandQueue)
+	, m_Regions(maxRegions)
+{
+	assert(maxRegions > 0);
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = maxRegions * 2;
+	ThrowIfFailed(m_d3d12Device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_QueryHeap)));
+
+	// Readback heaps start (and stay) in COPY_DEST, what ResolveQueryData writes to
+	ThrowIfFailed(m_d3d12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT64) * queryHeapDesc.Count),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&m_ReadbackBuffer)));
+
+	ThrowIfFailed(m_CommandQueue->GetD3D12CommandQueue()->GetTimestampFrequency(&m_GpuFrequency));
+	LARGE_INTEGER cpuFrequency;
+	QueryPerformanceFrequency(&cpuFrequency);
+	m_CpuFrequency = (UINT64)cpuFrequency.QuadPart;
+}
+
+
+void GpuTimer::Begin(ID3D12GraphicsCommandList* commandList, const char* name)
+{
+	assert(!m_Open && "Regions don't nest");
+	m_Open = true;
+	m_Dropping = m_RegionCount == m_Regions.size();
+	if (m_Dropping)
+	{
+		m_DroppedRegions++;
+		return;
+	}
+
+	const UINT32 index = (m_FirstRegion + m_RegionCount) % (UINT32)m_Regions.size();
+	m_Regions[index].name = name;
+	m_Regions[index].fenceValue = 0;
+	commandList->EndQuery(m_QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, index * 2);
+}
+
+
+void GpuTimer::End(ID3D12GraphicsCommandList* commandList)
+{
+	assert(m_Open);
+	m_Open = false;
+	if (m_Dropping)
+		return;
+
+	const UINT32 index = (m_FirstRegion + m_RegionCount) % (UINT32)m_Regions.size();
+	commandList->EndQuery(m_QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, index * 2 + 1);
+	commandList->ResolveQueryData(m_QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, index * 2, 2, m_ReadbackBuffer.Get(), sizeof(UINT64) * index * 2);
+	m_RegionCount++;
+}
+
+
+void GpuTimer::Submitted(UINT64 fenceValue)
+{
+	// The untagged regions are the newest ones
+	for (UINT32 i = m_RegionCount; i-- > 0;)
+	{
+		Region& region = m_Regions[(m_FirstRegion + i) % m_Regions.size()];
+		if (region.fenceValue != 0)
+			break;
+		region.fenceValue = fenceValue;
+	}
+}
+
+
+void GpuTimer::Collect(TimelineTrace& trace, uint32_t track)
+{
+	const UINT64 completedFenceValue = m_CommandQueue->GetCompletedFenceValue();
+	if (m_RegionCount == 0 || m_Regions[m_FirstRegion].fenceValue == 0 || m_Regions[m_FirstRegion].fenceValue > completedFenceValue)
+		return;
+
+	// GPU and CPU clocks at the same moment, again every time - they drift apart
+	UINT64 gpuCalibration, cpuCalibration;
+	ThrowIfFailed(m_CommandQueue->GetD3D12CommandQueue()->GetClockCalibration(&gpuCalibration, &cpuCalibration));
+	const double cpuCalibrationUs = cpuCalibration * 1e6 / m_CpuFrequency;
+
+	const UINT64* pTimestamps;
+	CD3DX12_RANGE readRange(0, sizeof(UINT64) * m_Regions.size() * 2);
+	ThrowIfFailed(m_ReadbackBuffer->Map(0, &readRange, (void**)&pTimestamps));
+	while (m_RegionCount > 0)
+	{
+		const Region& region = m_Regions[m_FirstRegion];
+		if (region.fenceValue == 0 || region.fenceValue > completedFenceValue)
+			break;
+
+		const double beginUs = cpuCalibrationUs + (double)(INT64)(pTimestamps[m_FirstRegion * 2] - gpuCalibration) * 1e6 / m_GpuFrequency;
+		const double endUs = cpuCalibrationUs + (double)(INT64)(pTimestamps[m_FirstRegion * 2 + 1] - gpuCalibration) * 1e6 / m_GpuFrequency;
+		trace.Add(track, region.name.c_str(), beginUs, endUs);
+
+		m_FirstRegion = (m_FirstRegion + 1) % (UINT32)m_Regions.size();
+		m_RegionCount--;
+	}
+	CD3DX12_RANGE writeRange(0, 0);
+	m_ReadbackBuffer->Unmap(0, &writeRange);
+}
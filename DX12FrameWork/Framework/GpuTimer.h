@@ -0,0 +1,67 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>    // For Microsoft::WRL::ComPtr
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CommandQueue.h"
+#include "../Utils/TimelineTrace.h"
+
+using Microsoft::WRL::ComPtr;
+
+// GPU time of regions of the command lists of one queue, through timestamp queries. The timestamps
+// are moved to the QueryPerformanceCounter clock (ID3D12CommandQueue::GetClockCalibration), so the
+// regions of several queues - one GpuTimer each - share one timeline.
+//
+// Begin()/End() enclose the commands of a region, End() also resolves its two timestamps into the
+// readback buffer. Submitted() tags the regions recorded since the last call with the fence value
+// of the submit that executes them, Collect() adds the ones the GPU finished to a TimelineTrace.
+// Regions wait in a ring of maxRegions: when it is full Begin() skips the region (GetDroppedRegions()).
+//
+// Direct and compute queues (copy queues need CopyQueueTimestampQueriesSupported). Regions don't nest.
+// Not thread-safe: used by the thread recording and submitting the queue's lists.
+class GpuTimer
+{
+public:
+	GpuTimer(ComPtr<ID3D12Device5> device, std::shared_ptr<CommandQueue> commandQueue, UINT32 maxRegions = 256);
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// name is copied
+	void Begin(ID3D12GraphicsCommandList* commandList, const char* name);
+	void End(ID3D12GraphicsCommandList* commandList);
+	// After the lists with the regions were submitted, fenceValue: of that submit
+	void Submitted(UINT64 fenceValue);
+
+	// Regions whose fence completed, in submit order, to track of trace (microseconds)
+	void Collect(TimelineTrace& trace, uint32_t track);
+
+	UINT64 GetDroppedRegions() const { return m_DroppedRegions; }
+
+private:
+	struct Region
+	{
+		std::string name;
+		UINT64 fenceValue;			// 0 until Submitted()
+	};
+
+private:
+	ComPtr<ID3D12Device5> m_d3d12Device;
+	std::shared_ptr<CommandQueue> m_CommandQueue;
+
+	// Two timestamps per region of the ring
+	ComPtr<ID3D12QueryHeap> m_QueryHeap;
+	ComPtr<ID3D12Resource> m_ReadbackBuffer;
+
+	std::vector<Region> m_Regions;
+	UINT32 m_FirstRegion = 0;			// oldest waiting
+	UINT32 m_RegionCount = 0;			// ended, waiting for their fence
+	bool m_Open = false;				// between Begin() and End()
+	bool m_Dropping = false;			// ... of a skipped region
+	UINT64 m_DroppedRegions = 0;
+
+	// Ticks per second
+	UINT64 m_GpuFrequency = 0;
+	UINT64 m_CpuFrequency = 0;
+};
@@ -0,0 +1,160 @@
+#include <stdexcept>
+#include "../Helpers/Helpers.h"
+#include "../Helpers/d3dx12.h"
+
+#include "TransientHeap.h"
+
+namespace
+{
+	bool SameRequest(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b)
+	{
+		return a.Dimension == b.Dimension && a.Alignment == b.Alignment && a.Width == b.Width && a.Height == b.Height &&
+			a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels && a.Format == b.Format &&
+			a.SampleDesc.Count == b.SampleDesc.Count && a.SampleDesc.Quality == b.SampleDesc.Quality &&
+			a.Layout == b.Layout && a.Flags == b.Flags;
+	}
+
+	UINT32 GetSubresourceCount(const D3D12_RESOURCE_DESC& desc)
+	{
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+			return 1;
+		const UINT32 arraySize = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+		return desc.MipLevels * arraySize;
+	}
+}
+
+
+TransientHeap::TransientHeap(ComPtr<ID3D12Device5> device, std::shared_ptr<CommandQueue> commandQueue, ResourceStateTracker& stateTracker)
+	: m_d3d12Device(device)
+	, m_CommandQueue(commandQueue)
+	, m_StateTracker(stateTracker)
+{
+	// Buffers, render targets and other textures in one heap
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	ThrowIfFailed(m_d3d12Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+	if (options.ResourceHeapTier < D3D12_RESOURCE_HEAP_TIER_2)
+		throw std::runtime_error("TransientHeap: resource heap tier 2 required");
+}
+
+TransientHeap::~TransientHeap()
+{
+	// The GPU may still use the placed resources
+	m_CommandQueue->Flush();
+	for (PlacedResource& placed : m_PlacedResources)
+		m_StateTracker.Unregister(placed.resource.Get());
+}
+
+
+RenderGraph::Handle TransientHeap::CreateTransient(RenderGraph& graph, const char* name, const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue)
+{
+	const D3D12_RESOURCE_ALLOCATION_INFO info = m_d3d12Device->GetResourceAllocationInfo(0, 1, &desc);
+
+	RenderGraph::TransientDesc transientDesc;
+	transientDesc.name = name;
+	transientDesc.size = info.SizeInBytes;
+	transientDesc.alignment = info.Alignment;
+	const RenderGraph::Handle handle = graph.CreateTransient(transientDesc);
+
+	if (m_Requests.size() <= handle)
+		m_Requests.resize(handle + 1);
+	Request& request = m_Requests[handle];
+	request.desc = desc;
+	request.initialState = initialState;
+	request.hasClearValue = pClearValue != nullptr;
+	request.clearValue = pClearValue ? *pClearValue : D3D12_CLEAR_VALUE();
+	return handle;
+}
+
+
+void TransientHeap::Allocate(RenderGraph& graph)
+{
+	const UINT64 completedFenceValue = m_CommandQueue->GetCompletedFenceValue();
+	size_t kept = 0;
+	for (size_t i = 0; i < m_Retired.size(); i++)
+	{
+		if (m_Retired[i].fenceValue > completedFenceValue)
+			m_Retired[kept++] = m_Retired[i];
+	}
+	m_Retired.resize(kept);
+	m_RetireFenceValue = 0;
+
+	// A larger heap: the resources in the old one go with it
+	const UINT64 heapSize = (graph.GetHeapSize() + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) &
+		~(UINT64)(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+	if (heapSize > m_HeapSize)
+	{
+		for (PlacedResource& placed : m_PlacedResources)
+			Retire(placed.resource, nullptr);
+		m_PlacedResources.clear();
+		if (m_Heap)
+			Retire(nullptr, m_Heap);
+
+		CD3DX12_HEAP_DESC heapDesc(heapSize, D3D12_HEAP_TYPE_DEFAULT, 0, D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES);
+		ThrowIfFailed(m_d3d12Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_Heap)));
+		m_HeapSize = heapSize;
+	}
+
+	for (PlacedResource& placed : m_PlacedResources)
+		placed.used = false;
+
+	for (RenderGraph::Handle handle = 0; handle < m_Requests.size(); handle++)
+	{
+		if (!graph.IsTransientUsed(handle))
+			continue;
+
+		const Request& request = m_Requests[handle];
+		const UINT64 offset = graph.GetTransientOffset(handle);
+		PlacedResource* pPlaced = nullptr;
+		for (PlacedResource& placed : m_PlacedResources)
+		{
+			if (!placed.used && placed.offset == offset && placed.request.initialState == request.initialState &&
+				SameRequest(placed.request.desc, request.desc))
+			{
+				pPlaced = &placed;
+				break;
+			}
+		}
+
+		const bool newPlacement = pPlaced == nullptr;
+		if (newPlacement)
+		{
+			PlacedResource placed = {};
+			placed.request = request;
+			placed.offset = offset;
+			ThrowIfFailed(m_d3d12Device->CreatePlacedResource(m_Heap.Get(), offset, &request.desc, request.initialState,
+				request.hasClearValue ? &request.clearValue : nullptr, IID_PPV_ARGS(&placed.resource)));
+			m_StateTracker.Register(placed.resource.Get(), request.initialState, GetSubresourceCount(request.desc));
+			m_PlacedResources.push_back(placed);
+			pPlaced = &m_PlacedResources.back();
+		}
+
+		pPlaced->used = true;
+		graph.SetTransientResource(handle, pPlaced->resource.Get(), newPlacement);
+	}
+
+	// Resources of earlier frames' transients
+	kept = 0;
+	for (size_t i = 0; i < m_PlacedResources.size(); i++)
+	{
+		if (m_PlacedResources[i].used)
+			m_PlacedResources[kept++] = m_PlacedResources[i];
+		else
+			Retire(m_PlacedResources[i].resource, nullptr);
+	}
+	m_PlacedResources.resize(kept);
+
+	m_Requests.clear();
+}
+
+
+void TransientHeap::Retire(ComPtr<ID3D12Resource> resource, ComPtr<ID3D12Heap> heap)
+{
+	// One signal for all the resources an Allocate() retires
+	if (m_RetireFenceValue == 0)
+		m_RetireFenceValue = m_CommandQueue->Signal();
+
+	if (resource)
+		m_StateTracker.Unregister(resource.Get());
+	m_Retired.push_back(Retired{ m_RetireFenceValue, resource, heap });
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>    // For Microsoft::WRL::ComPtr
+#include <memory>
+#include <vector>
+
+#include "CommandQueue.h"
+#include "../Utils/RenderGraph.h"
+#include "../Utils/ResourceStateTracker.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Memory for the transients of a RenderGraph: one default heap with buffers and textures together
+// (resource heap tier 2), placed resources at the offsets the graph's Compile() gave them.
+//
+// The placed resources stay from frame to frame while the graph asks for the same desc at the same
+// offset, so descriptors to them stay valid too. The ones a frame doesn't use any more, and the heap
+// when a frame needs a larger one, are released once the queue's fence passes the frames that may
+// still use them. Placed resources are registered with the state tracker while they live.
+//
+// Not thread-safe: used by the thread recording the graph's passes on the queue.
+class TransientHeap
+{
+public:
+	TransientHeap(ComPtr<ID3D12Device5> device, std::shared_ptr<CommandQueue> commandQueue, ResourceStateTracker& stateTracker);
+	~TransientHeap();
+	TransientHeap(const TransientHeap&) = delete;
+	TransientHeap& operator=(const TransientHeap&) = delete;
+
+	// A transient of graph for the frame being declared, created in initialState (pClearValue for
+	// render targets and depth)
+	RenderGraph::Handle CreateTransient(RenderGraph& graph, const char* name, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue = nullptr);
+
+	// After graph.Compile(): the placed resources for the transients the graph uses, handed to it
+	void Allocate(RenderGraph& graph);
+
+	UINT64 GetHeapSize() const { return m_HeapSize; }
+
+private:
+	struct Request
+	{
+		D3D12_RESOURCE_DESC desc;
+		D3D12_RESOURCE_STATES initialState;
+		bool hasClearValue;
+		D3D12_CLEAR_VALUE clearValue;
+	};
+
+	struct PlacedResource
+	{
+		Request request;
+		UINT64 offset;
+		ComPtr<ID3D12Resource> resource;
+		bool used;
+	};
+
+	struct Retired
+	{
+		UINT64 fenceValue;
+		ComPtr<ID3D12Resource> resource;
+		ComPtr<ID3D12Heap> heap;
+	};
+
+	// Released after the work submitted so far
+	void Retire(ComPtr<ID3D12Resource> resource, ComPtr<ID3D12Heap> heap);
+
+private:
+	ComPtr<ID3D12Device5> m_d3d12Device;
+	std::shared_ptr<CommandQueue> m_CommandQueue;
+	ResourceStateTracker& m_StateTracker;
+
+	ComPtr<ID3D12Heap> m_Heap;
+	UINT64 m_HeapSize = 0;
+
+	// Per graph handle of this frame's transients (imported handles unused)
+	std::vector<Request> m_Requests;
+	std::vector<PlacedResource> m_PlacedResources;
+	std::vector<Retired> m_Retired;
+	// Fence value that covers the frames submitted before this Allocate(), 0 until needed
+	UINT64 m_RetireFenceValue = 0;
+};
@@ -0,0 +1,139 @@
+#include <cstring>
+#include "../Helpers/Helpers.h"
+#include "../Helpers/d3dx12.h"
+
+#include "UploadRingBuffer.h"
+
+
+UploadRingBuffer::UploadRingBuffer(ComPtr<ID3D12Device5> device, std::shared_ptr<CommandQueue> commandQueue, UINT64 size)
+	: m_d3d12Device(device)
+	, m_CommandQueue(commandQueue)
+	, m_Ring(size)
+{
+	ThrowIfFailed(m_d3d12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_Resource)));
+
+	// Upload heaps may stay mapped for their whole lifetime - the CPU only writes, the range read is empty
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_Resource->Map(0, &readRange, reinterpret_cast<void**>(&m_pMappedData)));
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	// The GPU may still read the ring
+	m_CommandQueue->WaitForFenceValue(Submit());
+	m_Resource->Unmap(0, nullptr);
+}
+
+
+UINT64 UploadRingBuffer::AllocateStaging(UINT64 size, UINT64 alignment)
+{
+	m_Ring.Reclaim(m_CommandQueue->GetCompletedFenceValue());
+	UINT64 offset = m_Ring.Allocate(size, alignment);
+	while (offset == FenceRingAllocator::kInvalidOffset)
+	{
+		// Full: the open copies go to the GPU, then the oldest batch is waited for
+		Submit();
+		m_CommandQueue->WaitForFenceValue(m_Ring.GetOldestPendingFence());
+		m_Stats.stalls++;
+
+		m_Ring.Reclaim(m_CommandQueue->GetCompletedFenceValue());
+		offset = m_Ring.Allocate(size, alignment);
+	}
+	return offset;
+}
+
+
+void UploadRingBuffer::Upload(ID3D12Resource* pDestination, UINT64 destinationOffset, const void* pData, UINT64 size)
+{
+	m_Stats.uploads++;
+	m_Stats.uploadedBytes += size;
+
+	// Chunks of a quarter of the ring, so the GPU copies one while the CPU fills the next
+	const UINT64 maxChunk = m_Ring.GetCapacity() / 4;
+	const UINT8* pSource = static_cast<const UINT8*>(pData);
+	for (UINT64 done = 0; done < size;)
+	{
+		const UINT64 chunk = size - done < maxChunk ? size - done : maxChunk;
+		const UINT64 offset = AllocateStaging(chunk);
+		memcpy(m_pMappedData + offset, pSource + done, (size_t)chunk);
+
+		if (!m_CommandList)
+			m_CommandList = m_CommandQueue->GetCommandList();
+		m_CommandList->CopyBufferRegion(pDestination, destinationOffset + done, m_Resource.Get(), offset, chunk);
+		m_Stats.copies++;
+
+		done += chunk;
+	}
+}
+
+
+void UploadRingBuffer::UploadTexture(ID3D12Resource* pDestination, UINT firstSubresource, UINT subresourceCount, const D3D12_SUBRESOURCE_DATA* pSubresources)
+{
+	const D3D12_RESOURCE_DESC desc = pDestination->GetDesc();
+	for (UINT i = 0; i < subresourceCount; i++)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+		UINT rowCount;
+		UINT64 rowSize, totalSize;
+		m_d3d12Device->GetCopyableFootprints(&desc, firstSubresource + i, 1, 0, &footprint, &rowCount, &rowSize, &totalSize);
+		if (totalSize > m_Ring.GetCapacity())
+			ThrowIfFailed(E_INVALIDARG);
+
+		m_Stats.uploads++;
+		m_Stats.uploadedBytes += totalSize;
+
+		// Rows (and slices) at the footprint's pitch - wider than the source rows, 256-byte aligned
+		footprint.Offset = AllocateStaging(totalSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		const D3D12_SUBRESOURCE_DATA& source = pSubresources[i];
+		for (UINT z = 0; z < footprint.Footprint.Depth; z++)
+		{
+			UINT8* pSliceDest = m_pMappedData + footprint.Offset + (UINT64)z * footprint.Footprint.RowPitch * rowCount;
+			const UINT8* pSliceSource = static_cast<const UINT8*>(source.pData) + z * source.SlicePitch;
+			for (UINT row = 0; row < rowCount; row++)
+				memcpy(pSliceDest + (UINT64)row * footprint.Footprint.RowPitch, pSliceSource + row * source.RowPitch, (size_t)rowSize);
+		}
+
+		if (!m_CommandList)
+			m_CommandList = m_CommandQueue->GetCommandList();
+		CD3DX12_TEXTURE_COPY_LOCATION destination(pDestination, firstSubresource + i);
+		CD3DX12_TEXTURE_COPY_LOCATION staging(m_Resource.Get(), footprint);
+		m_CommandList->CopyTextureRegion(&destination, 0, 0, 0, &staging, nullptr);
+		m_Stats.copies++;
+	}
+}
+
+
+ComPtr<ID3D12Resource> UploadRingBuffer::CreateBuffer(const void* pData, UINT64 size, D3D12_RESOURCE_FLAGS flags)
+{
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(m_d3d12Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size, flags),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&buffer)));
+
+	if (pData)
+		Upload(buffer.Get(), 0, pData, size);
+	return buffer;
+}
+
+
+UINT64 UploadRingBuffer::Submit()
+{
+	if (m_CommandList)
+	{
+		m_LastFenceValue = m_CommandQueue->ExecuteCommandList(m_CommandList);
+		m_CommandList = nullptr;
+		m_Ring.FinishBatch(m_LastFenceValue);
+		m_Stats.submits++;
+	}
+	return m_LastFenceValue;
+}
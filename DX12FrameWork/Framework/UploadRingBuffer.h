@@ -0,0 +1,75 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>    // For Microsoft::WRL::ComPtr
+#include <memory>
+
+#include "CommandQueue.h"
+#include "../Utils/FenceRingAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Staging memory for buffer and texture uploads: one persistently mapped upload heap buffer,
+// sub-allocated as a ring (FenceRingAllocator) instead of a committed upload resource per buffer.
+//
+// Uploads are copied into the ring and recorded into one command list of the queue (a copy queue
+// normally). Submit() executes that list, and the fence value it returns tags the ring space the
+// copies used - the space comes back once the queue's fence passes it. Data larger than a quarter
+// of the ring goes in chunks. A full ring submits the pending copies and waits for the oldest
+// batch, so any amount of data fits through any ring size.
+//
+// Not thread-safe: one thread records the uploads.
+class UploadRingBuffer
+{
+public:
+	struct Stats
+	{
+		UINT64 uploads = 0;			// Upload() calls and texture subresources
+		UINT64 uploadedBytes = 0;
+		UINT64 copies = 0;			// CopyBufferRegion/CopyTextureRegion calls (chunks, subresources)
+		UINT64 submits = 0;
+		UINT64 stalls = 0;			// waits for the GPU on a full ring
+	};
+
+	UploadRingBuffer(ComPtr<ID3D12Device5> device, std::shared_ptr<CommandQueue> commandQueue, UINT64 size = 32 * 1024 * 1024);
+	~UploadRingBuffer();
+	UploadRingBuffer(const UploadRingBuffer&) = delete;
+	UploadRingBuffer& operator=(const UploadRingBuffer&) = delete;
+
+	// Records a copy of size bytes from pData to pDestination at destinationOffset. pDestination
+	// must be in D3D12_RESOURCE_STATE_COPY_DEST (or COMMON, promoted) until the copy has executed.
+	void Upload(ID3D12Resource* pDestination, UINT64 destinationOffset, const void* pData, UINT64 size);
+
+	// Records the copies of subresourceCount subresources from firstSubresource on, one footprint
+	// (256-byte row pitch, 512-byte aligned) in the ring each. A subresource has to fit in the ring.
+	// pDestination must be in COPY_DEST (or COMMON, promoted) until the copies have executed.
+	void UploadTexture(ID3D12Resource* pDestination, UINT firstSubresource, UINT subresourceCount, const D3D12_SUBRESOURCE_DATA* pSubresources);
+
+	// A default heap buffer in COPY_DEST with an Upload() of pData (size bytes) recorded, if not null
+	ComPtr<ID3D12Resource> CreateBuffer(const void* pData, UINT64 size, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+
+	// Executes the recorded copies. Returns the fence value of the queue to wait for before the
+	// destinations are used - the one of the last submit if nothing was recorded since.
+	UINT64 Submit();
+
+	std::shared_ptr<CommandQueue> GetCommandQueue() const { return m_CommandQueue; }
+	const Stats& GetStats() const { return m_Stats; }
+	const FenceRingAllocator& GetRing() const { return m_Ring; }
+
+private:
+	// Ring space for size bytes, submitting and waiting while the ring is full
+	UINT64 AllocateStaging(UINT64 size, UINT64 alignment = 16);
+
+private:
+	ComPtr<ID3D12Device5> m_d3d12Device;
+	std::shared_ptr<CommandQueue> m_CommandQueue;
+
+	ComPtr<ID3D12Resource> m_Resource;
+	UINT8* m_pMappedData = nullptr;
+	FenceRingAllocator m_Ring;
+
+	// Open list of the copies since the last Submit(), null if none
+	ComPtr<ID3D12GraphicsCommandList4> m_CommandList;
+	UINT64 m_LastFenceValue = 0;
+
+	Stats m_Stats;
+};
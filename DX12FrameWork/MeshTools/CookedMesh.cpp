@@ -0,0 +1,209 @@
+#include "CookedMesh.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace MeshTools
+{
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + kCookedMeshAlignment - 1) & ~(uint64_t)(kCookedMeshAlignment - 1);
+	}
+
+	bool WriteAt(FILE* pFile, uint64_t* pPosition, uint64_t offset, const void* pData, uint64_t size)
+	{
+		// Zero padding up to the aligned section start
+		static const uint8_t kZeros[kCookedMeshAlignment] = {};
+		while (*pPosition < offset)
+		{
+			const size_t padding = (size_t)(offset - *pPosition);
+			const size_t chunk = padding < sizeof(kZeros) ? padding : sizeof(kZeros);
+			if (fwrite(kZeros, 1, chunk, pFile) != chunk)
+				return false;
+			*pPosition += chunk;
+		}
+
+		if (size && fwrite(pData, 1, (size_t)size, pFile) != (size_t)size)
+			return false;
+		*pPosition += size;
+		return true;
+	}
+
+	// [offset, offset + count) within [0, size), without overflow
+	bool IsRangeInside(uint64_t offset, uint64_t count, uint64_t size)
+	{
+		return offset <= size && count <= size - offset;
+	}
+
+	// The submeshes, LODs and meshlets point into the other sections - entries outside them
+	// would be read past the mapping by the loader, so such a cache counts as stale
+	bool AreEntriesValid(const uint8_t* pData, const CookedMeshHeader& header)
+	{
+		const CookedSubmesh* pSubmeshes = reinterpret_cast<const CookedSubmesh*>(pData + header.submeshOffset);
+		const MeshLod* pLods = reinterpret_cast<const MeshLod*>(pData + header.lodOffset);
+		const Meshlet* pMeshlets = reinterpret_cast<const Meshlet*>(pData + header.meshletOffset);
+
+		for (uint32_t s = 0; s < header.submeshCount; s++)
+		{
+			const CookedSubmesh& submesh = pSubmeshes[s];
+			if ((submesh.indexSize != 2 && submesh.indexSize != 4) || submesh.indexByteOffset % 4 != 0 ||
+				!IsRangeInside(submesh.baseVertex, submesh.vertexCount, header.vertexCount) ||
+				!IsRangeInside(submesh.indexByteOffset, (uint64_t)submesh.indexCount * submesh.indexSize, header.indexDataSize) ||
+				!IsRangeInside(submesh.firstLod, submesh.lodCount, header.lodCount) ||
+				!IsRangeInside(submesh.firstMeshlet, submesh.meshletCount, header.meshletCount))
+				return false;
+
+			// LOD runs have the index size of their submesh
+			for (uint32_t l = 0; l < submesh.lodCount; l++)
+			{
+				const MeshLod& lod = pLods[submesh.firstLod + l];
+				if (lod.indexByteOffset % 4 != 0 ||
+					!IsRangeInside(lod.indexByteOffset, (uint64_t)lod.indexCount * submesh.indexSize, header.indexDataSize))
+					return false;
+			}
+		}
+
+		for (uint32_t m = 0; m < header.meshletCount; m++)
+		{
+			if (!IsRangeInside(pMeshlets[m].vertexOffset, pMeshlets[m].vertexCount, header.meshletVertexCount) ||
+				!IsRangeInside(pMeshlets[m].primitiveOffset, pMeshlets[m].primitiveCount, header.meshletPrimitiveCount))
+				return false;
+		}
+		return true;
+	}
+}
+
+// =====================================================================================
+//										Write
+// =====================================================================================
+
+uint64_t HashSourceFile(const char* path)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return 0;
+	return HashBytes(file.GetData(), file.GetSize());
+}
+
+bool WriteCookedMesh(const char* path, uint64_t sourceHash,
+	const void* pVertices, uint32_t vertexCount, uint32_t vertexStride,
+	const void* pIndexData, uint64_t indexDataSize,
+	const CookedSubmesh* pSubmeshes, uint32_t submeshCount,
+	const MeshletData* pMeshlets, VertexFormat vertexFormat,
+	const MeshLod* pLods, uint32_t lodCount)
+{
+	static const MeshletData kNoMeshlets;
+	if (!pMeshlets)
+		pMeshlets = &kNoMeshlets;
+
+	CookedMeshHeader header = {};
+	header.magic = kCookedMeshMagic;
+	header.version = kCookedMeshVersion;
+	header.sourceHash = sourceHash;
+	header.vertexStride = vertexStride;
+	header.vertexCount = vertexCount;
+	header.submeshCount = submeshCount;
+	header.lodCount = lodCount;
+	header.submeshOffset = AlignUp(sizeof(CookedMeshHeader));
+	header.vertexOffset = AlignUp(header.submeshOffset + (uint64_t)submeshCount * sizeof(CookedSubmesh));
+	header.indexOffset = AlignUp(header.vertexOffset + (uint64_t)vertexCount * vertexStride);
+	header.indexDataSize = indexDataSize;
+	header.meshletCount = (uint32_t)pMeshlets->meshlets.size();
+	header.meshletVertexCount = (uint32_t)pMeshlets->vertexIndices.size();
+	header.meshletPrimitiveCount = (uint32_t)pMeshlets->primitives.size();
+	header.vertexFormat = vertexFormat.ToBits();
+	header.meshletOffset = AlignUp(header.indexOffset + indexDataSize);
+	header.meshletBoundsOffset = AlignUp(header.meshletOffset + (uint64_t)header.meshletCount * sizeof(Meshlet));
+	header.meshletVertexOffset = AlignUp(header.meshletBoundsOffset + (uint64_t)header.meshletCount * sizeof(MeshletBounds));
+	header.meshletPrimitiveOffset = AlignUp(header.meshletVertexOffset + (uint64_t)header.meshletVertexCount * sizeof(uint32_t));
+	header.lodOffset = AlignUp(header.meshletPrimitiveOffset + (uint64_t)header.meshletPrimitiveCount * sizeof(uint32_t));
+
+	// Written under a temporary name and renamed at the end, so an interrupted
+	// cook never leaves a truncated cache behind that passes the header checks
+	const std::string tempPath = std::string(path) + ".tmp";
+	FILE* pFile = fopen(tempPath.c_str(), "wb");
+	if (!pFile)
+		return false;
+
+	uint64_t position = 0;
+	bool ok = WriteAt(pFile, &position, 0, &header, sizeof(header))
+		&& WriteAt(pFile, &position, header.submeshOffset, pSubmeshes, (uint64_t)submeshCount * sizeof(CookedSubmesh))
+		&& WriteAt(pFile, &position, header.vertexOffset, pVertices, (uint64_t)vertexCount * vertexStride)
+		&& WriteAt(pFile, &position, header.indexOffset, pIndexData, indexDataSize)
+		&& WriteAt(pFile, &position, header.meshletOffset, pMeshlets->meshlets.data(), (uint64_t)header.meshletCount * sizeof(Meshlet))
+		&& WriteAt(pFile, &position, header.meshletBoundsOffset, pMeshlets->bounds.data(), (uint64_t)header.meshletCount * sizeof(MeshletBounds))
+		&& WriteAt(pFile, &position, header.meshletVertexOffset, pMeshlets->vertexIndices.data(), (uint64_t)header.meshletVertexCount * sizeof(uint32_t))
+		&& WriteAt(pFile, &position, header.meshletPrimitiveOffset, pMeshlets->primitives.data(), (uint64_t)header.meshletPrimitiveCount * sizeof(uint32_t))
+		&& WriteAt(pFile, &position, header.lodOffset, pLods, (uint64_t)lodCount * sizeof(MeshLod));
+	ok = fclose(pFile) == 0 && ok;
+
+	if (ok)
+	{
+		remove(path);
+		ok = rename(tempPath.c_str(), path) == 0;
+	}
+	if (!ok)
+		remove(tempPath.c_str());
+	return ok;
+}
+
+// =====================================================================================
+//										Load
+// =====================================================================================
+
+bool CookedMesh::Open(const char* path, uint64_t sourceHash, uint32_t vertexStride, VertexFormat vertexFormat)
+{
+	Close();
+	if (!m_File.Open(path) || m_File.GetSize() < sizeof(CookedMeshHeader))
+	{
+		m_File.Close();
+		return false;
+	}
+
+	const CookedMeshHeader* pHeader = reinterpret_cast<const CookedMeshHeader*>(m_File.GetData());
+	const uint64_t fileSize = m_File.GetSize();
+	const bool valid =
+		pHeader->magic == kCookedMeshMagic &&
+		pHeader->version == kCookedMeshVersion &&
+		pHeader->sourceHash == sourceHash &&
+		pHeader->vertexStride == vertexStride &&
+		pHeader->vertexFormat == vertexFormat.ToBits() &&
+		pHeader->submeshOffset + (uint64_t)pHeader->submeshCount * sizeof(CookedSubmesh) <= fileSize &&
+		pHeader->vertexOffset + (uint64_t)pHeader->vertexCount * pHeader->vertexStride <= fileSize &&
+		pHeader->indexOffset + pHeader->indexDataSize <= fileSize &&
+		pHeader->meshletOffset + (uint64_t)pHeader->meshletCount * sizeof(Meshlet) <= fileSize &&
+		pHeader->meshletBoundsOffset + (uint64_t)pHeader->meshletCount * sizeof(MeshletBounds) <= fileSize &&
+		pHeader->meshletVertexOffset + (uint64_t)pHeader->meshletVertexCount * sizeof(uint32_t) <= fileSize &&
+		pHeader->meshletPrimitiveOffset + (uint64_t)pHeader->meshletPrimitiveCount * sizeof(uint32_t) <= fileSize &&
+		pHeader->lodOffset + (uint64_t)pHeader->lodCount * sizeof(MeshLod) <= fileSize &&
+		AreEntriesValid(m_File.GetData(), *pHeader);
+
+	if (!valid)
+	{
+		m_File.Close();
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	return true;
+}
+
+void CookedMesh::GetMeshlets(MeshletData* pOut) const
+{
+	const uint8_t* pData = m_File.GetData();
+	const Meshlet* pMeshlets = reinterpret_cast<const Meshlet*>(pData + m_pHeader->meshletOffset);
+	const MeshletBounds* pBounds = reinterpret_cast<const MeshletBounds*>(pData + m_pHeader->meshletBoundsOffset);
+	const uint32_t* pVertexIndices = reinterpret_cast<const uint32_t*>(pData + m_pHeader->meshletVertexOffset);
+	const uint32_t* pPrimitives = reinterpret_cast<const uint32_t*>(pData + m_pHeader->meshletPrimitiveOffset);
+
+	pOut->meshlets.assign(pMeshlets, pMeshlets + m_pHeader->meshletCount);
+	pOut->bounds.assign(pBounds, pBounds + m_pHeader->meshletCount);
+	pOut->vertexIndices.assign(pVertexIndices, pVertexIndices + m_pHeader->meshletVertexCount);
+	pOut->primitives.assign(pPrimitives, pPrimitives + m_pHeader->meshletPrimitiveCount);
+}
+
+} // namespace MeshTools
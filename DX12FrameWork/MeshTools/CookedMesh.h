@@ -0,0 +1,132 @@
+#pragma once
+
+// Cooked mesh cache: the post-processed (imported, converted, triangulated, welded)
+// vertex/index/submesh data of a source asset in one binary file, so a start doesn't
+// have to go through the importer again.
+//
+// Layout (little endian, every section 64-byte aligned):
+//		CookedMeshHeader
+//		CookedSubmesh[submeshCount]
+//		vertex data		vertexCount * vertexStride bytes, in vertexFormat (VertexQuantization.h)
+//		index data		indexDataSize bytes (16/32-bit runs, see CookedSubmesh)
+//		Meshlet[meshletCount], MeshletBounds[meshletCount]
+//		meshlet vertex indices	uint32_t[meshletVertexCount]
+//		meshlet primitives		uint32_t[meshletPrimitiveCount]
+//		MeshLod[lodCount]		index runs of the LOD chains, inside the index data
+//
+// The file is memory-mapped on load: GetVertexData()/GetIndexData() point into the mapping
+// and can go straight into an upload. A cache is stale when the format version, the vertex
+// format or the hash of the source file differs - Open() fails and the caller re-cooks.
+
+#include "Meshlet.h"
+#include "Simplify.h"
+#include "VertexQuantization.h"
+#include "../Utils/MappedFile.h"
+
+#include <cstdint>
+
+namespace MeshTools
+{
+
+struct CookedSubmesh
+{
+	char name[64];
+	// Row-major, row vectors (XMFLOAT4X4 layout)
+	float world[16];
+	uint32_t baseVertex;
+	uint32_t vertexCount;
+	uint32_t indexByteOffset;		// into the index data, a multiple of 4
+	uint32_t indexCount;
+	uint32_t indexSize;				// 2 or 4
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	// QuantizationBounds of Unorm16 positions (identity otherwise)
+	float positionOffset[3];
+	float positionScale[3];
+	uint32_t firstLod;				// LOD chain, coarser levels in order (Simplify.h)
+	uint32_t lodCount;
+	// Bounding sphere of the positions (before quantization), for the LOD distance
+	float boundsCenter[3];
+	float boundsRadius;
+	uint32_t reserved[5];
+};
+static_assert(sizeof(CookedSubmesh) == 224, "Part of the file format - bump kCookedMeshVersion on changes");
+
+struct CookedMeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t submeshCount;
+	uint32_t lodCount;
+	uint64_t submeshOffset;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t indexDataSize;
+	uint32_t meshletCount;
+	uint32_t meshletVertexCount;
+	uint32_t meshletPrimitiveCount;
+	uint32_t vertexFormat;			// VertexFormat::ToBits()
+	uint64_t meshletOffset;
+	uint64_t meshletBoundsOffset;
+	uint64_t meshletVertexOffset;
+	uint64_t meshletPrimitiveOffset;
+	uint64_t lodOffset;
+};
+
+const uint32_t kCookedMeshMagic = 0x4853454D;		// "MESH"
+// 2: index runs in post-transform vertex cache order (VertexCache.h)
+// 3: overdraw ordering (Overdraw.h), vertices in first-use order (VertexFetch.h)
+// 4: meshlets (Meshlet.h)
+// 5: packed vertex formats (VertexQuantization.h)
+// 6: LOD chains (Simplify.h)
+const uint32_t kCookedMeshVersion = 6;
+const uint32_t kCookedMeshAlignment = 64;
+
+// Content hash of a source asset, 0 if it can't be read
+uint64_t HashSourceFile(const char* path);
+
+// Writes a cooked mesh. pVertices: vertexCount vertices encoded in vertexFormat (vertexStride =
+// its GetStride() for anything but raw data). pMeshlets may be null (no meshlets). pLods: the
+// levels of all submeshes (CookedSubmesh::firstLod/lodCount), their runs part of pIndexData.
+// Returns false on I/O errors.
+bool WriteCookedMesh(const char* path, uint64_t sourceHash,
+	const void* pVertices, uint32_t vertexCount, uint32_t vertexStride,
+	const void* pIndexData, uint64_t indexDataSize,
+	const CookedSubmesh* pSubmeshes, uint32_t submeshCount,
+	const MeshletData* pMeshlets = nullptr, VertexFormat vertexFormat = VertexFormat(),
+	const MeshLod* pLods = nullptr, uint32_t lodCount = 0);
+
+class CookedMesh
+{
+public:
+	// Maps the cache file and checks it against the expected source hash, vertex stride and format.
+	// Returns false if the file is missing, truncated, stale or has entries outside its sections.
+	bool Open(const char* path, uint64_t sourceHash, uint32_t vertexStride, VertexFormat vertexFormat = VertexFormat());
+	void Close() { m_File.Close(); m_pHeader = nullptr; }
+
+	bool IsOpen() const { return m_pHeader != nullptr; }
+	uint32_t GetVertexCount() const { return m_pHeader->vertexCount; }
+	uint32_t GetVertexStride() const { return m_pHeader->vertexStride; }
+	VertexFormat GetVertexFormat() const { return VertexFormat::FromBits(m_pHeader->vertexFormat); }
+	const void* GetVertexData() const { return m_File.GetData() + m_pHeader->vertexOffset; }
+	uint64_t GetIndexDataSize() const { return m_pHeader->indexDataSize; }
+	const void* GetIndexData() const { return m_File.GetData() + m_pHeader->indexOffset; }
+	uint32_t GetSubmeshCount() const { return m_pHeader->submeshCount; }
+	const CookedSubmesh* GetSubmeshes() const { return reinterpret_cast<const CookedSubmesh*>(m_File.GetData() + m_pHeader->submeshOffset); }
+
+	// LOD levels of all submeshes (CookedSubmesh::firstLod/lodCount), in the mapping
+	uint32_t GetLodCount() const { return m_pHeader->lodCount; }
+	const MeshLod* GetLods() const { return reinterpret_cast<const MeshLod*>(m_File.GetData() + m_pHeader->lodOffset); }
+
+	// Meshlets of all submeshes (CookedSubmesh::firstMeshlet/meshletCount) - copies of the mapped arrays
+	void GetMeshlets(MeshletData* pOut) const;
+
+private:
+	MappedFile m_File;
+	const CookedMeshHeader* m_pHeader = nullptr;
+};
+
+} // namespace MeshTools
@@ -0,0 +1,138 @@
+#pragma once
+
+// Loader-independent mesh container of MeshTools: all parts of a file in one vertex
+// array and one index arena. Same layout as MeshData of 2_Mesh (VertexPosColor, Submesh),
+// so a loaded mesh can be handed to the renderer without conversion of the buffers.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../Utils/ThreadPool.h"
+
+namespace MeshTools
+{
+
+// Layout of VertexPosColor (XMFLOAT3 Position, Color, Normal, XMFLOAT2 UV)
+struct MeshVertex
+{
+	float position[3];
+	float color[3];
+	float normal[3];
+	float uv[2];
+};
+static_assert(sizeof(MeshVertex) == 44, "Must match VertexPosColor");
+
+// A range of the shared arena. Indices are relative to baseVertex.
+struct MeshPart
+{
+	std::string name;
+	uint32_t baseVertex = 0;
+	uint32_t vertexCount = 0;
+	// Offset into IndexedMesh::indexData, a multiple of 4 bytes
+	uint32_t indexByteOffset = 0;
+	uint32_t indexCount = 0;
+	// 2 unless the part has more than 65536 vertices
+	uint32_t indexSize = 2;
+};
+
+struct IndexedMesh
+{
+	std::vector<MeshVertex> vertices;
+	// Runs of 16- or 32-bit indices, one per part
+	std::vector<uint8_t> indexData;
+	std::vector<MeshPart> parts;
+
+	void Clear() { vertices.clear(); indexData.clear(); parts.clear(); }
+
+	uint32_t GetIndex(const MeshPart& part, uint32_t i) const
+	{
+		const uint8_t* pRun = &indexData[part.indexByteOffset];
+		if (part.indexSize == 4)
+		{
+			uint32_t index;
+			memcpy(&index, pRun + i * 4, 4);
+			return index;
+		}
+		uint16_t index;
+		memcpy(&index, pRun + i * 2, 2);
+		return index;
+	}
+
+	size_t GetIndexCount() const
+	{
+		size_t count = 0;
+		for (const MeshPart& part : parts)
+			count += part.indexCount;
+		return count;
+	}
+};
+
+// Size of the index run of a part with indexCount indices, padded to keep the next run 4-byte aligned
+inline size_t GetIndexRunSize(uint32_t indexCount, uint32_t indexSize)
+{
+	return ((size_t)indexCount * indexSize + 3) & ~(size_t)3;
+}
+
+// Index runs of either size as 32-bit indices, for the processing steps that work on uint32_t
+inline void ReadIndexRun(const void* pIndices, uint32_t indexSize, uint32_t indexCount, std::vector<uint32_t>* pOut)
+{
+	pOut->resize(indexCount);
+	if (indexSize == 4)
+	{
+		memcpy(pOut->data(), pIndices, (size_t)indexCount * sizeof(uint32_t));
+		return;
+	}
+	const uint16_t* pIndices16 = static_cast<const uint16_t*>(pIndices);
+	for (uint32_t i = 0; i < indexCount; i++)
+		(*pOut)[i] = pIndices16[i];
+}
+
+inline void WriteIndexRun(const std::vector<uint32_t>& indices, uint32_t indexSize, void* pOut)
+{
+	if (indexSize == 4)
+	{
+		memcpy(pOut, indices.data(), indices.size() * sizeof(uint32_t));
+		return;
+	}
+	uint16_t* pOut16 = static_cast<uint16_t*>(pOut);
+	for (size_t i = 0; i < indices.size(); i++)
+		pOut16[i] = (uint16_t)indices[i];
+}
+
+// Triangles (first index / 3) of every vertex in compressed sparse rows: the (*pCounts)[v] triangles
+// of v start at (*pTriangles)[(*pOffsets)[v]]
+inline void BuildVertexTriangles(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+	std::vector<uint32_t>* pCounts, std::vector<uint32_t>* pOffsets, std::vector<uint32_t>* pTriangles)
+{
+	pCounts->assign(vertexCount, 0);
+	for (uint32_t index : indices)
+		(*pCounts)[index]++;
+
+	pOffsets->assign(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; v++)
+		(*pOffsets)[v + 1] = (*pOffsets)[v] + (*pCounts)[v];
+
+	std::vector<uint32_t> fill(pOffsets->begin(), pOffsets->end() - 1);
+	pTriangles->resize(indices.size());
+	for (uint32_t i = 0; i < (uint32_t)indices.size(); i++)
+		(*pTriangles)[fill[indices[i]]++] = i / 3;
+}
+
+// body(part) for every part of the mesh, on the threads of pPool if there is one
+template<typename Body>
+void ForEachPart(IndexedMesh* pMesh, ThreadPool* pPool, const Body& body)
+{
+	if (pPool)
+	{
+		ParallelForWorkStealing(*pPool, (uint32_t)pMesh->parts.size(), [&](uint32_t p, uint32_t) { body(pMesh->parts[p]); });
+	}
+	else
+	{
+		for (const MeshPart& part : pMesh->parts)
+			body(part);
+	}
+}
+
+} // namespace MeshTools
@@ -0,0 +1,28 @@
+#pragma once
+
+// Position math shared by the MeshTools processing steps. Positions are read in place from the
+// vertex arrays: the 3 floats at the start of each vertex, any stride.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace MeshTools
+{
+
+struct float3
+{
+	float x, y, z;
+};
+
+inline float3 Sub(const float3& a, const float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline float3 Cross(const float3& a, const float3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline float Dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float Length(const float3& a) { return sqrtf(Dot(a, a)); }
+
+inline const float3& GetPosition(const float* pPositions, size_t positionStride, uint32_t index)
+{
+	return *reinterpret_cast<const float3*>(reinterpret_cast<const uint8_t*>(pPositions) + index * positionStride);
+}
+
+} // namespace MeshTools
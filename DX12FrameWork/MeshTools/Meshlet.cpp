@@ -0,0 +1,368 @@
+#include "Meshlet.h"
+#include "IndexedMesh.h"
+#include "MeshToolsMath.h"
+#include "Overdraw.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace MeshTools
+{
+
+namespace
+{
+	const uint32_t kNotInMeshlet = 0xFFFFFFFF;
+	const uint32_t kNoTriangle = 0xFFFFFFFF;
+
+	// Vertices of a triangle not in the meshlet yet - repeated corners of a degenerate triangle count once.
+	// OptimizeMeshletOrder and BuildMeshlets must agree on this, they cut at the same triangles.
+	template<typename IsInMeshlet>
+	uint32_t CountNewVertices(const uint32_t* pCorners, const IsInMeshlet& isInMeshlet)
+	{
+		uint32_t newVertices = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			const bool repeated = (c > 0 && pCorners[c] == pCorners[0]) || (c > 1 && pCorners[c] == pCorners[1]);
+			newVertices += !isInMeshlet(pCorners[c]) && !repeated;
+		}
+		return newVertices;
+	}
+
+	MeshletBounds ComputeBounds(const MeshletData& data, const Meshlet& meshlet, const float* pPositions, size_t positionStride)
+	{
+		MeshletBounds bounds = {};
+		const uint32_t* pVertices = &data.vertexIndices[meshlet.vertexOffset];
+
+		// Sphere around the box center - within a few % of the minimal one for these small clusters
+		float3 boxMin = GetPosition(pPositions, positionStride, pVertices[0]), boxMax = boxMin;
+		for (uint32_t v = 1; v < meshlet.vertexCount; v++)
+		{
+			const float3& p = GetPosition(pPositions, positionStride, pVertices[v]);
+			boxMin = { std::min(boxMin.x, p.x), std::min(boxMin.y, p.y), std::min(boxMin.z, p.z) };
+			boxMax = { std::max(boxMax.x, p.x), std::max(boxMax.y, p.y), std::max(boxMax.z, p.z) };
+		}
+		const float3 center = { (boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f };
+		float radius = 0.0f;
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+			radius = std::max(radius, Length(Sub(GetPosition(pPositions, positionStride, pVertices[v]), center)));
+
+		bounds.center[0] = center.x;
+		bounds.center[1] = center.y;
+		bounds.center[2] = center.z;
+		bounds.radius = radius;
+
+		// Normal cone: axis = average of the unit normals, half angle from the normal furthest away
+		std::vector<float3> normals;
+		normals.reserve(meshlet.primitiveCount);
+		float3 axis = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t t = 0; t < meshlet.primitiveCount; t++)
+		{
+			const uint32_t packed = data.primitives[meshlet.primitiveOffset + t];
+			const float3& a = GetPosition(pPositions, positionStride, pVertices[packed & 0x3FF]);
+			const float3& b = GetPosition(pPositions, positionStride, pVertices[(packed >> 10) & 0x3FF]);
+			const float3& c = GetPosition(pPositions, positionStride, pVertices[(packed >> 20) & 0x3FF]);
+
+			const float3 n = Cross(Sub(b, a), Sub(c, a));
+			const float length = Length(n);
+			if (length == 0.0f)
+				continue;		// degenerate triangles are never rasterized
+
+			normals.push_back({ n.x / length, n.y / length, n.z / length });
+			axis = { axis.x + normals.back().x, axis.y + normals.back().y, axis.z + normals.back().z };
+		}
+
+		bounds.coneCutoff = 2.0f;
+		const float axisLength = Length(axis);
+		if (axisLength > 0.0f)
+		{
+			axis = { axis.x / axisLength, axis.y / axisLength, axis.z / axisLength };
+			float minDot = 1.0f;
+			for (const float3& n : normals)
+				minDot = std::min(minDot, Dot(n, axis));
+
+			bounds.coneAxis[0] = axis.x;
+			bounds.coneAxis[1] = axis.y;
+			bounds.coneAxis[2] = axis.z;
+			// A cone of 90 degrees or more can't be behind a camera as a whole
+			if (minDot > 0.0f)
+				bounds.coneCutoff = sqrtf(1.0f - minDot * minDot);
+		}
+		return bounds;
+	}
+}
+
+// =====================================================================================
+//										Order
+// =====================================================================================
+
+void OptimizeMeshletOrder(void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount,
+	bool sortForOverdraw, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	maxVertices = std::min(std::max(maxVertices, 3u), 1024u);
+	maxTriangles = std::max(maxTriangles, 1u);
+
+	const uint32_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, triangleCount * 3, &indices);
+
+	// Triangles of every vertex; the first remainingTriangles[v] entries are the ones not emitted yet
+	std::vector<uint32_t> remainingTriangles, adjacencyOffsets, adjacency;
+	BuildVertexTriangles(indices, vertexCount, &remainingTriangles, &adjacencyOffsets, &adjacency);
+
+	// Membership of the current meshlet: meshletStamps[v] == meshletIndex
+	std::vector<uint32_t> meshletStamps(vertexCount, kNotInMeshlet);
+	uint32_t meshletIndex = 0;
+	std::vector<uint32_t> meshletVertices;
+	meshletVertices.reserve(maxVertices);
+	uint32_t meshletTriangles = 0;
+	float3 positionSum = { 0.0f, 0.0f, 0.0f };
+	std::vector<uint32_t> meshletStarts(1, 0);
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> output(triangleCount * 3);
+	uint32_t scanCursor = 0;
+	uint32_t nextTriangle = kNoTriangle;
+	auto isInMeshlet = [&](uint32_t v) { return meshletStamps[v] == meshletIndex; };
+
+	for (uint32_t outTriangle = 0; outTriangle < triangleCount; outTriangle++)
+	{
+		if (nextTriangle == kNoTriangle)
+		{
+			// Nothing left around the meshlet: continue with the next triangle in input order
+			while (emitted[scanCursor])
+				scanCursor++;
+			nextTriangle = scanCursor;
+		}
+
+		const uint32_t* pCorners = &indices[nextTriangle * 3];
+		if (meshletVertices.size() + CountNewVertices(pCorners, isInMeshlet) > maxVertices || meshletTriangles + 1 > maxTriangles)
+		{
+			meshletIndex++;
+			meshletStarts.push_back(outTriangle);
+			meshletVertices.clear();
+			meshletTriangles = 0;
+			positionSum = { 0.0f, 0.0f, 0.0f };
+		}
+
+		memcpy(&output[outTriangle * 3], pCorners, 3 * sizeof(uint32_t));
+		emitted[nextTriangle] = 1;
+		meshletTriangles++;
+		for (int c = 0; c < 3; c++)
+		{
+			const uint32_t v = pCorners[c];
+
+			// Remove the triangle from the vertex's remaining list
+			uint32_t* pTriangles = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t i = 0; i < remainingTriangles[v]; i++)
+			{
+				if (pTriangles[i] == nextTriangle)
+				{
+					pTriangles[i] = pTriangles[--remainingTriangles[v]];
+					break;
+				}
+			}
+
+			if (!isInMeshlet(v))
+			{
+				meshletStamps[v] = meshletIndex;
+				meshletVertices.push_back(v);
+				const float3& p = GetPosition(pPositions, positionStride, v);
+				positionSum = { positionSum.x + p.x, positionSum.y + p.y, positionSum.z + p.z };
+			}
+		}
+
+		// Next: a triangle sharing a vertex with the meshlet, fewest new vertices, then nearest to its center
+		const float scale = 1.0f / meshletVertices.size();
+		const float3 center = { positionSum.x * scale, positionSum.y * scale, positionSum.z * scale };
+		nextTriangle = kNoTriangle;
+		uint32_t bestNewVertices = 4;
+		float bestDistance = FLT_MAX;
+		for (uint32_t v : meshletVertices)
+		{
+			const uint32_t* pTriangles = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t i = 0; i < remainingTriangles[v]; i++)
+			{
+				const uint32_t t = pTriangles[i];
+				const uint32_t* pCandidate = &indices[t * 3];
+				const uint32_t newVertices = CountNewVertices(pCandidate, isInMeshlet);
+				if (newVertices > bestNewVertices)
+					continue;
+
+				const float3& a = GetPosition(pPositions, positionStride, pCandidate[0]);
+				const float3& b = GetPosition(pPositions, positionStride, pCandidate[1]);
+				const float3& c = GetPosition(pPositions, positionStride, pCandidate[2]);
+				const float3 offset = { (a.x + b.x + c.x) / 3.0f - center.x, (a.y + b.y + c.y) / 3.0f - center.y, (a.z + b.z + c.z) / 3.0f - center.z };
+				const float distance = Dot(offset, offset);
+				if (newVertices < bestNewVertices || distance < bestDistance)
+				{
+					bestNewVertices = newVertices;
+					bestDistance = distance;
+					nextTriangle = t;
+				}
+			}
+		}
+	}
+
+	WriteIndexRun(output, indexSize, pIndices);
+
+	// The cuts mostly survive the sort: a meshlet ended because the best triangle around it didn't fit,
+	// the start of another cluster rarely fits better. The last one could take the first triangle of
+	// any other, so it stays last. BuildMeshlets is exact either way, this only decides how compact.
+	if (sortForOverdraw)
+		SortClustersForOverdraw(pIndices, indexSize, meshletStarts.data(), (uint32_t)meshletStarts.size() - 1, pPositions, positionStride);
+}
+
+void OptimizeMeshletOrder(IndexedMesh* pMesh, bool sortForOverdraw, ThreadPool* pPool)
+{
+	ForEachPart(pMesh, pPool, [pMesh, sortForOverdraw](const MeshPart& part)
+	{
+		if (part.vertexCount == 0)
+			return;
+		OptimizeMeshletOrder(&pMesh->indexData[part.indexByteOffset], part.indexSize, part.indexCount,
+			pMesh->vertices[part.baseVertex].position, sizeof(MeshVertex), part.vertexCount, sortForOverdraw);
+	});
+}
+
+// =====================================================================================
+//										Build
+// =====================================================================================
+
+uint32_t BuildMeshlets(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount, MeshletData* pOut,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	maxVertices = std::min(std::max(maxVertices, 3u), 1024u);		// 10-bit local indices
+	maxTriangles = std::max(maxTriangles, 1u);
+
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, indexCount, &indices);
+
+	// Local index of every vertex in the current meshlet
+	std::vector<uint32_t> localIndices(vertexCount, kNotInMeshlet);
+	const size_t firstMeshlet = pOut->meshlets.size();
+
+	Meshlet meshlet = {};
+	auto finish = [&]()
+	{
+		if (meshlet.primitiveCount == 0)
+			return;
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+			localIndices[pOut->vertexIndices[meshlet.vertexOffset + v]] = kNotInMeshlet;
+
+		pOut->meshlets.push_back(meshlet);
+		pOut->bounds.push_back(ComputeBounds(*pOut, meshlet, pPositions, positionStride));
+
+		meshlet.vertexOffset += meshlet.vertexCount;
+		meshlet.vertexCount = 0;
+		meshlet.primitiveOffset += meshlet.primitiveCount;
+		meshlet.firstIndex += meshlet.primitiveCount * 3;
+		meshlet.primitiveCount = 0;
+	};
+
+	meshlet.vertexOffset = (uint32_t)pOut->vertexIndices.size();
+	meshlet.primitiveOffset = (uint32_t)pOut->primitives.size();
+	for (uint32_t t = 0; t + 2 < indexCount; t += 3)
+	{
+		const uint32_t* pCorners = &indices[t];
+		const uint32_t newVertices = CountNewVertices(pCorners, [&](uint32_t v) { return localIndices[v] != kNotInMeshlet; });
+
+		if (meshlet.vertexCount + newVertices > maxVertices || meshlet.primitiveCount + 1 > maxTriangles)
+			finish();
+
+		uint32_t packed = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			uint32_t& local = localIndices[pCorners[c]];
+			if (local == kNotInMeshlet)
+			{
+				local = meshlet.vertexCount++;
+				pOut->vertexIndices.push_back(pCorners[c]);
+			}
+			packed |= local << (10 * c);
+		}
+		pOut->primitives.push_back(packed);
+		meshlet.primitiveCount++;
+	}
+	finish();
+
+	return (uint32_t)(pOut->meshlets.size() - firstMeshlet);
+}
+
+// =====================================================================================
+//										Culling
+// =====================================================================================
+
+void ExtractFrustumPlanes(const float* pMatrix, float planes[6][4])
+{
+	// Column j of the matrix gives clip component j as a plane equation
+	auto column = [pMatrix](int j, int i) { return pMatrix[i * 4 + j]; };
+	for (int i = 0; i < 4; i++)
+	{
+		planes[0][i] = column(3, i) + column(0, i);		// left:   x >= -w
+		planes[1][i] = column(3, i) - column(0, i);		// right:  x <= w
+		planes[2][i] = column(3, i) + column(1, i);		// bottom: y >= -w
+		planes[3][i] = column(3, i) - column(1, i);		// top:    y <= w
+		planes[4][i] = column(2, i);					// near:   z >= 0
+		planes[5][i] = column(3, i) - column(2, i);		// far:    z <= w
+	}
+
+	for (int p = 0; p < 6; p++)
+	{
+		const float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		for (int i = 0; i < 4 && length > 0.0f; i++)
+			planes[p][i] /= length;
+	}
+}
+
+void CullMeshlets(const MeshletData& data, uint32_t firstMeshlet, uint32_t meshletCount,
+	const float planes[6][4], const float* cameraPosition, std::vector<uint32_t>* pVisible, MeshletCullStats* pStats)
+{
+	MeshletCullStats stats;
+	stats.meshletCount = meshletCount;
+
+	for (uint32_t m = firstMeshlet; m < firstMeshlet + meshletCount; m++)
+	{
+		const MeshletBounds& bounds = data.bounds[m];
+		const uint32_t triangleCount = data.meshlets[m].primitiveCount;
+		stats.triangleCount += triangleCount;
+
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++)
+		{
+			const float distance = planes[p][0] * bounds.center[0] + planes[p][1] * bounds.center[1] +
+				planes[p][2] * bounds.center[2] + planes[p][3];
+			outside = distance < -bounds.radius;
+		}
+		if (outside)
+		{
+			stats.frustumCulled++;
+			continue;
+		}
+
+		if (bounds.coneCutoff <= 1.0f)
+		{
+			const float3 toCenter = { bounds.center[0] - cameraPosition[0], bounds.center[1] - cameraPosition[1], bounds.center[2] - cameraPosition[2] };
+			const float3 axis = { bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2] };
+			if (Dot(toCenter, axis) >= bounds.coneCutoff * Length(toCenter) + bounds.radius * (1.0f + bounds.coneCutoff))
+			{
+				stats.backfaceCulled++;
+				continue;
+			}
+		}
+
+		pVisible->push_back(m);
+		stats.meshletsVisible++;
+		stats.trianglesVisible += triangleCount;
+	}
+
+	if (pStats)
+		pStats->Add(stats);
+}
+
+} // namespace MeshTools
@@ -0,0 +1,123 @@
+#pragma once
+
+// Meshlets: clusters of at most 64 vertices / 124 triangles (the sizes of the D3D12 mesh shader
+// samples) with culling data, so that whole clusters can be skipped before they're drawn.
+//
+// BuildMeshlets walks an index run in its order and starts a new meshlet whenever the next triangle
+// doesn't fit anymore. Every meshlet is therefore also a contiguous range of the run (firstIndex,
+// 3 * primitiveCount), which lets a plain indexed draw skip culled meshlets without mesh shaders.
+//
+// OptimizeMeshletOrder makes those ranges compact. In vertex cache order (strips around the
+// surface) the sequential build gives long, thin meshlets with wide normal cones. This pass grows
+// clusters over shared vertices instead - the candidate adding the fewest new vertices, the one
+// nearest to the cluster center among those - and writes the triangles out cluster by cluster.
+// It cuts where BuildMeshlets does, so the build afterwards reproduces its clusters, also after
+// OptimizeVertexFetch (a vertex remap doesn't change which corners are shared).
+// sortForOverdraw: the finished clusters are sorted like OptimizeOverdraw sorts its own (the last
+// one stays last, so the cuts don't move), replacing that pass. Order in a cook: OptimizeVertexCache,
+// OptimizeMeshletOrder, OptimizeVertexFetch, BuildMeshlets.
+//
+// Culling data per meshlet:
+//		bounding sphere - frustum culling
+//		normal cone     - axis and sin(half angle) of the cone holding all triangle normals. Every
+//		                  triangle faces away from a camera where
+//		                  dot(center - camera, axis) >= coneCutoff * |center - camera| + radius * (1 + coneCutoff)
+//		                  (front faces = clockwise, the D3D12 default with back face culling)
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+namespace MeshTools
+{
+
+struct IndexedMesh;
+
+const uint32_t kMaxMeshletVertices = 64;
+const uint32_t kMaxMeshletTriangles = 124;
+
+struct Meshlet
+{
+	uint32_t vertexOffset;			// into MeshletData::vertexIndices
+	uint32_t vertexCount;
+	uint32_t primitiveOffset;		// into MeshletData::primitives
+	uint32_t primitiveCount;
+	uint32_t firstIndex;			// of the meshlet's triangles in the index run it was built from
+};
+static_assert(sizeof(Meshlet) == 20, "Part of the cooked mesh format");
+
+struct MeshletBounds
+{
+	float center[3];
+	float radius;
+	float coneAxis[3];
+	float coneCutoff;				// > 1: the normals are too spread for a back face test
+};
+static_assert(sizeof(MeshletBounds) == 32, "Part of the cooked mesh format");
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	// Vertices of the meshlets, relative to the base vertex of their index run
+	std::vector<uint32_t> vertexIndices;
+	// One triangle each: 3 x 10-bit indices into the meshlet's vertices (bits 0-9, 10-19, 20-29)
+	std::vector<uint32_t> primitives;
+
+	void Clear() { meshlets.clear(); bounds.clear(); vertexIndices.clear(); primitives.clear(); }
+};
+
+// Reorders the triangles of an index run (16- or 32-bit) into compact meshlet-sized clusters.
+// pPositions: float xyz of vertex 0 of the run, positionStride bytes apart.
+void OptimizeMeshletOrder(void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount,
+	bool sortForOverdraw = true, uint32_t maxVertices = kMaxMeshletVertices, uint32_t maxTriangles = kMaxMeshletTriangles);
+
+// All parts of the mesh, parts in parallel if pPool != nullptr
+void OptimizeMeshletOrder(IndexedMesh* pMesh, bool sortForOverdraw = true, ThreadPool* pPool = nullptr);
+
+// Appends the meshlets of an index run (16- or 32-bit) to pOut. pPositions: float xyz of vertex 0
+// of the run, positionStride bytes apart. Returns the number of meshlets added.
+uint32_t BuildMeshlets(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount, MeshletData* pOut,
+	uint32_t maxVertices = kMaxMeshletVertices, uint32_t maxTriangles = kMaxMeshletTriangles);
+
+// =====================================================================================
+//										Culling
+// =====================================================================================
+
+struct MeshletCullStats
+{
+	uint32_t meshletCount = 0;
+	uint32_t meshletsVisible = 0;
+	uint32_t frustumCulled = 0;		// meshlets
+	uint32_t backfaceCulled = 0;	// meshlets
+	uint64_t triangleCount = 0;
+	uint64_t trianglesVisible = 0;
+
+	double GetCulledTriangleRatio() const { return triangleCount ? 1.0 - (double)trianglesVisible / triangleCount : 0.0; }
+
+	void Add(const MeshletCullStats& other)
+	{
+		meshletCount += other.meshletCount;
+		meshletsVisible += other.meshletsVisible;
+		frustumCulled += other.frustumCulled;
+		backfaceCulled += other.backfaceCulled;
+		triangleCount += other.triangleCount;
+		trianglesVisible += other.trianglesVisible;
+	}
+};
+
+// Frustum of a clip matrix in the DirectXMath layout (row-major, row vectors: clip = v * M, depth
+// 0..w). Planes are (a, b, c, d), normalized, with a*x + b*y + c*z + d >= 0 inside. For the MVP
+// matrix of an object the planes are in the object's space.
+void ExtractFrustumPlanes(const float* pMatrix, float planes[6][4]);
+
+// Appends the indices (firstMeshlet + i) of the visible meshlets of [firstMeshlet, firstMeshlet + meshletCount)
+// to pVisible. Planes and cameraPosition in the space the meshlets were built in.
+void CullMeshlets(const MeshletData& data, uint32_t firstMeshlet, uint32_t meshletCount,
+	const float planes[6][4], const float* cameraPosition, std::vector<uint32_t>* pVisible, MeshletCullStats* pStats = nullptr);
+
+} // namespace MeshTools
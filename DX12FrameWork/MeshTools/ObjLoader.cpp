@@ -0,0 +1,562 @@
+#include "ObjLoader.h"
+#include "VertexWelder.h"
+#include "../Utils/MappedFile.h"
+#include "../Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+
+namespace MeshTools
+{
+
+namespace
+{
+	const uint32_t kNoIndex = 0xFFFFFFFF;
+	const size_t kChunkSize = 1 << 20;
+
+	// Position/uv/normal indices of one triangle corner (0-based, kNoIndex if absent)
+	struct ObjCorner
+	{
+		uint32_t position;
+		uint32_t uv;
+		uint32_t normal;
+	};
+
+	struct ObjGroup
+	{
+		uint32_t firstCorner;		// within the chunk
+		std::string name;
+	};
+
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+
+		// Step 1
+		uint32_t positionCount = 0, uvCount = 0, normalCount = 0;
+		// Global index of the first attribute of each kind defined in the chunk
+		uint32_t positionBase = 0, uvBase = 0, normalBase = 0;
+
+		// Step 2
+		std::vector<ObjCorner> corners;
+		std::vector<ObjGroup> groups;
+		std::string error;
+	};
+
+	struct ObjData
+	{
+		std::vector<float> positions;		// xyz
+		std::vector<float> uvs;				// uv
+		std::vector<float> normals;			// xyz
+	};
+
+	void ForEach(ThreadPool* pool, uint32_t count, const std::function<void(uint32_t)>& body)
+	{
+		if (pool)
+		{
+			ParallelForWorkStealing(*pool, count, [&](uint32_t item, uint32_t) { body(item); });
+		}
+		else
+		{
+			for (uint32_t i = 0; i < count; i++)
+				body(i);
+		}
+	}
+
+	bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+	bool IsDigit(char c) { return (unsigned)(c - '0') < 10; }
+
+	const char* SkipBlanks(const char* p, const char* end)
+	{
+		while (p < end && IsBlank(*p))
+			p++;
+		return p;
+	}
+
+	const char* NextLine(const char* p, const char* end)
+	{
+		const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+		return newline ? newline + 1 : end;
+	}
+
+	// Line end without the '\r' of CRLF files and without trailing blanks
+	const char* TrimmedLineEnd(const char* lineBegin, const char* lineEnd)
+	{
+		while (lineEnd > lineBegin && (lineEnd[-1] == '\n' || lineEnd[-1] == '\r' || IsBlank(lineEnd[-1])))
+			lineEnd--;
+		return lineEnd;
+	}
+
+	const char* ParseInt(const char* p, const char* end, int64_t* pValue)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+		if (p == end || !IsDigit(*p))
+			return nullptr;
+
+		int64_t value = 0;
+		while (p < end && IsDigit(*p) && value < ((int64_t)1 << 40))
+			value = value * 10 + (*p++ - '0');
+		*pValue = negative ? -value : value;
+		return p;
+	}
+
+	// OBJ indices are 1-based, negative ones count back from the last defined attribute
+	bool ResolveIndex(int64_t raw, uint32_t definedSoFar, uint32_t* pIndex)
+	{
+		const int64_t index = raw > 0 ? raw - 1 : (int64_t)definedSoFar + raw;
+		if (raw == 0 || index < 0 || index >= kNoIndex)
+			return false;
+		*pIndex = (uint32_t)index;
+		return true;
+	}
+
+	// ----------------------------- Step 1
+	void CountChunk(ObjChunk& chunk)
+	{
+		for (const char* p = chunk.begin; p < chunk.end; p = NextLine(p, chunk.end))
+		{
+			const char* q = SkipBlanks(p, chunk.end);
+			if (chunk.end - q < 2 || q[0] != 'v')
+				continue;
+			if (IsBlank(q[1]))
+				chunk.positionCount++;
+			else if (q[1] == 't' && chunk.end - q > 2 && IsBlank(q[2]))
+				chunk.uvCount++;
+			else if (q[1] == 'n' && chunk.end - q > 2 && IsBlank(q[2]))
+				chunk.normalCount++;
+		}
+	}
+
+	// ----------------------------- Step 2
+	bool ParseFloats(const char* p, const char* end, float* pValues, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const char* next = ParseObjFloat(p, end, &pValues[i]);
+			if (next == p)
+				return false;
+			p = next;
+		}
+		return true;
+	}
+
+	void ParseChunk(ObjChunk& chunk, ObjData& data)
+	{
+		uint32_t positions = chunk.positionBase, uvs = chunk.uvBase, normals = chunk.normalBase;
+		std::vector<ObjCorner> polygon;
+		const char* line = nullptr;
+		const char* end = nullptr;
+
+		auto fail = [&](const char* what)
+		{
+			chunk.error = std::string(what) + ": \"" + std::string(line, std::min<size_t>(end - line, 80)) + "\"";
+		};
+
+		for (const char* next = chunk.begin; next < chunk.end && chunk.error.empty();)
+		{
+			line = next;
+			next = NextLine(line, chunk.end);
+			end = TrimmedLineEnd(line, next);
+			const char* p = SkipBlanks(line, end);
+
+			if (end - p < 2 || (!IsBlank(p[1]) && !(p[0] == 'v' && end - p > 2 && IsBlank(p[2]))))
+			{
+				// Keywords longer than two characters ("usemtl", "mtllib") and empty lines
+				continue;
+			}
+
+			if (p[0] == 'v' && IsBlank(p[1]))
+			{
+				if (!ParseFloats(p + 2, end, &data.positions[positions * 3], 3))
+					return fail("Invalid position");
+				positions++;
+			}
+			else if (p[0] == 'v' && p[1] == 't')
+			{
+				if (!ParseFloats(p + 3, end, &data.uvs[uvs * 2], 2))
+					return fail("Invalid texture coordinate");
+				uvs++;
+			}
+			else if (p[0] == 'v' && p[1] == 'n')
+			{
+				if (!ParseFloats(p + 3, end, &data.normals[normals * 3], 3))
+					return fail("Invalid normal");
+				normals++;
+			}
+			else if (p[0] == 'f' && IsBlank(p[1]))
+			{
+				// v, v/vt, v//vn or v/vt/vn per corner, up to the end of the line or a trailing comment
+				polygon.clear();
+				for (p = SkipBlanks(p + 2, end); p < end && *p != '#'; p = SkipBlanks(p, end))
+				{
+					ObjCorner corner = { kNoIndex, kNoIndex, kNoIndex };
+					int64_t raw;
+
+					p = ParseInt(p, end, &raw);
+					if (!p || !ResolveIndex(raw, positions, &corner.position))
+						return fail("Invalid position index");
+
+					if (p < end && *p == '/')
+					{
+						p++;
+						if (p < end && *p != '/')
+						{
+							p = ParseInt(p, end, &raw);
+							if (!p || !ResolveIndex(raw, uvs, &corner.uv))
+								return fail("Invalid texture coordinate index");
+						}
+						if (p < end && *p == '/')
+						{
+							p = ParseInt(p + 1, end, &raw);
+							if (!p || !ResolveIndex(raw, normals, &corner.normal))
+								return fail("Invalid normal index");
+						}
+					}
+					if (p < end && !IsBlank(*p) && *p != '#')
+						return fail("Invalid face");
+					polygon.push_back(corner);
+				}
+
+				// Fan triangulation (OBJ polygons are convex)
+				for (size_t i = 2; i < polygon.size(); i++)
+				{
+					chunk.corners.push_back(polygon[0]);
+					chunk.corners.push_back(polygon[i - 1]);
+					chunk.corners.push_back(polygon[i]);
+				}
+			}
+			else if ((p[0] == 'o' || p[0] == 'g') && IsBlank(p[1]))
+			{
+				ObjGroup group;
+				group.firstCorner = (uint32_t)chunk.corners.size();
+				const char* name = SkipBlanks(p + 2, end);
+				group.name.assign(name, end);
+				chunk.groups.push_back(group);
+			}
+		}
+	}
+
+	// ----------------------------- Step 3
+	struct ObjPart
+	{
+		std::string name;
+		uint32_t firstCorner = 0;
+		uint32_t cornerCount = 0;
+
+		// Output of the welding
+		std::vector<ObjCorner> uniqueCorners;
+		std::vector<uint32_t> indices;
+	};
+
+	void WeldPart(ObjPart& part, const std::vector<ObjCorner>& corners, VertexWelder<ObjCorner>& welder)
+	{
+		// Corners with the same index triple are the same vertex - cheaper than comparing vertices
+		welder.Reset(part.cornerCount);
+		part.indices.resize(part.cornerCount);
+		for (uint32_t i = 0; i < part.cornerCount; i++)
+			part.indices[i] = welder.Insert(corners[part.firstCorner + i]);
+		part.uniqueCorners = welder.GetVertices();
+	}
+}
+
+// =====================================================================================
+//										Number parsing
+// =====================================================================================
+
+const char* ParseObjFloat(const char* p, const char* end, float* pValue)
+{
+	static const double kPow10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	const char* start = SkipBlanks(p, end);
+	const char* q = start;
+
+	bool negative = false;
+	if (q < end && (*q == '-' || *q == '+'))
+		negative = *q++ == '-';
+
+	// Up to 19 significant digits fit into the mantissa; more can't change a float
+	uint64_t mantissa = 0;
+	int exponent = 0, significantDigits = 0, digits = 0;
+	for (; q < end && IsDigit(*q); q++, digits++)
+	{
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*q - '0');
+			significantDigits += mantissa != 0;
+		}
+		else
+		{
+			exponent++;
+		}
+	}
+	if (q < end && *q == '.')
+	{
+		for (q++; q < end && IsDigit(*q); q++, digits++)
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*q - '0');
+				significantDigits += mantissa != 0;
+				exponent--;
+			}
+		}
+	}
+
+	if (digits == 0)
+	{
+		// "inf", "nan", hex floats... - rare enough for strtod
+		char buffer[64];
+		const size_t length = std::min((size_t)(end - start), sizeof(buffer) - 1);
+		memcpy(buffer, start, length);
+		buffer[length] = '\0';
+		char* parsedEnd;
+		const double value = strtod(buffer, &parsedEnd);
+		if (parsedEnd == buffer)
+			return p;
+		*pValue = (float)value;
+		return start + (parsedEnd - buffer);
+	}
+
+	if (q < end && (*q == 'e' || *q == 'E'))
+	{
+		const char* e = q + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+			negativeExponent = *e++ == '-';
+		if (e < end && IsDigit(*e))
+		{
+			int value = 0;
+			for (; e < end && IsDigit(*e); e++)
+				value = std::min(value * 10 + (*e - '0'), 10000);
+			exponent += negativeExponent ? -value : value;
+			q = e;
+		}
+	}
+
+	// One rounding for the mantissa, one for the exact power of ten - far below float precision
+	double value = (double)mantissa;
+	if (mantissa != 0 && exponent != 0)
+	{
+		if (exponent > 0)
+			value = exponent <= 22 ? value * kPow10[exponent] : value * std::pow(10.0, exponent);
+		else
+			value = exponent >= -22 ? value / kPow10[-exponent] : value * std::pow(10.0, exponent);
+	}
+
+	*pValue = (float)(negative ? -value : value);
+	return q;
+}
+
+// =====================================================================================
+//										Loading
+// =====================================================================================
+
+bool ParseObj(const char* text, size_t size, IndexedMesh* pOutMesh, ThreadPool* pPool, ObjLoadStats* pStats, std::string* pError)
+{
+	auto startTime = std::chrono::steady_clock::now();
+	pOutMesh->Clear();
+
+	// ----------------------------- Chunks
+	std::vector<ObjChunk> chunks;
+	for (const char* p = text, *end = text + size; p < end;)
+	{
+		ObjChunk chunk;
+		chunk.begin = p;
+		chunk.end = size_t(end - p) > kChunkSize ? NextLine(p + kChunkSize, end) : end;
+		p = chunk.end;
+		chunks.push_back(std::move(chunk));
+	}
+
+	ForEach(pPool, (uint32_t)chunks.size(), [&](uint32_t i) { CountChunk(chunks[i]); });
+
+	ObjData data;
+	uint32_t positionCount = 0, uvCount = 0, normalCount = 0;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.positionBase = positionCount;
+		chunk.uvBase = uvCount;
+		chunk.normalBase = normalCount;
+		positionCount += chunk.positionCount;
+		uvCount += chunk.uvCount;
+		normalCount += chunk.normalCount;
+	}
+	data.positions.resize(positionCount * 3);
+	data.uvs.resize(uvCount * 2);
+	data.normals.resize(normalCount * 3);
+
+	ForEach(pPool, (uint32_t)chunks.size(), [&](uint32_t i) { ParseChunk(chunks[i], data); });
+
+	for (const ObjChunk& chunk : chunks)
+	{
+		if (!chunk.error.empty())
+		{
+			if (pError)
+				*pError = chunk.error;
+			return false;
+		}
+	}
+
+	// Forward references ("f 1 2 3" before "v" lines) can only be checked now
+	std::atomic<bool> outOfRange(false);
+	ForEach(pPool, (uint32_t)chunks.size(), [&](uint32_t i)
+	{
+		for (const ObjCorner& corner : chunks[i].corners)
+		{
+			if (corner.position >= positionCount || (corner.uv != kNoIndex && corner.uv >= uvCount) ||
+				(corner.normal != kNoIndex && corner.normal >= normalCount))
+			{
+				outOfRange = true;
+				return;
+			}
+		}
+	});
+	if (outOfRange)
+	{
+		if (pError)
+			*pError = "Face references an attribute that is never defined";
+		return false;
+	}
+
+	auto parsedTime = std::chrono::steady_clock::now();
+
+	// ----------------------------- Parts
+	// Corners of all chunks in file order; a part ends at the next "o"/"g" line
+	std::vector<ObjCorner> corners;
+	std::vector<ObjPart> parts(1);
+	parts[0].name = "default";
+	{
+		size_t cornerCount = 0;
+		for (const ObjChunk& chunk : chunks)
+			cornerCount += chunk.corners.size();
+		corners.reserve(cornerCount);
+	}
+
+	for (ObjChunk& chunk : chunks)
+	{
+		const uint32_t chunkFirstCorner = (uint32_t)corners.size();
+		corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+		std::vector<ObjCorner>().swap(chunk.corners);
+
+		for (const ObjGroup& group : chunk.groups)
+		{
+			ObjPart part;
+			part.name = group.name;
+			part.firstCorner = chunkFirstCorner + group.firstCorner;
+			parts.push_back(std::move(part));
+		}
+	}
+	for (size_t i = 0; i < parts.size(); i++)
+		parts[i].cornerCount = (i + 1 < parts.size() ? parts[i + 1].firstCorner : (uint32_t)corners.size()) - parts[i].firstCorner;
+	parts.erase(std::remove_if(parts.begin(), parts.end(), [](const ObjPart& part) { return part.cornerCount == 0; }), parts.end());
+
+	std::vector<VertexWelder<ObjCorner>> welders(pPool ? pPool->GetThreadCount() : 1);
+	if (pPool)
+	{
+		ParallelForWorkStealing(*pPool, (uint32_t)parts.size(), [&](uint32_t i, uint32_t workerIndex)
+		{
+			WeldPart(parts[i], corners, welders[workerIndex]);
+		});
+	}
+	else
+	{
+		for (ObjPart& part : parts)
+			WeldPart(part, corners, welders[0]);
+	}
+	welders.clear();
+
+	// ----------------------------- Arena
+	size_t vertexCount = 0, indexDataSize = 0;
+	for (const ObjPart& objPart : parts)
+	{
+		MeshPart part;
+		part.name = objPart.name;
+		part.baseVertex = (uint32_t)vertexCount;
+		part.vertexCount = (uint32_t)objPart.uniqueCorners.size();
+		part.indexByteOffset = (uint32_t)indexDataSize;
+		part.indexCount = objPart.cornerCount;
+		part.indexSize = part.vertexCount > 0x10000 ? 4 : 2;
+
+		vertexCount += part.vertexCount;
+		indexDataSize += GetIndexRunSize(part.indexCount, part.indexSize);
+		pOutMesh->parts.push_back(part);
+	}
+
+	pOutMesh->vertices.resize(vertexCount);
+	pOutMesh->indexData.resize(indexDataSize, 0);
+	ForEach(pPool, (uint32_t)parts.size(), [&](uint32_t p)
+	{
+		const ObjPart& objPart = parts[p];
+		const MeshPart& part = pOutMesh->parts[p];
+
+		MeshVertex* pVertices = &pOutMesh->vertices[part.baseVertex];
+		for (uint32_t i = 0; i < part.vertexCount; i++)
+		{
+			const ObjCorner& corner = objPart.uniqueCorners[i];
+			MeshVertex& v = pVertices[i];
+			memset(&v, 0, sizeof(v));
+			memcpy(v.position, &data.positions[corner.position * 3], sizeof(v.position));
+			if (corner.normal != kNoIndex)
+				memcpy(v.normal, &data.normals[corner.normal * 3], sizeof(v.normal));
+			if (corner.uv != kNoIndex)
+				memcpy(v.uv, &data.uvs[corner.uv * 2], sizeof(v.uv));
+		}
+
+		uint8_t* pDst = &pOutMesh->indexData[part.indexByteOffset];
+		if (part.indexSize == 4)
+		{
+			memcpy(pDst, objPart.indices.data(), part.indexCount * sizeof(uint32_t));
+		}
+		else
+		{
+			uint16_t* pDst16 = reinterpret_cast<uint16_t*>(pDst);
+			for (uint32_t i = 0; i < part.indexCount; i++)
+				pDst16[i] = (uint16_t)objPart.indices[i];
+		}
+	});
+
+	if (pStats)
+	{
+		auto endTime = std::chrono::steady_clock::now();
+		pStats->bytes = size;
+		pStats->positionCount = positionCount;
+		pStats->normalCount = normalCount;
+		pStats->uvCount = uvCount;
+		pStats->triangleCount = (uint32_t)(corners.size() / 3);
+		pStats->chunkCount = (uint32_t)chunks.size();
+		pStats->parseMs = std::chrono::duration<double, std::milli>(parsedTime - startTime).count();
+		pStats->weldMs = std::chrono::duration<double, std::milli>(endTime - parsedTime).count();
+		pStats->totalMs = pStats->parseMs + pStats->weldMs;
+	}
+	return true;
+}
+
+bool LoadObj(const char* path, IndexedMesh* pOutMesh, ThreadPool* pPool, ObjLoadStats* pStats, std::string* pError)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		if (pError)
+			*pError = std::string("Can't open ") + path;
+		return false;
+	}
+
+	const bool ok = ParseObj(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), pOutMesh, pPool, pStats, pError);
+	if (ok && pStats)
+		pStats->totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	return ok;
+}
+
+} // namespace MeshTools
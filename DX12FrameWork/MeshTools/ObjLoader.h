@@ -0,0 +1,50 @@
+#pragma once
+
+// Native Wavefront OBJ importer - no FBX SDK, builds on Linux as well.
+//
+// The file is memory-mapped and split into ~1 MB chunks at line boundaries:
+//		1. Per chunk (parallel): count the v/vt/vn lines -> global index base of every chunk
+//		2. Per chunk (parallel): parse with a hand-written number parser; attributes go straight
+//		   into their slots of the global arrays, faces are fan-triangulated into corners
+//		   (position/uv/normal index triples, relative indices already resolved)
+//		3. Per part (parallel): corners are welded on their index triples
+//		4. The parts are packed into the IndexedMesh arena (16-bit indices where they fit)
+// A part starts at every "o" and "g" line. Materials, smoothing groups and lines are ignored.
+
+#include "IndexedMesh.h"
+
+#include <string>
+
+class ThreadPool;
+
+namespace MeshTools
+{
+
+struct ObjLoadStats
+{
+	uint64_t bytes = 0;
+	uint32_t positionCount = 0;
+	uint32_t normalCount = 0;
+	uint32_t uvCount = 0;
+	uint32_t triangleCount = 0;
+	uint32_t chunkCount = 0;
+	double parseMs = 0.0;		// steps 1-2
+	double weldMs = 0.0;		// steps 3-4
+	double totalMs = 0.0;		// including the mapping of the file
+};
+
+// Loads the OBJ file into pOutMesh (debug colors stay 0). pPool == nullptr - calling thread only.
+// Returns false if the file can't be read or references attributes that don't exist (*pError says why).
+bool LoadObj(const char* path, IndexedMesh* pOutMesh, ThreadPool* pPool = nullptr,
+	ObjLoadStats* pStats = nullptr, std::string* pError = nullptr);
+
+// The same for OBJ text already in memory
+bool ParseObj(const char* text, size_t size, IndexedMesh* pOutMesh, ThreadPool* pPool = nullptr,
+	ObjLoadStats* pStats = nullptr, std::string* pError = nullptr);
+
+// Number parser used by ParseObj, exposed for the benchmarks. Parses [+-]digits[.digits][(e|E)[+-]digits]
+// (and anything else through strtod) starting at p, leading blanks skipped. Returns the position after
+// the number, or p itself if there is none. Results match strtod within 1 ulp of the float.
+const char* ParseObjFloat(const char* p, const char* end, float* pValue);
+
+} // namespace MeshTools
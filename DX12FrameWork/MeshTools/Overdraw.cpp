@@ -0,0 +1,364 @@
+#include "Overdraw.h"
+#include "IndexedMesh.h"
+#include "MeshToolsMath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+namespace MeshTools
+{
+
+namespace
+{
+	const uint32_t kCacheSize = 32;
+	// Soft cuts need a few triangles per cluster, otherwise every restart of the cache is a cut
+	const uint32_t kMinClusterTriangles = 16;
+
+	// FIFO post-transform cache, see AnalyzeVertexCache
+	class CacheSimulator
+	{
+	public:
+		explicit CacheSimulator(uint32_t vertexCount) : m_MissStamps(vertexCount, 0) {}
+
+		uint32_t Access(const uint32_t* pCorners)
+		{
+			uint32_t misses = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				uint64_t& stamp = m_MissStamps[pCorners[c]];
+				if (stamp == 0 || m_Misses - stamp >= kCacheSize)
+				{
+					stamp = ++m_Misses;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		// Everything counts as evicted afterwards
+		void Flush() { m_Misses += kCacheSize; }
+
+	private:
+		std::vector<uint64_t> m_MissStamps;
+		uint64_t m_Misses = 0;
+	};
+
+	// Orthographic depth-only rasterizer looking down one of the 6 axis directions
+	class OverdrawRasterizer
+	{
+	public:
+		OverdrawRasterizer(uint32_t resolution, const float* pBoundsMin, const float* pBoundsMax)
+			: m_Resolution(resolution), m_Depth((size_t)resolution * resolution)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				m_Min[i] = pBoundsMin[i];
+				const float extent = pBoundsMax[i] - pBoundsMin[i];
+				m_Scale[i] = extent > 0.0f ? 1.0f / extent : 0.0f;
+			}
+		}
+
+		void Begin(int view)
+		{
+			m_Axis = view / 2;
+			m_Flip = view % 2 == 1;
+			std::fill(m_Depth.begin(), m_Depth.end(), FLT_MAX);
+		}
+
+		void Draw(const uint32_t* pIndices, uint32_t indexCount, const float* pPositions, size_t positionStride)
+		{
+			for (uint32_t t = 0; t + 2 < indexCount; t += 3)
+			{
+				float v[3][3];
+				for (int c = 0; c < 3; c++)
+					Project(GetPosition(pPositions, positionStride, pIndices[t + c]), v[c]);
+				DrawTriangle(v[0], v[1], v[2]);
+			}
+		}
+
+		void End(OverdrawStats* pStats)
+		{
+			for (float depth : m_Depth)
+				pStats->pixelsCovered += depth != FLT_MAX;
+			pStats->pixelsShaded += m_Shaded;
+			m_Shaded = 0;
+		}
+
+	private:
+		// Screen x/y in pixels, depth in [0, 1] growing away from the viewer
+		void Project(const float3& p, float* pOut) const
+		{
+			const float n[3] = { (p.x - m_Min[0]) * m_Scale[0], (p.y - m_Min[1]) * m_Scale[1], (p.z - m_Min[2]) * m_Scale[2] };
+			const int u = (m_Axis + 1) % 3, v = (m_Axis + 2) % 3;
+			pOut[0] = n[u] * m_Resolution;
+			pOut[1] = n[v] * m_Resolution;
+			pOut[2] = m_Flip ? 1.0f - n[m_Axis] : n[m_Axis];
+		}
+
+		void DrawTriangle(const float* a, const float* b, const float* c)
+		{
+			float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+			if (area == 0.0f)
+				return;
+			// No culling - both windings are drawn
+			if (area < 0.0f)
+			{
+				std::swap(b, c);
+				area = -area;
+			}
+
+			const int maxPixel = (int)m_Resolution - 1;
+			const int x0 = std::max(0, (int)floorf(std::min(a[0], std::min(b[0], c[0]))));
+			const int x1 = std::min(maxPixel, (int)ceilf(std::max(a[0], std::max(b[0], c[0]))));
+			const int y0 = std::max(0, (int)floorf(std::min(a[1], std::min(b[1], c[1]))));
+			const int y1 = std::min(maxPixel, (int)ceilf(std::max(a[1], std::max(b[1], c[1]))));
+
+			const float invArea = 1.0f / area;
+			for (int y = y0; y <= y1; y++)
+			{
+				const float py = y + 0.5f;
+				for (int x = x0; x <= x1; x++)
+				{
+					const float px = x + 0.5f;
+					const float wa = (b[0] - px) * (c[1] - py) - (b[1] - py) * (c[0] - px);
+					const float wb = (c[0] - px) * (a[1] - py) - (c[1] - py) * (a[0] - px);
+					const float wc = (a[0] - px) * (b[1] - py) - (a[1] - py) * (b[0] - px);
+					if (wa < 0.0f || wb < 0.0f || wc < 0.0f)
+						continue;
+
+					const float depth = (wa * a[2] + wb * b[2] + wc * c[2]) * invArea;
+					float& stored = m_Depth[(size_t)y * m_Resolution + x];
+					if (depth < stored)
+					{
+						stored = depth;
+						m_Shaded++;
+					}
+				}
+			}
+		}
+
+		uint32_t m_Resolution;
+		std::vector<float> m_Depth;
+		float m_Min[3];
+		float m_Scale[3];
+		int m_Axis = 0;
+		bool m_Flip = false;
+		uint64_t m_Shaded = 0;
+	};
+
+	// Step 2 of OptimizeOverdraw: sorts the clusters [pClusterStarts[k], pClusterStarts[k + 1]) (triangles)
+	// by dot(cluster centroid - mesh centroid, cluster normal), descending
+	void SortClusters(std::vector<uint32_t>* pIndices, const uint32_t* pClusterStarts, uint32_t clusterCount,
+		const float* pPositions, size_t positionStride)
+	{
+		std::vector<uint32_t>& indices = *pIndices;
+
+		// Area-weighted centroid and normal of every cluster (the cross product is twice the area)
+		std::vector<float> centroids(clusterCount * 3, 0.0f), normals(clusterCount * 3, 0.0f);
+		float meshCentroid[3] = {}, meshArea = 0.0f;
+		for (size_t k = 0; k < clusterCount; k++)
+		{
+			float clusterArea = 0.0f;
+			for (uint32_t t = pClusterStarts[k]; t < pClusterStarts[k + 1]; t++)
+			{
+				const float3& a = GetPosition(pPositions, positionStride, indices[t * 3]);
+				const float3& b = GetPosition(pPositions, positionStride, indices[t * 3 + 1]);
+				const float3& c = GetPosition(pPositions, positionStride, indices[t * 3 + 2]);
+
+				const float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z }, e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+				const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				const float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				const float center[3] = { (a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f };
+				for (int i = 0; i < 3; i++)
+				{
+					centroids[k * 3 + i] += center[i] * area;
+					normals[k * 3 + i] += n[i];
+					meshCentroid[i] += center[i] * area;
+				}
+				clusterArea += area;
+			}
+
+			meshArea += clusterArea;
+			for (int i = 0; i < 3 && clusterArea > 0.0f; i++)
+				centroids[k * 3 + i] /= clusterArea;
+		}
+		for (int i = 0; i < 3 && meshArea > 0.0f; i++)
+			meshCentroid[i] /= meshArea;
+
+		std::vector<float> keys(clusterCount);
+		for (size_t k = 0; k < clusterCount; k++)
+		{
+			const float* n = &normals[k * 3];
+			const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			float key = 0.0f;
+			for (int i = 0; i < 3 && length > 0.0f; i++)
+				key += (centroids[k * 3 + i] - meshCentroid[i]) * n[i] / length;
+			keys[k] = key;
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		for (uint32_t k = 0; k < clusterCount; k++)
+			order[k] = k;
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+		std::vector<uint32_t> output;
+		output.reserve((pClusterStarts[clusterCount] - pClusterStarts[0]) * 3);
+		for (uint32_t k : order)
+			output.insert(output.end(), indices.begin() + pClusterStarts[k] * 3, indices.begin() + pClusterStarts[k + 1] * 3);
+		std::copy(output.begin(), output.end(), indices.begin() + pClusterStarts[0] * 3);
+	}
+
+	void ComputeBounds(const float* pPositions, size_t positionStride, uint32_t vertexCount, float* pMin, float* pMax)
+	{
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			const float3& p = GetPosition(pPositions, positionStride, v);
+			pMin[0] = std::min(pMin[0], p.x); pMin[1] = std::min(pMin[1], p.y); pMin[2] = std::min(pMin[2], p.z);
+			pMax[0] = std::max(pMax[0], p.x); pMax[1] = std::max(pMax[1], p.y); pMax[2] = std::max(pMax[2], p.z);
+		}
+	}
+}
+
+// =====================================================================================
+//										Optimization
+// =====================================================================================
+
+void OptimizeOverdraw(void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount, float threshold)
+{
+	const uint32_t triangleCount = indexCount / 3;
+	if (triangleCount < 2 * kMinClusterTriangles)
+		return;
+
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, triangleCount * 3, &indices);
+
+	// ----------------------------- Hard cuts
+	std::vector<uint32_t> hardStarts;
+	{
+		CacheSimulator cache(vertexCount);
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			if (cache.Access(&indices[t * 3]) == 3 || t == 0)
+				hardStarts.push_back(t);
+		}
+		hardStarts.push_back(triangleCount);
+	}
+
+	// ----------------------------- Soft cuts
+	std::vector<uint32_t> clusterStarts;
+	{
+		CacheSimulator cache(vertexCount);
+		for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+		{
+			const uint32_t begin = hardStarts[h], end = hardStarts[h + 1];
+
+			cache.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t t = begin; t < end; t++)
+				clusterMisses += cache.Access(&indices[t * 3]);
+			const float targetAcmr = threshold * clusterMisses / (end - begin);
+
+			cache.Flush();
+			clusterStarts.push_back(begin);
+			uint32_t misses = 0, start = begin;
+			for (uint32_t t = begin; t < end; t++)
+			{
+				misses += cache.Access(&indices[t * 3]);
+				const uint32_t count = t + 1 - start;
+				if (count >= kMinClusterTriangles && t + 1 < end && (float)misses <= targetAcmr * count)
+				{
+					clusterStarts.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					cache.Flush();
+				}
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+	}
+
+	// ----------------------------- Sort
+	SortClusters(&indices, clusterStarts.data(), (uint32_t)clusterStarts.size() - 1, pPositions, positionStride);
+	WriteIndexRun(indices, indexSize, pIndices);
+}
+
+void SortClustersForOverdraw(void* pIndices, uint32_t indexSize, const uint32_t* pClusterStarts, uint32_t clusterCount,
+	const float* pPositions, size_t positionStride)
+{
+	if (clusterCount < 2)
+		return;
+
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, pClusterStarts[clusterCount] * 3, &indices);
+	SortClusters(&indices, pClusterStarts, clusterCount, pPositions, positionStride);
+	WriteIndexRun(indices, indexSize, pIndices);
+}
+
+void OptimizeOverdraw(IndexedMesh* pMesh, float threshold, ThreadPool* pPool)
+{
+	ForEachPart(pMesh, pPool, [pMesh, threshold](const MeshPart& part)
+	{
+		if (part.vertexCount == 0)
+			return;
+		OptimizeOverdraw(&pMesh->indexData[part.indexByteOffset], part.indexSize, part.indexCount,
+			pMesh->vertices[part.baseVertex].position, sizeof(MeshVertex), part.vertexCount, threshold);
+	});
+}
+
+// =====================================================================================
+//										Analysis
+// =====================================================================================
+
+OverdrawStats AnalyzeOverdraw(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount, uint32_t resolution)
+{
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, indexCount, &indices);
+
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	ComputeBounds(pPositions, positionStride, vertexCount, boundsMin, boundsMax);
+
+	OverdrawStats stats;
+	OverdrawRasterizer rasterizer(resolution, boundsMin, boundsMax);
+	for (int view = 0; view < 6; view++)
+	{
+		rasterizer.Begin(view);
+		rasterizer.Draw(indices.data(), indexCount, pPositions, positionStride);
+		rasterizer.End(&stats);
+	}
+	return stats;
+}
+
+OverdrawStats AnalyzeOverdraw(const IndexedMesh& mesh, uint32_t resolution)
+{
+	// All parts into the same depth buffer - parts occlude each other
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	if (!mesh.vertices.empty())
+		ComputeBounds(mesh.vertices[0].position, sizeof(MeshVertex), (uint32_t)mesh.vertices.size(), boundsMin, boundsMax);
+
+	std::vector<std::vector<uint32_t>> partIndices(mesh.parts.size());
+	for (size_t p = 0; p < mesh.parts.size(); p++)
+		ReadIndexRun(&mesh.indexData[mesh.parts[p].indexByteOffset], mesh.parts[p].indexSize, mesh.parts[p].indexCount, &partIndices[p]);
+
+	OverdrawStats stats;
+	OverdrawRasterizer rasterizer(resolution, boundsMin, boundsMax);
+	for (int view = 0; view < 6; view++)
+	{
+		rasterizer.Begin(view);
+		for (size_t p = 0; p < mesh.parts.size(); p++)
+		{
+			if (mesh.parts[p].vertexCount == 0)
+				continue;
+			rasterizer.Draw(partIndices[p].data(), mesh.parts[p].indexCount,
+				mesh.vertices[mesh.parts[p].baseVertex].position, sizeof(MeshVertex));
+		}
+		rasterizer.End(&stats);
+	}
+	return stats;
+}
+
+} // namespace MeshTools
@@ -0,0 +1,59 @@
+#pragma once
+
+// View-independent overdraw reduction (Sander, Nehab, Barczak - "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw"), run on an index run that went through OptimizeVertexCache:
+//		1. The run is cut into clusters: hard cuts where the cache optimizer had to restart (all 3
+//		   vertices miss the simulated cache), soft cuts inside where the ACMR up to that triangle
+//		   is still within threshold * the ACMR of the whole cluster
+//		2. Clusters are drawn in descending order of dot(cluster centroid - mesh centroid, cluster
+//		   normal): outward-facing clusters on the outside of the mesh are likely to occlude the
+//		   rest from most view directions, so they go first and early depth test rejects more
+// Triangles keep their order within a cluster, so most of the vertex cache efficiency stays -
+// threshold trades it against overdraw (1.0: only hard cuts, 1.05: about 5% more transforms).
+//
+// AnalyzeOverdraw rasterizes the run from the 6 axis directions into a small depth buffer
+// (orthographic, no culling) and reports
+//		overdraw - pixels shaded (passed the depth test) / pixels covered (1 is the ideal)
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+namespace MeshTools
+{
+
+struct IndexedMesh;
+
+struct OverdrawStats
+{
+	uint64_t pixelsCovered = 0;
+	uint64_t pixelsShaded = 0;
+
+	double GetOverdraw() const { return pixelsCovered ? (double)pixelsShaded / pixelsCovered : 0.0; }
+
+	void Add(const OverdrawStats& other)
+	{
+		pixelsCovered += other.pixelsCovered;
+		pixelsShaded += other.pixelsShaded;
+	}
+};
+
+// pPositions: float xyz of vertex 0 of the run, positionStride bytes apart (e.g. sizeof(MeshVertex))
+void OptimizeOverdraw(void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount, float threshold = 1.05f);
+
+// Step 2 alone, for passes that cut the run into clusters of their own (OptimizeMeshletOrder):
+// pClusterStarts holds clusterCount + 1 triangle offsets. Triangles from pClusterStarts[clusterCount]
+// on keep their place.
+void SortClustersForOverdraw(void* pIndices, uint32_t indexSize, const uint32_t* pClusterStarts, uint32_t clusterCount,
+	const float* pPositions, size_t positionStride);
+
+OverdrawStats AnalyzeOverdraw(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount, uint32_t resolution = 256);
+
+// All parts of the mesh, parts in parallel if pPool != nullptr
+void OptimizeOverdraw(IndexedMesh* pMesh, float threshold = 1.05f, ThreadPool* pPool = nullptr);
+OverdrawStats AnalyzeOverdraw(const IndexedMesh& mesh, uint32_t resolution = 256);
+
+} // namespace MeshTools
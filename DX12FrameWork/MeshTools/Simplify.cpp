@@ -0,0 +1,602 @@
+#include "Simplify.h"
+#include "IndexedMesh.h"
+#include "MeshToolsMath.h"
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace MeshTools
+{
+
+namespace
+{
+	const uint32_t kNone = 0xFFFFFFFF;
+
+	// Planes along open edges, relative to the triangle planes (area weighted, edges length weighted)
+	const float kBorderWeight = 10.0f;
+	const float kSeamWeight = 1.0f;
+	// A collapse may turn a remaining triangle by up to acos(0.25) ~ 75 degrees
+	const float kMaxFlipCos = 0.25f;
+
+	enum VertexKind : uint8_t
+	{
+		Manifold,
+		Border,
+		Seam,
+		Locked,
+	};
+
+	// Source kind (row) may collapse onto target kind (column)
+	const bool kCanCollapse[4][4] =
+	{
+		{ true, true, true, true },
+		{ false, true, false, true },
+		{ false, false, true, true },
+		{ false, false, false, false },
+	};
+
+	// Symmetric 4x4 matrix of the sum of squared plane distances, w = sum of the weights
+	struct Quadric
+	{
+		float a00, a11, a22, a10, a20, a21, b0, b1, b2, c, w;
+	};
+
+	void AddPlane(Quadric* q, const float3& n, float d, float weight)
+	{
+		q->a00 += weight * n.x * n.x;
+		q->a11 += weight * n.y * n.y;
+		q->a22 += weight * n.z * n.z;
+		q->a10 += weight * n.y * n.x;
+		q->a20 += weight * n.z * n.x;
+		q->a21 += weight * n.z * n.y;
+		q->b0 += weight * n.x * d;
+		q->b1 += weight * n.y * d;
+		q->b2 += weight * n.z * d;
+		q->c += weight * d * d;
+		q->w += weight;
+	}
+
+	void AddQuadric(Quadric* q, const Quadric& other)
+	{
+		q->a00 += other.a00;
+		q->a11 += other.a11;
+		q->a22 += other.a22;
+		q->a10 += other.a10;
+		q->a20 += other.a20;
+		q->a21 += other.a21;
+		q->b0 += other.b0;
+		q->b1 += other.b1;
+		q->b2 += other.b2;
+		q->c += other.c;
+		q->w += other.w;
+	}
+
+	// Weighted mean of the squared plane distances
+	float EvaluateQuadric(const Quadric& q, const float3& p)
+	{
+		const float rx = q.a00 * p.x + q.a10 * p.y + q.a20 * p.z;
+		const float ry = q.a10 * p.x + q.a11 * p.y + q.a21 * p.z;
+		const float rz = q.a20 * p.x + q.a21 * p.y + q.a22 * p.z;
+		const float r = rx * p.x + ry * p.y + rz * p.z + 2.0f * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+		return fabsf(r) / (q.w > 0.0f ? q.w : 1.0f);
+	}
+
+	// Compressed sparse rows: the items of key k are items[offsets[k]..offsets[k + 1])
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> items;
+
+		const uint32_t* Begin(uint32_t key) const { return items.data() + offsets[key]; }
+		const uint32_t* End(uint32_t key) const { return items.data() + offsets[key + 1]; }
+	};
+
+	// Directed edges a -> b of the triangles, keyed by remap[a], items remap[b]
+	void BuildEdges(const std::vector<uint32_t>& indices, const uint32_t* pRemap, uint32_t vertexCount, Adjacency* pOut)
+	{
+		pOut->offsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : indices)
+			pOut->offsets[pRemap[index] + 1]++;
+		for (uint32_t v = 0; v < vertexCount; v++)
+			pOut->offsets[v + 1] += pOut->offsets[v];
+
+		std::vector<uint32_t> fill(pOut->offsets.begin(), pOut->offsets.end() - 1);
+		pOut->items.resize(indices.size());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			for (int k = 0; k < 3; k++)
+				pOut->items[fill[pRemap[indices[t + k]]]++] = pRemap[indices[t + (k + 1) % 3]];
+		}
+	}
+
+	bool HasEdge(const Adjacency& edges, uint32_t a, uint32_t b)
+	{
+		return std::find(edges.Begin(a), edges.End(a), b) != edges.End(a);
+	}
+
+	// Triangles (first index / 3) around each position
+	void BuildTriangleAdjacency(const std::vector<uint32_t>& indices, const uint32_t* pRemap, uint32_t vertexCount, Adjacency* pOut)
+	{
+		pOut->offsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : indices)
+			pOut->offsets[pRemap[index] + 1]++;
+		for (uint32_t v = 0; v < vertexCount; v++)
+			pOut->offsets[v + 1] += pOut->offsets[v];
+
+		std::vector<uint32_t> fill(pOut->offsets.begin(), pOut->offsets.end() - 1);
+		pOut->items.resize(indices.size());
+		for (uint32_t i = 0; i < (uint32_t)indices.size(); i++)
+			pOut->items[fill[pRemap[indices[i]]]++] = i / 3;
+	}
+
+	struct Collapse
+	{
+		uint32_t source;
+		uint32_t target;
+		float error;
+	};
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const float* pPositions, size_t positionStride, uint32_t vertexCount)
+			: m_pPositions(pPositions), m_PositionStride(positionStride), m_VertexCount(vertexCount)
+		{
+		}
+
+		uint32_t Run(std::vector<uint32_t>* pIndices, uint32_t targetIndexCount, float maxError, float* pResultError);
+
+	private:
+		void BuildPositionRemap();
+		void ClassifyVertices(const std::vector<uint32_t>& indices);
+		void FillQuadrics(const std::vector<uint32_t>& indices);
+		bool CanCollapse(uint32_t source, uint32_t target) const;
+		bool HasTriangleFlips(const std::vector<uint32_t>& indices, const Adjacency& triangles, uint32_t source, uint32_t target) const;
+		void RemapEdgeLoops(std::vector<uint32_t>* pLoop, const std::vector<uint32_t>& collapseRemap) const;
+
+		// Positions scaled into the unit cube, so the quadrics stay in float range
+		float3 Position(uint32_t v) const { return m_Scaled[v]; }
+
+		const float* m_pPositions;
+		size_t m_PositionStride;
+		uint32_t m_VertexCount;
+		float m_Scale = 1.0f;
+
+		std::vector<float3> m_Scaled;
+		std::vector<uint32_t> m_Remap;		// first vertex with the same position
+		std::vector<uint32_t> m_Wedge;		// next vertex with the same position, circular
+		std::vector<VertexKind> m_Kinds;
+		std::vector<uint32_t> m_Loop;		// open edge v -> loop[v], kNone if none or several
+		std::vector<uint32_t> m_LoopBack;	// open edge loopBack[v] -> v
+		std::vector<Quadric> m_Quadrics;	// per position (remap)
+	};
+
+	void Simplifier::BuildPositionRemap()
+	{
+		float3 boxMin = { FLT_MAX, FLT_MAX, FLT_MAX }, boxMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t v = 0; v < m_VertexCount; v++)
+		{
+			const float3& p = GetPosition(m_pPositions, m_PositionStride, v);
+			boxMin = { std::min(boxMin.x, p.x), std::min(boxMin.y, p.y), std::min(boxMin.z, p.z) };
+			boxMax = { std::max(boxMax.x, p.x), std::max(boxMax.y, p.y), std::max(boxMax.z, p.z) };
+		}
+		const float extent = std::max(boxMax.x - boxMin.x, std::max(boxMax.y - boxMin.y, boxMax.z - boxMin.z));
+		m_Scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+		m_Scaled.resize(m_VertexCount);
+		for (uint32_t v = 0; v < m_VertexCount; v++)
+			m_Scaled[v] = Sub(GetPosition(m_pPositions, m_PositionStride, v), boxMin);
+		for (float3& p : m_Scaled)
+			p = { p.x * m_Scale, p.y * m_Scale, p.z * m_Scale };
+
+		// Equal positions (bit for bit) are neighbours after sorting
+		std::vector<uint32_t> order(m_VertexCount);
+		for (uint32_t v = 0; v < m_VertexCount; v++)
+			order[v] = v;
+		auto compare = [this](uint32_t a, uint32_t b)
+		{
+			const int result = memcmp(&GetPosition(m_pPositions, m_PositionStride, a), &GetPosition(m_pPositions, m_PositionStride, b), sizeof(float3));
+			return result != 0 ? result < 0 : a < b;
+		};
+		std::sort(order.begin(), order.end(), compare);
+
+		m_Remap.resize(m_VertexCount);
+		m_Wedge.resize(m_VertexCount);
+		for (uint32_t i = 0; i < m_VertexCount;)
+		{
+			uint32_t end = i + 1;
+			while (end < m_VertexCount && memcmp(&GetPosition(m_pPositions, m_PositionStride, order[i]),
+				&GetPosition(m_pPositions, m_PositionStride, order[end]), sizeof(float3)) == 0)
+				end++;
+			for (uint32_t j = i; j < end; j++)
+			{
+				m_Remap[order[j]] = order[i];
+				m_Wedge[order[j]] = order[j + 1 < end ? j + 1 : i];
+			}
+			i = end;
+		}
+	}
+
+	void Simplifier::ClassifyVertices(const std::vector<uint32_t>& indices)
+	{
+		std::vector<uint32_t> identity(m_VertexCount);
+		for (uint32_t v = 0; v < m_VertexCount; v++)
+			identity[v] = v;
+
+		Adjacency vertexEdges, positionEdges;
+		BuildEdges(indices, identity.data(), m_VertexCount, &vertexEdges);
+		BuildEdges(indices, m_Remap.data(), m_VertexCount, &positionEdges);
+
+		// Open edges: no triangle on the other side with the same vertices
+		std::vector<uint8_t> openOut(m_VertexCount, 0), openIn(m_VertexCount, 0), nonManifold(m_VertexCount, 0);
+		m_Loop.assign(m_VertexCount, kNone);
+		m_LoopBack.assign(m_VertexCount, kNone);
+		for (uint32_t a = 0; a < m_VertexCount; a++)
+		{
+			for (const uint32_t* pEdge = vertexEdges.Begin(a); pEdge != vertexEdges.End(a); pEdge++)
+			{
+				const uint32_t b = *pEdge;
+				// The same directed edge twice: more than two triangles on an edge, or one flipped
+				if (std::find(pEdge + 1, vertexEdges.End(a), b) != vertexEdges.End(a))
+					nonManifold[m_Remap[a]] = nonManifold[m_Remap[b]] = 1;
+				if (HasEdge(vertexEdges, b, a))
+					continue;
+				openOut[a] = (uint8_t)std::min(openOut[a] + 1, 2);
+				openIn[b] = (uint8_t)std::min(openIn[b] + 1, 2);
+				m_Loop[a] = b;
+				m_LoopBack[b] = a;
+			}
+		}
+
+		auto isSeamSide = [&](uint32_t v)
+		{
+			// One open edge in and out, both closed by another vertex of the same positions
+			return openOut[v] == 1 && openIn[v] == 1 &&
+				HasEdge(positionEdges, m_Remap[m_Loop[v]], m_Remap[v]) && HasEdge(positionEdges, m_Remap[v], m_Remap[m_LoopBack[v]]);
+		};
+
+		m_Kinds.assign(m_VertexCount, Locked);
+		for (uint32_t v = 0; v < m_VertexCount; v++)
+		{
+			if (m_Remap[v] != v)
+				continue;
+
+			uint32_t wedgeCount = 0;
+			bool open = false;
+			uint32_t w = v;
+			do
+			{
+				wedgeCount++;
+				open |= openOut[w] || openIn[w];
+				w = m_Wedge[w];
+			} while (w != v);
+
+			VertexKind kind = Locked;
+			if (nonManifold[v])
+				kind = Locked;
+			else if (wedgeCount == 1)
+				kind = !open ? Manifold : openOut[v] == 1 && openIn[v] == 1 ? Border : Locked;
+			else if (wedgeCount == 2)
+			{
+				// The two sides of one seam line: each side continues where the other comes from
+				const uint32_t w1 = m_Wedge[v];
+				if (isSeamSide(v) && isSeamSide(w1) &&
+					m_Remap[m_Loop[v]] == m_Remap[m_LoopBack[w1]] && m_Remap[m_Loop[w1]] == m_Remap[m_LoopBack[v]])
+					kind = Seam;
+			}
+
+			w = v;
+			do
+			{
+				m_Kinds[w] = kind;
+				w = m_Wedge[w];
+			} while (w != v);
+		}
+	}
+
+	void Simplifier::FillQuadrics(const std::vector<uint32_t>& indices)
+	{
+		m_Quadrics.assign(m_VertexCount, Quadric());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			const uint32_t i[3] = { indices[t], indices[t + 1], indices[t + 2] };
+			const float3 p[3] = { Position(i[0]), Position(i[1]), Position(i[2]) };
+			float3 normal = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+			const float area = Length(normal);
+			if (area == 0.0f)
+				continue;
+			normal = { normal.x / area, normal.y / area, normal.z / area };
+
+			Quadric plane = {};
+			AddPlane(&plane, normal, -Dot(normal, p[0]), area);
+			for (int k = 0; k < 3; k++)
+				AddQuadric(&m_Quadrics[m_Remap[i[k]]], plane);
+
+			// Open edges: a plane through the edge, perpendicular to the triangle
+			for (int k = 0; k < 3; k++)
+			{
+				const uint32_t a = i[k], b = i[(k + 1) % 3];
+				if (m_Loop[a] != b)
+					continue;
+				const float3 edge = Sub(p[(k + 1) % 3], p[k]);
+				const float length = Length(edge);
+				float3 side = Cross(edge, normal);
+				const float sideLength = Length(side);
+				if (sideLength == 0.0f)
+					continue;
+				side = { side.x / sideLength, side.y / sideLength, side.z / sideLength };
+
+				Quadric edgePlane = {};
+				AddPlane(&edgePlane, side, -Dot(side, p[k]), length * (m_Kinds[a] == Seam ? kSeamWeight : kBorderWeight));
+				AddQuadric(&m_Quadrics[m_Remap[a]], edgePlane);
+				AddQuadric(&m_Quadrics[m_Remap[b]], edgePlane);
+			}
+		}
+	}
+
+	bool Simplifier::CanCollapse(uint32_t source, uint32_t target) const
+	{
+		if (!kCanCollapse[m_Kinds[source]][m_Kinds[target]])
+			return false;
+		// Borders and seams only along their own open edges
+		if (m_Kinds[source] == Border || m_Kinds[source] == Seam)
+			return m_Loop[source] == target || m_LoopBack[source] == target;
+		return true;
+	}
+
+	bool Simplifier::HasTriangleFlips(const std::vector<uint32_t>& indices, const Adjacency& triangles, uint32_t source, uint32_t target) const
+	{
+		const float3 s = Position(source), d = Position(target);
+		const uint32_t targetPosition = m_Remap[target];
+		for (const uint32_t* pTriangle = triangles.Begin(m_Remap[source]); pTriangle != triangles.End(m_Remap[source]); pTriangle++)
+		{
+			const uint32_t* pCorners = &indices[*pTriangle * 3];
+			int k = 0;
+			while (k < 2 && m_Remap[pCorners[k]] != m_Remap[source])
+				k++;
+			const uint32_t b = pCorners[(k + 1) % 3], c = pCorners[(k + 2) % 3];
+			// Triangles on the collapsed edge disappear
+			if (m_Remap[b] == targetPosition || m_Remap[c] == targetPosition)
+				continue;
+
+			const float3 pb = Position(b), pc = Position(c);
+			const float3 before = Cross(Sub(pb, s), Sub(pc, s));
+			const float3 after = Cross(Sub(pb, d), Sub(pc, d));
+			if (Dot(before, after) <= kMaxFlipCos * Length(before) * Length(after))
+				return true;
+		}
+		return false;
+	}
+
+	// Open edges follow the collapses. i == r: a seam edge collapsed against the direction of the loop.
+	void Simplifier::RemapEdgeLoops(std::vector<uint32_t>* pLoop, const std::vector<uint32_t>& collapseRemap) const
+	{
+		std::vector<uint32_t>& loop = *pLoop;
+		for (uint32_t i = 0; i < m_VertexCount; i++)
+		{
+			if (loop[i] == kNone)
+				continue;
+			const uint32_t l = loop[i];
+			const uint32_t r = collapseRemap[l];
+			loop[i] = i == r ? loop[l] : r;
+		}
+	}
+
+	uint32_t Simplifier::Run(std::vector<uint32_t>* pIndices, uint32_t targetIndexCount, float maxError, float* pResultError)
+	{
+		std::vector<uint32_t>& indices = *pIndices;
+		BuildPositionRemap();
+
+		// Triangles without area in position terms can't be collapsed sensibly - dropped up front
+		size_t kept = 0;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			const uint32_t a = m_Remap[indices[t]], b = m_Remap[indices[t + 1]], c = m_Remap[indices[t + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			for (int k = 0; k < 3; k++)
+				indices[kept + k] = indices[t + k];
+			kept += 3;
+		}
+		indices.resize(kept);
+
+		ClassifyVertices(indices);
+		FillQuadrics(indices);
+
+		const float errorLimit = maxError < FLT_MAX ? (maxError * m_Scale) * (maxError * m_Scale) : FLT_MAX;
+		float resultError = 0.0f;
+
+		Adjacency triangles;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> collapseRemap(m_VertexCount);
+		std::vector<uint8_t> locked(m_VertexCount);
+		while (indices.size() > targetIndexCount)
+		{
+			// Cheaper direction of every edge that may collapse. An inner edge is seen from both of its
+			// triangles, only the one with the lower first position adds it.
+			collapses.clear();
+			for (size_t t = 0; t + 2 < indices.size(); t += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					const uint32_t a = indices[t + k], b = indices[t + (k + 1) % 3];
+					if (m_Remap[a] > m_Remap[b] && m_Loop[a] != b)
+						continue;
+					const bool canAB = CanCollapse(a, b), canBA = CanCollapse(b, a);
+					if (!canAB && !canBA)
+						continue;
+					const float errorAB = canAB ? EvaluateQuadric(m_Quadrics[m_Remap[a]], Position(b)) : FLT_MAX;
+					const float errorBA = canBA ? EvaluateQuadric(m_Quadrics[m_Remap[b]], Position(a)) : FLT_MAX;
+					collapses.push_back(errorAB <= errorBA ? Collapse{ a, b, errorAB } : Collapse{ b, a, errorBA });
+				}
+			}
+			if (collapses.empty())
+				break;
+
+			// A collapse takes two triangles (one on a border). Many candidates get locked out by a
+			// neighbour, so the pass accepts errors up to 1.5x the one of the last collapse it needs.
+			// Only the collapses under that limit get sorted.
+			auto byError = [](const Collapse& a, const Collapse& b) { return a.error < b.error; };
+			const uint32_t triangleGoal = (uint32_t)(indices.size() - targetIndexCount) / 3;
+			const uint32_t edgeGoal = triangleGoal / 2;
+			float passLimit = errorLimit;
+			if (edgeGoal < collapses.size())
+			{
+				std::nth_element(collapses.begin(), collapses.begin() + edgeGoal, collapses.end(), byError);
+				passLimit = std::min(passLimit, collapses[edgeGoal].error * 1.5f);
+			}
+			const auto end = std::partition(collapses.begin(), collapses.end(), [passLimit](const Collapse& c) { return c.error <= passLimit; });
+			collapses.erase(end, collapses.end());
+			std::sort(collapses.begin(), collapses.end(), byError);
+
+			BuildTriangleAdjacency(indices, m_Remap.data(), m_VertexCount, &triangles);
+			for (uint32_t v = 0; v < m_VertexCount; v++)
+				collapseRemap[v] = v;
+			std::fill(locked.begin(), locked.end(), (uint8_t)0);
+
+			uint32_t collapsedTriangles = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapsedTriangles >= triangleGoal)
+					break;
+				const uint32_t source = collapse.source, target = collapse.target;
+				if (locked[m_Remap[source]] || locked[m_Remap[target]])
+					continue;
+				if (HasTriangleFlips(indices, triangles, source, target))
+					continue;
+
+				if (m_Kinds[source] == Seam)
+				{
+					// The other side of the seam goes to the other side of the target
+					const uint32_t otherSource = m_Wedge[source];
+					const uint32_t otherTarget = m_Loop[source] == target ? m_LoopBack[otherSource] : m_Loop[otherSource];
+					if (otherTarget == kNone || m_Remap[otherTarget] != m_Remap[target])
+						continue;
+					collapseRemap[otherSource] = otherTarget;
+				}
+				collapseRemap[source] = target;
+
+				AddQuadric(&m_Quadrics[m_Remap[target]], m_Quadrics[m_Remap[source]]);
+				locked[m_Remap[source]] = 1;
+				locked[m_Remap[target]] = 1;
+				collapsedTriangles += m_Kinds[source] == Border ? 1 : 2;
+				resultError = std::max(resultError, collapse.error);
+			}
+			if (collapsedTriangles == 0)
+				break;
+
+			size_t count = 0;
+			for (size_t t = 0; t + 2 < indices.size(); t += 3)
+			{
+				const uint32_t a = collapseRemap[indices[t]], b = collapseRemap[indices[t + 1]], c = collapseRemap[indices[t + 2]];
+				if (m_Remap[a] == m_Remap[b] || m_Remap[b] == m_Remap[c] || m_Remap[a] == m_Remap[c])
+					continue;
+				indices[count] = a;
+				indices[count + 1] = b;
+				indices[count + 2] = c;
+				count += 3;
+			}
+			indices.resize(count);
+			RemapEdgeLoops(&m_Loop, collapseRemap);
+			RemapEdgeLoops(&m_LoopBack, collapseRemap);
+		}
+
+		if (pResultError)
+			*pResultError = sqrtf(resultError) / m_Scale;
+		return (uint32_t)indices.size();
+	}
+}
+
+// =====================================================================================
+//										Simplify
+// =====================================================================================
+
+uint32_t SimplifyIndices(uint32_t* pDestination, const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount,
+	uint32_t targetIndexCount, float maxError, float* pResultError)
+{
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, indexCount / 3 * 3, &indices);
+
+	Simplifier simplifier(pPositions, positionStride, vertexCount);
+	const uint32_t count = simplifier.Run(&indices, targetIndexCount, maxError, pResultError);
+	memcpy(pDestination, indices.data(), (size_t)count * sizeof(uint32_t));
+	return count;
+}
+
+// =====================================================================================
+//										LOD chain
+// =====================================================================================
+
+uint32_t BuildLodChain(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount,
+	const float* pRatios, uint32_t ratioCount, float maxError, std::vector<LodLevel>* pOut)
+{
+	pOut->clear();
+	std::vector<uint32_t> indices(indexCount);
+	uint32_t previousCount = indexCount / 3 * 3;
+	float previousError = 0.0f;
+	for (uint32_t r = 0; r < ratioCount; r++)
+	{
+		const uint32_t target = (uint32_t)(indexCount / 3 * pRatios[r]) * 3;
+		float error = 0.0f;
+		const uint32_t count = SimplifyIndices(indices.data(), pIndices, indexSize, indexCount,
+			pPositions, positionStride, vertexCount, target, maxError, &error);
+		if (count == 0 || count > previousCount / 10 * 9)
+			break;
+
+		LodLevel level;
+		level.indices.assign(indices.begin(), indices.begin() + count);
+		OptimizeVertexCache(level.indices.data(), sizeof(uint32_t), count, vertexCount);
+		level.error = std::max(error, previousError);
+		pOut->push_back(std::move(level));
+
+		previousCount = count;
+		previousError = pOut->back().error;
+	}
+	return (uint32_t)pOut->size();
+}
+
+// =====================================================================================
+//										Selection
+// =====================================================================================
+
+void ComputeBoundingSphere(const float* pPositions, size_t positionStride, uint32_t vertexCount, float center[3], float* pRadius)
+{
+	center[0] = center[1] = center[2] = 0.0f;
+	*pRadius = 0.0f;
+	if (vertexCount == 0)
+		return;
+
+	float3 boxMin = GetPosition(pPositions, positionStride, 0), boxMax = boxMin;
+	for (uint32_t v = 1; v < vertexCount; v++)
+	{
+		const float3& p = GetPosition(pPositions, positionStride, v);
+		boxMin = { std::min(boxMin.x, p.x), std::min(boxMin.y, p.y), std::min(boxMin.z, p.z) };
+		boxMax = { std::max(boxMax.x, p.x), std::max(boxMax.y, p.y), std::max(boxMax.z, p.z) };
+	}
+	const float3 boxCenter = { (boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f };
+	float radius = 0.0f;
+	for (uint32_t v = 0; v < vertexCount; v++)
+		radius = std::max(radius, Length(Sub(GetPosition(pPositions, positionStride, v), boxCenter)));
+
+	center[0] = boxCenter.x;
+	center[1] = boxCenter.y;
+	center[2] = boxCenter.z;
+	*pRadius = radius;
+}
+
+uint32_t SelectLod(const MeshLod* pLods, uint32_t lodCount, float distance, float pixelsPerUnit, float maxPixelError)
+{
+	// error / distance * pixelsPerUnit <= maxPixelError, without the division (distance may be 0).
+	// Errors only grow along the chain, the first level over the budget ends the search.
+	uint32_t selected = 0;
+	while (selected < lodCount && pLods[selected].error * pixelsPerUnit <= maxPixelError * distance)
+		selected++;
+	return selected;
+}
+
+} // namespace MeshTools
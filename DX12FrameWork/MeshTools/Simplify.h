@@ -0,0 +1,81 @@
+#pragma once
+
+// Mesh simplification and discrete LODs.
+//
+// SimplifyIndices is a quadric error edge collapser (Garland/Heckbert) that only writes new
+// indices: every collapse moves a vertex onto a neighbour that already exists, so the vertex
+// buffer stays as it is and all levels of a chain share it. Each vertex carries the quadric of the
+// planes of its triangles (area weighted); a collapse costs the source quadric evaluated at the
+// target, and the collapses of a pass are taken cheapest first, at most one per vertex.
+//
+// Welded vertices are split wherever an attribute changes (uv islands, hard normals), so the same
+// position can have several vertices. Positions are classified once:
+//		manifold - one vertex, closed fan: collapses onto any neighbour
+//		border   - one vertex on one open edge loop: only along that loop
+//		seam     - two vertices with the edges between them open on either side (a uv or normal
+//		           seam): only along the seam, both vertices together, so the seam stays closed
+//		locked   - everything else (corners where seams meet, non-manifold fans): never moves
+// Open edges get extra planes perpendicular to their triangle, so borders and seams keep their line.
+// Collapses that would turn a triangle by more than ~75 degrees are skipped.
+//
+// Errors are distances in mesh units (square root of the quadric error). A level stores its error,
+// SelectLod turns it into pixels at a distance and picks the coarsest level under a pixel budget.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MeshTools
+{
+
+// Simplifies an index run (16- or 32-bit, triangle list) to at most targetIndexCount indices, or
+// less far if that needs collapses above maxError (mesh units). pPositions: float xyz of vertex 0
+// of the run, positionStride bytes apart. pDestination: room for indexCount 32-bit indices.
+// Returns the number of indices written; *pResultError (optional) gets the largest error used.
+uint32_t SimplifyIndices(uint32_t* pDestination, const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount,
+	uint32_t targetIndexCount, float maxError, float* pResultError = nullptr);
+
+// =====================================================================================
+//										LOD chain
+// =====================================================================================
+
+const float kDefaultLodRatios[] = { 0.5f, 0.25f, 0.125f };
+
+struct LodLevel
+{
+	std::vector<uint32_t> indices;		// relative to the vertices of the source run
+	float error = 0.0f;					// mesh units, never below the error of the level before
+};
+
+// One level per ratio, each simplified from the full run to about ratio * indexCount indices and
+// ordered for the vertex cache. Stops early when a level gets no smaller than 90% of the one
+// before (everything left is locked, or maxError is reached). Returns the number of levels.
+uint32_t BuildLodChain(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	const float* pPositions, size_t positionStride, uint32_t vertexCount,
+	const float* pRatios, uint32_t ratioCount, float maxError, std::vector<LodLevel>* pOut);
+
+// A level of a submesh: a range of the shared index arena (same index size and base vertex as the submesh)
+struct MeshLod
+{
+	uint32_t indexByteOffset;		// a multiple of 4
+	uint32_t indexCount;
+	float error;
+	uint32_t reserved;
+};
+static_assert(sizeof(MeshLod) == 16, "Part of the cooked mesh format");
+
+// =====================================================================================
+//										Selection
+// =====================================================================================
+
+// Sphere around the box center of the positions, for the distance of SelectLod
+void ComputeBoundingSphere(const float* pPositions, size_t positionStride, uint32_t vertexCount, float center[3], float* pRadius);
+
+// pixelsPerUnit: projected size of one unit at distance 1 - viewport height / (2 * tan(fovY / 2)).
+// distance: from the camera to the closest point of the bounding sphere, same units as the errors.
+// Returns 0 for the full mesh, i for pLods[i - 1]: the coarsest level with error * pixelsPerUnit /
+// distance <= maxPixelError.
+uint32_t SelectLod(const MeshLod* pLods, uint32_t lodCount, float distance, float pixelsPerUnit, float maxPixelError);
+
+} // namespace MeshTools
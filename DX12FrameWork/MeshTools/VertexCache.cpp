@@ -0,0 +1,247 @@
+#include "VertexCache.h"
+#include "IndexedMesh.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace MeshTools
+{
+
+namespace
+{
+	// Forsyth's constants
+	const uint32_t kCacheSize = 32;
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+	const uint32_t kValenceTableSize = 64;
+	const uint32_t kNoTriangle = 0xFFFFFFFF;
+
+	struct ScoreTables
+	{
+		float cache[kCacheSize];
+		float valence[kValenceTableSize];
+
+		ScoreTables()
+		{
+			for (uint32_t i = 0; i < kCacheSize; i++)
+			{
+				// The vertices of the last triangle get a fixed score, so that the next triangle
+				// doesn't just reuse an edge of it (which favours long strips over compact patches)
+				cache[i] = i < 3 ? kLastTriangleScore
+					: powf(1.0f - (float)(i - 3) / (kCacheSize - 3), kCacheDecayPower);
+			}
+			valence[0] = 0.0f;
+			for (uint32_t i = 1; i < kValenceTableSize; i++)
+				valence[i] = kValenceBoostScale * powf((float)i, -kValenceBoostPower);
+		}
+	};
+
+	float GetVertexScore(const ScoreTables& tables, int32_t cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;		// no triangle left to emit
+
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+		score += remainingTriangles < kValenceTableSize ? tables.valence[remainingTriangles]
+			: kValenceBoostScale * powf((float)remainingTriangles, -kValenceBoostPower);
+		return score;
+	}
+}
+
+// =====================================================================================
+//										Optimization
+// =====================================================================================
+
+void OptimizeVertexCache(void* pIndices, uint32_t indexSize, uint32_t indexCount, uint32_t vertexCount)
+{
+	static const ScoreTables tables;
+
+	const uint32_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, triangleCount * 3, &indices);
+
+	// Triangles of every vertex; the first remainingTriangles[v] entries are the ones not emitted yet
+	std::vector<uint32_t> remainingTriangles, adjacencyOffsets, adjacency;
+	BuildVertexTriangles(indices, vertexCount, &remainingTriangles, &adjacencyOffsets, &adjacency);
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = GetVertexScore(tables, -1, remainingTriangles[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	uint32_t bestTriangle = 0;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = t;
+	}
+
+	// The simulated cache, plus room for the 3 vertices that get pushed out per triangle
+	uint32_t cache[kCacheSize + 3];
+	uint32_t newCache[kCacheSize + 3];
+	uint32_t cacheCount = 0;
+
+	std::vector<uint32_t> output(triangleCount * 3);
+	uint32_t scanCursor = 0;
+	for (uint32_t outTriangle = 0; outTriangle < triangleCount; outTriangle++)
+	{
+		if (bestTriangle == kNoTriangle)
+		{
+			// No triangle left around the cache: continue with the next one in input order.
+			// The cursor only moves forward, so this costs O(triangleCount) over the whole run.
+			while (emitted[scanCursor])
+				scanCursor++;
+			bestTriangle = scanCursor;
+		}
+
+		const uint32_t* pCorners = &indices[bestTriangle * 3];
+		memcpy(&output[outTriangle * 3], pCorners, 3 * sizeof(uint32_t));
+		emitted[bestTriangle] = 1;
+
+		uint32_t newCacheCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			const uint32_t v = pCorners[c];
+
+			// Remove the triangle from the vertex's remaining list
+			uint32_t* pTriangles = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t i = 0; i < remainingTriangles[v]; i++)
+			{
+				if (pTriangles[i] == bestTriangle)
+				{
+					pTriangles[i] = pTriangles[--remainingTriangles[v]];
+					pTriangles[remainingTriangles[v]] = bestTriangle;
+					break;
+				}
+			}
+
+			bool duplicate = false;
+			for (uint32_t i = 0; i < newCacheCount; i++)
+				duplicate |= newCache[i] == v;
+			if (!duplicate)
+				newCache[newCacheCount++] = v;
+		}
+		for (uint32_t i = 0; i < cacheCount; i++)
+		{
+			const uint32_t v = cache[i];
+			if (v != pCorners[0] && v != pCorners[1] && v != pCorners[2])
+				newCache[newCacheCount++] = v;
+		}
+
+		// New cache positions and scores; the delta goes to the vertex's remaining triangles
+		for (uint32_t i = 0; i < newCacheCount; i++)
+		{
+			const uint32_t v = newCache[i];
+			cachePositions[v] = i < kCacheSize ? (int32_t)i : -1;
+
+			const float score = GetVertexScore(tables, cachePositions[v], remainingTriangles[v]);
+			const float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const uint32_t* pTriangles = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t t = 0; t < remainingTriangles[v]; t++)
+				triangleScores[pTriangles[t]] += delta;
+		}
+
+		cacheCount = newCacheCount < kCacheSize ? newCacheCount : kCacheSize;
+		memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+		// The next triangle is one of those touching the cache
+		bestTriangle = kNoTriangle;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < cacheCount; i++)
+		{
+			const uint32_t v = cache[i];
+			const uint32_t* pTriangles = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t t = 0; t < remainingTriangles[v]; t++)
+			{
+				if (triangleScores[pTriangles[t]] > bestScore)
+				{
+					bestScore = triangleScores[pTriangles[t]];
+					bestTriangle = pTriangles[t];
+				}
+			}
+		}
+	}
+
+	WriteIndexRun(output, indexSize, pIndices);
+}
+
+void OptimizeVertexCache(IndexedMesh* pMesh, ThreadPool* pPool)
+{
+	ForEachPart(pMesh, pPool, [pMesh](const MeshPart& part)
+	{
+		OptimizeVertexCache(&pMesh->indexData[part.indexByteOffset], part.indexSize, part.indexCount, part.vertexCount);
+	});
+}
+
+// =====================================================================================
+//										Analysis
+// =====================================================================================
+
+VertexCacheStats AnalyzeVertexCache(const void* pIndices, uint32_t indexSize, uint32_t indexCount, uint32_t vertexCount,
+	uint32_t cacheSize, VertexCacheModel model)
+{
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, indexCount, &indices);
+
+	VertexCacheStats stats;
+	stats.triangleCount = indexCount / 3;
+	stats.vertexCount = vertexCount;
+
+	if (model == VertexCacheModel::Fifo)
+	{
+		// A vertex is still in the FIFO if fewer than cacheSize misses happened since its own
+		std::vector<uint64_t> missStamps(vertexCount, 0);
+		uint64_t misses = 0;
+		for (uint32_t index : indices)
+		{
+			if (missStamps[index] == 0 || misses - missStamps[index] >= cacheSize)
+				missStamps[index] = ++misses;
+		}
+		stats.transformCount = misses;
+	}
+	else
+	{
+		std::vector<uint32_t> cache;
+		cache.reserve(cacheSize);
+		for (uint32_t index : indices)
+		{
+			size_t position = 0;
+			while (position < cache.size() && cache[position] != index)
+				position++;
+
+			if (position == cache.size())
+			{
+				stats.transformCount++;
+				if (cache.size() < cacheSize)
+					cache.push_back(index);
+				position = cache.size() - 1;
+			}
+			// Move to the front
+			for (; position > 0; position--)
+				cache[position] = cache[position - 1];
+			cache[0] = index;
+		}
+	}
+	return stats;
+}
+
+VertexCacheStats AnalyzeVertexCache(const IndexedMesh& mesh, uint32_t cacheSize, VertexCacheModel model)
+{
+	VertexCacheStats stats;
+	for (const MeshPart& part : mesh.parts)
+		stats.Add(AnalyzeVertexCache(&mesh.indexData[part.indexByteOffset], part.indexSize, part.indexCount, part.vertexCount, cacheSize, model));
+	return stats;
+}
+
+} // namespace MeshTools
@@ -0,0 +1,61 @@
+#pragma once
+
+// Post-transform vertex cache: triangle reordering and a cache simulator to measure it.
+//
+// OptimizeVertexCache is Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": triangles are
+// emitted greedily, always the one with the highest score, where a vertex scores by its position
+// in a simulated 32-entry LRU cache and by how few of its triangles are left (so that vertices
+// get finished instead of leaving islands behind). Only the order of the triangles changes, the
+// corners of a triangle stay as they are (winding is kept).
+//
+// AnalyzeVertexCache replays an index buffer through a FIFO (what most GPUs implement) or an LRU
+// cache and reports:
+//		ACMR - average cache miss ratio, transformed vertices per triangle (0.5 is the ideal for a
+//		       big regular grid, 3 is no reuse at all)
+//		ATVR - average transform to vertex ratio, transformed vertices per vertex (1 is the ideal)
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+namespace MeshTools
+{
+
+struct IndexedMesh;
+
+enum class VertexCacheModel
+{
+	Fifo,
+	Lru,
+};
+
+struct VertexCacheStats
+{
+	uint32_t triangleCount = 0;
+	uint32_t vertexCount = 0;
+	uint64_t transformCount = 0;		// cache misses
+
+	double GetAcmr() const { return triangleCount ? (double)transformCount / triangleCount : 0.0; }
+	double GetAtvr() const { return vertexCount ? (double)transformCount / vertexCount : 0.0; }
+
+	void Add(const VertexCacheStats& other)
+	{
+		triangleCount += other.triangleCount;
+		vertexCount += other.vertexCount;
+		transformCount += other.transformCount;
+	}
+};
+
+// Reorders the triangles of a run of 16- or 32-bit indices (indexSize 2 or 4) in place.
+// Indices must be < vertexCount.
+void OptimizeVertexCache(void* pIndices, uint32_t indexSize, uint32_t indexCount, uint32_t vertexCount);
+
+VertexCacheStats AnalyzeVertexCache(const void* pIndices, uint32_t indexSize, uint32_t indexCount, uint32_t vertexCount,
+	uint32_t cacheSize = 32, VertexCacheModel model = VertexCacheModel::Fifo);
+
+// All parts of the mesh, parts in parallel if pPool != nullptr
+void OptimizeVertexCache(IndexedMesh* pMesh, ThreadPool* pPool = nullptr);
+VertexCacheStats AnalyzeVertexCache(const IndexedMesh& mesh, uint32_t cacheSize = 32, VertexCacheModel model = VertexCacheModel::Fifo);
+
+} // namespace MeshTools
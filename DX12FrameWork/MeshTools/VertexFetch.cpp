@@ -0,0 +1,138 @@
+#include "VertexFetch.h"
+#include "IndexedMesh.h"
+
+#include <cstring>
+#include <vector>
+
+namespace MeshTools
+{
+
+namespace
+{
+	const uint32_t kUnassigned = 0xFFFFFFFF;
+	const uint32_t kCacheLineSize = 64;
+	const uint32_t kPostTransformCacheSize = 32;
+}
+
+// =====================================================================================
+//										Optimization
+// =====================================================================================
+
+void BuildVertexFetchRemap(const void* pIndices, uint32_t indexSize, uint32_t indexCount, uint32_t vertexCount, uint32_t* pRemap)
+{
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, indexCount, &indices);
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+		pRemap[v] = kUnassigned;
+
+	uint32_t nextVertex = 0;
+	for (uint32_t index : indices)
+	{
+		if (pRemap[index] == kUnassigned)
+			pRemap[index] = nextVertex++;
+	}
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		if (pRemap[v] == kUnassigned)
+			pRemap[v] = nextVertex++;
+	}
+}
+
+void RemapIndices(void* pIndices, uint32_t indexSize, uint32_t indexCount, const uint32_t* pRemap)
+{
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, indexCount, &indices);
+	for (uint32_t& index : indices)
+		index = pRemap[index];
+	WriteIndexRun(indices, indexSize, pIndices);
+}
+
+void RemapVertices(void* pDst, const void* pSrc, uint32_t vertexCount, uint32_t vertexStride, const uint32_t* pRemap)
+{
+	uint8_t* pDstBytes = static_cast<uint8_t*>(pDst);
+	const uint8_t* pSrcBytes = static_cast<const uint8_t*>(pSrc);
+	for (uint32_t v = 0; v < vertexCount; v++)
+		memcpy(pDstBytes + (size_t)pRemap[v] * vertexStride, pSrcBytes + (size_t)v * vertexStride, vertexStride);
+}
+
+void OptimizeVertexFetch(void* pVertices, uint32_t vertexCount, uint32_t vertexStride,
+	void* pIndices, uint32_t indexSize, uint32_t indexCount)
+{
+	if (vertexCount == 0)
+		return;
+
+	std::vector<uint32_t> remap(vertexCount);
+	BuildVertexFetchRemap(pIndices, indexSize, indexCount, vertexCount, remap.data());
+	RemapIndices(pIndices, indexSize, indexCount, remap.data());
+
+	std::vector<uint8_t> source(static_cast<const uint8_t*>(pVertices), static_cast<const uint8_t*>(pVertices) + (size_t)vertexCount * vertexStride);
+	RemapVertices(pVertices, source.data(), vertexCount, vertexStride, remap.data());
+}
+
+void OptimizeVertexFetch(IndexedMesh* pMesh, ThreadPool* pPool)
+{
+	// Parts own disjoint vertex ranges and index runs
+	ForEachPart(pMesh, pPool, [pMesh](const MeshPart& part)
+	{
+		if (part.vertexCount == 0)
+			return;
+		OptimizeVertexFetch(&pMesh->vertices[part.baseVertex], part.vertexCount, sizeof(MeshVertex),
+			&pMesh->indexData[part.indexByteOffset], part.indexSize, part.indexCount);
+	});
+}
+
+// =====================================================================================
+//										Analysis
+// =====================================================================================
+
+VertexFetchStats AnalyzeVertexFetch(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	uint32_t vertexCount, uint32_t vertexStride, uint32_t cacheBytes)
+{
+	std::vector<uint32_t> indices;
+	ReadIndexRun(pIndices, indexSize, indexCount, &indices);
+
+	VertexFetchStats stats;
+	stats.vertexCount = vertexCount;
+	stats.vertexStride = vertexStride;
+
+	// Post-transform FIFO (see AnalyzeVertexCache) in front of a direct-mapped cache of lines
+	std::vector<uint64_t> missStamps(vertexCount, 0);
+	uint64_t misses = 0;
+
+	const uint32_t lineCount = cacheBytes / kCacheLineSize > 0 ? cacheBytes / kCacheLineSize : 1;
+	std::vector<uint64_t> lines(lineCount, ~(uint64_t)0);
+
+	for (uint32_t index : indices)
+	{
+		if (missStamps[index] != 0 && misses - missStamps[index] < kPostTransformCacheSize)
+			continue;
+		missStamps[index] = ++misses;
+
+		const uint64_t firstLine = (uint64_t)index * vertexStride / kCacheLineSize;
+		const uint64_t lastLine = ((uint64_t)index * vertexStride + vertexStride - 1) / kCacheLineSize;
+		for (uint64_t line = firstLine; line <= lastLine; line++)
+		{
+			uint64_t& slot = lines[line % lineCount];
+			if (slot != line)
+			{
+				slot = line;
+				stats.bytesFetched += kCacheLineSize;
+			}
+		}
+	}
+	return stats;
+}
+
+VertexFetchStats AnalyzeVertexFetch(const IndexedMesh& mesh, uint32_t cacheBytes)
+{
+	VertexFetchStats stats;
+	for (const MeshPart& part : mesh.parts)
+	{
+		stats.Add(AnalyzeVertexFetch(&mesh.indexData[part.indexByteOffset], part.indexSize, part.indexCount,
+			part.vertexCount, sizeof(MeshVertex), cacheBytes));
+	}
+	return stats;
+}
+
+} // namespace MeshTools
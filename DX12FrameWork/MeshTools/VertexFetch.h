@@ -0,0 +1,57 @@
+#pragma once
+
+// Vertex fetch locality: after the triangles are in their final order (OptimizeVertexCache,
+// OptimizeOverdraw), the vertices are renumbered in the order the index buffer first uses them.
+// Vertices the transform stage reads one after the other then sit next to each other in memory,
+// so a fetched cache line serves several of them instead of one.
+//
+// AnalyzeVertexFetch estimates the memory traffic: every vertex that misses a FIFO post-transform
+// cache is fetched through a direct-mapped cache of 64-byte lines.
+//		overfetch - fetched bytes / vertex buffer bytes (1 is the ideal, every byte read once)
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+namespace MeshTools
+{
+
+struct IndexedMesh;
+
+struct VertexFetchStats
+{
+	uint32_t vertexCount = 0;
+	uint32_t vertexStride = 0;
+	uint64_t bytesFetched = 0;
+
+	double GetOverfetch() const { return vertexCount ? (double)bytesFetched / ((uint64_t)vertexCount * vertexStride) : 0.0; }
+
+	void Add(const VertexFetchStats& other)
+	{
+		vertexCount += other.vertexCount;
+		vertexStride = other.vertexStride;
+		bytesFetched += other.bytesFetched;
+	}
+};
+
+// Fills pRemap[vertexCount] with the new position of every vertex: first-use order of the index run,
+// unreferenced vertices last (in their old order), so the vertex count doesn't change.
+void BuildVertexFetchRemap(const void* pIndices, uint32_t indexSize, uint32_t indexCount, uint32_t vertexCount, uint32_t* pRemap);
+
+// Applies a remap to an index run in place and to a vertex array (pDst and pSrc must not overlap)
+void RemapIndices(void* pIndices, uint32_t indexSize, uint32_t indexCount, const uint32_t* pRemap);
+void RemapVertices(void* pDst, const void* pSrc, uint32_t vertexCount, uint32_t vertexStride, const uint32_t* pRemap);
+
+// Both steps for the vertices of one part, in place
+void OptimizeVertexFetch(void* pVertices, uint32_t vertexCount, uint32_t vertexStride,
+	void* pIndices, uint32_t indexSize, uint32_t indexCount);
+
+VertexFetchStats AnalyzeVertexFetch(const void* pIndices, uint32_t indexSize, uint32_t indexCount,
+	uint32_t vertexCount, uint32_t vertexStride, uint32_t cacheBytes = 16 * 1024);
+
+// All parts of the mesh, parts in parallel if pPool != nullptr
+void OptimizeVertexFetch(IndexedMesh* pMesh, ThreadPool* pPool = nullptr);
+VertexFetchStats AnalyzeVertexFetch(const IndexedMesh& mesh, uint32_t cacheBytes = 16 * 1024);
+
+} // namespace MeshTools
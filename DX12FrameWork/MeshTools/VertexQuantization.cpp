@@ -0,0 +1,616 @@
+#include "VertexQuantization.h"
+#include "IndexedMesh.h"
+
+#include <cfloat>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MESHTOOLS_SIMD_SSE 1
+	#include <emmintrin.h>
+#endif
+
+namespace MeshTools
+{
+
+namespace
+{
+	const uint32_t kSignBit = 0x80000000u;
+	const float kPi = 3.14159265f;
+
+	uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	float BitsFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Operand order as _mm_min_ps/_mm_max_ps: the second one wins on NaN
+	float Min(float a, float b) { return a < b ? a : b; }
+	float Max(float a, float b) { return a > b ? a : b; }
+
+	// Per-attribute offsets in an encoded vertex
+	struct Layout
+	{
+		uint32_t stride, color, normal, uv;
+
+		explicit Layout(const VertexFormat& format)
+			: stride(format.GetStride()),
+			color(format.GetPositionSize()),
+			normal(color + format.GetColorSize()),
+			uv(normal + format.GetNormalSize())
+		{
+		}
+	};
+
+	// ---------------------------------------------------------------------------------
+	// Scalar conversions. The SSE2 code below does the same operations in the same order.
+	// ---------------------------------------------------------------------------------
+
+	uint32_t ToUnorm(float value, float maxValue)
+	{
+		return (uint32_t)lrintf(Min(Max(value, 0.0f), 1.0f) * maxValue);
+	}
+
+	uint32_t ToSnorm16(float value)
+	{
+		return (uint32_t)(uint16_t)(int16_t)lrintf(Min(Max(value, -1.0f), 1.0f) * 32767.0f);
+	}
+
+	float FromSnorm16(uint32_t bits)
+	{
+		return Max((float)(int16_t)(uint16_t)bits / 32767.0f, -1.0f);
+	}
+
+	// Round to nearest even, overflow to infinity, NaN stays NaN (F. Giesen, "float->half variants")
+	uint32_t FloatToHalf(float value)
+	{
+		const uint32_t bits = FloatBits(value);
+		const uint32_t sign = bits & kSignBit;
+		const uint32_t absBits = bits ^ sign;
+
+		uint32_t half;
+		if (absBits >= (127 + 16) << 23)
+			half = absBits > 0x7F800000u ? 0x7E00 : 0x7C00;
+		else if (absBits < (127 - 14) << 23)
+			half = FloatBits(BitsFloat(absBits) + 0.5f) - FloatBits(0.5f);		// denormal: let the FPU round
+		else
+			half = (absBits + 0xFFF - ((127 - 15) << 23) + ((absBits >> 13) & 1)) >> 13;
+		return half | sign >> 16;
+	}
+
+	float HalfToFloat(uint32_t half)
+	{
+		const uint32_t expMant = half & 0x7FFF;
+		const float scaled = BitsFloat(expMant << 13) * BitsFloat((254 - 15) << 23);
+		const uint32_t infNan = expMant > 0x7BFF ? 0x7F800000u : 0;
+		return BitsFloat(FloatBits(scaled) | infNan | (half & 0x8000) << 16);
+	}
+
+	// Octahedral mapping: project on |x| + |y| + |z| = 1, fold the lower half over the diagonals
+	uint32_t EncodeOctahedral(const float* n)
+	{
+		const float sum = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+		const float scale = sum > 0.0f ? 1.0f / sum : 0.0f;
+		float x = n[0] * scale, y = n[1] * scale;
+		if (n[2] < 0.0f)
+		{
+			const float foldedX = BitsFloat(FloatBits(1.0f - fabsf(y)) | (FloatBits(x) & kSignBit));
+			const float foldedY = BitsFloat(FloatBits(1.0f - fabsf(x)) | (FloatBits(y) & kSignBit));
+			x = foldedX;
+			y = foldedY;
+		}
+		return ToSnorm16(x) | ToSnorm16(y) << 16;
+	}
+
+	void DecodeOctahedral(uint32_t bits, float* n)
+	{
+		float x = FromSnorm16(bits & 0xFFFF), y = FromSnorm16(bits >> 16);
+		const float z = 1.0f - fabsf(x) - fabsf(y);
+		const float t = Max(-z, 0.0f);
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+		const float length = sqrtf(x * x + y * y + z * z);
+		n[0] = x / length;
+		n[1] = y / length;
+		n[2] = z / length;
+	}
+
+#ifdef MESHTOOLS_SIMD_SSE
+	// ---------------------------------------------------------------------------------
+	// SSE2, 4 vertices a step. Float3 attributes are transposed to one register per component.
+	// ---------------------------------------------------------------------------------
+
+	// 16 bytes from each vertex - the 4th float is the next member of MeshVertex, never past its end
+	void LoadFloat3(const float* p0, size_t stride, __m128* pX, __m128* pY, __m128* pZ)
+	{
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(p0);
+		__m128 r0 = _mm_loadu_ps(reinterpret_cast<const float*>(p));
+		__m128 r1 = _mm_loadu_ps(reinterpret_cast<const float*>(p + stride));
+		__m128 r2 = _mm_loadu_ps(reinterpret_cast<const float*>(p + stride * 2));
+		__m128 r3 = _mm_loadu_ps(reinterpret_cast<const float*>(p + stride * 3));
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		*pX = r0;
+		*pY = r1;
+		*pZ = r2;
+	}
+
+	// Writes 16 bytes per vertex - the 4th float lands on the next member, which is written later
+	void StoreFloat3(float* p0, size_t stride, __m128 x, __m128 y, __m128 z)
+	{
+		uint8_t* p = reinterpret_cast<uint8_t*>(p0);
+		__m128 w = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(reinterpret_cast<float*>(p), x);
+		_mm_storeu_ps(reinterpret_cast<float*>(p + stride), y);
+		_mm_storeu_ps(reinterpret_cast<float*>(p + stride * 2), z);
+		_mm_storeu_ps(reinterpret_cast<float*>(p + stride * 3), w);
+	}
+
+	void StoreLanes(__m128i value, uint8_t* p, size_t stride)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			const uint32_t lane = (uint32_t)_mm_cvtsi128_si32(value);
+			memcpy(p + stride * i, &lane, sizeof(lane));
+			value = _mm_srli_si128(value, 4);
+		}
+	}
+
+	__m128i LoadLane(const uint8_t* p)
+	{
+		int32_t lane;
+		memcpy(&lane, p, sizeof(lane));
+		return _mm_cvtsi32_si128(lane);
+	}
+
+	// Gathered in registers - through a uint32_t[4] the vector load waits for 4 scalar stores
+	__m128i LoadLanes(const uint8_t* p, size_t stride)
+	{
+		const __m128i lanes01 = _mm_unpacklo_epi32(LoadLane(p), LoadLane(p + stride));
+		const __m128i lanes23 = _mm_unpacklo_epi32(LoadLane(p + stride * 2), LoadLane(p + stride * 3));
+		return _mm_unpacklo_epi64(lanes01, lanes23);
+	}
+
+	__m128 Clamp(__m128 value, __m128 minValue, __m128 maxValue)
+	{
+		return _mm_min_ps(_mm_max_ps(value, minValue), maxValue);
+	}
+
+	__m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	__m128i FloatToHalf4(__m128 value)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)kSignBit));
+		const __m128 sign = _mm_and_ps(value, signMask);
+		const __m128 absValue = _mm_xor_ps(value, sign);
+		const __m128i absBits = _mm_castps_si128(absValue);
+
+		const __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), absBits);
+		const __m128i isNan = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(0x7F800000));
+		const __m128i infOrNan = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNan, _mm_set1_epi32(0x200)));
+
+		const __m128i isDenormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), absBits);
+		const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValue, _mm_set1_ps(0.5f))), _mm_set1_epi32((int)FloatBits(0.5f)));
+
+		const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(absBits, 13), _mm_set1_epi32(1));
+		const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), mantissaOdd), 13);
+
+		const __m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+		const __m128i half = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNan));
+		return _mm_or_si128(half, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+	}
+
+	__m128 HalfToFloat4(__m128i half)
+	{
+		const __m128i expMant = _mm_and_si128(half, _mm_set1_epi32(0x7FFF));
+		const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+		const __m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x7BFF)), _mm_set1_epi32(0x7F800000));
+		const __m128i sign = _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16);
+		return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(infNan, sign)));
+	}
+
+	// Two halves of a lane pair (u, v) -> one 32-bit lane; lanes 0, 1 of the result
+	__m128i PackHalfPairs(__m128i halves)
+	{
+		const __m128i joined = _mm_or_si128(halves, _mm_srli_epi64(halves, 16));
+		return _mm_shuffle_epi32(joined, _MM_SHUFFLE(3, 1, 2, 0));
+	}
+
+	__m128i ToSnorm16x4(__m128 value)
+	{
+		const __m128i snorm = _mm_cvtps_epi32(_mm_mul_ps(Clamp(value, _mm_set1_ps(-1.0f), _mm_set1_ps(1.0f)), _mm_set1_ps(32767.0f)));
+		return _mm_and_si128(snorm, _mm_set1_epi32(0xFFFF));
+	}
+
+	__m128 FromSnorm16x4(__m128i bits)
+	{
+		// Sign extension of the low 16 bits
+		const __m128i value = _mm_srai_epi32(_mm_slli_epi32(bits, 16), 16);
+		return _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(32767.0f)), _mm_set1_ps(-1.0f));
+	}
+
+	__m128 Abs(__m128 value)
+	{
+		return _mm_andnot_ps(_mm_castsi128_ps(_mm_set1_epi32((int)kSignBit)), value);
+	}
+
+	void EncodeBlock(const MeshVertex* pVertices, const VertexFormat& format, const Layout& layout,
+		const __m128* pOffset, const __m128* pInvScale, uint8_t* pOut)
+	{
+		const size_t inStride = sizeof(MeshVertex);
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)kSignBit));
+
+		if (format.position == PositionFormat::Unorm16)
+		{
+			__m128 p[3];
+			LoadFloat3(pVertices->position, inStride, &p[0], &p[1], &p[2]);
+			__m128i q[3];
+			for (int i = 0; i < 3; i++)
+				q[i] = _mm_cvtps_epi32(_mm_mul_ps(Clamp(_mm_mul_ps(_mm_sub_ps(p[i], pOffset[i]), pInvScale[i]), zero, one), _mm_set1_ps(65535.0f)));
+			StoreLanes(_mm_or_si128(q[0], _mm_slli_epi32(q[1], 16)), pOut, layout.stride);
+			StoreLanes(q[2], pOut + 4, layout.stride);
+		}
+
+		if (format.color == ColorFormat::Unorm8)
+		{
+			__m128 c[3];
+			LoadFloat3(pVertices->color, inStride, &c[0], &c[1], &c[2]);
+			__m128i rgba = _mm_set1_epi32((int)0xFF000000u);
+			for (int i = 0; i < 3; i++)
+				rgba = _mm_or_si128(rgba, _mm_slli_epi32(_mm_cvtps_epi32(_mm_mul_ps(Clamp(c[i], zero, one), _mm_set1_ps(255.0f))), 8 * i));
+			StoreLanes(rgba, pOut + layout.color, layout.stride);
+		}
+
+		if (format.normal == NormalFormat::Octahedral16)
+		{
+			__m128 n[3];
+			LoadFloat3(pVertices->normal, inStride, &n[0], &n[1], &n[2]);
+			const __m128 sum = _mm_add_ps(_mm_add_ps(Abs(n[0]), Abs(n[1])), Abs(n[2]));
+			const __m128 scale = _mm_and_ps(_mm_cmpgt_ps(sum, zero), _mm_div_ps(one, sum));
+			const __m128 x = _mm_mul_ps(n[0], scale), y = _mm_mul_ps(n[1], scale);
+			const __m128 foldedX = _mm_or_ps(_mm_sub_ps(one, Abs(y)), _mm_and_ps(x, signMask));
+			const __m128 foldedY = _mm_or_ps(_mm_sub_ps(one, Abs(x)), _mm_and_ps(y, signMask));
+			const __m128 lower = _mm_cmplt_ps(n[2], zero);
+			const __m128i qx = ToSnorm16x4(Select(lower, foldedX, x)), qy = ToSnorm16x4(Select(lower, foldedY, y));
+			StoreLanes(_mm_or_si128(qx, _mm_slli_epi32(qy, 16)), pOut + layout.normal, layout.stride);
+		}
+
+		if (format.uv == UvFormat::Half)
+		{
+			// 8 bytes each - the uv is the last member
+			const __m128 uv01 = _mm_loadh_pi(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(pVertices[0].uv)), reinterpret_cast<const __m64*>(pVertices[1].uv));
+			const __m128 uv23 = _mm_loadh_pi(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(pVertices[2].uv)), reinterpret_cast<const __m64*>(pVertices[3].uv));
+			const __m128i packed = _mm_unpacklo_epi64(PackHalfPairs(FloatToHalf4(uv01)), PackHalfPairs(FloatToHalf4(uv23)));
+			StoreLanes(packed, pOut + layout.uv, layout.stride);
+		}
+
+		// Float32 attributes are copied as they are
+		for (int v = 0; v < 4; v++)
+		{
+			const MeshVertex& vertex = pVertices[v];
+			uint8_t* p = pOut + layout.stride * v;
+			if (format.position == PositionFormat::Float32)
+				memcpy(p, vertex.position, sizeof(vertex.position));
+			if (format.color == ColorFormat::Float32)
+				memcpy(p + layout.color, vertex.color, sizeof(vertex.color));
+			if (format.normal == NormalFormat::Float32)
+				memcpy(p + layout.normal, vertex.normal, sizeof(vertex.normal));
+			if (format.uv == UvFormat::Float32)
+				memcpy(p + layout.uv, vertex.uv, sizeof(vertex.uv));
+		}
+	}
+
+	// Members in MeshVertex order - StoreFloat3 spills into the next one
+	void DecodeBlock(const uint8_t* pData, const VertexFormat& format, const Layout& layout,
+		const __m128* pOffset, const __m128* pScale, MeshVertex* pOut)
+	{
+		const size_t outStride = sizeof(MeshVertex);
+		const __m128 zero = _mm_setzero_ps();
+
+		if (format.position == PositionFormat::Unorm16)
+		{
+			const __m128i xy = LoadLanes(pData, layout.stride), zw = LoadLanes(pData + 4, layout.stride);
+			const __m128i q[3] = { _mm_and_si128(xy, _mm_set1_epi32(0xFFFF)), _mm_srli_epi32(xy, 16), _mm_and_si128(zw, _mm_set1_epi32(0xFFFF)) };
+			__m128 p[3];
+			for (int i = 0; i < 3; i++)
+				p[i] = _mm_add_ps(pOffset[i], _mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(q[i]), _mm_set1_ps(65535.0f)), pScale[i]));
+			StoreFloat3(pOut->position, outStride, p[0], p[1], p[2]);
+		}
+		else
+		{
+			for (int v = 0; v < 4; v++)
+				memcpy(pOut[v].position, pData + layout.stride * v, sizeof(pOut[v].position));
+		}
+
+		if (format.color == ColorFormat::Unorm8)
+		{
+			const __m128i rgba = LoadLanes(pData + layout.color, layout.stride);
+			__m128 c[3];
+			for (int i = 0; i < 3; i++)
+				c[i] = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgba, 8 * i), _mm_set1_epi32(0xFF))), _mm_set1_ps(255.0f));
+			StoreFloat3(pOut->color, outStride, c[0], c[1], c[2]);
+		}
+		else
+		{
+			for (int v = 0; v < 4; v++)
+				memcpy(pOut[v].color, pData + layout.stride * v + layout.color, sizeof(pOut[v].color));
+		}
+
+		if (format.normal == NormalFormat::Octahedral16)
+		{
+			const __m128i bits = LoadLanes(pData + layout.normal, layout.stride);
+			__m128 x = FromSnorm16x4(bits), y = FromSnorm16x4(_mm_srli_epi32(bits, 16));
+			const __m128 z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Abs(x)), Abs(y));
+			const __m128 t = _mm_max_ps(_mm_sub_ps(zero, z), zero);
+			const __m128 negT = _mm_xor_ps(t, _mm_castsi128_ps(_mm_set1_epi32((int)kSignBit)));
+			x = _mm_add_ps(x, Select(_mm_cmpge_ps(x, zero), negT, t));
+			y = _mm_add_ps(y, Select(_mm_cmpge_ps(y, zero), negT, t));
+			const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			StoreFloat3(pOut->normal, outStride, _mm_div_ps(x, length), _mm_div_ps(y, length), _mm_div_ps(z, length));
+		}
+		else
+		{
+			for (int v = 0; v < 4; v++)
+				memcpy(pOut[v].normal, pData + layout.stride * v + layout.normal, sizeof(pOut[v].normal));
+		}
+
+		if (format.uv == UvFormat::Half)
+		{
+			const __m128i halves = LoadLanes(pData + layout.uv, layout.stride);
+			const __m128 u = HalfToFloat4(_mm_and_si128(halves, _mm_set1_epi32(0xFFFF))), v = HalfToFloat4(_mm_srli_epi32(halves, 16));
+			const __m128 uv01 = _mm_unpacklo_ps(u, v), uv23 = _mm_unpackhi_ps(u, v);
+			_mm_storel_pi(reinterpret_cast<__m64*>(pOut[0].uv), uv01);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(pOut[1].uv), uv01);
+			_mm_storel_pi(reinterpret_cast<__m64*>(pOut[2].uv), uv23);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(pOut[3].uv), uv23);
+		}
+		else
+		{
+			for (int v = 0; v < 4; v++)
+				memcpy(pOut[v].uv, pData + layout.stride * v + layout.uv, sizeof(pOut[v].uv));
+		}
+	}
+#endif
+}
+
+// =====================================================================================
+//										Encode / Decode
+// =====================================================================================
+
+QuantizationBounds ComputeQuantizationBounds(const MeshVertex* pVertices, uint32_t vertexCount)
+{
+	QuantizationBounds bounds;
+	if (vertexCount == 0)
+		return bounds;
+
+	float boxMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boxMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			boxMin[i] = Min(boxMin[i], pVertices[v].position[i]);
+			boxMax[i] = Max(boxMax[i], pVertices[v].position[i]);
+		}
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		bounds.offset[i] = boxMin[i];
+		bounds.scale[i] = boxMax[i] > boxMin[i] ? boxMax[i] - boxMin[i] : 1.0f;
+	}
+	return bounds;
+}
+
+void EncodeVerticesScalar(const MeshVertex* pVertices, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, void* pOut)
+{
+	const Layout layout(format);
+	const float invScale[3] = { 1.0f / bounds.scale[0], 1.0f / bounds.scale[1], 1.0f / bounds.scale[2] };
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		const MeshVertex& vertex = pVertices[v];
+		uint8_t* p = static_cast<uint8_t*>(pOut) + (size_t)layout.stride * v;
+
+		if (format.position == PositionFormat::Float32)
+		{
+			memcpy(p, vertex.position, sizeof(vertex.position));
+		}
+		else
+		{
+			uint32_t q[3];
+			for (int i = 0; i < 3; i++)
+				q[i] = ToUnorm((vertex.position[i] - bounds.offset[i]) * invScale[i], 65535.0f);
+			const uint32_t packed[2] = { q[0] | q[1] << 16, q[2] };
+			memcpy(p, packed, sizeof(packed));
+		}
+
+		if (format.color == ColorFormat::Float32)
+		{
+			memcpy(p + layout.color, vertex.color, sizeof(vertex.color));
+		}
+		else
+		{
+			const uint32_t rgba = ToUnorm(vertex.color[0], 255.0f) | ToUnorm(vertex.color[1], 255.0f) << 8 |
+				ToUnorm(vertex.color[2], 255.0f) << 16 | 0xFF000000u;
+			memcpy(p + layout.color, &rgba, sizeof(rgba));
+		}
+
+		if (format.normal == NormalFormat::Float32)
+		{
+			memcpy(p + layout.normal, vertex.normal, sizeof(vertex.normal));
+		}
+		else
+		{
+			const uint32_t octahedral = EncodeOctahedral(vertex.normal);
+			memcpy(p + layout.normal, &octahedral, sizeof(octahedral));
+		}
+
+		if (format.uv == UvFormat::Float32)
+		{
+			memcpy(p + layout.uv, vertex.uv, sizeof(vertex.uv));
+		}
+		else
+		{
+			const uint32_t halves = FloatToHalf(vertex.uv[0]) | FloatToHalf(vertex.uv[1]) << 16;
+			memcpy(p + layout.uv, &halves, sizeof(halves));
+		}
+	}
+}
+
+void DecodeVerticesScalar(const void* pData, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, MeshVertex* pOut)
+{
+	const Layout layout(format);
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(pData) + (size_t)layout.stride * v;
+		MeshVertex& vertex = pOut[v];
+
+		if (format.position == PositionFormat::Float32)
+		{
+			memcpy(vertex.position, p, sizeof(vertex.position));
+		}
+		else
+		{
+			uint32_t packed[2];
+			memcpy(packed, p, sizeof(packed));
+			const uint32_t q[3] = { packed[0] & 0xFFFF, packed[0] >> 16, packed[1] & 0xFFFF };
+			for (int i = 0; i < 3; i++)
+				vertex.position[i] = bounds.offset[i] + (float)q[i] / 65535.0f * bounds.scale[i];
+		}
+
+		if (format.color == ColorFormat::Float32)
+		{
+			memcpy(vertex.color, p + layout.color, sizeof(vertex.color));
+		}
+		else
+		{
+			uint32_t rgba;
+			memcpy(&rgba, p + layout.color, sizeof(rgba));
+			for (int i = 0; i < 3; i++)
+				vertex.color[i] = (float)((rgba >> (8 * i)) & 0xFF) / 255.0f;
+		}
+
+		if (format.normal == NormalFormat::Float32)
+		{
+			memcpy(vertex.normal, p + layout.normal, sizeof(vertex.normal));
+		}
+		else
+		{
+			uint32_t octahedral;
+			memcpy(&octahedral, p + layout.normal, sizeof(octahedral));
+			DecodeOctahedral(octahedral, vertex.normal);
+		}
+
+		if (format.uv == UvFormat::Float32)
+		{
+			memcpy(vertex.uv, p + layout.uv, sizeof(vertex.uv));
+		}
+		else
+		{
+			uint32_t halves;
+			memcpy(&halves, p + layout.uv, sizeof(halves));
+			vertex.uv[0] = HalfToFloat(halves & 0xFFFF);
+			vertex.uv[1] = HalfToFloat(halves >> 16);
+		}
+	}
+}
+
+void EncodeVertices(const MeshVertex* pVertices, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, void* pOut)
+{
+	// All Float32 is the MeshVertex layout
+	if (format == VertexFormat())
+	{
+		memcpy(pOut, pVertices, (size_t)vertexCount * sizeof(MeshVertex));
+		return;
+	}
+
+	uint32_t v = 0;
+#ifdef MESHTOOLS_SIMD_SSE
+	const Layout layout(format);
+	__m128 offset[3], invScale[3];
+	for (int i = 0; i < 3; i++)
+	{
+		offset[i] = _mm_set1_ps(bounds.offset[i]);
+		invScale[i] = _mm_set1_ps(1.0f / bounds.scale[i]);
+	}
+	for (; v + 4 <= vertexCount; v += 4)
+		EncodeBlock(pVertices + v, format, layout, offset, invScale, static_cast<uint8_t*>(pOut) + (size_t)layout.stride * v);
+#endif
+	EncodeVerticesScalar(pVertices + v, vertexCount - v, format, bounds, static_cast<uint8_t*>(pOut) + (size_t)format.GetStride() * v);
+}
+
+void DecodeVertices(const void* pData, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, MeshVertex* pOut)
+{
+	if (format == VertexFormat())
+	{
+		memcpy(pOut, pData, (size_t)vertexCount * sizeof(MeshVertex));
+		return;
+	}
+
+	uint32_t v = 0;
+#ifdef MESHTOOLS_SIMD_SSE
+	const Layout layout(format);
+	__m128 offset[3], scale[3];
+	for (int i = 0; i < 3; i++)
+	{
+		offset[i] = _mm_set1_ps(bounds.offset[i]);
+		scale[i] = _mm_set1_ps(bounds.scale[i]);
+	}
+	for (; v + 4 <= vertexCount; v += 4)
+		DecodeBlock(static_cast<const uint8_t*>(pData) + (size_t)layout.stride * v, format, layout, offset, scale, pOut + v);
+#endif
+	DecodeVerticesScalar(static_cast<const uint8_t*>(pData) + (size_t)format.GetStride() * v, vertexCount - v, format, bounds, pOut + v);
+}
+
+// =====================================================================================
+//										Error metrics
+// =====================================================================================
+
+QuantizationError MeasureQuantizationError(const MeshVertex* pOriginal, const MeshVertex* pDecoded, uint32_t vertexCount)
+{
+	QuantizationError error;
+	error.vertexCount = vertexCount;
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		const MeshVertex& a = pOriginal[v];
+		const MeshVertex& b = pDecoded[v];
+
+		float squared = 0.0f;
+		for (int i = 0; i < 3; i++)
+			squared += (a.position[i] - b.position[i]) * (a.position[i] - b.position[i]);
+		error.maxPosition = Max(error.maxPosition, sqrtf(squared));
+		error.sumSquaredPosition += squared;
+
+		const float lengthA = sqrtf(a.normal[0] * a.normal[0] + a.normal[1] * a.normal[1] + a.normal[2] * a.normal[2]);
+		const float lengthB = sqrtf(b.normal[0] * b.normal[0] + b.normal[1] * b.normal[1] + b.normal[2] * b.normal[2]);
+		if (lengthA > 0.0f && lengthB > 0.0f)
+		{
+			const float cosine = (a.normal[0] * b.normal[0] + a.normal[1] * b.normal[1] + a.normal[2] * b.normal[2]) / (lengthA * lengthB);
+			error.maxNormalDegrees = Max(error.maxNormalDegrees, acosf(Min(Max(cosine, -1.0f), 1.0f)) * 180.0f / kPi);
+		}
+
+		for (int i = 0; i < 2; i++)
+			error.maxUv = Max(error.maxUv, fabsf(a.uv[i] - b.uv[i]));
+		for (int i = 0; i < 3; i++)
+			error.maxColor = Max(error.maxColor, fabsf(a.color[i] - b.color[i]));
+	}
+	return error;
+}
+
+} // namespace MeshTools
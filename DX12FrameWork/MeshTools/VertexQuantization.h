@@ -0,0 +1,124 @@
+#pragma once
+
+// Packed vertex formats for MeshVertex (VertexPosColor of 2_Mesh, 44 bytes of floats). Every
+// attribute picks its own encoding:
+//		position	Float32 - R32G32B32_FLOAT (12 bytes)	Unorm16      - R16G16B16A16_UNORM (8), relative to bounds
+//		color		Float32 - R32G32B32_FLOAT (12)			Unorm8       - R8G8B8A8_UNORM (4), alpha 1
+//		normal		Float32 - R32G32B32_FLOAT (12)			Octahedral16 - R16G16_SNORM (4), octahedral mapping
+//		uv			Float32 - R32G32_FLOAT (8)				Half         - R16G16_FLOAT (4)
+// All packed: 20 bytes a vertex, 45% of the floats. Attributes stay in MeshVertex order and every
+// one is a multiple of 4 bytes, so D3D12_APPEND_ALIGNED_ELEMENT gives the offsets of GetStride().
+//
+// The input assembler expands the packed formats to floats, two need help in the vertex shader:
+//		Unorm16 positions arrive in [0, 1]: position = bounds.offset + value * bounds.scale, a
+//		scale + translation that goes in front of the world matrix (QuantizationBounds)
+//		Octahedral16 normals arrive as (x, y, 0):
+//			n = (x, y, 1 - |x| - |y|); t = max(-n.z, 0); n.xy += n.xy >= 0 ? -t : t; normalize(n)
+//
+// Encode/DecodeVertices take 4 vertices a step with SSE2 (any x64 build) and run the plain C++
+// versions on the rest and on other targets. Both give the same bits.
+
+#include <cmath>
+#include <cstdint>
+
+namespace MeshTools
+{
+
+struct MeshVertex;
+
+enum class PositionFormat : uint8_t { Float32, Unorm16 };
+enum class ColorFormat : uint8_t { Float32, Unorm8 };
+enum class NormalFormat : uint8_t { Float32, Octahedral16 };
+enum class UvFormat : uint8_t { Float32, Half };
+
+struct VertexFormat
+{
+	PositionFormat position = PositionFormat::Float32;
+	ColorFormat color = ColorFormat::Float32;
+	NormalFormat normal = NormalFormat::Float32;
+	UvFormat uv = UvFormat::Float32;
+
+	static VertexFormat Packed()
+	{
+		VertexFormat format;
+		format.position = PositionFormat::Unorm16;
+		format.color = ColorFormat::Unorm8;
+		format.normal = NormalFormat::Octahedral16;
+		format.uv = UvFormat::Half;
+		return format;
+	}
+
+	uint32_t GetPositionSize() const { return position == PositionFormat::Float32 ? 12 : 8; }
+	uint32_t GetColorSize() const { return color == ColorFormat::Float32 ? 12 : 4; }
+	uint32_t GetNormalSize() const { return normal == NormalFormat::Float32 ? 12 : 4; }
+	uint32_t GetUvSize() const { return uv == UvFormat::Float32 ? 8 : 4; }
+	uint32_t GetStride() const { return GetPositionSize() + GetColorSize() + GetNormalSize() + GetUvSize(); }
+
+	// One byte per attribute, 0 = all Float32 (stored in the cooked mesh header)
+	uint32_t ToBits() const { return (uint32_t)position | (uint32_t)color << 8 | (uint32_t)normal << 16 | (uint32_t)uv << 24; }
+	static VertexFormat FromBits(uint32_t bits)
+	{
+		VertexFormat format;
+		format.position = (PositionFormat)(bits & 0xFF);
+		format.color = (ColorFormat)(bits >> 8 & 0xFF);
+		format.normal = (NormalFormat)(bits >> 16 & 0xFF);
+		format.uv = (UvFormat)(bits >> 24);
+		return format;
+	}
+	bool operator==(const VertexFormat& other) const { return ToBits() == other.ToBits(); }
+	bool operator!=(const VertexFormat& other) const { return ToBits() != other.ToBits(); }
+};
+
+// Unorm16 positions: position = offset + value * scale, value in [0, 1]. The identity for Float32.
+struct QuantizationBounds
+{
+	float offset[3] = { 0.0f, 0.0f, 0.0f };
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+// Bounding box of the positions (a flat axis gets scale 1)
+QuantizationBounds ComputeQuantizationBounds(const MeshVertex* pVertices, uint32_t vertexCount);
+
+// pOut: vertexCount * format.GetStride() bytes
+void EncodeVertices(const MeshVertex* pVertices, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, void* pOut);
+void DecodeVertices(const void* pData, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, MeshVertex* pOut);
+
+// Plain C++ versions, for reference
+void EncodeVerticesScalar(const MeshVertex* pVertices, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, void* pOut);
+void DecodeVerticesScalar(const void* pData, uint32_t vertexCount, const VertexFormat& format,
+	const QuantizationBounds& bounds, MeshVertex* pOut);
+
+// =====================================================================================
+//										Error metrics
+// =====================================================================================
+
+// Differences between the original and the decoded vertices
+struct QuantizationError
+{
+	uint32_t vertexCount = 0;
+	float maxPosition = 0.0f;			// distance, mesh units
+	double sumSquaredPosition = 0.0;
+	float maxNormalDegrees = 0.0f;		// angle between the unit normals
+	float maxUv = 0.0f;					// per component
+	float maxColor = 0.0f;				// per component
+
+	double GetRmsPosition() const { return vertexCount ? std::sqrt(sumSquaredPosition / vertexCount) : 0.0; }
+
+	// Ternaries, not std::max - included after Windows.h in 2_Mesh
+	void Add(const QuantizationError& other)
+	{
+		vertexCount += other.vertexCount;
+		maxPosition = other.maxPosition > maxPosition ? other.maxPosition : maxPosition;
+		sumSquaredPosition += other.sumSquaredPosition;
+		maxNormalDegrees = other.maxNormalDegrees > maxNormalDegrees ? other.maxNormalDegrees : maxNormalDegrees;
+		maxUv = other.maxUv > maxUv ? other.maxUv : maxUv;
+		maxColor = other.maxColor > maxColor ? other.maxColor : maxColor;
+	}
+};
+
+QuantizationError MeasureQuantizationError(const MeshVertex* pOriginal, const MeshVertex* pDecoded, uint32_t vertexCount);
+
+} // namespace MeshTools
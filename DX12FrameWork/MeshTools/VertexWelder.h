@@ -0,0 +1,121 @@
+#pragma once
+
+// Portable (no Windows/D3D12/FBX headers) mesh processing used by the mesh loaders.
+//
+// VertexWelder turns a stream of per-corner vertices into unique vertices + indices.
+// Vertices are compared bit-exactly over ALL their bytes (position, normal, UV, ...),
+// so corners that only share a position (hard edges, UV seams) stay separate.
+// Lookups go through a flat open-addressing table (linear probing, load factor <= 1/2)
+// storing the hash next to the vertex index - a probe rarely touches the vertex itself.
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace MeshTools
+{
+
+template<typename Vertex>
+class VertexWelder
+{
+	static_assert(std::is_trivially_copyable<Vertex>::value, "Vertices are hashed and compared as raw bytes");
+
+public:
+	// Forgets all vertices. expectedCornerCount (e.g. 3 * polygon count) sizes the
+	// table so that no rehash happens while the mesh is welded.
+	void Reset(size_t expectedCornerCount = 0)
+	{
+		m_Vertices.clear();
+		m_Vertices.reserve(expectedCornerCount);
+
+		size_t tableSize = 16;
+		while (tableSize < expectedCornerCount * 2)
+			tableSize *= 2;
+		m_Table.assign(tableSize, Slot());
+	}
+
+	// Returns the index of v among the unique vertices, appending it if it's new.
+	// Padding bytes take part in the comparison - zero-initialize vertices with padding.
+	uint32_t Insert(const Vertex& v)
+	{
+		if (m_Table.empty() || (m_Vertices.size() + 1) * 2 > m_Table.size())
+			Grow();
+
+		const uint32_t hash = Hash(v);
+		const size_t mask = m_Table.size() - 1;
+		for (size_t i = hash & mask;; i = (i + 1) & mask)
+		{
+			Slot& slot = m_Table[i];
+			if (slot.index == kEmpty)
+			{
+				slot.hash = hash;
+				slot.index = (uint32_t)m_Vertices.size();
+				m_Vertices.push_back(v);
+				return slot.index;
+			}
+			if (slot.hash == hash && memcmp(&m_Vertices[slot.index], &v, sizeof(Vertex)) == 0)
+				return slot.index;
+		}
+	}
+
+	size_t GetVertexCount() const { return m_Vertices.size(); }
+	const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
+	std::vector<Vertex>& GetVertices() { return m_Vertices; }
+
+private:
+	static const uint32_t kEmpty = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		uint32_t hash = 0;
+		uint32_t index = kEmpty;
+	};
+
+	// Murmur3-style mixing of the 32-bit words of the vertex
+	static uint32_t Hash(const Vertex& v)
+	{
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+		uint32_t h = 0x9747B28C;
+		size_t offset = 0;
+		for (; offset + 4 <= sizeof(Vertex); offset += 4)
+		{
+			uint32_t k;
+			memcpy(&k, bytes + offset, 4);
+			k *= 0xCC9E2D51; k = (k << 15) | (k >> 17); k *= 0x1B873593;
+			h ^= k; h = (h << 13) | (h >> 19); h = h * 5 + 0xE6546B64;
+		}
+		for (; offset < sizeof(Vertex); offset++)
+			h = (h ^ bytes[offset]) * 0x01000193;
+
+		h ^= h >> 16; h *= 0x85EBCA6B;
+		h ^= h >> 13; h *= 0xC2B2AE35;
+		h ^= h >> 16;
+		return h;
+	}
+
+	void Grow()
+	{
+		std::vector<Slot> oldTable;
+		oldTable.swap(m_Table);
+		m_Table.assign(oldTable.empty() ? 16 : oldTable.size() * 2, Slot());
+
+		const size_t mask = m_Table.size() - 1;
+		for (const Slot& slot : oldTable)
+		{
+			if (slot.index == kEmpty)
+				continue;
+			size_t i = slot.hash & mask;
+			while (m_Table[i].index != kEmpty)
+				i = (i + 1) & mask;
+			m_Table[i] = slot;
+		}
+	}
+
+private:
+	std::vector<Vertex> m_Vertices;
+	std::vector<Slot> m_Table;
+};
+
+} // namespace MeshTools
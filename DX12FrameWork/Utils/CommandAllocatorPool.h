@@ -0,0 +1,109 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) pool of command allocators for recording on several threads.
+//
+// Every recording thread owns a slot: a FIFO of the allocators it used, each tagged with the fence
+// value of the submit that executed it. A thread only takes allocators from its own slot, so
+// recording threads never wait for each other; a slot's lock is shared with the submitting thread
+// only (Retire()). An allocator can be reset once the queue's fence passed its tag. Tags are
+// retired in fence order, so only the front of a FIFO has to be checked.
+//
+// Allocator is a cheap to copy handle (ComPtr<ID3D12CommandAllocator>, a pointer). Creating new
+// allocators is left to the caller - Acquire() fails when none of the slot's allocators is free.
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+template <typename Allocator>
+class CommandAllocatorPool
+{
+public:
+	struct Stats
+	{
+		uint64_t acquired = 0;		// Acquire() calls
+		uint64_t reused = 0;		// ... that returned an allocator, the caller created the rest
+		uint64_t retired = 0;
+		uint64_t allocatorCount = 0;	// idle and in flight
+	};
+
+	explicit CommandAllocatorPool(uint32_t threadCount)
+		: m_Slots(new Slot[threadCount])
+		, m_ThreadCount(threadCount)
+	{
+	}
+	CommandAllocatorPool(const CommandAllocatorPool&) = delete;
+	CommandAllocatorPool& operator=(const CommandAllocatorPool&) = delete;
+
+	// The oldest allocator of the thread's slot if completedFenceValue passed its tag.
+	// False: the caller creates a new allocator and Retire()s it to the slot after use.
+	bool Acquire(uint32_t threadIndex, uint64_t completedFenceValue, Allocator* pAllocator)
+	{
+		assert(threadIndex < m_ThreadCount);
+		Slot& slot = m_Slots[threadIndex];
+		std::lock_guard<std::mutex> lock(slot.mutex);
+
+		slot.stats.acquired++;
+		if (slot.entries.empty() || slot.entries.front().fenceValue > completedFenceValue)
+		{
+			slot.stats.allocatorCount++;
+			return false;
+		}
+
+		*pAllocator = std::move(slot.entries.front().allocator);
+		slot.entries.pop_front();
+		slot.stats.reused++;
+		return true;
+	}
+
+	// Returns an allocator to the slot it was acquired for, fenceValue signals the end of its
+	// commands. Fence values of a slot must not decrease - retire while holding the submit lock.
+	void Retire(uint32_t threadIndex, uint64_t fenceValue, Allocator allocator)
+	{
+		assert(threadIndex < m_ThreadCount);
+		Slot& slot = m_Slots[threadIndex];
+		std::lock_guard<std::mutex> lock(slot.mutex);
+
+		assert(slot.entries.empty() || slot.entries.back().fenceValue <= fenceValue);
+		slot.entries.push_back(Entry{ fenceValue, std::move(allocator) });
+		slot.stats.retired++;
+	}
+
+	uint32_t GetThreadCount() const { return m_ThreadCount; }
+
+	// Sum over the slots
+	Stats GetStats() const
+	{
+		Stats total;
+		for (uint32_t i = 0; i < m_ThreadCount; i++)
+		{
+			std::lock_guard<std::mutex> lock(m_Slots[i].mutex);
+			total.acquired += m_Slots[i].stats.acquired;
+			total.reused += m_Slots[i].stats.reused;
+			total.retired += m_Slots[i].stats.retired;
+			total.allocatorCount += m_Slots[i].stats.allocatorCount;
+		}
+		return total;
+	}
+
+private:
+	struct Entry
+	{
+		uint64_t fenceValue;
+		Allocator allocator;
+	};
+
+	struct Slot
+	{
+		mutable std::mutex mutex;
+		std::deque<Entry> entries;
+		Stats stats;
+		// Keeps the locks of neighbouring slots off one cache line
+		char padding[64];
+	};
+
+	std::unique_ptr<Slot[]> m_Slots;
+	uint32_t m_ThreadCount;
+};
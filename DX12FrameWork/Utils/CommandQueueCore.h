@@ -0,0 +1,276 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) logic of CommandQueue: command lists with allocators from a
+// CommandAllocatorPool slot per recording thread, batches of closed lists, and submits, signals and
+// GPU waits in one order. The graphics API calls go through Api, so the same code runs over D3D12
+// (CommandQueue) and over the mock objects of 5_Framework_Headless.
+//
+// Api is a cheap to copy handle to the native objects:
+//		typedef ... Allocator;		handle of a command allocator (ComPtr, pointer)
+//		typedef ... CommandList;	handle of a command list
+//		Allocator CreateAllocator();
+//		void ResetAllocator(const Allocator& allocator);
+//		CommandList CreateCommandList(const Allocator& allocator);	// in the recording state
+//		void ResetCommandList(const CommandList& commandList, const Allocator& allocator);
+//		void CloseCommandList(const CommandList& commandList);
+//		// The allocator and the pool slot travel with the list (D3D12: its private data)
+//		void SetListAllocator(const CommandList& commandList, const Allocator& allocator, uint32_t slot);
+//		void GetListAllocator(const CommandList& commandList, Allocator* pAllocator, uint32_t* pSlot);
+//		void ExecuteCommandLists(const CommandList* pCommandLists, uint32_t count);
+//		void Signal(uint64_t fenceValue);
+//		void Wait(const Api& other, uint64_t fenceValue);	// GPU-side, on the fence of other
+//		uint64_t GetCompletedFenceValue() const;
+//		void WaitForFenceValue(uint64_t fenceValue);		// blocks the calling thread
+// The creates and resets are called from any recording thread, the rest under the submit lock
+// (GetCompletedFenceValue and WaitForFenceValue from any thread).
+
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "CommandAllocatorPool.h"
+#include "ThreadPool.h"
+
+template <typename Api>
+class CommandQueueCore
+{
+public:
+	typedef typename Api::Allocator Allocator;
+	typedef typename Api::CommandList CommandList;
+
+	struct SubmitStats
+	{
+		uint64_t submits = 0;		// Api::ExecuteCommandLists calls
+		uint64_t commandLists = 0;
+		uint64_t signals = 0;
+		uint64_t gpuWaits = 0;		// Api::Wait calls
+	};
+
+	// threadSlots: slots of the allocator pool, threadIndex < threadSlots
+	CommandQueueCore(const Api& api, uint32_t threadSlots)
+		: m_Api(api)
+		, m_AllocatorPool(threadSlots)
+	{
+	}
+	CommandQueueCore(const CommandQueueCore&) = delete;
+	CommandQueueCore& operator=(const CommandQueueCore&) = delete;
+
+	uint64_t Signal()
+	{
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		return SubmitLocked(true);
+	}
+
+	bool IsFenceComplete(uint64_t fenceValue) const { return m_Api.GetCompletedFenceValue() >= fenceValue; }
+	uint64_t GetCompletedFenceValue() const { return m_Api.GetCompletedFenceValue(); }
+
+	void WaitForFenceValue(uint64_t fenceValue)
+	{
+		// A value AddToBatch() returned may not be signaled yet
+		{
+			std::lock_guard<std::mutex> lock(m_SubmitMutex);
+			if (fenceValue > m_FenceValue)
+				SubmitLocked(true);
+		}
+
+		if (!IsFenceComplete(fenceValue))
+			m_Api.WaitForFenceValue(fenceValue);
+	}
+
+	void Flush() { WaitForFenceValue(Signal()); }
+
+	// GPU-side wait: work submitted to this queue afterwards starts once the fence of other reaches fenceValue
+	void Wait(const CommandQueueCore& other, uint64_t fenceValue)
+	{
+		// The batched lists were added before - they must not wait
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		SubmitLocked(false);
+		m_Api.Wait(other.m_Api, fenceValue);
+		m_SubmitStats.gpuWaits++;
+	}
+
+	// A list in the recording state, its allocator from the slot of threadIndex. Threads recording at
+	// the same time should pass different indices (any index is safe, a shared one only costs lock
+	// contention).
+	CommandList GetCommandList(uint32_t threadIndex = 0)
+	{
+		// The allocator can be reused once it is not "in-flight" on the queue any more
+		Allocator allocator;
+		if (m_AllocatorPool.Acquire(threadIndex, m_Api.GetCompletedFenceValue(), &allocator))
+			m_Api.ResetAllocator(allocator);
+		else
+			allocator = m_Api.CreateAllocator();
+
+		// Lists can be reset right after their submit - no fence for them
+		CommandList commandList = CommandList();
+		bool reused = false;
+		{
+			std::lock_guard<std::mutex> lock(m_CommandListMutex);
+			if (!m_CommandLists.empty())
+			{
+				commandList = m_CommandLists.front();
+				m_CommandLists.pop();
+				reused = true;
+			}
+		}
+		if (reused)
+			m_Api.ResetCommandList(commandList, allocator);
+		else
+			commandList = m_Api.CreateCommandList(allocator);
+
+		// There is no way to ask a list for its allocator - it goes back to the pool on submit
+		m_Api.SetListAllocator(commandList, allocator, threadIndex);
+		return commandList;
+	}
+
+	uint64_t ExecuteCommandList(const CommandList& commandList) { return ExecuteCommandLists(&commandList, 1); }
+
+	// Closes the lists and submits them in order (after the open batch) with one ExecuteCommandLists and one Signal
+	uint64_t ExecuteCommandLists(const CommandList* pCommandLists, uint32_t count)
+	{
+		std::vector<BatchEntry> entries;
+		entries.reserve(count);
+		for (uint32_t i = 0; i < count; i++)
+			entries.push_back(CloseCommandList(pCommandLists[i]));
+
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		for (BatchEntry& entry : entries)
+			m_Batch.push_back(std::move(entry));
+		return SubmitLocked(true);
+	}
+
+	// Records listCount lists on the threads of pool (record(list, listIndex) per list, in any order
+	// and concurrently) and submits them in listIndex order. Returns the fence value of the submit.
+	template <typename RecordFunction>
+	uint64_t ExecuteParallel(ThreadPool& pool, uint32_t listCount, const RecordFunction& record)
+	{
+		assert(pool.GetThreadCount() <= m_AllocatorPool.GetThreadCount());
+
+		// Worker w takes its allocators from slot w; the lists keep their listIndex place
+		std::vector<CommandList> commandLists(listCount);
+		ParallelForWorkStealing(pool, listCount, [&](uint32_t listIndex, uint32_t workerIndex)
+		{
+			commandLists[listIndex] = GetCommandList(workerIndex);
+			record(commandLists[listIndex], listIndex);
+		});
+
+		return ExecuteCommandLists(commandLists.data(), listCount);
+	}
+
+	// Closes the list and adds it to the open batch. Returns the fence value that signals its
+	// completion - the one of the batch's submit, which also a Signal() or another submit does.
+	uint64_t AddToBatch(const CommandList& commandList)
+	{
+		BatchEntry entry = CloseCommandList(commandList);
+
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		m_Batch.push_back(std::move(entry));
+		return m_FenceValue + 1;
+	}
+
+	// Executes the batched lists with one ExecuteCommandLists and one Signal and returns the fence
+	// value. An empty batch signals nothing and returns the last signaled value.
+	uint64_t SubmitBatch()
+	{
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		return m_Batch.empty() ? m_FenceValue : SubmitLocked(true);
+	}
+
+	// Counters since the queue was created
+	SubmitStats GetSubmitStats()
+	{
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		return m_SubmitStats;
+	}
+
+	// Counters since the previous call (once per frame)
+	SubmitStats GetFrameSubmitStats()
+	{
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
+		SubmitStats frame;
+		frame.submits = m_SubmitStats.submits - m_FrameStartStats.submits;
+		frame.commandLists = m_SubmitStats.commandLists - m_FrameStartStats.commandLists;
+		frame.signals = m_SubmitStats.signals - m_FrameStartStats.signals;
+		frame.gpuWaits = m_SubmitStats.gpuWaits - m_FrameStartStats.gpuWaits;
+		m_FrameStartStats = m_SubmitStats;
+		return frame;
+	}
+
+	typename CommandAllocatorPool<Allocator>::Stats GetAllocatorStats() const { return m_AllocatorPool.GetStats(); }
+
+	Api& GetApi() { return m_Api; }
+	const Api& GetApi() const { return m_Api; }
+
+private:
+	// A closed list with the allocator and pool slot it recorded with
+	struct BatchEntry
+	{
+		CommandList commandList;
+		Allocator commandAllocator;
+		uint32_t slot;
+	};
+
+	BatchEntry CloseCommandList(const CommandList& commandList)
+	{
+		m_Api.CloseCommandList(commandList);
+
+		BatchEntry entry;
+		entry.commandList = commandList;
+		m_Api.GetListAllocator(commandList, &entry.commandAllocator, &entry.slot);
+		return entry;
+	}
+
+	// With m_SubmitMutex held: executes the open batch (if any) and signals if signal is set.
+	// Returns the fence value that covers the batch.
+	uint64_t SubmitLocked(bool signal)
+	{
+		// The batch's allocators are free again once the next signal passed - the one below or,
+		// without it, the next one of the queue
+		const uint64_t fenceValue = m_FenceValue + 1;
+
+		if (!m_Batch.empty())
+		{
+			std::vector<CommandList> commandLists(m_Batch.size());
+			for (size_t i = 0; i < m_Batch.size(); i++)
+				commandLists[i] = m_Batch[i].commandList;
+			m_Api.ExecuteCommandLists(commandLists.data(), (uint32_t)commandLists.size());
+			m_SubmitStats.submits++;
+			m_SubmitStats.commandLists += m_Batch.size();
+
+			// Still under the submit lock: the fence values of every slot stay in order
+			std::lock_guard<std::mutex> lock(m_CommandListMutex);
+			for (BatchEntry& entry : m_Batch)
+			{
+				m_AllocatorPool.Retire(entry.slot, fenceValue, std::move(entry.commandAllocator));
+				m_CommandLists.push(std::move(entry.commandList));
+			}
+			m_Batch.clear();
+		}
+
+		if (signal)
+		{
+			m_FenceValue = fenceValue;
+			m_Api.Signal(fenceValue);
+			m_SubmitStats.signals++;
+		}
+		return fenceValue;
+	}
+
+private:
+	Api m_Api;
+
+	// Allocators wait in their slot for the fence of the submit that executed them
+	CommandAllocatorPool<Allocator> m_AllocatorPool;
+	std::queue<CommandList> m_CommandLists;
+	std::mutex m_CommandListMutex;
+
+	uint64_t m_FenceValue = 0;
+	// Submits, signals and GPU waits in one order - fence values have to reach the queue increasing
+	std::mutex m_SubmitMutex;
+	// Lists added since the last submit, under m_SubmitMutex
+	std::vector<BatchEntry> m_Batch;
+	SubmitStats m_SubmitStats;
+	SubmitStats m_FrameStartStats;
+};
@@ -0,0 +1,63 @@
+#include "FenceRingAllocator.h"
+
+#include <cassert>
+
+FenceRingAllocator::FenceRingAllocator(uint64_t capacity)
+	: m_Capacity(capacity)
+{
+}
+
+uint64_t FenceRingAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	assert(size <= m_Capacity && (alignment & (alignment - 1)) == 0);
+
+	// The used bytes are the circular range ending at m_Head, the free ones start there
+	uint64_t offset = (m_Head + alignment - 1) & ~(alignment - 1);
+	bool wrap = false;
+	if (offset + size > m_Capacity)
+	{
+		offset = 0;
+		wrap = true;
+	}
+	const uint64_t padding = wrap ? m_Capacity - m_Head : offset - m_Head;
+	if (m_UsedBytes + padding + size > m_Capacity)
+	{
+		m_Stats.failedAllocations++;
+		return kInvalidOffset;
+	}
+
+	m_Head = offset + size == m_Capacity ? 0 : offset + size;
+	m_UsedBytes += padding + size;
+	m_OpenBatchBytes += padding + size;
+
+	m_Stats.allocations++;
+	m_Stats.allocatedBytes += size;
+	m_Stats.paddingBytes += padding;
+	m_Stats.wraps += wrap ? 1 : 0;
+	m_Stats.peakUsedBytes = m_UsedBytes > m_Stats.peakUsedBytes ? m_UsedBytes : m_Stats.peakUsedBytes;
+	return offset;
+}
+
+void FenceRingAllocator::FinishBatch(uint64_t fenceValue)
+{
+	if (m_OpenBatchBytes == 0)
+		return;
+
+	assert(m_Batches.empty() || m_Batches.back().fenceValue <= fenceValue);
+	m_Batches.push_back(Batch{ fenceValue, m_OpenBatchBytes });
+	m_OpenBatchBytes = 0;
+	m_Stats.batches++;
+}
+
+void FenceRingAllocator::Reclaim(uint64_t completedFenceValue)
+{
+	while (!m_Batches.empty() && m_Batches.front().fenceValue <= completedFenceValue)
+	{
+		m_UsedBytes -= m_Batches.front().size;
+		m_Batches.pop_front();
+	}
+
+	// An empty ring starts over at 0, the next allocations don't have to wrap
+	if (m_UsedBytes == 0)
+		m_Head = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) ring sub-allocator for memory the GPU reads asynchronously,
+// e.g. a persistently mapped upload buffer. Offsets only - the owner holds the memory.
+//
+// Allocations go in a ring, oldest first. Everything allocated between two FinishBatch() calls
+// belongs to one batch, tagged with the fence value that the batch's GPU work signals. Reclaim()
+// frees the batches whose fence the GPU has passed, in order. A full ring fails Allocate() - the
+// owner submits its pending batch and waits for GetOldestPendingFence().
+//
+// An allocation is never split: one that doesn't fit before the end of the ring skips the rest
+// of it (counted as used until its batch retires) and starts at offset 0.
+
+#include <cstdint>
+#include <deque>
+
+class FenceRingAllocator
+{
+public:
+	static const uint64_t kInvalidOffset = ~0ull;
+
+	struct Stats
+	{
+		uint64_t allocations = 0;
+		uint64_t allocatedBytes = 0;
+		uint64_t paddingBytes = 0;		// alignment and the skipped ends of the ring
+		uint64_t failedAllocations = 0;	// full ring
+		uint64_t peakUsedBytes = 0;
+		uint64_t batches = 0;
+		uint64_t wraps = 0;
+	};
+
+	explicit FenceRingAllocator(uint64_t capacity);
+
+	// Offset of size bytes aligned to alignment (a power of 2), kInvalidOffset if there's no room
+	// until older batches retire. size must not exceed the capacity.
+	uint64_t Allocate(uint64_t size, uint64_t alignment = 16);
+
+	// Tags the allocations since the last call with fenceValue (values must not decrease).
+	// Nothing is recorded if there weren't any.
+	void FinishBatch(uint64_t fenceValue);
+
+	// Frees the batches with fence values <= completedFenceValue
+	void Reclaim(uint64_t completedFenceValue);
+
+	bool HasPendingBatches() const { return !m_Batches.empty(); }
+	// Fence of the oldest batch still in use, 0 if none
+	uint64_t GetOldestPendingFence() const { return m_Batches.empty() ? 0 : m_Batches.front().fenceValue; }
+
+	uint64_t GetCapacity() const { return m_Capacity; }
+	// Bytes in finished and open batches, padding included
+	uint64_t GetUsedBytes() const { return m_UsedBytes; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct Batch
+	{
+		uint64_t fenceValue;
+		uint64_t size;				// bytes from the end of the previous batch, padding included
+	};
+
+	uint64_t m_Capacity;
+	uint64_t m_Head = 0;			// next free byte
+	uint64_t m_UsedBytes = 0;
+	uint64_t m_OpenBatchBytes = 0;	// allocated since the last FinishBatch()
+	std::deque<Batch> m_Batches;
+	Stats m_Stats;
+};
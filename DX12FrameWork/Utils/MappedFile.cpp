@@ -0,0 +1,146 @@
+#include "MappedFile.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+// =====================================================================================
+//										MappedFile
+// =====================================================================================
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size))
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_Size = (size_t)size.QuadPart;
+	m_IsOpen = true;
+
+	// A zero-sized file can't be mapped
+	if (m_Size == 0)
+		return true;
+
+	m_hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping)
+		m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	if (m_hFile)
+		CloseHandle(m_hFile);
+
+	m_pData = nullptr;
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+	m_Size = 0;
+	m_IsOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	m_Size = (size_t)st.st_size;
+	m_IsOpen = true;
+
+	if (m_Size > 0)
+	{
+		void* pData = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (pData == MAP_FAILED)
+		{
+			close(fd);
+			m_Size = 0;
+			m_IsOpen = false;
+			return false;
+		}
+		m_pData = static_cast<const uint8_t*>(pData);
+	}
+
+	// The mapping stays valid without the descriptor
+	close(fd);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		munmap(const_cast<uint8_t*>(m_pData), m_Size);
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_IsOpen = false;
+}
+
+#endif
+
+// =====================================================================================
+//										Hash
+// =====================================================================================
+
+uint64_t HashBytes(const void* pData, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(pData);
+	const uint64_t kPrime = 0x100000001B3ull;
+	uint64_t hash = seed ^ (uint64_t)size;
+
+	// 8 bytes per step - hashing a source file must stay far cheaper than importing it
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * kPrime;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; i++)
+		hash = (hash ^ bytes[i]) * kPrime;
+	return hash;
+}
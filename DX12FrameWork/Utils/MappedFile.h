@@ -0,0 +1,37 @@
+#pragma once
+
+// Read-only memory-mapped file (CreateFileMapping on Windows, mmap elsewhere).
+// The pages are loaded on first access, so mapping a large file is cheap and
+// its contents can be handed to an upload without a copy into a std::vector.
+
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { Close(); }
+
+	// Returns false if the file can't be opened. An empty file maps successfully with GetData() == nullptr.
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_IsOpen; }
+	const uint8_t* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const uint8_t* m_pData = nullptr;
+	size_t m_Size = 0;
+	bool m_IsOpen = false;
+#if defined(_WIN32)
+	void* m_hFile = nullptr;
+	void* m_hMapping = nullptr;
+#endif
+};
+
+// 64-bit FNV-1a style hash of a byte range - content hash for cache invalidation
+uint64_t HashBytes(const void* pData, size_t size, uint64_t seed = 0xCBF29CE484222325ull);
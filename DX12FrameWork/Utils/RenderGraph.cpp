@@ -0,0 +1,332 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// D3D12_RESOURCE_STATE_UNORDERED_ACCESS and _RAYTRACING_ACCELERATION_STRUCTURE: accesses in them
+	// are ordered by UAV barriers, the state doesn't change between a write and the next access
+	const uint32_t kUavStates = 0x8 | 0x400000;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+// =====================================================================================
+//										Declaration
+// =====================================================================================
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(Handle resource, uint32_t state, uint32_t subresource)
+{
+	m_Graph.AddAccess(m_Pass, resource, state, subresource, false);
+	return *this;
+}
+
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(Handle resource, uint32_t state, uint32_t subresource)
+{
+	m_Graph.AddAccess(m_Pass, resource, state, subresource, true);
+	return *this;
+}
+
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SideEffect()
+{
+	m_Graph.m_Passes[m_Pass].sideEffect = true;
+	return *this;
+}
+
+
+void RenderGraph::Reset()
+{
+	m_Passes.clear();
+	m_Accesses.clear();
+	m_Resources.clear();
+	m_Stats = Stats();
+}
+
+
+RenderGraph::Handle RenderGraph::Import(const char* name, void* pResource, uint32_t finalState)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.pResource = pResource;
+	resource.imported = true;
+	resource.finalState = finalState;
+	m_Resources.push_back(resource);
+	return (Handle)m_Resources.size() - 1;
+}
+
+
+RenderGraph::Handle RenderGraph::CreateTransient(const TransientDesc& desc)
+{
+	assert(desc.size > 0 && desc.alignment > 0);
+	Resource resource = {};
+	resource.name = desc.name;
+	resource.finalState = kKeepState;
+	resource.desc = desc;
+	m_Resources.push_back(resource);
+	return (Handle)m_Resources.size() - 1;
+}
+
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* name, ExecuteFunction execute)
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.execute = std::move(execute);
+	pass.firstAccess = (uint32_t)m_Accesses.size();
+	m_Passes.push_back(std::move(pass));
+	return PassBuilder(*this, (uint32_t)m_Passes.size() - 1);
+}
+
+
+void RenderGraph::AddAccess(uint32_t pass, Handle resource, uint32_t state, uint32_t subresource, bool write)
+{
+	// The accesses of a pass are consecutive in m_Accesses
+	assert(pass == m_Passes.size() - 1 && resource < m_Resources.size());
+	m_Accesses.push_back(Access{ resource, state, subresource, write });
+	m_Passes[pass].accessCount++;
+}
+
+// =====================================================================================
+//										Compile
+// =====================================================================================
+
+void RenderGraph::Compile()
+{
+	m_Stats = Stats();
+	m_Stats.passes = (uint32_t)m_Passes.size();
+
+	CullPasses();
+
+	// Lifetimes of the transients over the passes that run, reads need a write before them
+	for (Resource& resource : m_Resources)
+	{
+		resource.firstPass = kNoPass;
+		resource.lastPass = kNoPass;
+		resource.aliased = false;
+	}
+
+	std::vector<bool>& written = m_Needed;
+	written.assign(m_Resources.size(), false);
+	for (uint32_t passIndex = 0; passIndex < m_Passes.size(); passIndex++)
+	{
+		const Pass& pass = m_Passes[passIndex];
+		if (pass.culled)
+			continue;
+
+		for (uint32_t i = 0; i < pass.accessCount; i++)
+		{
+			const Access& access = m_Accesses[pass.firstAccess + i];
+			Resource& resource = m_Resources[access.resource];
+			if (!access.write && !resource.imported && !written[access.resource])
+				throw std::logic_error(std::string("RenderGraph: pass ") + pass.name + " reads " + resource.name + " before a pass writes it");
+
+			resource.firstPass = std::min(resource.firstPass, passIndex);
+			resource.lastPass = resource.lastPass == kNoPass ? passIndex : std::max(resource.lastPass, passIndex);
+		}
+		for (uint32_t i = 0; i < pass.accessCount; i++)
+		{
+			const Access& access = m_Accesses[pass.firstAccess + i];
+			written[access.resource] = written[access.resource] || access.write;
+		}
+	}
+
+	PlaceTransients();
+}
+
+
+void RenderGraph::CullPasses()
+{
+	// Backwards: a pass runs if something after it needs what it writes. Its reads are needed from
+	// the passes before it, a write of the whole resource (without a read) ends the need.
+	m_Needed.assign(m_Resources.size(), false);
+	for (uint32_t passIndex = (uint32_t)m_Passes.size(); passIndex-- > 0;)
+	{
+		Pass& pass = m_Passes[passIndex];
+		bool needed = pass.sideEffect;
+		for (uint32_t i = 0; i < pass.accessCount && !needed; i++)
+		{
+			const Access& access = m_Accesses[pass.firstAccess + i];
+			needed = access.write && (m_Resources[access.resource].imported || m_Needed[access.resource]);
+		}
+
+		pass.culled = !needed;
+		if (pass.culled)
+		{
+			m_Stats.culledPasses++;
+			continue;
+		}
+
+		for (uint32_t i = 0; i < pass.accessCount; i++)
+		{
+			const Access& access = m_Accesses[pass.firstAccess + i];
+			if (access.write && access.subresource == ResourceStateTracker::kAllSubresources)
+				m_Needed[access.resource] = false;
+		}
+		for (uint32_t i = 0; i < pass.accessCount; i++)
+		{
+			const Access& access = m_Accesses[pass.firstAccess + i];
+			if (!access.write)
+				m_Needed[access.resource] = true;
+		}
+	}
+}
+
+
+void RenderGraph::PlaceTransients()
+{
+	// Largest first, each at the lowest offset that doesn't overlap the memory of a placed transient
+	// that lives at the same time
+	m_Placement.clear();
+	for (Handle handle = 0; handle < m_Resources.size(); handle++)
+	{
+		if (!m_Resources[handle].imported && m_Resources[handle].firstPass != kNoPass)
+			m_Placement.push_back(handle);
+	}
+	std::stable_sort(m_Placement.begin(), m_Placement.end(), [this](Handle a, Handle b)
+	{
+		return m_Resources[a].desc.size > m_Resources[b].desc.size;
+	});
+
+	for (size_t placed = 0; placed < m_Placement.size(); placed++)
+	{
+		Resource& resource = m_Resources[m_Placement[placed]];
+		uint64_t offset = 0;
+		for (bool moved = true; moved;)
+		{
+			moved = false;
+			for (size_t i = 0; i < placed; i++)
+			{
+				const Resource& other = m_Resources[m_Placement[i]];
+				const bool livesTogether = other.firstPass <= resource.lastPass && resource.firstPass <= other.lastPass;
+				const bool overlaps = other.offset < offset + resource.desc.size && offset < other.offset + other.desc.size;
+				if (livesTogether && overlaps)
+				{
+					offset = AlignUp(other.offset + other.desc.size, resource.desc.alignment);
+					moved = true;
+				}
+			}
+		}
+		resource.offset = offset;
+
+		// Memory shared with a transient of another lifetime
+		for (size_t i = 0; i < placed; i++)
+		{
+			Resource& other = m_Resources[m_Placement[i]];
+			if (other.offset < offset + resource.desc.size && offset < other.offset + other.desc.size)
+			{
+				resource.aliased = true;
+				other.aliased = true;
+			}
+		}
+
+		m_Stats.transients++;
+		m_Stats.transientBytes += resource.desc.size;
+		m_Stats.heapBytes = std::max(m_Stats.heapBytes, offset + resource.desc.size);
+	}
+}
+
+
+bool RenderGraph::IsTransientUsed(Handle resource) const
+{
+	return !m_Resources[resource].imported && m_Resources[resource].firstPass != kNoPass;
+}
+
+
+uint64_t RenderGraph::GetTransientOffset(Handle resource) const
+{
+	assert(IsTransientUsed(resource));
+	return m_Resources[resource].offset;
+}
+
+
+const RenderGraph::TransientDesc& RenderGraph::GetTransientDesc(Handle resource) const
+{
+	return m_Resources[resource].desc;
+}
+
+
+void RenderGraph::SetTransientResource(Handle resource, void* pResource, bool newPlacement)
+{
+	assert(IsTransientUsed(resource));
+	m_Resources[resource].pResource = pResource;
+	m_Resources[resource].aliased = m_Resources[resource].aliased || newPlacement;
+}
+
+// =====================================================================================
+//										Execute
+// =====================================================================================
+
+void RenderGraph::Execute(ResourceStateTracker& stateTracker, const std::function<void()>& flushBarriers)
+{
+	for (Resource& resource : m_Resources)
+	{
+		resource.lastAccessPass = kNoPass;
+		resource.lastAccessWrite = false;
+	}
+
+	for (uint32_t passIndex = 0; passIndex < m_Passes.size(); passIndex++)
+	{
+		const Pass& pass = m_Passes[passIndex];
+		if (pass.culled)
+			continue;
+
+		for (uint32_t i = 0; i < pass.accessCount; i++)
+		{
+			const Access& access = m_Accesses[pass.firstAccess + i];
+			Resource& resource = m_Resources[access.resource];
+			assert(resource.pResource);
+
+			if (resource.lastAccessPass == passIndex)
+			{
+				// Another access of the same pass
+				stateTracker.Transition(resource.pResource, access.state, access.subresource);
+				resource.lastAccessWrite = resource.lastAccessWrite || access.write;
+				continue;
+			}
+
+			if (resource.lastAccessPass == kNoPass && resource.aliased)
+				stateTracker.AliasingBarrier(nullptr, resource.pResource);
+
+			// UAV accesses in the same state: a barrier unless both only read. The accesses of an
+			// imported resource before the frame are unknown (the acceleration structure the last
+			// frame traced is refitted), the memory of a transient is new.
+			const uint32_t subresource = access.subresource == ResourceStateTracker::kAllSubresources ? 0 : access.subresource;
+			const bool hazard = resource.lastAccessPass != kNoPass ? access.write || resource.lastAccessWrite : resource.imported;
+			if (hazard && (access.state & kUavStates) && stateTracker.GetState(resource.pResource, subresource) == access.state)
+				stateTracker.UavBarrier(resource.pResource);
+
+			stateTracker.Transition(resource.pResource, access.state, access.subresource);
+			resource.lastAccessPass = passIndex;
+			resource.lastAccessWrite = access.write;
+		}
+
+		flushBarriers();
+		pass.execute();
+	}
+
+	bool finalTransitions = false;
+	for (const Resource& resource : m_Resources)
+	{
+		if (resource.imported && resource.finalState != kKeepState)
+		{
+			stateTracker.Transition(resource.pResource, resource.finalState);
+			finalTransitions = true;
+		}
+	}
+	if (finalTransitions)
+		flushBarriers();
+}
+
+
+void* RenderGraph::GetResource(Handle resource) const
+{
+	return m_Resources[resource].pResource;
+}
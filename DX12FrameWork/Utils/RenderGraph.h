@@ -0,0 +1,154 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) frame graph: passes declare the resources they read and write,
+// in which D3D12_RESOURCE_STATES, and the graph takes care of the rest.
+//
+// Compile() culls the passes whose results nothing uses - a pass stays if it has side effects, writes
+// an imported resource or writes what a remaining pass reads - and gives every transient an offset in
+// one heap: transients whose lifetimes (first to last pass that uses them) don't overlap share memory.
+// Execute() runs the remaining passes, each after one batch of barriers: transitions and UAV barriers
+// through the ResourceStateTracker, an aliasing barrier before the first use of a transient that
+// shares memory, and the imported resources end in their final states.
+//
+// Passes run in the order they were added and a read sees the writes added before it, so the
+// declaration order is the dependency order. The first pass writing a transient that shares memory
+// has to initialize it: Clear/DiscardResource for render targets and depth, or a full overwrite.
+// A graph is declared, compiled and executed per frame (Reset() keeps the memory).
+
+#include "ResourceStateTracker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class RenderGraph
+{
+public:
+	typedef uint32_t Handle;
+	static const uint32_t kKeepState = 0xffffffff;
+
+	// Memory of a transient (D3D12: GetResourceAllocationInfo of its desc)
+	struct TransientDesc
+	{
+		const char* name = "";
+		uint64_t size = 0;
+		uint64_t alignment = 65536;
+	};
+
+	struct Stats
+	{
+		uint32_t passes = 0;			// added
+		uint32_t culledPasses = 0;
+		uint32_t transients = 0;		// used by the passes that run
+		uint64_t transientBytes = 0;	// ... their sizes summed
+		uint64_t heapBytes = 0;			// ... the heap they share
+	};
+
+	typedef std::function<void()> ExecuteFunction;
+
+	// Declares the resource accesses of the pass AddPass() returned it for, before the next AddPass()
+	class PassBuilder
+	{
+	public:
+		PassBuilder& Read(Handle resource, uint32_t state, uint32_t subresource = ResourceStateTracker::kAllSubresources);
+		PassBuilder& Write(Handle resource, uint32_t state, uint32_t subresource = ResourceStateTracker::kAllSubresources);
+		// Never culled (readback, work outside the graph depends on it)
+		PassBuilder& SideEffect();
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+		RenderGraph& m_Graph;
+		uint32_t m_Pass;
+	};
+
+	// Forgets the passes and resources of the last frame
+	void Reset();
+
+	// A resource owned outside the graph (backbuffer, acceleration structure ...). Its writes are seen
+	// outside, their passes always run. finalState: its state after Execute()
+	Handle Import(const char* name, void* pResource, uint32_t finalState = kKeepState);
+	// A resource for this frame only, created after Compile() at the offset the graph gives it
+	Handle CreateTransient(const TransientDesc& desc);
+	PassBuilder AddPass(const char* name, ExecuteFunction execute);
+
+	// Throws std::logic_error for a pass reading a transient no pass wrote before it
+	void Compile();
+
+	// After Compile(): the transients that are used and their place in the heap
+	bool IsTransientUsed(Handle resource) const;
+	uint64_t GetTransientOffset(Handle resource) const;
+	const TransientDesc& GetTransientDesc(Handle resource) const;
+	uint64_t GetHeapSize() const { return m_Stats.heapBytes; }
+	// The resource created for a used transient. newPlacement: the memory held another resource
+	// before (needs an aliasing barrier even if the graph doesn't share it this frame)
+	void SetTransientResource(Handle resource, void* pResource, bool newPlacement);
+
+	// Runs the passes that weren't culled. flushBarriers issues the tracker's batch on the list the
+	// passes record to (FlushBarriers() of Utils.h)
+	void Execute(ResourceStateTracker& stateTracker, const std::function<void()>& flushBarriers);
+
+	// The resource behind a handle, for the passes
+	void* GetResource(Handle resource) const;
+
+	uint32_t GetPassCount() const { return (uint32_t)m_Passes.size(); }
+	const char* GetPassName(uint32_t pass) const { return m_Passes[pass].name; }
+	bool IsPassCulled(uint32_t pass) const { return m_Passes[pass].culled; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	static const uint32_t kNoPass = 0xffffffff;
+
+	struct Access
+	{
+		Handle resource;
+		uint32_t state;
+		uint32_t subresource;
+		bool write;
+	};
+
+	struct Pass
+	{
+		const char* name;
+		ExecuteFunction execute;
+		uint32_t firstAccess;		// in m_Accesses
+		uint32_t accessCount;
+		bool sideEffect;
+		bool culled;
+	};
+
+	struct Resource
+	{
+		const char* name;
+		void* pResource;
+		bool imported;
+		uint32_t finalState;
+		TransientDesc desc;
+
+		// Compile()
+		uint32_t firstPass;
+		uint32_t lastPass;
+		uint64_t offset;
+		bool aliased;
+
+		// Execute()
+		uint32_t lastAccessPass;
+		bool lastAccessWrite;		// ... by that pass
+	};
+
+	void AddAccess(uint32_t pass, Handle resource, uint32_t state, uint32_t subresource, bool write);
+	void CullPasses();
+	void PlaceTransients();
+
+private:
+	std::vector<Pass> m_Passes;
+	std::vector<Access> m_Accesses;
+	std::vector<Resource> m_Resources;
+	Stats m_Stats;
+
+	// Compile() scratch
+	std::vector<bool> m_Needed;
+	std::vector<Handle> m_Placement;
+};
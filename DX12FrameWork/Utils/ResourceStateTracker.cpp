@@ -0,0 +1,145 @@
+#include "ResourceStateTracker.h"
+
+#include <cassert>
+
+namespace
+{
+	// D3D12_RESOURCE_STATE_* bits that only read: a resource in a combination of them may be
+	// used in any of them without a barrier
+	const uint32_t kReadOnlyStates =
+		0x1 |		// VERTEX_AND_CONSTANT_BUFFER
+		0x2 |		// INDEX_BUFFER
+		0x20 |		// DEPTH_READ
+		0x40 |		// NON_PIXEL_SHADER_RESOURCE
+		0x80 |		// PIXEL_SHADER_RESOURCE
+		0x200 |		// INDIRECT_ARGUMENT
+		0x800 |		// COPY_SOURCE
+		0x2000;		// RESOLVE_SOURCE
+
+	bool NeedsBarrier(uint32_t current, uint32_t requested)
+	{
+		if (current == requested)
+			return false;
+		const bool currentReadOnly = current != 0 && (current & ~kReadOnlyStates) == 0;
+		return !(currentReadOnly && requested != 0 && (current & requested) == requested);
+	}
+}
+
+
+void ResourceStateTracker::Register(void* pResource, uint32_t state, uint32_t subresourceCount)
+{
+	assert(subresourceCount > 0);
+	m_States[pResource].assign(subresourceCount, state);
+}
+
+
+void ResourceStateTracker::Unregister(void* pResource)
+{
+	m_States.erase(pResource);
+}
+
+
+uint32_t ResourceStateTracker::GetState(void* pResource, uint32_t subresource) const
+{
+	auto it = m_States.find(pResource);
+	if (it == m_States.end())
+		return 0;
+	assert(subresource < it->second.size());
+	return it->second[subresource];
+}
+
+
+void ResourceStateTracker::Transition(void* pResource, uint32_t state, uint32_t subresource)
+{
+	auto it = m_States.find(pResource);
+	if (it == m_States.end())
+		it = m_States.emplace(pResource, std::vector<uint32_t>(1, 0)).first;
+	std::vector<uint32_t>& states = it->second;
+
+	if (subresource != kAllSubresources)
+	{
+		assert(subresource < states.size());
+		states[subresource] = TransitionSubresource(pResource, subresource, states[subresource], state);
+		return;
+	}
+
+	// One barrier for the whole resource while its subresources agree, one per subresource otherwise
+	bool uniform = true;
+	for (uint32_t i = 1; i < states.size() && uniform; i++)
+		uniform = states[i] == states[0];
+
+	if (uniform)
+	{
+		const uint32_t newState = TransitionSubresource(pResource, kAllSubresources, states[0], state);
+		for (uint32_t& subresourceState : states)
+			subresourceState = newState;
+	}
+	else
+	{
+		for (uint32_t i = 0; i < states.size(); i++)
+			states[i] = TransitionSubresource(pResource, i, states[i], state);
+	}
+}
+
+
+void ResourceStateTracker::UavBarrier(void* pResource)
+{
+	m_Stats.uavRequested++;
+	for (const Barrier& barrier : m_Pending)
+	{
+		// A global one covers all resources
+		if (barrier.type == BarrierType::Uav && (barrier.pResource == pResource || barrier.pResource == nullptr))
+			return;
+	}
+	m_Pending.push_back(Barrier{ BarrierType::Uav, pResource, nullptr, kAllSubresources, 0, 0 });
+}
+
+
+void ResourceStateTracker::AliasingBarrier(void* pResourceBefore, void* pResource)
+{
+	m_Pending.push_back(Barrier{ BarrierType::Aliasing, pResource, pResourceBefore, kAllSubresources, 0, 0 });
+}
+
+
+void ResourceStateTracker::Flush(std::vector<Barrier>* pBarriers)
+{
+	pBarriers->clear();
+	pBarriers->swap(m_Pending);
+
+	for (const Barrier& barrier : *pBarriers)
+	{
+		m_Stats.issued += barrier.type == BarrierType::Transition ? 1 : 0;
+		m_Stats.uavIssued += barrier.type == BarrierType::Uav ? 1 : 0;
+		m_Stats.aliasingIssued += barrier.type == BarrierType::Aliasing ? 1 : 0;
+	}
+	m_Stats.batches += pBarriers->empty() ? 0 : 1;
+}
+
+
+uint32_t ResourceStateTracker::TransitionSubresource(void* pResource, uint32_t subresource, uint32_t before, uint32_t after)
+{
+	m_Stats.requested++;
+	if (!NeedsBarrier(before, after))
+	{
+		m_Stats.redundant++;
+		return before;
+	}
+
+	for (size_t i = 0; i < m_Pending.size(); i++)
+	{
+		Barrier& barrier = m_Pending[i];
+		if (barrier.type != BarrierType::Transition || barrier.pResource != pResource || barrier.subresource != subresource)
+			continue;
+
+		// The batched barrier goes to the new state directly, a round trip needs none.
+		// Its request was counted already, this one is merged either way.
+		m_Stats.merged++;
+		barrier.after = after;
+		if (barrier.before == barrier.after)
+			m_Pending.erase(m_Pending.begin() + i);
+		return after;
+	}
+
+	m_Pending.push_back(Barrier{ BarrierType::Transition, pResource, nullptr, subresource, before, after });
+	return after;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) resource state tracking for barrier batching.
+// States are D3D12_RESOURCE_STATES bits, resources are opaque pointers (ID3D12Resource*).
+//
+// The tracker knows the current state of every subresource of the resources it has seen, so the
+// code that uses a resource only asks for the state it needs (Transition()) - the "before" state
+// is never guessed. A request for the current state, or for a read state the current read state
+// already includes, needs no barrier. The barriers that are needed collect in a batch that Flush()
+// hands out, to be issued with one ResourceBarrier call before the pass that uses the resources.
+// Requests for a subresource that already has a barrier in the batch change that barrier instead
+// of adding one (A->B, B->C gives A->C; A->B, B->A none) - nothing runs between them anyway.
+//
+// One recording thread; lists that use the same resources have to be executed in the order they
+// were recorded. Resources the tracker hasn't seen are in COMMON (= PRESENT) - Register() the ones
+// created in other states and Unregister() resources before releasing them.
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class ResourceStateTracker
+{
+public:
+	// D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+	static const uint32_t kAllSubresources = 0xffffffff;
+
+	enum class BarrierType
+	{
+		Transition,
+		Uav,						// pResource null for all UAV accesses
+		Aliasing,					// pResource starts to use memory pResourceBefore (null: any resource) used
+	};
+
+	struct Barrier
+	{
+		BarrierType type;
+		void* pResource;
+		void* pResourceBefore;		// Aliasing only
+		uint32_t subresource;		// Transition: kAllSubresources or one of them
+		uint32_t before;
+		uint32_t after;
+	};
+
+	struct Stats
+	{
+		uint64_t requested = 0;		// Transition() calls, per subresource that needed its own barrier
+		uint64_t redundant = 0;		// ... already in the state (or a read state that includes it)
+		uint64_t merged = 0;		// ... folded into a barrier of the batch
+		uint64_t issued = 0;		// transition barriers handed out by Flush()
+		uint64_t uavRequested = 0;
+		uint64_t uavIssued = 0;
+		uint64_t aliasingIssued = 0;
+		uint64_t batches = 0;		// Flush() calls that handed out barriers (= ResourceBarrier calls)
+
+		uint64_t GetEliminated() const { return requested - issued; }
+	};
+
+	// subresourceCount subresources of pResource in state from now on (at creation, or after use
+	// outside the tracker)
+	void Register(void* pResource, uint32_t state, uint32_t subresourceCount = 1);
+	void Unregister(void* pResource);
+	uint32_t GetState(void* pResource, uint32_t subresource = 0) const;
+
+	// pResource (one or all subresources) is used in state from the next Flush() on
+	void Transition(void* pResource, uint32_t state, uint32_t subresource = kAllSubresources);
+	// The UAV accesses to pResource (all of them if null) before the next Flush() finish before the ones after it
+	void UavBarrier(void* pResource);
+	// pResource (placed) takes over the memory of pResourceBefore (null: of whatever used it) from the next Flush() on
+	void AliasingBarrier(void* pResourceBefore, void* pResource);
+
+	// Moves the batched barriers to pBarriers (replacing its content)
+	void Flush(std::vector<Barrier>* pBarriers);
+	size_t GetPendingCount() const { return m_Pending.size(); }
+
+	const Stats& GetStats() const { return m_Stats; }
+	void ResetStats() { m_Stats = Stats(); }
+
+private:
+	// The state of one subresource (or all) after the request, adds or changes a batched barrier
+	uint32_t TransitionSubresource(void* pResource, uint32_t subresource, uint32_t before, uint32_t after);
+
+private:
+	// Current state per subresource - the state after the batched barriers
+	std::unordered_map<void*, std::vector<uint32_t>> m_States;
+	std::vector<Barrier> m_Pending;
+	Stats m_Stats;
+};
@@ -0,0 +1,227 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// =====================================================================================
+//										ThreadPool
+// =====================================================================================
+
+ThreadPool::ThreadPool(uint32_t numThreads)
+{
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	// The thread which waits on a TaskGroup also executes tasks,
+	// so one worker less than requested is spawned.
+	for (uint32_t i = 1; i < numThreads; i++)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_WakeUp.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::Submit(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(std::move(task));
+	}
+	m_WakeUp.notify_one();
+}
+
+bool ThreadPool::TryRunPendingTask()
+{
+	Task task;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Tasks.empty())
+			return false;
+
+		task = std::move(m_Tasks.front());
+		m_Tasks.pop_front();
+	}
+
+	task();
+	return true;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WakeUp.wait(lock, [this] { return m_Quit || !m_Tasks.empty(); });
+
+			if (m_Quit && m_Tasks.empty())
+				return;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+// =====================================================================================
+//										TaskGroup
+// =====================================================================================
+
+void TaskGroup::Run(ThreadPool::Task task)
+{
+	m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+	// The counter is decremented only after the task body has finished,
+	// so Wait() can't return while the task still touches captured data.
+	m_Pool.Submit([this, task]()
+	{
+		task();
+		m_Pending.fetch_sub(1, std::memory_order_release);
+	});
+}
+
+void TaskGroup::Wait()
+{
+	// Help the pool instead of sleeping - the tasks this group waits for
+	// may be sitting in the queue behind other tasks.
+	while (m_Pending.load(std::memory_order_acquire) != 0)
+	{
+		if (!m_Pool.TryRunPendingTask())
+			std::this_thread::yield();
+	}
+}
+
+// =====================================================================================
+//										ParallelFor
+// =====================================================================================
+
+void ParallelFor(ThreadPool& pool, uint32_t begin, uint32_t end, uint32_t grain,
+	const std::function<void(uint32_t, uint32_t)>& body)
+{
+	if (begin >= end)
+		return;
+
+	grain = std::max(1u, grain);
+	const uint32_t count = end - begin;
+
+	// Around 4 chunks per thread is enough to balance the load without
+	// paying too much for the task overhead.
+	uint32_t chunkCount = std::min((count + grain - 1) / grain, pool.GetThreadCount() * 4);
+	if (chunkCount <= 1)
+	{
+		body(begin, end);
+		return;
+	}
+
+	const uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+	TaskGroup group(pool);
+	for (uint32_t chunkBegin = begin + chunkSize; chunkBegin < end; chunkBegin += chunkSize)
+	{
+		uint32_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+		group.Run([&body, chunkBegin, chunkEnd]() { body(chunkBegin, chunkEnd); });
+	}
+
+	// The first chunk is executed by the calling thread
+	body(begin, std::min(end, begin + chunkSize));
+	group.Wait();
+}
+
+// =====================================================================================
+//									ParallelForWorkStealing
+// =====================================================================================
+
+void ParallelForWorkStealing(ThreadPool& pool, uint32_t itemCount,
+	const std::function<void(uint32_t, uint32_t)>& body)
+{
+	if (itemCount == 0)
+		return;
+
+	const uint32_t workerCount = std::min(pool.GetThreadCount(), itemCount);
+
+	// [begin, end) of every slice packed into one 64-bit word, so the owner (begin++)
+	// and the thieves (end--) race on a single compare-and-swap
+	struct Slice
+	{
+		std::atomic<uint64_t> range;
+		char padding[64 - sizeof(std::atomic<uint64_t>)];	// One slice per cache line
+	};
+	std::vector<Slice> slices(workerCount);
+	for (uint32_t w = 0; w < workerCount; w++)
+	{
+		uint64_t begin = (uint64_t)itemCount * w / workerCount;
+		uint64_t end = (uint64_t)itemCount * (w + 1) / workerCount;
+		slices[w].range.store((begin << 32) | end, std::memory_order_relaxed);
+	}
+
+	auto popFront = [&slices](uint32_t w, uint32_t* pItem)
+	{
+		uint64_t range = slices[w].range.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+			if (begin >= end)
+				return false;
+			if (slices[w].range.compare_exchange_weak(range, ((uint64_t)(begin + 1) << 32) | end, std::memory_order_relaxed))
+			{
+				*pItem = begin;
+				return true;
+			}
+		}
+	};
+
+	auto stealBack = [&slices](uint32_t victim, uint32_t* pItem)
+	{
+		uint64_t range = slices[victim].range.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+			if (begin >= end)
+				return false;
+			if (slices[victim].range.compare_exchange_weak(range, ((uint64_t)begin << 32) | (end - 1), std::memory_order_relaxed))
+			{
+				*pItem = end - 1;
+				return true;
+			}
+		}
+	};
+
+	auto workerLoop = [&](uint32_t w)
+	{
+		uint32_t item;
+		while (popFront(w, &item))
+			body(item, w);
+
+		// Own slice is done - steal from the others, starting with the neighbour
+		for (uint32_t i = 1; i < workerCount; i++)
+		{
+			uint32_t victim = (w + i) % workerCount;
+			while (stealBack(victim, &item))
+				body(item, w);
+		}
+	};
+
+	TaskGroup group(pool);
+	for (uint32_t w = 1; w < workerCount; w++)
+		group.Run([&workerLoop, w]() { workerLoop(w); });
+
+	workerLoop(0);
+	group.Wait();
+}
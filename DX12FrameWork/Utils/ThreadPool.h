@@ -0,0 +1,82 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) task pool used by the CPU-side tools:
+//		- CpuRT BVH builders
+//		- Headless benchmarks
+// Only the C++ standard library is used, so it can be compiled on Linux as well.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	// numThreads - total number of threads that execute tasks, INCLUDING the calling thread
+	//				(the thread that waits on a TaskGroup helps executing tasks).
+	//				0 - use std::thread::hardware_concurrency().
+	explicit ThreadPool(uint32_t numThreads = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size() + 1; }
+
+	// Pushes a task into the queue. Use TaskGroup to wait for the completion.
+	void Submit(Task task);
+
+	// Pops and executes one pending task on the calling thread.
+	// Returns false if there was nothing to execute.
+	bool TryRunPendingTask();
+
+	// Process-wide pool sized to the number of hardware threads.
+	static ThreadPool& GetDefault();
+
+private:
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread>	m_Workers;
+	std::deque<Task>			m_Tasks;
+	std::mutex					m_Mutex;
+	std::condition_variable		m_WakeUp;
+	bool						m_Quit = false;
+};
+
+// A set of tasks that can be waited for.
+// Wait() executes pending tasks of the pool instead of blocking, so tasks
+// are allowed to spawn and wait for nested TaskGroups (recursive builders).
+class TaskGroup
+{
+public:
+	explicit TaskGroup(ThreadPool& pool) : m_Pool(pool) {}
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+	~TaskGroup() { Wait(); }
+
+	void Run(ThreadPool::Task task);
+	void Wait();
+
+private:
+	ThreadPool& m_Pool;
+	std::atomic<uint32_t> m_Pending { 0 };
+};
+
+// Splits [begin, end) into chunks of at least 'grain' elements and executes
+// body(chunkBegin, chunkEnd) for each chunk on the pool. Blocks until all chunks are done.
+void ParallelFor(ThreadPool& pool, uint32_t begin, uint32_t end, uint32_t grain,
+	const std::function<void(uint32_t, uint32_t)>& body);
+
+// Executes body(item, workerIndex) for every item in [0, itemCount) with work stealing:
+// every worker owns an equal contiguous slice of the items and takes from its front;
+// a worker that ran out of items steals single items from the back of the other slices.
+// Meant for items of very uneven cost (e.g. screen tiles). workerIndex < pool.GetThreadCount().
+void ParallelForWorkStealing(ThreadPool& pool, uint32_t itemCount,
+	const std::function<void(uint32_t, uint32_t)>& body);
@@ -0,0 +1,144 @@
+#include "TimelineTrace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+namespace
+{
+	void WriteJsonString(FILE* pFile, const std::string& text)
+	{
+		fputc('"', pFile);
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				fputc('\\', pFile);
+			if ((unsigned char)c >= 0x20)
+				fputc(c, pFile);
+		}
+		fputc('"', pFile);
+	}
+}
+
+
+uint32_t TimelineTrace::AddTrack(const char* name)
+{
+	m_Tracks.push_back(name);
+	return (uint32_t)m_Tracks.size() - 1;
+}
+
+
+void TimelineTrace::Add(uint32_t track, const char* name, double beginUs, double endUs)
+{
+	assert(track < m_Tracks.size() && beginUs <= endUs);
+	m_Intervals.push_back(Interval{ track, name, beginUs, endUs });
+}
+
+
+void TimelineTrace::Clear()
+{
+	m_Intervals.clear();
+}
+
+
+double TimelineTrace::GetBusyUs(uint32_t track) const
+{
+	double busyUs = 0.0;
+	for (const auto& range : GetBusyRanges(track))
+		busyUs += range.second - range.first;
+	return busyUs;
+}
+
+
+double TimelineTrace::GetOverlapUs(uint32_t trackA, uint32_t trackB) const
+{
+	const std::vector<std::pair<double, double>> a = GetBusyRanges(trackA);
+	const std::vector<std::pair<double, double>> b = GetBusyRanges(trackB);
+
+	// Both sorted and disjoint: step past whichever range ends first
+	double overlapUs = 0.0;
+	size_t i = 0, j = 0;
+	while (i < a.size() && j < b.size())
+	{
+		const double begin = std::max(a[i].first, b[j].first);
+		const double end = std::min(a[i].second, b[j].second);
+		overlapUs += std::max(0.0, end - begin);
+		if (a[i].second < b[j].second)
+			i++;
+		else
+			j++;
+	}
+	return overlapUs;
+}
+
+
+double TimelineTrace::GetSpanUs() const
+{
+	if (m_Intervals.empty())
+		return 0.0;
+
+	double begin = m_Intervals[0].beginUs;
+	double end = m_Intervals[0].endUs;
+	for (const Interval& interval : m_Intervals)
+	{
+		begin = std::min(begin, interval.beginUs);
+		end = std::max(end, interval.endUs);
+	}
+	return end - begin;
+}
+
+
+bool TimelineTrace::WriteChromeTrace(const char* path) const
+{
+	FILE* pFile = fopen(path, "w");
+	if (!pFile)
+		return false;
+
+	double originUs = m_Intervals.empty() ? 0.0 : m_Intervals[0].beginUs;
+	for (const Interval& interval : m_Intervals)
+		originUs = std::min(originUs, interval.beginUs);
+
+	// Complete ("X") events on thread rows named after the tracks
+	fprintf(pFile, "{\"traceEvents\":[\n");
+	for (uint32_t track = 0; track < m_Tracks.size(); track++)
+	{
+		fprintf(pFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", track);
+		WriteJsonString(pFile, m_Tracks[track]);
+		fprintf(pFile, "}},\n");
+	}
+	for (size_t i = 0; i < m_Intervals.size(); i++)
+	{
+		const Interval& interval = m_Intervals[i];
+		fprintf(pFile, "{\"name\":");
+		WriteJsonString(pFile, interval.name);
+		fprintf(pFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n", interval.track,
+			interval.beginUs - originUs, interval.endUs - interval.beginUs, i + 1 < m_Intervals.size() ? "," : "");
+	}
+	fprintf(pFile, "],\"displayTimeUnit\":\"ms\"}\n");
+
+	const bool written = ferror(pFile) == 0;
+	return fclose(pFile) == 0 && written;
+}
+
+
+std::vector<std::pair<double, double>> TimelineTrace::GetBusyRanges(uint32_t track) const
+{
+	std::vector<std::pair<double, double>> ranges;
+	for (const Interval& interval : m_Intervals)
+	{
+		if (interval.track == track)
+			ranges.push_back(std::make_pair(interval.beginUs, interval.endUs));
+	}
+	std::sort(ranges.begin(), ranges.end());
+
+	size_t merged = 0;
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		if (merged > 0 && ranges[i].first <= ranges[merged - 1].second)
+			ranges[merged - 1].second = std::max(ranges[merged - 1].second, ranges[i].second);
+		else
+			ranges[merged++] = ranges[i];
+	}
+	ranges.resize(merged);
+	return ranges;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Portable (no Windows/D3D12 headers) timeline of busy intervals on named tracks - the GPU queues,
+// measured with timestamp queries (GpuTimer) or simulated (NullDevice). Times are microseconds on
+// one clock shared by all tracks, any origin.
+//
+// Gives each track's busy time and the time two tracks were busy together, and writes the
+// intervals as a Chrome trace (JSON; chrome://tracing or ui.perfetto.dev), one row per track.
+//
+// Not thread-safe.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TimelineTrace
+{
+public:
+	struct Interval
+	{
+		uint32_t track;
+		std::string name;
+		double beginUs;
+		double endUs;
+	};
+
+	uint32_t AddTrack(const char* name);
+	void Add(uint32_t track, const char* name, double beginUs, double endUs);
+	// Forgets the intervals, keeps the tracks
+	void Clear();
+
+	// Time covered by the track's intervals (overlapping ones counted once)
+	double GetBusyUs(uint32_t track) const;
+	// Time both tracks were busy
+	double GetOverlapUs(uint32_t trackA, uint32_t trackB) const;
+	// First begin to last end over all tracks, 0 without intervals
+	double GetSpanUs() const;
+
+	uint32_t GetTrackCount() const { return (uint32_t)m_Tracks.size(); }
+	const char* GetTrackName(uint32_t track) const { return m_Tracks[track].c_str(); }
+	const std::vector<Interval>& GetIntervals() const { return m_Intervals; }
+
+	// Times relative to the first interval. False if the file can't be written.
+	bool WriteChromeTrace(const char* path) const;
+
+private:
+	// The track's intervals merged into disjoint ones, sorted
+	std::vector<std::pair<double, double>> GetBusyRanges(uint32_t track) const;
+
+private:
+	std::vector<std::string> m_Tracks;
+	std::vector<Interval> m_Intervals;
+};
@@ -1,19 +1,45 @@
 #pragma once
 
 #include <wrl.h>
+#include <vector>
 #include "..\Helpers\d3dx12.h"
+#include "ResourceStateTracker.h"
 
 using Microsoft::WRL::ComPtr;
 
-inline void TransitionResource(ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource> resource,
-	D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+// The barrier to the state waits in the tracker - one or all subresources, the tracker knows the
+// state they are in
+inline void TransitionResource(ResourceStateTracker& stateTracker, ComPtr<ID3D12Resource> resource,
+	D3D12_RESOURCE_STATES after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
 {
-	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition
-	(
-		resource.Get(), before, after
-	);
+	stateTracker.Transition(resource.Get(), after, subresource);
+}
+
+// Issues the barriers the tracker collected with one ResourceBarrier call (none if nothing changed),
+// before the commands that use the resources
+inline void FlushBarriers(ResourceStateTracker& stateTracker, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	static thread_local std::vector<ResourceStateTracker::Barrier> barriers;
+	static thread_local std::vector<D3D12_RESOURCE_BARRIER> d3d12Barriers;
+
+	stateTracker.Flush(&barriers);
+	if (barriers.empty())
+		return;
+
+	d3d12Barriers.clear();
+	for (const ResourceStateTracker::Barrier& barrier : barriers)
+	{
+		ID3D12Resource* pResource = static_cast<ID3D12Resource*>(barrier.pResource);
+		if (barrier.type == ResourceStateTracker::BarrierType::Uav)
+			d3d12Barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(pResource));
+		else if (barrier.type == ResourceStateTracker::BarrierType::Aliasing)
+			d3d12Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(static_cast<ID3D12Resource*>(barrier.pResourceBefore), pResource));
+		else
+			d3d12Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource,
+				(D3D12_RESOURCE_STATES)barrier.before, (D3D12_RESOURCE_STATES)barrier.after, barrier.subresource));
+	}
 
-	commandList->ResourceBarrier(1, &barrier);
+	commandList->ResourceBarrier((UINT)d3d12Barriers.size(), d3d12Barriers.data());
 }
 
 inline void ClearRTV(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList,